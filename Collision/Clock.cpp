@@ -0,0 +1,46 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include "Clock.h"
+
+// Constructors
+Clock::Clock()
+  : last_(0), wraps_(0), base_us_(0ULL), asleep_us_(0ULL)
+{}
+
+// Epoch time is epoch_s now.  TimeLib is set too so hour(), minute() and the rest agree.
+void Clock::set(const time_t epoch_s)
+{
+  base_us_ = (unsigned long long)epoch_s * 1000000ULL - up_us();
+  setTime(epoch_s);
+}
+
+// µs since boot
+unsigned long long Clock::up_us()
+{
+  uint32_t now = micros();
+  if ( now < last_ ) wraps_++;
+  last_ = now;
+  return ( ( ( (unsigned long long)wraps_ << 32 ) | now ) + asleep_us_ );
+}
@@ -0,0 +1,59 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#ifndef _CLOCK_H
+#define _CLOCK_H
+
+#include <Arduino.h>
+#include "TimeLib.h"
+
+// The one time source.  micros() is extended to 64 bits by counting its wraps, so every read is O(1)
+// and nothing rolls over:  up_us() is monotonic µs since boot, and epoch time is up time plus an
+// offset fixed by set().  Needs a read at least every 71 minutes to see each wrap; the loop reads it
+// every pass.  Interval timers that only difference micros() or millis(), e.g. flash budgets, keep
+// doing that since those differences are wrap safe.  Standby stops micros(), so whoever sleeps adds
+// the time asleep with slept().
+class Clock
+{
+public:
+  Clock();
+  ~Clock(){};
+  unsigned long long asleep_us() { return ( asleep_us_ ); };
+  unsigned long long ms() { return ( ms(up_us()) ); };           // Epoch ms
+  unsigned long long ms(const unsigned long long up_us) { return ( ( up_us + base_us_ ) / 1000ULL ); };  // of an up_us reading
+  void set(const time_t epoch_s);
+  void slept(const unsigned long long us) { asleep_us_ += us; };
+  unsigned long long up_ms() { return ( up_us() / 1000ULL ); };  // Since boot
+  unsigned long long up_us();
+  unsigned long long us() { return ( up_us() + base_us_ ); };     // Epoch µs
+protected:
+  uint32_t last_;               // micros() at the latest read
+  uint32_t wraps_;              // micros() wraps seen
+  unsigned long long base_us_;  // Epoch µs at boot
+  unsigned long long asleep_us_; // Standby time, which micros() did not count
+};
+
+extern Clock Clk;
+
+#endif
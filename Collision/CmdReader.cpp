@@ -0,0 +1,165 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include "CmdReader.h"
+
+// Argument type and value, one look at each character
+static uint8_t arg_value(const char *s, int32_t *i, float *f)
+{
+  *i = -1;
+  *f = 0.;
+  if ( !*s ) return ( CMD_NONE );
+  boolean neg = *s == '-';
+  if ( neg || *s == '+' ) s++;
+  uint32_t whole = 0;
+  uint8_t digits = 0;
+  float frac = 0.;
+  float place = 1.;
+  boolean point = false;
+  for ( ; *s; s++ )
+  {
+    if ( *s == '.' && !point ) point = true;
+    else if ( *s < '0' || *s > '9' || digits >= 10 ) return ( CMD_NAME );
+    else if ( point )
+    {
+      place *= 0.1;
+      frac += ( *s - '0' ) * place;
+      digits++;
+    }
+    else
+    {
+      uint8_t d = *s - '0';
+      if ( whole > ( 0x7FFFFFFFUL - d ) / 10 ) return ( CMD_NAME );  // past int32_t, before it wraps
+      whole = whole * 10 + d;
+      digits++;
+    }
+  }
+  if ( !digits ) return ( CMD_NAME );
+  *f = ( float(whole) + frac ) * ( neg ? -1. : 1. );
+  if ( point ) return ( CMD_FLOAT );
+  *i = neg ? -int32_t(whole) : int32_t(whole);
+  return ( CMD_INT );
+}
+
+// Constructors
+CmdReader::CmdReader(const CmdEntry *table, const uint8_t n)
+  : table_(table), n_(n), iQ_(0), nQ_(0), len_(0), in_arg_(false), too_long_(false), bad_(0)
+{}
+
+// Close the command being read and queue it
+void CmdReader::end()
+{
+  Cmd *C = &Q_[( iQ_ + nQ_ ) % CMD_QUEUE];
+  if ( too_long_ )
+  {
+    Text.print(C->text); Text.println("... too long");
+    bad_++;
+  }
+  else if ( len_ )
+  {
+    C->type = arg_value(C->arg(), &C->i, &C->f);
+    nQ_++;
+  }
+  len_ = 0;
+  in_arg_ = false;
+  too_long_ = false;
+}
+
+// Take one character.  False when the fifo is full and ch was left for later.  text stays zero
+// terminated after every character so a command is ready the moment it ends.
+boolean CmdReader::put(const char ch)
+{
+  if ( nQ_ >= CMD_QUEUE ) return ( false );
+  Cmd *C = &Q_[( iQ_ + nQ_ ) % CMD_QUEUE];
+  switch ( ch )
+  {
+    case ( ';' ):
+    case ( ',' ):
+    case ( '\n' ):
+    case ( '\r' ):
+    case ( '\0' ):
+      end();
+      return ( true );
+    case ( '\b' ):
+      if ( !len_ ) return ( true );
+      if ( in_arg_ && len_ == C->arg_at ) in_arg_ = false;  // back into the name
+      C->text[--len_] = '\0';
+      if ( !in_arg_ ) C->arg_at = len_;
+      Text.print("\b \b");
+      return ( true );
+    case ( ' ' ):
+    case ( '=' ):
+      if ( len_ && !in_arg_ && !too_long_ )
+      {
+        C->text[len_++] = '\0';
+        C->text[len_] = '\0';
+        C->arg_at = len_;
+        in_arg_ = true;
+      }
+      return ( true );
+  }
+  if ( too_long_ || len_ > CMD_BYTES - 3 )
+  {
+    too_long_ = true;
+    return ( true );
+  }
+  boolean letter = ( ch >= 'a' && ch <= 'z' ) || ( ch >= 'A' && ch <= 'Z' );
+  if ( !in_arg_ && !letter )
+  {
+    C->text[len_++] = '\0';
+    C->arg_at = len_;
+    in_arg_ = true;
+  }
+  C->text[len_++] = ch;
+  C->text[len_] = '\0';
+  if ( !in_arg_ ) C->arg_at = len_;
+  return ( true );
+}
+
+// Take what in has, as far as the fifo allows
+void CmdReader::read(Stream *in)
+{
+  while ( nQ_ < CMD_QUEUE && in->available() ) put((char)in->read());
+}
+
+// Run the oldest waiting command.  False if there was none.
+boolean CmdReader::run(void *ctx)
+{
+  if ( !nQ_ ) return ( false );
+  Cmd *C = &Q_[iQ_];
+  Text.print("cmd: "); Text.print(C->name());
+  if ( C->type != CMD_NONE ) { Text.print(" arg: "); Text.print(C->arg()); }
+  Text.println();
+  uint8_t k = 0;
+  while ( k < n_ && strcmp(table_[k].name, C->name()) ) k++;
+  if ( k < n_ ) table_[k].run(C, ctx);
+  else
+  {
+    Text.print(C->name()); Text.println(" unknown");
+    bad_++;
+  }
+  iQ_ = ( iQ_ + 1 ) % CMD_QUEUE;
+  nQ_--;
+  return ( true );
+}
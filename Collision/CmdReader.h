@@ -0,0 +1,86 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#ifndef _CMD_READER_H
+#define _CMD_READER_H
+
+#include <Arduino.h>
+#include "constants.h"
+#include "TxQueue.h"
+
+// Argument types
+#define CMD_NONE                 0
+#define CMD_INT                  1
+#define CMD_FLOAT                2
+#define CMD_NAME                 3
+
+// One command:  a name of letters, then an argument that starts at the first character that is not a
+// letter, or after a space or '=' when it is a word itself, e.g. "pp3", "UT 1704067196", "tc raw".
+struct Cmd
+{
+  char text[CMD_BYTES];     // name, a zero, then the argument and a zero
+  uint8_t arg_at;           // where the argument starts in text
+  uint8_t type;             // CMD_NONE, CMD_INT, CMD_FLOAT or CMD_NAME
+  int32_t i;                // argument as an integer, -1 unless type is CMD_INT
+  float f;                  // argument as a number, 0 unless CMD_INT or CMD_FLOAT
+  const char *name() { return ( text ); };
+  const char *arg() { return ( text + arg_at ); };
+};
+
+// Handler, found by name in a CmdEntry table
+typedef void (*CmdRun)(Cmd *c, void *ctx);
+struct CmdEntry
+{
+  const char *name;
+  CmdRun run;
+};
+
+// Commands from Serial, split as the bytes arrive.  Commands end at ';', ',', or end of line, so a
+// line may hold several, e.g. "tc raw; td 2; tg".  Spaces and '=' are dropped as before.  Finished
+// commands wait in a fifo and run one per run() so a long script never holds up a loop pass.  When
+// the fifo is full reading stops and the rest waits in the USB buffer.
+class CmdReader
+{
+public:
+  CmdReader(const CmdEntry *table, const uint8_t n);
+  ~CmdReader(){};
+  uint32_t bad() { return ( bad_ ); };
+  boolean put(const char ch);
+  void read(Stream *in);
+  boolean run(void *ctx);
+  uint8_t waiting() { return ( nQ_ ); };
+protected:
+  void end();
+  const CmdEntry *table_;
+  uint8_t n_;               // Entries in table_
+  Cmd Q_[CMD_QUEUE];        // fifo, oldest at iQ_; the one being read follows the last
+  uint8_t iQ_;
+  uint8_t nQ_;
+  uint8_t len_;             // Characters of the one being read
+  boolean in_arg_;          // Past the name
+  boolean too_long_;
+  uint32_t bad_;            // Commands too long or unknown
+};
+
+#endif
@@ -0,0 +1,79 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include "CollCore.h"
+
+// One read frame at up_ms since boot, stamped t_ms epoch.  quiet keeps the register lock and unlock
+// debug off Text.  Returns CORE_STARTED or CORE_STOPPED when logging changed, else 0.
+uint8_t CollCore::step(const boolean reset, const ImuSample *imu, const unsigned long long up_ms, const unsigned long long t_ms,
+  const boolean quiet)
+{
+  TRACE_BEGIN(TRACE_STEP);
+  PROBE_MARK(t);
+  Sen_->take(reset, imu, up_ms, t_ms);
+  Sen_->filter(reset);
+  PROBE_LAP(PROBE_FILTER, t);
+  Sen_->quiet_decisions(reset);
+  PROBE_LAP(PROBE_QUIET, t);
+  L_->put_ram(Sen_);  // continuous; a trigger backdates the register start into what is already here
+  PROBE_LAP(PROBE_PUT_RAM, t);
+  uint8_t changed = trigger(quiet);
+  TRACE_END(TRACE_STEP, changed);
+  return ( changed );
+}
+
+// Logging state machine on the latest quiet decisions.  Returns CORE_STARTED or CORE_STOPPED when
+// logging changed, else 0.
+uint8_t CollCore::trigger(const boolean quiet)
+{
+  if ( Sen_->both_not_quiet() && !logging_ )
+  {
+    logging_ = true;
+    new_event_ = Sen_->t_ms;
+    log_size_++;
+  }
+  else
+  {
+    if ( Sen_->both_are_quiet() && logging_ )
+    {
+      logging_ = false;  // This throws out the last event
+    }
+    log_size_ = 0;
+  }
+
+  // Log data - full resolution since part of 'read' frame
+  uint8_t changed = 0;
+  if ( logging_ && !logging_past_ )
+  {
+    if ( L_ ) L_->register_lock(quiet, Sen_);  // after put_ram so has values on first save
+    changed = CORE_STARTED;
+  }
+  else if ( !logging_ && logging_past_ )
+  {
+    if ( L_ ) L_->register_unlock(quiet, Sen_);
+    changed = CORE_STOPPED;
+  }
+  logging_past_ = logging_;
+  return ( changed );
+}
@@ -0,0 +1,63 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#ifndef _COLL_CORE_H
+#define _COLL_CORE_H
+
+#include "constants.h"
+#include "Sensors.h"
+#include "CollDatum.h"
+#include "Probe.h"
+#include "Trace.h"
+
+// What a step did
+#define CORE_STARTED          0x01      // Logging started; a register is locked and filling
+#define CORE_STOPPED          0x02      // Logging stopped; the register is unlocked and whole
+
+// Trigger and log pipeline for one read frame, free of hardware so host tools can replay recordings
+// through it:  Sensors filtering and quiet decisions, Ram logging, and the logging state machine
+// that locks a register when both signals stop being quiet and unlocks it when both are quiet again.
+// trigger() is the state machine alone, for tools that feed their own quiet decisions; with no
+// Data_st it only tracks logging.
+class CollCore
+{
+public:
+  constexpr CollCore(Sensors *Sen, Data_st *L)
+    : Sen_(Sen), L_(L), logging_(false), logging_past_(false), new_event_(0ULL), log_size_(0) {};
+  ~CollCore(){};
+  boolean logging() { return ( logging_ ); };
+  unsigned long long new_event() { return ( new_event_ ); };
+  uint8_t step(const boolean reset, const ImuSample *imu, const unsigned long long up_ms, const unsigned long long t_ms,
+    const boolean quiet);
+  uint8_t trigger(const boolean quiet);
+protected:
+  Sensors *Sen_;
+  Data_st *L_;
+  boolean logging_;
+  boolean logging_past_;
+  unsigned long long new_event_;  // Sensors t_ms when logging last started
+  uint16_t log_size_;
+};
+
+#endif
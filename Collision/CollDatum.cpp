@@ -43,17 +43,17 @@ void Datum_st::filt_from(Sensors *Sen)
   y_int = int16_t(Sen->y_filt * G_SCL);
   z_int = int16_t(Sen->z_filt * G_SCL);
 }
-void Datum_st::from(Datum_st input)
+void Datum_st::from(Datum_st *input)
 {
-  t_ms = input.t_ms;
-  T_rot_int = input.T_rot_int;
-  a_int = input.a_int;
-  b_int = input.b_int;
-  c_int = input.c_int;
-  T_acc_int = input.T_acc_int;
-  x_int = input.x_int;
-  y_int = input.y_int;
-  z_int = input.z_int;
+  t_ms = input->t_ms;
+  T_rot_int = input->T_rot_int;
+  a_int = input->a_int;
+  b_int = input->b_int;
+  c_int = input->c_int;
+  T_acc_int = input->T_acc_int;
+  x_int = input->x_int;
+  y_int = input->y_int;
+  z_int = input->z_int;
 }
 void Datum_st::raw_from(Sensors *Sen)
 {
@@ -82,57 +82,102 @@ void Datum_st::nominal()
   z_int = int16_t(0);
 }
 
-// Print functions
-void Datum_st::plot(const uint16_t i)
+// Print functions.  Lines are built from the stored integers without float and sent in one write.
+#ifndef SAVE_RAW
+  #define DATUM_KIND "filt"
+#else
+  #define DATUM_KIND "raw"
+#endif
+
+// Two and three digit fields, zero padded
+static inline void put_2(char *p, const uint8_t v) { p[0] = '0' + v / 10; p[1] = '0' + v % 10; }
+static inline void put_3(char *p, const uint16_t v) { p[0] = '0' + v / 100; put_2(p + 1, v % 100); }
+
+// Copy a string, returning the end
+static char *put_str(char *p, const char *s)
 {
-  #ifndef SAVE_RAW
-    Serial.print("T_rot_filt*100:"); Serial.print(float(T_rot_int) * 100. / T_SCL, 3);
-    Serial.print("\ta_filt:"); Serial.print(float(a_int) / O_SCL, 3);
-    Serial.print("\tb_filt:"); Serial.print(float(b_int) / O_SCL, 3);
-    Serial.print("\tc_filt:"); Serial.print(float(c_int) / O_SCL, 3);
-    Serial.print("\tT_acc_filt*100:"); Serial.print(float(T_acc_int) * 100. / T_SCL, 3);
-    Serial.print("\tx_filt:"); Serial.print(float(x_int) / G_SCL, 3);
-    Serial.print("\ty_filt:"); Serial.print(float(y_int) / G_SCL, 3);
-    Serial.print("\tz_filt:"); Serial.println(float(z_int) / G_SCL, 3);
-  #else
-    Serial.print("T_rot_raw*100:"); Serial.print(float(T_rot_int) * 100. / T_SCL, 3);
-    Serial.print("\ta_raw:"); Serial.print(float(a_int) / O_SCL, 3);
-    Serial.print("\tb_raw:"); Serial.print(float(b_int) / O_SCL, 3);
-    Serial.print("\tc_raw:"); Serial.print(float(c_int) / O_SCL, 3);
-    Serial.print("\tT_acc_raw*100:"); Serial.print(float(T_acc_int) * 100. / T_SCL, 3);
-    Serial.print("\tx_raw:"); Serial.print(float(x_int) / G_SCL, 3);
-    Serial.print("\ty_raw:"); Serial.print(float(y_int) / G_SCL, 3);
-    Serial.print("\tz_raw:"); Serial.println(float(z_int) / G_SCL, 3);
-  #endif
+  while ( *s ) *p++ = *s++;
+  return ( p );
 }
 
-void Datum_st::print(const uint16_t i)
+// Unsigned decimal, returning the end
+static char *put_uint(char *p, unsigned long long v)
+{
+  char rev[20];
+  uint8_t n = 0;
+  do { rev[n++] = '0' + v % 10; v /= 10; } while ( v );
+  while ( n ) *p++ = rev[--n];
+  return ( p );
+}
+
+// printFloat(x * mult / scl, 3) of a magnitude whose thousandths land exactly on a half, where it is
+// float error in the old print that decided which way it went.  Done the same way so dumps match.
+static uint32_t tie_thou(const uint32_t mag, const uint32_t scl, const uint32_t mult)
+{
+  double number = mult == 1 ? double(float(mag) / float(scl)) : double(float(mag)) * mult / double(float(scl));
+  double rounding = 0.5;
+  for ( uint8_t i=0; i<3; i++ ) rounding /= 10.0;
+  number += rounding;
+  uint32_t thou = uint32_t(number);
+  double remainder = number - double(thou);
+  for ( uint8_t i=0; i<3; i++ )
+  {
+    remainder *= 10.0;
+    uint8_t digit = uint8_t(remainder);
+    thou = thou * 10 + digit;
+    remainder -= digit;
+  }
+  return ( thou );
+}
+
+// x * mult / scl to 3 decimals, as print(float, 3) does it:  sign, then the magnitude rounded half up
+// but for exact halves, which go as the float print took them (tie_thou).  scl must be whole and
+// 32768 * 1000 * mult must fit in 32 bits.
+static char *put_scaled(char *p, const int16_t x, const uint32_t scl, const uint32_t mult=1)
+{
+  uint32_t mag = x < 0 ? uint32_t(-int32_t(x)) : uint32_t(x);
+  if ( x < 0 ) *p++ = '-';
+  uint32_t num = mag * 1000UL * mult;
+  uint32_t thou = ( num % scl == scl / 2 && !( scl & 1 ) ) ? tie_thou(mag, scl, mult) : ( num + scl / 2 ) / scl;
+  p = put_uint(p, thou / 1000);
+  *p++ = '.';
+  put_3(p, thou % 1000);
+  return ( p + 3 );
+}
+
+void Datum_st::plot(const uint16_t i, Print *out)
+{
+  char buf[TX_LINE_MAX];
+  char *p = put_str(buf, "T_rot_" DATUM_KIND "*100:"); p = put_scaled(p, T_rot_int, uint32_t(T_SCL), 100);
+  p = put_str(p, "\ta_" DATUM_KIND ":"); p = put_scaled(p, a_int, uint32_t(O_SCL));
+  p = put_str(p, "\tb_" DATUM_KIND ":"); p = put_scaled(p, b_int, uint32_t(O_SCL));
+  p = put_str(p, "\tc_" DATUM_KIND ":"); p = put_scaled(p, c_int, uint32_t(O_SCL));
+  p = put_str(p, "\tT_acc_" DATUM_KIND "*100:"); p = put_scaled(p, T_acc_int, uint32_t(T_SCL), 100);
+  p = put_str(p, "\tx_" DATUM_KIND ":"); p = put_scaled(p, x_int, uint32_t(G_SCL));
+  p = put_str(p, "\ty_" DATUM_KIND ":"); p = put_scaled(p, y_int, uint32_t(G_SCL));
+  p = put_str(p, "\tz_" DATUM_KIND ":"); p = put_scaled(p, z_int, uint32_t(G_SCL));
+  p = put_str(p, "\r\n");
+  out->write((const uint8_t *)buf, p - buf);
+}
+
+void Datum_st::print(const uint16_t i, Print *out)
 {
   cSF(prn_buff, INPUT_BYTES, "");
-  prn_buff = "---";
   time_long_2_str(t_ms, prn_buff);
-  Serial.print(i);
-  Serial.print(" "); Serial.print(t_ms);
-  Serial.print(" "); Serial.print(prn_buff);
-  #ifndef SAVE_RAW
-    Serial.print(" T_rot_filt "); Serial.print(float(T_rot_int) / T_SCL, 3);
-    Serial.print(" a_filt "); Serial.print(float(a_int) / O_SCL, 3);
-    Serial.print(" b_filt "); Serial.print(float(b_int) / O_SCL, 3);
-    Serial.print(" c_filt "); Serial.print(float(c_int) / O_SCL, 3);
-    Serial.print(" T_acc_filt "); Serial.print(float(T_acc_int) / T_SCL, 3);
-    Serial.print(" x_filt "); Serial.print(float(x_int) / G_SCL, 3);
-    Serial.print(" y_filt "); Serial.print(float(y_int) / G_SCL, 3);
-    Serial.print(" z_filt "); Serial.println(float(z_int) / G_SCL, 3);
-  #else
-    Serial.print(" T_rot_raw "); Serial.print(float(T_rot_int) / T_SCL, 3);
-    Serial.print(" a_raw "); Serial.print(float(a_int) / O_SCL, 3);
-    Serial.print(" b_raw "); Serial.print(float(b_int) / O_SCL, 3);
-    Serial.print(" c_raw "); Serial.print(float(c_int) / O_SCL, 3);
-    Serial.print(" T_acc_raw "); Serial.print(float(T_acc_int) / T_SCL, 3);
-    Serial.print(" x_raw "); Serial.print(float(x_int) / G_SCL, 3);
-    Serial.print(" y_raw "); Serial.print(float(y_int) / G_SCL, 3);
-    Serial.print(" z_raw "); Serial.println(float(z_int) / G_SCL, 3);
-  #endif
+  char buf[TX_LINE_MAX];
+  char *p = put_uint(buf, i);
+  *p++ = ' '; p = put_uint(p, t_ms);
+  *p++ = ' '; p = put_str(p, prn_buff.c_str());
+  p = put_str(p, " T_rot_" DATUM_KIND " "); p = put_scaled(p, T_rot_int, uint32_t(T_SCL));
+  p = put_str(p, " a_" DATUM_KIND " "); p = put_scaled(p, a_int, uint32_t(O_SCL));
+  p = put_str(p, " b_" DATUM_KIND " "); p = put_scaled(p, b_int, uint32_t(O_SCL));
+  p = put_str(p, " c_" DATUM_KIND " "); p = put_scaled(p, c_int, uint32_t(O_SCL));
+  p = put_str(p, " T_acc_" DATUM_KIND " "); p = put_scaled(p, T_acc_int, uint32_t(T_SCL));
+  p = put_str(p, " x_" DATUM_KIND " "); p = put_scaled(p, x_int, uint32_t(G_SCL));
+  p = put_str(p, " y_" DATUM_KIND " "); p = put_scaled(p, y_int, uint32_t(G_SCL));
+  p = put_str(p, " z_" DATUM_KIND " "); p = put_scaled(p, z_int, uint32_t(G_SCL));
+  p = put_str(p, "\r\n");
+  out->write((const uint8_t *)buf, p - buf);
 }
 
 // nominalize
@@ -140,171 +185,199 @@ void Datum_st::put_nominal()
 {
   Datum_st source;
   source.nominal();
-  from(source);
+  from(&source);
 }
 
 
 //////////////////////////////////////////////////////////
 // struct Data_st data log
 
-// Delete the over-ridden registers except the one we're currently filling
-void Data_st::clear_register_overlap(Register_st *CurrentReg)
+// Delete the register about to be over-ridden, except the one we're currently filling.
+// Registers are locked in the same order their data is written into the Ram ring, so the
+// oldest active register is always the next one the write pointer runs into.  Checking only
+// the head of that fifo makes this O(1) per sample regardless of the number of registers.
+void Data_st::clear_register_overlap()
 {
-  for ( int j=0; j<nRg_; j++ )
-  {
-    if ( CurrentReg == Reg[j] ) continue;
-    if ( (iR_ < (Reg[j]->i + Reg[j]->n-1)) && (iStart_ > Reg[j]->i)  && (iR_ > Reg[j]->i) ) 
-    {
-Serial.print("j="); Serial.print(j); Serial.print(" iStart_="); Serial.print(iStart_); Serial.print(" iR_="); Serial.print(iR_); Serial.print(" Reg[j]->i="); Serial.print(Reg[j]->i); Serial.print(" Reg[j]->n="); Serial.print(Reg[j]->n); Serial.print(" Reg[j]->t_ms="); Serial.print(Reg[j]->t_ms);
-      Serial.println(" nominal");
-      Reg[j]->put_nominal();
-    }
-  }
-  // sort_registers();
+  while ( nAR_ && &Reg[iOldRg_] != CurrentRegPtr_ && Reg[iOldRg_].holds(iR_, nR_) )
+    pop_oldest_register();
 }
 
-// Transfer precursor data to storage
-void Data_st::move_precursor()
+// Retire the head of the register fifo
+void Data_st::pop_oldest_register()
 {
-  uint16_t count = 0;
-  uint16_t j = iP_;
-  while ( count++ < nP_ -1 )
-  {
-    if ( ++j > (nP_-1) ) j = 0;  // circular buffer
-    if ( Precursor[j]->t_ms == 1ULL ) continue;
-    put_ram(Precursor[j]);
-  }
-  nAR_ = min(nAR_+1, NREG);  // This is  not perfect
+  Reg[iOldRg_].put_nominal();
+  if ( ++iOldRg_ > (nRg_-1) ) iOldRg_ = 0;  // circular buffer
+  nAR_--;
 }
 
-void Data_st::plot_latest_ram()
+// Step the Ram write pointer.  While idle the pretrigger band lives in the free space between the
+// newest and oldest registers.  When it runs into the oldest register, rewind it to just after the
+// newest one, carrying the last nP_ samples along so a trigger can always backdate contiguously.
+// That copy happens once per pass through the free space, never at trigger time.  When there is
+// too little free space for that to pay off, the oldest register is given up instead.
+void Data_st::advance_ram()
 {
-  int begin = max(min( Reg[iRg_]->i, nR_-1), 0);
-  int end = max(min(begin + Reg[iRg_]->n/2, nR_-1), 0);  // plot half
-  for ( int i=begin; i<end; i+=2 )
+  if ( ++iR_ > (nR_-1) ) iR_ = 0;  // circular buffer
+  if ( CurrentRegPtr_ || !nAR_ || iR_ != Reg[iOldRg_].i ) return;
+  uint16_t free = ( Reg[iOldRg_].i + nR_ - iEnd_ - 1 ) % nR_;
+  if ( free < 2*nP_ ) return;  // clear_register_overlap retires the oldest
+  uint16_t src = ( Reg[iOldRg_].i + nR_ - nP_ - 1 ) % nR_;
+  uint16_t dst = iEnd_;
+  for ( uint16_t j=0; j<nP_; j++ )
   {
-    if ( i==begin ) for ( int j=0; j<5; j++ ) { Ram[i]->plot(j); delay(16UL); }
-    Ram[i]->plot(i); delay(16UL);
+    if ( ++src > (nR_-1) ) src = 0;
+    if ( ++dst > (nR_-1) ) dst = 0;
+    Ram[dst].from(&Ram[src]);
   }
+  iR_ = dst;
+  if ( ++iR_ > (nR_-1) ) iR_ = 0;
 }
 
+// Play the latest register back to the serial plotter, every sample, one per pace_ms.  The first
+// sample is repeated so the plotter settles its scale before the event.
+void Data_st::plot_latest_ram(const uint16_t pace_ms)
+{
+  plot_i_ = Reg[iRg_].i;
+  plot_n_ = Reg[iRg_].n;
+  Tx.job(&Data, plot_line, this, pace_ms);
+}
+
+// Dumps are queued on Tx and printed a line at a time as the port drains
 void Data_st::print_all_registers()
 {
-  for ( int i=0; i<nRg_; i++ )
-    Reg[i]->print(nR_);
+  Tx.job(&Data, all_registers_line, this);
 }
 
 void Data_st::print_latest_datum()
 {
-  Ram[iR_]->print(iR_);
+  Ram[iR_].print(iR_);
 }
 
 void Data_st::print_latest_register()
 {
-  Reg[iRg_]->print(nR_);
+  Tx.job(&Data, latest_register_line, this);
 }
 
+// Latest register as it stood when asked, following the ring through any wrap
 void Data_st::print_latest_ram()
 {
-  int begin = max(min( Reg[iRg_]->i, nR_-1), 0);
-  int end = max(min(begin + Reg[iRg_]->n, nR_-1), 0);
-  for ( int i=begin; i<end; i++ )
-  {
-    Ram[i]->print(i);
-  }
+  dump_i_ = Reg[iRg_].i;
+  dump_n_ = Reg[iRg_].n;
+  Tx.job(&Data, latest_ram_line, this);
 }
 
-
 void Data_st::print_ram()
 {
-  for (int j = 0; j < nR_; j++)
-  {
-    Ram[j]->print(j);
-  }
+  Tx.job(&Data, ram_line, this);
 }
 
-// Precursor storage
-void Data_st:: put_precursor(Sensors *Sen)
+// Tx line jobs
+boolean Data_st::all_registers_line(Print *out, const uint16_t k, void *ctx)
 {
-  if ( ++iP_ > (nP_-1) ) iP_ = 0;  // circular buffer
-  #ifndef SAVE_RAW
-    Precursor[iP_]->filt_from(Sen);
-  #else
-    Precursor[iP_]->raw_from(Sen);
-  #endif
+  Data_st *L = (Data_st *)ctx;
+  if ( k >= L->nRg_ ) return ( false );
+  L->Reg[k].print(L->nR_, out);
+  return ( true );
 }
 
-void Data_st::put_ram(Sensors *Sen)
+boolean Data_st::latest_ram_line(Print *out, const uint16_t k, void *ctx)
 {
-  if ( ++iR_ > (nR_-1) ) iR_ = 0;  // circular buffer
-  #ifndef SAVE_RAW
-    Ram[iR_]->filt_from(Sen);
-    Reg[iRg_]->o_raw_max = max(Reg[iRg_]->o_raw_max, Sen->o_raw);
-    Reg[iRg_]->g_raw_max = max(Reg[iRg_]->g_raw_max, Sen->g_raw);
-    Reg[iRg_]->o_filt_max = max(Reg[iRg_]->o_filt_max, Sen->o_filt);
-    Reg[iRg_]->g_filt_max = max(Reg[iRg_]->g_filt_max, Sen->g_filt);
-  #else
-    Ram[iR_]->raw_from(Sen);
-  #endif
-  clear_register_overlap(CurrentRegPtr_);
+  Data_st *L = (Data_st *)ctx;
+  if ( k >= L->dump_n_ ) return ( false );
+  uint16_t j = ( L->dump_i_ + k ) % L->nR_;
+  L->Ram[j].print(j, out);
+  return ( true );
 }
 
-void Data_st::put_ram(Datum_st *point)
+boolean Data_st::latest_register_line(Print *out, const uint16_t k, void *ctx)
 {
-  if ( ++iR_ > (nR_-1) ) iR_ = 0;  // circular buffer
+  Data_st *L = (Data_st *)ctx;
+  if ( k ) return ( false );
+  L->Reg[L->iRg_].print(L->nR_, out);
+  return ( true );
+}
+
+boolean Data_st::plot_line(Print *out, const uint16_t k, void *ctx)
+{
+  Data_st *L = (Data_st *)ctx;
+  if ( k >= L->plot_n_ + 5 ) return ( false );
+  uint16_t j = ( L->plot_i_ + ( k < 5 ? 0 : k - 5 ) ) % L->nR_;
+  L->Ram[j].plot(j, out);
+  return ( true );
+}
+
+boolean Data_st::ram_line(Print *out, const uint16_t k, void *ctx)
+{
+  Data_st *L = (Data_st *)ctx;
+  if ( k >= L->nR_ ) return ( false );
+  L->Ram[k].print(k, out);
+  return ( true );
+}
+
+// Called every sample, logging or not
+void Data_st::put_ram(Sensors *Sen)
+{
+  advance_ram();
   #ifndef SAVE_RAW
-    Ram[iR_]->from(*point);
+    Ram[iR_].filt_from(Sen);
   #else
-    Ram[iR_]->from(*point);
+    Ram[iR_].raw_from(Sen);
   #endif
-  clear_register_overlap(CurrentRegPtr_);
+  if ( CurrentRegPtr_ )  // peaks drive severity whichever way samples are saved
+  {
+    CurrentRegPtr_->o_raw_max = max(CurrentRegPtr_->o_raw_max, Sen->o_raw);
+    CurrentRegPtr_->g_raw_max = max(CurrentRegPtr_->g_raw_max, Sen->g_raw);
+    CurrentRegPtr_->o_filt_max = max(CurrentRegPtr_->o_filt_max, Sen->o_filt);
+    CurrentRegPtr_->g_filt_max = max(CurrentRegPtr_->g_filt_max, Sen->g_filt);
+  }
+  clear_register_overlap();
 }
 
-// Enter information about last data set into register
+// Enter information about last data set into register.  Called after put_ram of the trigger sample;
+// the start is backdated nP_ samples so the pretrigger already in Ram becomes part of the event, but
+// never past the end of the newest register, so a quick second event doesn't share its samples.
 void Data_st::register_lock(const boolean quiet, Sensors *Sen)
 {
   iRg_++;
   if ( iRg_ > (nRg_-1) ) iRg_ = 0;  // circular buffer
-  iStart_ = iR_;
-  if ( iStart_ > (nR_-1) ) iStart_ = 0;  // circular buffer
-  if ( !quiet ) { Serial.print(" lock: iRg_="); Serial.print(iRg_); Serial.print(" iStart_="); Serial.println(iStart_); }
-  Reg[iRg_]->locked = true;
-  Reg[iRg_]->i = iStart_;
-  CurrentRegPtr_ = Reg[iRg_];
-  Reg[iRg_]->o_raw_max = 0;
-  Reg[iRg_]->o_filt_max = 0;
-  Reg[iRg_]->g_raw_max = 0;
-  Reg[iRg_]->g_filt_max = 0;
+  if ( nAR_ >= nRg_ ) pop_oldest_register();  // fifo full so iRg_ is the oldest; reuse it
+  boolean after = nAR_ > 0;  // the newest register is whole and ends at iEnd_
+  if ( !nAR_ ) iOldRg_ = iRg_;
+  nAR_++;
+  iStart_ = ( iR_ + nR_ - nP_ ) % nR_;
+  if ( after && ( iR_ + nR_ - iEnd_ ) % nR_ <= nP_ ) iStart_ = ( iEnd_ + 1 ) % nR_;
+  for ( uint16_t j=0; j<nP_ && Ram[iStart_].t_ms == 1ULL; j++ )  // not yet filled after boot
+    if ( ++iStart_ > (nR_-1) ) iStart_ = 0;
+  if ( !quiet ) { Text.print(" lock: iRg_="); Text.print(iRg_); Text.print(" iStart_="); Text.println(iStart_); }
+  Reg[iRg_].locked = true;
+  Reg[iRg_].i = iStart_;
+  Reg[iRg_].n = 0;
+  CurrentRegPtr_ = &Reg[iRg_];
+  Reg[iRg_].o_raw_max = Sen->o_raw;
+  Reg[iRg_].o_filt_max = Sen->o_filt;
+  Reg[iRg_].g_raw_max = Sen->g_raw;
+  Reg[iRg_].g_filt_max = Sen->g_filt;
 }
 void Data_st::register_unlock(const boolean quiet, Sensors *Sen)
 {
-  Reg[iRg_]->t_ms = Ram[iStart_]->t_ms;
-  boolean reg_wrapped = false;
-  if ( Reg[iRg_]->i < iR_ )
+  Reg[iRg_].t_ms = Ram[iStart_].t_ms;
+  if ( Reg[iRg_].i < iR_ )
   {
-    Reg[iRg_]->n = iR_ - Reg[iRg_]->i;
+    Reg[iRg_].n = iR_ - Reg[iRg_].i;
   }
   else
   {
-    Reg[iRg_]->n = nR_ - (Reg[iRg_]->i - iR_);
-    reg_wrapped = true;
-  }
-  if ( reg_wrapped )
-  {
-    uint16_t j = 0;
-    while ( ( Reg[j]->i < iR_ ) && ( j < nRg_ ) )
-    {
-      Reg[j]->put_nominal();
-      j++;
-    }
+    Reg[iRg_].n = nR_ - (Reg[iRg_].i - iR_);  // wrapped; older registers already retired by clear_register_overlap
   }
-  Reg[iRg_]->locked = false;
+  Reg[iRg_].locked = false;
+  CurrentRegPtr_ = NULL;
+  iEnd_ = ( iR_ + nR_ - 1 ) % nR_;  // iR_ holds the unlock sample, which isn't part of it
   if ( !quiet )
   {
-    Serial.print("unlock: iRg_="); Serial.print(iRg_);
-    Serial.print(" iR_="); Serial.print(iR_); 
-    Serial.print(" Reg[iRg_]->i="); Serial.print(Reg[iRg_]->i);
-    Serial.print(" n="); Serial.println(Reg[iRg_]->n);
+    Text.print("unlock: iRg_="); Text.print(iRg_);
+    Text.print(" iR_="); Text.print(iR_); 
+    Text.print(" Reg[iRg_].i="); Text.print(Reg[iRg_].i);
+    Text.print(" n="); Text.println(Reg[iRg_].n);
   }
 }
 
@@ -313,43 +386,63 @@ void Data_st::reset(const boolean reset)
 {
   if ( reset )
   {
-    iP_ = 0;
-    for ( int j=0; j<nP_; j++ ) Precursor[j]->put_nominal();
     iR_ = 0;
-    for ( int j=0; j<nR_; j++ ) Ram[j]->put_nominal();
+    for ( int j=0; j<nR_; j++ ) Ram[j].put_nominal();
   }
 }
 
 // Sort registers
 void Data_st::sort_registers()
 {
-  Serial.println("TODO: sort registers");
+  Text.println("TODO: sort registers");
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-// For summary prints
+// For summary prints.  "YYYY-MM-DDTHH:" is rendered once per hour and cached; only minutes,
+// seconds and ms are redone per call.
 void time_long_2_str(const unsigned long long _time_ms, SafeString &return_str)
 {
-    int thou_ = _time_ms % 1000;
-    time_t time = _time_ms / 1000;
-    char tempStr[36];
-    #ifndef USE_ARDUINO
-      uint32_t year_ = Time.year(time);
-      uint8_t month_ = Time.month(time);
-      uint8_t day_ = Time.day(time);
-      uint8_t hours_ = Time.hour(time);
-      uint8_t minutes_   = Time.minute(time);
-      uint8_t seconds_   = Time.second(time);
-    #else
-      uint32_t year_ = year(time);
-      uint8_t month_ = month(time);
-      uint8_t day_ = day(time);
-      uint8_t hours_ = hour(time);
-      uint8_t minutes_   = minute(time);
-      uint8_t seconds_   = second(time);
-    #endif
-    sprintf(tempStr, "%4u-%02u-%02uT%02u:%02u:%02u.%03d", int(year_), month_, day_, hours_, minutes_, seconds_, thou_);
+    static unsigned long long prefix_hour = ~0ULL;
+    static char prefix[15];
+    uint16_t thou_ = _time_ms % 1000;
+    unsigned long long time = _time_ms / 1000;
+    unsigned long long hour_start = time - time % 3600;
+    if ( hour_start != prefix_hour )
+    {
+      #ifndef USE_ARDUINO
+        uint32_t year_ = Time.year(hour_start);
+        uint8_t month_ = Time.month(hour_start);
+        uint8_t day_ = Time.day(hour_start);
+        uint8_t hours_ = Time.hour(hour_start);
+      #else
+        tmElements_t tm;
+        breakTime64(hour_start, tm);  // past 2038
+        uint32_t year_ = tmYearToCalendar(tm.Year);
+        uint8_t month_ = tm.Month;
+        uint8_t day_ = tm.Day;
+        uint8_t hours_ = tm.Hour;
+      #endif
+      put_2(prefix, year_ / 100);
+      put_2(prefix + 2, year_ % 100);
+      prefix[4] = '-';
+      put_2(prefix + 5, month_);
+      prefix[7] = '-';
+      put_2(prefix + 8, day_);
+      prefix[10] = 'T';
+      put_2(prefix + 11, hours_);
+      prefix[13] = ':';
+      prefix[14] = '\0';
+      prefix_hour = hour_start;
+    }
+    uint16_t in_hour = time - hour_start;
+    char tempStr[24];
+    memcpy(tempStr, prefix, 14);
+    put_2(tempStr + 14, in_hour / 60);
+    tempStr[16] = ':';
+    put_2(tempStr + 17, in_hour % 60);
+    tempStr[19] = '.';
+    put_3(tempStr + 20, thou_);
+    tempStr[23] = '\0';
     return_str = tempStr;
 }
-
@@ -28,6 +28,7 @@
 #include "constants.h"
 #include "Sensors.h"
 #include "TimeLib.h"
+#include "TxQueue.h"
 
 #ifdef USE_ARDUINO
   #include <Arduino.h> //needed for Serial.println
@@ -58,10 +59,10 @@ struct Datum_st
 
   void get() {};
   void nominal();
-  void plot(const uint16_t i);
-  void print(const uint16_t i);
+  void plot(const uint16_t i, Print *out=&Data);
+  void print(const uint16_t i, Print *out=&Data);
   void filt_from(Sensors *Sen);
-  void from(Datum_st input);
+  void from(Datum_st *input);
   void put_nominal();
   void raw_from(Sensors *Sen);
 };
@@ -82,20 +83,30 @@ public:
 
   boolean is_empty() { if (t_ms) return(false); else return(true); };
 
+  // Severity, worse of peak g and peak rotation as a fraction of full scale x1000
+  uint16_t severity() { return uint16_t( max(g_raw_max / G_MAX, o_raw_max / W_MAX) * 1000. ); };
+
+  // True when ring slot j of an nR long ring falls inside this register
+  boolean holds(const uint16_t j, const uint16_t nR)
+  {
+    if ( j >= i ) return ( j - i < n );
+    else return ( j + nR - i < n );
+  };
+
   // Print function
-  void print(uint16_t nR)
+  void print(uint16_t nR, Print *out=&Data)
   {
-    Serial.print("Reg: t_ms:"); Serial.print(t_ms);
-    Serial.print(" i:"); Serial.print(i);
+    out->print("Reg: t_ms:"); out->print(t_ms);
+    out->print(" i:"); out->print(i);
     uint16_t end = i + n - 1;
     if ( end > nR - 1 ) end -= nR;
-    Serial.print(" - "); Serial.print(end);
-    Serial.print(" n: "); Serial.print(n);
-    Serial.print(" o_raw_max:"); Serial.print(o_raw_max);
-    Serial.print(" o_filt_max:"); Serial.print(o_filt_max);
-    Serial.print(" g_raw_max:"); Serial.print(g_raw_max);
-    Serial.print(" g_filt_max:"); Serial.print(g_filt_max);
-    Serial.println();
+    out->print(" - "); out->print(end);
+    out->print(" n: "); out->print(n);
+    out->print(" o_raw_max:"); out->print(o_raw_max);
+    out->print(" o_filt_max:"); out->print(o_filt_max);
+    out->print(" g_raw_max:"); out->print(g_raw_max);
+    out->print(" g_filt_max:"); out->print(g_filt_max);
+    out->println();
   }
   
   void put_nominal() { i = 0; n = 0; t_ms = 0ULL; locked = false; o_raw_max = 0; g_raw_max = 0; o_filt_max = 0; g_filt_max = 0; };
@@ -106,65 +117,59 @@ public:
 class Data_st
 {
 public:
-  Data_st() : iR_(0), nR_(0), iP_(0), nP_(0), iRg_(0), iStart_(0), nRg_(0), nAR_(0) {};
-  Data_st(uint16_t ram_datums, uint16_t pre_datums, uint16_t reg_registers) :
-   iR_(ram_datums), nR_(ram_datums),
-   iP_(pre_datums), nP_(pre_datums),
-   iRg_(reg_registers), nRg_(reg_registers),
-   nAR_(0)
+  Data_st() : Ram(NULL), Reg(NULL), CurrentRegPtr_(NULL), iR_(0), iRg_(0), iStart_(0), iEnd_(0), nR_(0), nP_(0), nRg_(0), iOldRg_(0), nAR_(0), dump_i_(0), dump_n_(0), plot_i_(0), plot_n_(0) {};
+  // Storage is the caller's, statically allocated so the link map shows what capture costs
+  Data_st(Datum_st *ram, const uint16_t ram_datums, const uint16_t pre_datums, Register_st *reg, const uint16_t reg_registers) :
+   Ram(ram), Reg(reg), CurrentRegPtr_(NULL),
+   iR_(ram_datums), iRg_(reg_registers), iStart_(0), iEnd_(0),
+   nR_(ram_datums), nP_(pre_datums), nRg_(reg_registers),
+   iOldRg_(0), nAR_(0), dump_i_(0), dump_n_(0), plot_i_(0), plot_n_(0)
   {
-    int j;
-    Precursor = new Datum_st*[nP_];
-    for (j=0; j<nP_; j++)
-    {
-      Precursor[j] = new Datum_st();
-      Precursor[j]->nominal();
-    }
-    Ram = new Datum_st*[nR_];
-    for (j=0; j<nR_; j++)
-    {
-      Ram[j] = new Datum_st();
-      Ram[j]->nominal();
-    }
-    Reg = new Register_st*[nRg_];
-    for (j=0; j<nRg_; j++)
-    {
-      Reg[j] = new Register_st();
-      Reg[j]->put_nominal();
-    }
-    Serial.print("Size of Data_st: "); Serial.println(size());
+    for ( uint16_t j=0; j<nR_; j++ ) Ram[j].nominal();
+    for ( uint16_t j=0; j<nRg_; j++ ) Reg[j].put_nominal();
+    Text.print("Size of Data_st: "); Text.println(size());
   };
-  ~Data_st();
-  void clear_register_overlap(Register_st *CurrentReg);
+  Datum_st *datum(const uint16_t j) { return &Ram[j]; };
+  void clear_register_overlap();
   void get();
   uint16_t iR(){ return iR_; };
   uint16_t iRg(){ return iRg_; };
   uint16_t nR(){ return nR_; };
-  void move_precursor();
+  uint16_t nRg(){ return nRg_; };
   int num_active_registers(){ return int(nAR_); };
-  void plot_latest_ram();
+  void plot_latest_ram(const uint16_t pace_ms);
   void print_latest_datum();
   void print_latest_ram();
   void print_all_registers();
   void print_latest_register();
   void print_ram();
-  void put_precursor(Sensors *Sen);
-  // void from(Datum_st input);
   void put_ram(Sensors *Sen);
-  void put_ram(Datum_st *point);
   void register_lock(const boolean quiet, Sensors *Sen);
   void register_unlock(const boolean quiet, Sensors *Sen);
+  Register_st *reg(const uint16_t j) { return &Reg[j]; };
   void reset(const boolean reset);
   int size(){ return nR_ * sizeof(Datum_st); };
   void sort_registers();
 
 protected:
-  Datum_st **Precursor; // Precursor storage
-  Datum_st **Ram;       // Ram storage
-  Register_st **Reg, *CurrentRegPtr_;    // Register for Ram
-  uint16_t iR_, iP_, iRg_, iStart_;
+  Datum_st *Ram;        // Ram storage, written every sample; pretrigger is backdated out of it
+  Register_st *Reg, *CurrentRegPtr_;      // Register for Ram
+  uint16_t iR_, iRg_, iStart_;
+  uint16_t iEnd_;       // Last Ram slot of the newest unlocked register
   uint16_t nR_, nP_, nRg_;
-  uint8_t nAR_;
+  uint16_t iOldRg_;     // Oldest active register, head of the ring-ordered register fifo
+  uint8_t nAR_;         // Number of active registers in the fifo, including the one being filled
+  uint16_t dump_i_;      // Register being dumped by print_latest_ram
+  uint16_t dump_n_;
+  uint16_t plot_i_;      // Register being played back by plot_latest_ram
+  uint16_t plot_n_;
+  void advance_ram();
+  static boolean all_registers_line(Print *out, const uint16_t k, void *ctx);
+  static boolean latest_ram_line(Print *out, const uint16_t k, void *ctx);
+  static boolean latest_register_line(Print *out, const uint16_t k, void *ctx);
+  static boolean plot_line(Print *out, const uint16_t k, void *ctx);
+  void pop_oldest_register();
+  static boolean ram_line(Print *out, const uint16_t k, void *ctx);
 };
 
 
@@ -0,0 +1,336 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Layouts and codecs shared by the firmware and host tools.  Plain C++, no Arduino dependencies,
+// so host programs can include this file directly.
+
+#ifndef _COLL_FORMAT_H
+#define _COLL_FORMAT_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Sample scaling.  Datum_st and StoreSample hold T_rot and T_acc in s, a, b, c in rps and x, y, z in
+// g's, as int16 = value * scale.
+#define G_MAX                  20.      // Max G value, g's (20.)
+#define W_MAX                  20.      // Max rotational value, rps (20.)
+#define T_MAX                 0.02      // Max expected update time, s (0.02)
+const float O_SCL = (16000./W_MAX);     // Rotational int16_t scale factor
+const float G_SCL = (16000./G_MAX);     // Acceleration int16_t scale factor
+const float T_SCL = (32000./T_MAX);     // Update time int16_t scale factor
+
+#define STORE_MAGIC         0xC011      // Flash log record marker
+#define STORE_VERSION            1      // Flash log record layout version
+#define STORE_CHANNELS           8      // int16 channels per sample, in Datum_st order
+#define STORE_SAMPLE_MAX        34      // Worst case encoded sample, bytes (10 t_ms + 8*3)
+
+// Flash log record header.  The payload follows immediately, then seq again as a trailer programmed
+// last, so a record cut short never checks out on a crc that happens to match, and the record is
+// padded to a page.  The trailer is flash only; len and what is sent end with the payload.
+// crc is crc16 of the payload continued over this header with crc=0.
+struct StoreHeader
+{
+  uint16_t magic;
+  uint16_t crc;
+  uint32_t seq;         // Commit sequence number, monotonic over the life of the log
+  uint64_t t_ms;        // Time of first sample, ms since epoch
+  uint16_t n;           // Number of samples
+  uint16_t len;         // Payload bytes
+  uint16_t severity;    // Register_st::severity() at commit
+  uint8_t version;
+  uint8_t flags;        // STORE_RAW when samples are raw, else filtered
+  float o_raw_max;      // Register_st metadata
+  float g_raw_max;
+  float o_filt_max;
+  float g_filt_max;
+};
+#define STORE_RAW             0x01
+#define STORE_PLAIN           0x02      // Payload is n StoreSample as is, not run through the codec
+
+// Flash a record of len payload bytes takes, trailer included, before padding
+inline uint32_t store_bytes(const uint16_t len) { return ( sizeof(StoreHeader) + len + sizeof(uint32_t) ); }
+
+// Flash event index, a journal over a ring of pages.  An item is a header, count entries and gen
+// again as a trailer, programmed last, so an item cut short never checks out.  A whole item holds the
+// table sorted by severity, worst first; after it every commit appends a one page delta with the
+// entry it added.  crc is crc16 of the entries continued over the header with crc=0.  The whole item
+// with the highest gen that checks out is current, and the deltas that follow it in gen order.
+#define INDEX_MAGIC         0x1D3C      // Flash index item marker
+#define INDEX_VERSION            2      // Flash index layout version
+#define INDEX_WHOLE           0x01      // Item holds the whole table
+struct IndexHeader
+{
+  uint16_t magic;
+  uint16_t crc;
+  uint32_t gen;         // Incremented every write
+  uint32_t head;        // CollStore head when written
+  uint32_t seq;         // CollStore next sequence number when written
+  uint8_t version;
+  uint8_t count;
+  uint8_t flags;        // INDEX_WHOLE, else a delta of at most one entry
+  uint8_t spare;
+};
+
+// One event in the index
+struct IndexEntry
+{
+  uint64_t t_ms;        // Time of first sample, ms since epoch
+  uint32_t off;         // Byte offset of the record in the log
+  uint32_t seq;
+  uint16_t n;           // Duration, samples
+  uint16_t severity;
+  int16_t g_max;        // Peak raw g x G_SCL
+  int16_t o_max;        // Peak raw rotation x O_SCL
+};
+
+// One decoded sample:  T_rot, a, b, c, T_acc, x, y, z as stored in Datum_st
+struct StoreSample
+{
+  uint64_t t_ms;
+  int16_t v[STORE_CHANNELS];
+};
+
+// Download link.  A packet is a LinkHead, up to LINK_PAYLOAD bytes of the object being sent, then
+// crc16 of both (little endian), COBS encoded and set between zero bytes so any text printed
+// between packets falls out as a frame of its own and is dropped.  The object is a log record,
+// header and payload, as it would sit in flash.  off is where the payload sits in the object, so a
+// receiver can ask to resume at the first byte it is missing.  LINK_END carries the object size in
+// off and no payload.  LINK_ERR means the source went away and the download is over.
+#define LINK_PAYLOAD            48      // Object bytes per packet
+#define LINK_DATA              'D'
+#define LINK_END               'E'
+#define LINK_ERR               'X'
+struct LinkHead
+{
+  uint8_t type;
+  uint8_t id;           // Download number, changes with every new download
+  uint16_t seq;         // Packet number within the download, counts resumes too
+  uint32_t off;
+};
+#define LINK_RAW_MAX   ( sizeof(LinkHead) + LINK_PAYLOAD + 2 )
+#define LINK_FRAME_MAX ( LINK_RAW_MAX + LINK_RAW_MAX/254 + 3 )  // with COBS overhead and delimiters
+
+// Telemetry stream.  Selected Sensors channels every decim'th sample, framed like the download
+// link (crc16, COBS, zero delimiters) so both can share the port.  A TelemHead goes out at the
+// start, on every change and every TELEM_HEAD_EVERY frames, carrying the channel mask, the time
+// base and the scale of each channel kind.  Each data frame is a TelemData followed by one int16
+// per set mask bit in channel order, value = int16 / scale[kind].  seq counts every frame due, sent
+// or not, so a receiver sees gaps where the port was full.
+#define TELEM_HEAD             'H'
+#define TELEM_DATA             'T'
+#define TELEM_HEAD_EVERY       100      // Data frames between repeated headers
+#define TELEM_CHANNELS          23
+enum TelemKind { TELEM_ROT, TELEM_ACC, TELEM_TIME, TELEM_BITS, TELEM_KINDS };
+struct TelemChannel
+{
+  const char *name;
+  uint8_t kind;
+};
+static const TelemChannel telem_channels[TELEM_CHANNELS] = {
+  {"T_rot", TELEM_TIME}, {"T_acc", TELEM_TIME},
+  {"a_raw", TELEM_ROT}, {"b_raw", TELEM_ROT}, {"c_raw", TELEM_ROT}, {"o_raw", TELEM_ROT},
+  {"x_raw", TELEM_ACC}, {"y_raw", TELEM_ACC}, {"z_raw", TELEM_ACC}, {"g_raw", TELEM_ACC},
+  {"a_filt", TELEM_ROT}, {"b_filt", TELEM_ROT}, {"c_filt", TELEM_ROT}, {"o_filt", TELEM_ROT},
+  {"x_filt", TELEM_ACC}, {"y_filt", TELEM_ACC}, {"z_filt", TELEM_ACC}, {"g_filt", TELEM_ACC},
+  {"o_qrate", TELEM_ROT}, {"o_quiet", TELEM_ROT}, {"g_qrate", TELEM_ACC}, {"g_quiet", TELEM_ACC},
+  {"quiet", TELEM_BITS},  // o_is_quiet, o_is_quiet_sure, g_is_quiet, g_is_quiet_sure in bits 0-3
+};
+struct TelemHead
+{
+  uint8_t type;
+  uint8_t decim;        // Samples per frame
+  uint16_t seq;         // seq of the next data frame
+  uint32_t mask;        // Bit c selects telem_channels[c]
+  uint64_t t_ms;        // Time base, ms since epoch
+  float scale[TELEM_KINDS];
+};
+struct TelemData
+{
+  uint8_t type;
+  uint8_t n;            // int16 values that follow
+  uint16_t seq;
+  uint32_t dt_ms;       // Sample time less the header t_ms
+};
+#define TELEM_RAW_MAX   ( sizeof(TelemData) + 2*TELEM_CHANNELS + 2 )  // a full data frame, more than a header
+#define TELEM_FRAME_MAX ( TELEM_RAW_MAX + TELEM_RAW_MAX/254 + 3 )
+
+// Trace dump.  The ram ring of trace events (Trace.h) goes out oldest first, framed like the
+// download link:  a TraceHead, then TraceData frames each followed by n TraceEvent.  us is micros()
+// on the board, wrapping every 71 minutes; the head pairs the us and epoch ms of the dump so a
+// reader can place the events in time.  ph is the Chrome trace phase:  'B' and 'E' open and close a
+// span, 'i' marks an instant and 'C' sets a counter, each with value.
+#define TRACE_HEAD             'R'
+#define TRACE_DATA             'V'
+#define TRACE_PER_FRAME         12      // Events per data frame
+enum TraceId
+{
+  TRACE_READ,       // Read frame, span
+  TRACE_SAMPLE,     // IMU read, span
+  TRACE_STEP,       // CollCore step, span; value 1 logging started, 2 stopped
+  TRACE_FLASH,      // Store, Snap and Writer runs, span
+  TRACE_PUBLISH,    // Monitor and plot output, span
+  TRACE_SHED,       // LoadShed level, counter
+  TRACE_STAMP,      // Sample stamp t_ms mod 1000, counter
+  TRACE_IDS
+};
+static const char *const trace_names[TRACE_IDS] = {"read", "sample", "step", "flash", "publish", "shed", "stamp"};
+struct TraceEvent
+{
+  uint32_t us;
+  uint8_t id;
+  uint8_t ph;
+  int16_t value;
+};
+struct TraceHead
+{
+  uint8_t type;
+  uint8_t spare;
+  uint16_t n;           // Events that follow
+  uint32_t lost;        // Events overwritten before the dump, or not kept while it ran
+  uint32_t us;          // micros() at the dump
+  uint64_t t_ms;        // and the epoch ms then
+};
+struct TraceData
+{
+  uint8_t type;
+  uint8_t n;            // TraceEvent that follow
+  uint16_t seq;         // Data frame number within the dump
+};
+#define TRACE_RAW_MAX   ( sizeof(TraceData) + TRACE_PER_FRAME*sizeof(TraceEvent) + 2 )
+#define TRACE_FRAME_MAX ( TRACE_RAW_MAX + TRACE_RAW_MAX/254 + 3 )
+
+// COBS:  rewrite n bytes with no zeros, returning the encoded length without the trailing delimiter
+inline uint16_t cobs_encode(const uint8_t *in, const uint16_t n, uint8_t *out)
+{
+  uint16_t code_at = 0;
+  uint16_t k = 1;
+  uint8_t code = 1;
+  for ( uint16_t i=0; i<n; i++ )
+  {
+    if ( in[i] )
+    {
+      out[k++] = in[i];
+      code++;
+    }
+    if ( !in[i] || code == 0xFF )
+    {
+      out[code_at] = code;
+      code = 1;
+      code_at = k++;
+    }
+  }
+  out[code_at] = code;
+  return ( k );
+}
+
+// Returns the decoded length, 0 if malformed
+inline uint16_t cobs_decode(const uint8_t *in, const uint16_t n, uint8_t *out)
+{
+  uint16_t i = 0;
+  uint16_t k = 0;
+  while ( i < n )
+  {
+    uint8_t code = in[i++];
+    if ( !code || i + code - 1 > n ) return ( 0 );
+    for ( uint8_t j=1; j<code; j++ )
+    {
+      if ( !in[i] ) return ( 0 );
+      out[k++] = in[i++];
+    }
+    if ( code < 0xFF && i < n ) out[k++] = 0;
+  }
+  return ( k );
+}
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), a nibble at a time from a 16 entry table
+inline uint16_t crc16_update(uint16_t crc, const void *data, uint32_t len)
+{
+  static const uint16_t table[16] = { 0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+                                      0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF };
+  const uint8_t *p = (const uint8_t *)data;
+  while ( len-- )
+  {
+    uint8_t b = *p++;
+    crc = uint16_t( (crc << 4) ^ table[(crc >> 12) ^ (b >> 4)] );
+    crc = uint16_t( (crc << 4) ^ table[(crc >> 12) ^ (b & 0x0F)] );
+  }
+  return ( crc );
+}
+
+inline uint32_t zigzag(const int32_t v) { return ( (uint32_t(v) << 1) ^ uint32_t(v >> 31) ); }
+inline int32_t unzigzag(const uint32_t u) { return ( int32_t(u >> 1) ^ -int32_t(u & 1) ); }
+
+// LEB128 varint; returns bytes written
+inline uint8_t varint_put(uint64_t v, uint8_t *out)
+{
+  uint8_t k = 0;
+  while ( v >= 0x80 )
+  {
+    out[k++] = uint8_t(v) | 0x80;
+    v >>= 7;
+  }
+  out[k++] = uint8_t(v);
+  return ( k );
+}
+
+// Returns false on a truncated or overlong varint
+inline bool varint_get(const uint8_t **p, const uint8_t *end, uint64_t *v)
+{
+  uint64_t r = 0;
+  for ( uint8_t shift=0; shift<64 && *p<end; shift+=7 )
+  {
+    uint8_t b = *(*p)++;
+    r |= uint64_t(b & 0x7F) << shift;
+    if ( !(b & 0x80) )
+    {
+      *v = r;
+      return ( true );
+    }
+  }
+  return ( false );
+}
+
+// Sample codec:  time delta then zigzag deltas of every channel against the previous sample.
+// Start both sides with prev.t_ms = header t_ms and prev.v all zero.
+inline uint8_t store_encode(StoreSample *prev, const StoreSample *s, uint8_t *out)
+{
+  uint8_t k = varint_put(s->t_ms - prev->t_ms, out);
+  for ( uint8_t c=0; c<STORE_CHANNELS; c++ )
+    k += varint_put(zigzag(int32_t(s->v[c]) - int32_t(prev->v[c])), out + k);
+  *prev = *s;
+  return ( k );
+}
+
+inline bool store_decode(StoreSample *prev, const uint8_t **p, const uint8_t *end)
+{
+  uint64_t u;
+  if ( !varint_get(p, end, &u) ) return ( false );
+  prev->t_ms += u;
+  for ( uint8_t c=0; c<STORE_CHANNELS; c++ )
+  {
+    if ( !varint_get(p, end, &u) ) return ( false );
+    prev->v[c] = int16_t( int32_t(prev->v[c]) + unzigzag(uint32_t(u)) );
+  }
+  return ( true );
+}
+
+#endif
@@ -0,0 +1,168 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "CollLink.h"
+
+// Constructors
+CollLink::CollLink(CollStore *Store)
+  : Store_(Store), src_(NONE), id_(0), seq_(0), off_(0), size_(0), ended_(false), sent_(0), rec_(NULL), rec_seq_(0),
+  L_(NULL), iReg_(0)
+{}
+
+// Drop the download
+void CollLink::abort()
+{
+  src_ = NONE;
+}
+
+// Source still holds what the download started with
+boolean CollLink::intact()
+{
+  if ( src_ == STORED ) return ( ((const StoreHeader *)rec_)->magic == STORE_MAGIC && ((const StoreHeader *)rec_)->seq == rec_seq_ );
+  Register_st *R = L_->reg(iReg_);
+  return ( R->t_ms == Reg_.t_ms && R->i == Reg_.i && !R->locked );
+}
+
+// n object bytes from off
+void CollLink::read(const uint32_t off, uint8_t *buf, const uint16_t n)
+{
+  if ( src_ == STORED )
+  {
+    memcpy(buf, rec_ + off, n);
+    return;
+  }
+  uint32_t k = off;
+  uint16_t done = 0;
+  while ( done < n && k < sizeof(StoreHeader) ) buf[done++] = ((const uint8_t *)&Hdr_)[k++];
+  while ( done < n )
+  {
+    uint32_t s = ( k - sizeof(StoreHeader) ) / sizeof(StoreSample);
+    uint16_t b = ( k - sizeof(StoreHeader) ) % sizeof(StoreSample);
+    StoreSample S;
+    CollStore::sample_from(L_->datum(( Reg_.i + s ) % L_->nR()), &S);
+    while ( done < n && b < sizeof(StoreSample) )
+    {
+      buf[done++] = ((const uint8_t *)&S)[b++];
+      k++;
+    }
+  }
+}
+
+// Restart the current download at off
+boolean CollLink::resume(const uint32_t off)
+{
+  if ( src_ == NONE || off > size_ ) return ( false );
+  off_ = off;
+  ended_ = false;
+  return ( true );
+}
+
+// Send the next packet if the port has room for it
+void CollLink::run()
+{
+  if ( src_ == NONE || ended_ || Data.availableForWrite() < int(LINK_FRAME_MAX) ) return;
+  if ( !intact() )
+  {
+    send(LINK_ERR, NULL, 0);
+    src_ = NONE;
+    return;
+  }
+  if ( off_ >= size_ )
+  {
+    send(LINK_END, NULL, 0);
+    ended_ = true;
+    return;
+  }
+  uint8_t payload[LINK_PAYLOAD];
+  uint16_t n = min(uint32_t(LINK_PAYLOAD), size_ - off_);
+  read(off_, payload, n);
+  send(LINK_DATA, payload, n);
+  off_ += n;
+}
+
+// Frame and write one packet
+void CollLink::send(const uint8_t type, const uint8_t *payload, const uint16_t n)
+{
+  uint8_t raw[LINK_RAW_MAX];
+  uint8_t frame[LINK_FRAME_MAX];
+  LinkHead *h = (LinkHead *)raw;
+  h->type = type;
+  h->id = id_;
+  h->seq = seq_++;
+  h->off = ( type == LINK_END ) ? size_ : off_;
+  if ( n ) memcpy(raw + sizeof(LinkHead), payload, n);
+  uint16_t crc = crc16_update(0xFFFF, raw, sizeof(LinkHead) + n);
+  raw[sizeof(LinkHead) + n] = uint8_t(crc);
+  raw[sizeof(LinkHead) + n + 1] = uint8_t(crc >> 8);
+  frame[0] = 0;
+  uint16_t len = 1 + cobs_encode(raw, sizeof(LinkHead) + n + 2, frame + 1);
+  frame[len++] = 0;
+  Data.write(frame, len);
+  sent_++;
+}
+
+// Download Ram register reg.  The header crc is computed here, once, over the plain samples.
+boolean CollLink::send_ram(Data_st *L, const uint16_t reg)
+{
+  if ( reg >= L->nRg() ) return ( false );
+  Register_st *R = L->reg(reg);
+  if ( R->is_empty() || R->locked || !R->n ) return ( false );
+  L_ = L;
+  iReg_ = reg;
+  Reg_ = *R;
+  CollStore::header_from(&Reg_, &Hdr_);
+  Hdr_.flags |= STORE_PLAIN;
+  Hdr_.len = uint16_t( Reg_.n * sizeof(StoreSample) );
+  uint16_t crc = 0xFFFF;
+  for ( uint16_t k=0; k<Reg_.n; k++ )
+  {
+    StoreSample S;
+    CollStore::sample_from(L->datum(( Reg_.i + k ) % L->nR()), &S);
+    crc = crc16_update(crc, &S, sizeof(S));
+  }
+  Hdr_.crc = crc16_update(crc, &Hdr_, sizeof(Hdr_));
+  start(RAM, sizeof(StoreHeader) + Hdr_.len);
+  return ( true );
+}
+
+// Download stored event i, 0 the worst
+boolean CollLink::send_stored(const uint8_t i)
+{
+  uint32_t bytes = 0;
+  rec_ = Store_->record(i, &bytes);
+  if ( !rec_ ) return ( false );
+  rec_seq_ = ((const StoreHeader *)rec_)->seq;
+  start(STORED, bytes);
+  return ( true );
+}
+
+// Common start of a download
+void CollLink::start(const Source src, const uint32_t size)
+{
+  src_ = src;
+  size_ = size;
+  off_ = 0;
+  seq_ = 0;
+  id_++;
+  ended_ = false;
+}
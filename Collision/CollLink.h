@@ -0,0 +1,71 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef _COLL_LINK_H
+#define _COLL_LINK_H
+
+#include "constants.h"
+#include "CollDatum.h"
+#include "CollFormat.h"
+#include "CollStore.h"
+#include "TxQueue.h"
+
+// Binary download of one event over Serial, as COBS framed packets (CollFormat.h).  A stored event
+// goes out as its flash record; a Ram register goes out as a STORE_PLAIN record built on the fly.
+// One packet is queued on Data per run() and only when it fits whole.  The receiver resumes a
+// broken download by asking for the first byte it is missing.
+class CollLink
+{
+public:
+  CollLink(CollStore *Store);
+  ~CollLink(){};
+  void abort();
+  boolean busy() { return ( src_ != NONE ); };
+  boolean resume(const uint32_t off);
+  void run();
+  boolean send_ram(Data_st *L, const uint16_t reg);
+  boolean send_stored(const uint8_t i);
+  uint32_t sent() { return ( sent_ ); };
+protected:
+  enum Source { NONE, STORED, RAM };
+  boolean intact();
+  void read(const uint32_t off, uint8_t *buf, const uint16_t n);
+  void send(const uint8_t type, const uint8_t *payload, const uint16_t n);
+  void start(const Source src, const uint32_t size);
+  CollStore *Store_;
+  Source src_;
+  uint8_t id_;              // Download number
+  uint16_t seq_;            // Next packet number
+  uint32_t off_;            // Next object byte to send
+  uint32_t size_;           // Object bytes
+  boolean ended_;           // LINK_END sent; waiting on a resume or a new download
+  uint32_t sent_;           // Packets sent since boot
+  const uint8_t *rec_;      // Stored record in flash
+  uint32_t rec_seq_;        // and its sequence number, to notice it being reclaimed
+  Data_st *L_;              // Ram register being sent
+  Register_st Reg_;
+  uint16_t iReg_;
+  StoreHeader Hdr_;         // Header made up for it
+};
+
+#endif
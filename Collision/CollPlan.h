@@ -0,0 +1,92 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+#ifndef _COLL_PLAN_H
+#define _COLL_PLAN_H
+
+#include "constants.h"
+#include "CollDatum.h"
+
+// Event log capacity, worked out by the compiler from the ram given to capture.  An event takes its
+// pretrigger, the motion, and the quiet set and reset persistence before the register unlocks; the
+// shortest, with no motion, sets how many registers the ring can need at once.  The functions take
+// everything as arguments so host tools can plan for budgets and layouts other than the board's
+// (coll_plan).  Sizes are in datums, one per LOG_DELAY.
+
+// Datums one event of event_s takes
+constexpr float plan_event(const float event_s, const float quiet_s, const float r_scl, const unsigned long log_ms,
+  const uint16_t hold)
+{
+  return ( ( event_s + quiet_s * ( r_scl + 1 ) / r_scl ) * 1000 / log_ms + hold );
+}
+
+// Registers for a ring of datums, enough for it full of the shortest events
+constexpr uint8_t plan_registers(const uint16_t datums, const float min_event)
+{
+  return ( datums / min_event >= 255 ? 255 : uint8_t(datums / min_event) );
+}
+
+// Bytes a ring of datums and its registers take
+constexpr unsigned long plan_bytes(const uint16_t datums, const size_t datum_bytes, const size_t reg_bytes, const float min_event)
+{
+  return ( datums * datum_bytes + plan_registers(datums, min_event) * reg_bytes );
+}
+
+// Largest ring that fits in bytes, its registers included.  n from the per datum cost is a floor;
+// the check covers rounding.
+constexpr uint16_t plan_fit(const unsigned long n, const unsigned long bytes, const size_t datum_bytes, const size_t reg_bytes,
+  const float min_event)
+{
+  return ( n > 65535 ? 65535 : plan_bytes(uint16_t(n), datum_bytes, reg_bytes, min_event) <= bytes ? uint16_t(n) : uint16_t(n - 1) );
+}
+constexpr uint16_t plan_datums(const unsigned long bytes, const size_t datum_bytes, const size_t reg_bytes, const float min_event)
+{
+  return ( plan_fit((unsigned long)( bytes / ( datum_bytes + reg_bytes / min_event ) ), bytes, datum_bytes, reg_bytes, min_event) );
+}
+
+// Events of event datums the ring holds at once
+constexpr uint16_t plan_events(const uint16_t datums, const float event)
+{
+  return ( uint16_t(datums / event) );
+}
+
+// Longest motion one register can record, sec; the pretrigger and the quiet tail take the rest
+constexpr float plan_longest_s(const uint16_t datums, const float min_event, const unsigned long log_ms)
+{
+  return ( datums > min_event ? ( datums - min_event ) * log_ms / 1000. : 0. );
+}
+
+// The board's plan, on the nominal quiet tuning; 'q' changes to quiet_s or r_scl move event lengths.
+// A TRACES build gives the trace ring out of the capture budget.
+constexpr unsigned long CAPTURE_RAM = CAPTURE_BYTES - ( TRACES ? TRACE_EVENTS * sizeof(TraceEvent) : 0 );  // Ram for capture
+constexpr float EVENT_MIN_DATUMS = plan_event(0., QUIET_S, R_SCL, LOG_DELAY, NHOLD);  // Shortest event
+constexpr float EVENT_DATUMS = plan_event(EVENT_S, QUIET_S, R_SCL, LOG_DELAY, NHOLD);
+constexpr uint16_t NDATUM = plan_datums(CAPTURE_RAM, sizeof(Datum_st), sizeof(Register_st), EVENT_MIN_DATUMS);  // Ram datums
+constexpr uint8_t NREG = plan_registers(NDATUM, EVENT_MIN_DATUMS);  // Registers
+static_assert(NDATUM > NHOLD && NREG > 0, "CAPTURE_BYTES has no room for an event; see coll_ram for what the link leaves");
+static_assert(plan_events(NDATUM, EVENT_DATUMS) >= EVENT_MIN,
+  "CAPTURE_BYTES, less any trace ring, holds fewer than EVENT_MIN events of EVENT_S; raise it (coll_ram shows the room) or lower EVENT_MIN");
+
+#endif
@@ -0,0 +1,716 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "CollStore.h"
+
+static uint32_t round_up(const uint32_t x, const uint32_t m) { return ( (x + m - 1) / m * m ); }
+
+// Two whole tables, so one can go down while the last still stands, and a row to step past a dirty one
+static_assert(INDEX_BYTES >= 2 * ( ( sizeof(IndexHeader) + STORE_MAX_RECORDS * sizeof(IndexEntry) + sizeof(uint32_t) + 255 ) / 256 * 256 ) + 256,
+  "INDEX_BYTES too small for the index journal");
+
+// Constructors
+CollStore::CollStore(FlashClass *Flash, FlashClass *Index, FlashWriter *Writer)
+  : Flash_(Flash), Index_(Index), Writer_(Writer), base_(NULL), ibase_(NULL), page_(64), row_(256),
+  nE_(0), head_(0), seq_(0), dropped_(0), gen_(0), ihead_(0), whole_(INDEX_BYTES), whole_end_(INDEX_BYTES), added_(0),
+  index_pending_(false), rebuild_(false), scanned_(false), load_us_(0),
+  L_(NULL), iReg_(0), queued_(false), writing_(false), start_(0), hdr_pos_(0), j_(0), k_(0),
+  pend_len_(0), pend_pos_(0), isrc_(NULL), iat_(0), ipos_(0), ev_h_(NULL), ev_p_(NULL), ev_seq_(0), worst_n_(0)
+{}
+
+// Insert an entry into the sorted table, evicting the oldest unpinned one when full
+void CollStore::add(IndexEntry *e)
+{
+  for ( uint8_t i=0; i<nE_; i++ )
+  {
+    if ( E_[i].t_ms != e->t_ms ) continue;
+    if ( E_[i].seq > e->seq ) return;  // already superseded
+    memmove(&E_[i], &E_[i+1], (nE_ - i - 1) * sizeof(IndexEntry));
+    nE_--;
+    break;
+  }
+  if ( nE_ >= STORE_MAX_RECORDS )
+  {
+    int8_t victim = -1;
+    for ( uint8_t i=STORE_KEEP; i<nE_; i++ )
+      if ( victim<0 || E_[i].seq < E_[victim].seq ) victim = i;
+    if ( victim < 0 ) return;
+    memmove(&E_[victim], &E_[victim+1], (nE_ - victim - 1) * sizeof(IndexEntry));
+    nE_--;
+  }
+  uint8_t i = nE_;
+  while ( i > 0 && ( E_[i-1].severity < e->severity || ( E_[i-1].severity == e->severity && E_[i-1].seq < e->seq ) ) )
+  {
+    E_[i] = E_[i-1];
+    i--;
+  }
+  E_[i] = *e;
+  nE_++;
+  Added_ = *e;
+  added_++;
+  index_pending_ = true;
+}
+
+// Load the index, or scan the log when it is missing or corrupt
+void CollStore::begin()
+{
+  unsigned long start = micros();
+  base_ = (const uint8_t *)Flash_->address();
+  ibase_ = (const uint8_t *)Index_->address();
+  page_ = Flash_->page_size();
+  row_ = Flash_->row_size();
+  scanned_ = !load_index();
+  if ( scanned_ ) scan();
+
+  // A record cut short by power loss leaves its row dirty past the head
+  for ( uint32_t b=head_; b<round_up(head_, row_); b++ )
+    if ( base_[b] != 0xFF )
+    {
+      head_ = round_up(head_, row_);
+      if ( head_ >= STORE_BYTES ) head_ = 0;
+      break;
+    }
+  load_us_ = micros() - start;
+}
+
+// Queue the event in register reg for the log.  One commit may wait behind the one in flight; if
+// another arrives the more severe is kept.
+boolean CollStore::commit(Data_st *L, const uint16_t reg)
+{
+  Register_st *R = L->reg(reg);
+  if ( R->is_empty() || R->locked || !R->n ) return ( false );
+  if ( queued_ )
+  {
+    dropped_++;
+    if ( R->severity() < Reg_.severity() ) return ( false );
+  }
+  L_ = L;
+  iReg_ = reg;
+  Reg_ = *R;
+  queued_ = true;
+  return ( true );
+}
+
+// First byte past a record in the table
+uint32_t CollStore::end_of(const uint8_t i)
+{
+  const StoreHeader *h = (const StoreHeader *)(base_ + E_[i].off);
+  return ( E_[i].off + round_up(store_bytes(h->len), page_) );
+}
+
+// Index entry for the valid record at off
+void CollStore::entry_from(const uint32_t off, IndexEntry *e)
+{
+  const StoreHeader *h = (const StoreHeader *)(base_ + off);
+  e->t_ms = h->t_ms;
+  e->off = off;
+  e->seq = h->seq;
+  e->n = h->n;
+  e->severity = h->severity;
+  e->g_max = int16_t( constrain(h->g_raw_max*G_SCL, -32767.f, 32767.f) );
+  e->o_max = int16_t( constrain(h->o_raw_max*O_SCL, -32767.f, 32767.f) );
+}
+
+// Entry still heads a record with a good crc
+boolean CollStore::entry_ok(const IndexEntry *e)
+{
+  if ( e->off % page_ || e->off + sizeof(StoreHeader) > STORE_BYTES ) return ( false );
+  const StoreHeader *h = (const StoreHeader *)(base_ + e->off);
+  return ( h->seq == e->seq && h->t_ms == e->t_ms && valid(e->off) );
+}
+
+// Roll forward over a record written after the index.  plan() puts it at the head, at the row past
+// a head begin() found dirty, at the start of the log, or just past a pinned record, so only those
+// places are checked.
+boolean CollStore::find_next()
+{
+  uint32_t at[STORE_KEEP + 3];
+  uint8_t n = 0;
+  at[n++] = head_;
+  at[n++] = round_up(head_, row_) >= STORE_BYTES ? 0 : round_up(head_, row_);
+  at[n++] = 0;
+  for ( uint8_t i=0; i<nE_ && i<STORE_KEEP; i++ )
+  {
+    uint32_t off = round_up(end_of(i), row_);
+    at[n++] = off >= STORE_BYTES ? 0 : off;
+  }
+  for ( uint8_t k=0; k<n; k++ )
+  {
+    const StoreHeader *h = (const StoreHeader *)(base_ + at[k]);
+    if ( h->magic != STORE_MAGIC || h->seq != seq_ || !valid(at[k]) ) continue;
+    kill(at[k], round_up(at[k] + store_bytes(h->len), row_));
+    IndexEntry e;
+    entry_from(at[k], &e);
+    add(&e);
+    seq_ = h->seq + 1;
+    head_ = at[k] + round_up(store_bytes(h->len), page_);
+    if ( head_ >= STORE_BYTES ) head_ = 0;
+    return ( true );
+  }
+  return ( false );
+}
+
+// Record header fields taken from a register; seq, len and crc are left zero
+void CollStore::header_from(Register_st *R, StoreHeader *h)
+{
+  memset(h, 0, sizeof(StoreHeader));
+  h->magic = STORE_MAGIC;
+  h->t_ms = R->t_ms;
+  h->n = R->n;
+  h->severity = R->severity();
+  h->version = STORE_VERSION;
+  #ifdef SAVE_RAW
+    h->flags = STORE_RAW;
+  #endif
+  h->o_raw_max = R->o_raw_max;
+  h->g_raw_max = R->g_raw_max;
+  h->o_filt_max = R->o_filt_max;
+  h->g_filt_max = R->g_filt_max;
+}
+
+// Index journal item of count entries, header and trailer included
+uint32_t CollStore::index_bytes(const uint8_t count)
+{
+  return ( sizeof(IndexHeader) + count * sizeof(IndexEntry) + sizeof(uint32_t) );
+}
+
+// An item of bytes at leaves the rows of the last whole table alone
+boolean CollStore::index_clear(const uint32_t at, const uint32_t bytes)
+{
+  uint32_t from = round_up(at, row_);  // rows the item erases
+  uint32_t to = round_up(at + bytes, row_);
+  return ( to <= whole_ / row_ * row_ || from >= round_up(whole_end_, row_) );
+}
+
+// Flash writer completion of an index item.  One that failed leaves its pages dirty, so the journal
+// steps to the next row and starts over with the whole table.
+void CollStore::index_done(const boolean ok, void *ctx)
+{
+  CollStore *S = (CollStore *)ctx;
+  uint32_t bytes = index_bytes(S->IHdr_.count);
+  if ( ok && S->Writer_->done_bytes() == bytes )
+  {
+    S->gen_ = S->IHdr_.gen;
+    S->ihead_ = round_up(S->iat_ + bytes, S->page_);
+    if ( S->IHdr_.flags & INDEX_WHOLE )
+    {
+      S->whole_ = S->iat_;
+      S->whole_end_ = S->iat_ + bytes;
+      S->rebuild_ = false;
+    }
+    S->added_ = 0;
+  }
+  else
+  {
+    S->ihead_ = round_up(S->iat_ + S->Writer_->done_bytes() + 1, S->row_);
+    S->rebuild_ = true;
+    S->index_pending_ = true;
+  }
+  if ( S->ihead_ >= INDEX_BYTES ) S->ihead_ = 0;
+  S->writing_ = false;
+}
+
+// Flash writer source for an index item:  header, entries, then gen as the trailer
+uint16_t CollStore::index_fill(uint8_t *buf, const uint16_t max, void *ctx)
+{
+  CollStore *S = (CollStore *)ctx;
+  uint16_t entries = sizeof(IndexHeader) + S->IHdr_.count * sizeof(IndexEntry);
+  uint16_t total = index_bytes(S->IHdr_.count);
+  uint16_t k = 0;
+  while ( k < max && S->ipos_ < total )
+  {
+    if ( S->ipos_ < sizeof(IndexHeader) ) buf[k++] = ((const uint8_t *)&S->IHdr_)[S->ipos_];
+    else if ( S->ipos_ < entries ) buf[k++] = ((const uint8_t *)S->isrc_)[S->ipos_ - sizeof(IndexHeader)];
+    else buf[k++] = ((const uint8_t *)&S->IHdr_.gen)[S->ipos_ - entries];
+    S->ipos_++;
+  }
+  return ( k );
+}
+
+// Where an item of bytes goes in the journal from at, wrapping rather than running off the end
+uint32_t CollStore::index_fit(const uint32_t at, const uint32_t bytes)
+{
+  return ( at + bytes > INDEX_BYTES ? 0 : at );
+}
+
+// Index journal item at that checks out, else NULL
+const IndexHeader *CollStore::index_item(const uint32_t at)
+{
+  if ( at + index_bytes(0) > INDEX_BYTES ) return ( NULL );
+  const IndexHeader *h = (const IndexHeader *)(ibase_ + at);
+  if ( h->magic != INDEX_MAGIC || h->version != INDEX_VERSION || h->count > STORE_MAX_RECORDS ) return ( NULL );
+  if ( !( h->flags & INDEX_WHOLE ) && h->count > 1 ) return ( NULL );
+  uint32_t bytes = index_bytes(h->count);
+  if ( at + bytes > INDEX_BYTES || h->head >= STORE_BYTES ) return ( NULL );
+  uint32_t trailer;
+  memcpy(&trailer, ibase_ + at + bytes - sizeof(trailer), sizeof(trailer));
+  if ( trailer != h->gen ) return ( NULL );
+  IndexHeader copy = *h;
+  copy.crc = 0;
+  uint16_t crc = crc16_update(0xFFFF, h + 1, h->count * sizeof(IndexEntry));
+  if ( crc16_update(crc, &copy, sizeof(copy)) != h->crc ) return ( NULL );
+  return ( h );
+}
+
+// Source register still describes the data in Ram
+boolean CollStore::intact()
+{
+  Register_st *R = L_->reg(iReg_);
+  return ( R->t_ms == Reg_.t_ms && R->i == Reg_.i && !R->locked );
+}
+
+// Among the STORE_KEEP most severe, counting a record of new_severity about to be written.  The
+// table is sorted so the rank is the position.
+boolean CollStore::is_pinned(const uint8_t i, const uint16_t new_severity)
+{
+  return ( i + ( new_severity > E_[i].severity ? 1 : 0 ) < STORE_KEEP );
+}
+
+// Forget records overlapping [from, to)
+void CollStore::kill(const uint32_t from, const uint32_t to)
+{
+  uint8_t i = 0;
+  while ( i < nE_ )
+  {
+    if ( E_[i].off < to && end_of(i) > from )
+    {
+      memmove(&E_[i], &E_[i+1], (nE_ - i - 1) * sizeof(IndexEntry));
+      nE_--;
+      index_pending_ = true;
+    }
+    else i++;
+  }
+}
+
+// Take the table from the newest whole one in the index journal and replay the deltas after it,
+// keeping only entries that still head a good record, then roll forward over anything committed
+// after the last item.  gen_ ends past every item seen so a rebuilt table outranks them.
+boolean CollStore::load_index()
+{
+  int32_t best = -1;
+  gen_ = 0;
+  for ( uint32_t p=0; p<INDEX_BYTES; p+=page_ )
+  {
+    const IndexHeader *h = index_item(p);
+    if ( !h ) continue;
+    gen_ = max(gen_, h->gen);
+    if ( ( h->flags & INDEX_WHOLE ) && ( best < 0 || h->gen > ((const IndexHeader *)(ibase_ + best))->gen ) ) best = p;
+  }
+  if ( best < 0 ) return ( false );
+
+  const IndexHeader *h = (const IndexHeader *)(ibase_ + best);
+  const IndexEntry *e = (const IndexEntry *)(h + 1);
+  whole_ = best;
+  whole_end_ = best + index_bytes(h->count);
+  gen_ = h->gen;
+  head_ = h->head;
+  seq_ = h->seq;
+  nE_ = 0;
+  for ( uint8_t i=0; i<h->count; i++ )
+    if ( entry_ok(&e[i]) ) E_[nE_++] = e[i];
+
+  // Deltas, each a page, follow in gen order
+  uint32_t p = round_up(whole_end_, page_);
+  for ( uint32_t n=0; n<INDEX_BYTES/page_; n++, p+=page_ )
+  {
+    p = index_fit(p, page_);
+    const IndexHeader *d = index_item(p);
+    if ( !d || ( d->flags & INDEX_WHOLE ) || d->gen != gen_ + 1 ) break;
+    gen_ = d->gen;
+    head_ = d->head;
+    seq_ = d->seq;
+    IndexEntry de = *(const IndexEntry *)(d + 1);
+    if ( d->count && entry_ok(&de) ) add(&de);
+  }
+  ihead_ = index_fit(p, page_);
+
+  // A delta cut short leaves the journal head dirty.  Deltas must follow on, so start over past it.
+  rebuild_ = false;
+  for ( uint32_t b=ihead_; b<round_up(ihead_, row_); b++ )
+    if ( ibase_[b] != 0xFF )
+    {
+      ihead_ = round_up(ihead_, row_);
+      if ( ihead_ >= INDEX_BYTES ) ihead_ = 0;
+      rebuild_ = true;
+      break;
+    }
+  added_ = 0;
+  index_pending_ = rebuild_;
+  while ( find_next() ) {};
+  return ( true );
+}
+
+// Find room for bytes at or after the head, stepping around pinned records.  Records in the rows
+// that will be erased are dropped from the table.
+boolean CollStore::plan(const uint32_t bytes, const uint16_t severity, uint32_t *start)
+{
+  uint32_t need = round_up(bytes, page_);
+  if ( need > STORE_BYTES ) return ( false );
+  uint32_t off = head_;
+  for ( uint32_t tries=0; tries <= STORE_BYTES / row_; tries++ )
+  {
+    if ( off + need > STORE_BYTES ) off = 0;
+    uint32_t erase_to = round_up(off + need, row_);
+    int8_t hit = -1;
+    for ( uint8_t i=0; i<nE_ && hit<0; i++ )
+      if ( E_[i].off < erase_to && end_of(i) > off && is_pinned(i, severity) ) hit = i;
+    if ( hit < 0 )
+    {
+      kill(off, erase_to);
+      *start = off;
+      return ( true );
+    }
+    off = round_up(end_of(hit), row_);
+    if ( off >= STORE_BYTES ) off = 0;
+  }
+  return ( false );
+}
+
+// List the log.  This and the other prints are queued on Tx and produced a line at a time.
+void CollStore::print()
+{
+  Tx.job(&Data, list_line, this);
+}
+
+// Decode one stored event and print it like Ram
+boolean CollStore::print_event(const uint8_t i)
+{
+  if ( i >= nE_ ) return ( false );
+  const StoreHeader *h = (const StoreHeader *)(base_ + E_[i].off);
+  ev_h_ = h;
+  ev_seq_ = h->seq;
+  ev_p_ = (const uint8_t *)(h + 1);
+  memset(&ev_s_, 0, sizeof(ev_s_));
+  ev_s_.t_ms = h->t_ms;
+  return ( Tx.job(&Data, event_line, this) );
+}
+
+// The n most severe stored events, straight from the index
+void CollStore::print_worst(const uint8_t n)
+{
+  worst_n_ = min(n, nE_);
+  Tx.job(&Data, worst_line, this);
+}
+
+// Tx line jobs
+boolean CollStore::event_line(Print *out, const uint16_t k, void *ctx)
+{
+  CollStore *S = (CollStore *)ctx;
+  const StoreHeader *h = S->ev_h_;
+  if ( k >= h->n || h->magic != STORE_MAGIC || h->seq != S->ev_seq_ ) return ( false );  // done or reclaimed
+  if ( !store_decode(&S->ev_s_, &S->ev_p_, (const uint8_t *)(h + 1) + h->len) ) return ( false );
+  Datum_st D;
+  D.t_ms = S->ev_s_.t_ms;
+  D.T_rot_int = S->ev_s_.v[0];
+  D.a_int = S->ev_s_.v[1];
+  D.b_int = S->ev_s_.v[2];
+  D.c_int = S->ev_s_.v[3];
+  D.T_acc_int = S->ev_s_.v[4];
+  D.x_int = S->ev_s_.v[5];
+  D.y_int = S->ev_s_.v[6];
+  D.z_int = S->ev_s_.v[7];
+  D.print(k, out);
+  return ( true );
+}
+
+boolean CollStore::list_line(Print *out, const uint16_t k, void *ctx)
+{
+  CollStore *S = (CollStore *)ctx;
+  if ( !k )
+  {
+    out->print("Store: events="); out->print(S->nE_);
+    out->print(" head="); out->print(S->head_);
+    out->print(" seq="); out->print(S->seq_);
+    out->print(" dropped="); out->print(S->dropped_);
+    out->print(" index gen="); out->print(S->gen_);
+    out->print(S->scanned_ ? " rebuilt" : " loaded");
+    out->print(" in "); out->print(S->load_us_); out->println(" us");
+    return ( true );
+  }
+  uint8_t i = k - 1;
+  if ( i >= S->nE_ ) return ( false );
+  cSF(prn_buff, INPUT_BYTES, "");
+  time_long_2_str(S->E_[i].t_ms, prn_buff);
+  out->print(i);
+  out->print(" seq:"); out->print(S->E_[i].seq);
+  out->print(" "); out->print(prn_buff);
+  out->print(" n:"); out->print(S->E_[i].n);
+  out->print(" severity:"); out->print(S->E_[i].severity);
+  out->print(" off:"); out->print(S->E_[i].off);
+  if ( S->is_pinned(i, 0) ) out->print(" pinned");
+  out->println();
+  return ( true );
+}
+
+boolean CollStore::worst_line(Print *out, const uint16_t k, void *ctx)
+{
+  CollStore *S = (CollStore *)ctx;
+  if ( !k )
+  {
+    out->print("Worst "); out->print(S->worst_n_); out->print(" of "); out->print(S->nE_); out->println(" stored:");
+    return ( true );
+  }
+  uint8_t i = k - 1;
+  if ( i >= S->worst_n_ || i >= S->nE_ ) return ( false );
+  cSF(prn_buff, INPUT_BYTES, "");
+  time_long_2_str(S->E_[i].t_ms, prn_buff);
+  out->print(i);
+  out->print(" "); out->print(prn_buff);
+  out->print(" dur:"); out->print(float(S->E_[i].n) * float(READ_DELAY) / 1000., 2);
+  out->print(" g:"); out->print(float(S->E_[i].g_max) / G_SCL, 3);
+  out->print(" o:"); out->print(float(S->E_[i].o_max) / O_SCL, 3);
+  out->print(" severity:"); out->println(S->E_[i].severity);
+  return ( true );
+}
+
+// Stored event i as it sits in flash, header and payload
+const uint8_t *CollStore::record(const uint8_t i, uint32_t *bytes)
+{
+  if ( i >= nE_ ) return ( NULL );
+  const StoreHeader *h = (const StoreHeader *)(base_ + E_[i].off);
+  *bytes = sizeof(StoreHeader) + h->len;
+  return ( base_ + E_[i].off );
+}
+
+// Flash writer completion of a record.  It is listed only if it reads back with a good crc.
+void CollStore::record_done(const boolean ok, void *ctx)
+{
+  CollStore *S = (CollStore *)ctx;
+  uint32_t written = round_up(S->Writer_->done_bytes(), S->page_);
+  S->head_ = S->start_ + written;
+  if ( S->head_ >= STORE_BYTES ) S->head_ = 0;
+  if ( ok && S->Writer_->done_bytes() == store_bytes(S->Hdr_.len) && S->valid(S->start_) )
+  {
+    IndexEntry e;
+    S->entry_from(S->start_, &e);
+    S->add(&e);
+  }
+  else
+  {
+    S->dropped_++;
+    S->seq_ = S->Hdr_.seq;  // reuse so roll forward on boot finds the next one
+  }
+  S->index_pending_ = true;
+  S->writing_ = false;
+}
+
+// Flash writer source:  header, samples encoded out of Ram one at a time, then seq as the trailer
+uint16_t CollStore::record_fill(uint8_t *buf, const uint16_t max, void *ctx)
+{
+  CollStore *S = (CollStore *)ctx;
+  uint16_t k = 0;
+  while ( k < max && S->hdr_pos_ < sizeof(StoreHeader) )
+    buf[k++] = ((const uint8_t *)&S->Hdr_)[S->hdr_pos_++];
+  if ( k < max && !S->intact() ) return ( 0 );  // overwritten mid-write; record will fail crc
+  while ( k < max )
+  {
+    if ( S->pend_pos_ >= S->pend_len_ )
+    {
+      if ( S->k_ > S->Hdr_.n ) break;
+      if ( S->k_ == S->Hdr_.n )
+      {
+        memcpy(S->pend_, &S->Hdr_.seq, sizeof(S->Hdr_.seq));
+        S->pend_len_ = sizeof(S->Hdr_.seq);
+      }
+      else
+      {
+        StoreSample s;
+        S->sample_from(S->L_->datum(S->j_), &s);
+        S->pend_len_ = store_encode(&S->Prev_, &s, S->pend_);
+        if ( ++S->j_ > (S->L_->nR()-1) ) S->j_ = 0;
+      }
+      S->pend_pos_ = 0;
+      S->k_++;
+    }
+    buf[k++] = S->pend_[S->pend_pos_++];
+  }
+  return ( k );
+}
+
+// Start the next flash job once the writer is free.  A changed table goes to the index first, so
+// the index never lags more than one record.  It goes as a delta unless the journal must start over,
+// more than one entry was added, or a delta would leave no room for the whole table ahead of the last
+// one.  Boot checks entries against their records, so the index may still list records whose rows
+// were erased since.  A queued commit is encoded once to size the record and compute its crc, then
+// streamed through the writer, encoding again page by page.
+void CollStore::run()
+{
+  if ( writing_ || Writer_->busy() ) return;
+
+  // Index
+  if ( index_pending_ )
+  {
+    index_pending_ = false;
+    uint32_t delta = index_bytes(added_);
+    uint32_t at = index_fit(ihead_, delta);
+    uint32_t room = index_bytes(STORE_MAX_RECORDS) + row_;
+    boolean whole = rebuild_ || added_ > 1 || !index_clear(at, delta) ||
+      !index_clear(index_fit(round_up(at + delta, page_), room), room);
+    memset(&IHdr_, 0, sizeof(IHdr_));
+    IHdr_.magic = INDEX_MAGIC;
+    IHdr_.gen = gen_ + 1;
+    IHdr_.head = head_;
+    IHdr_.seq = seq_;
+    IHdr_.version = INDEX_VERSION;
+    IHdr_.count = whole ? nE_ : added_;
+    IHdr_.flags = whole ? INDEX_WHOLE : 0;
+    isrc_ = whole ? E_ : &Added_;
+    uint16_t crc = crc16_update(0xFFFF, isrc_, IHdr_.count * sizeof(IndexEntry));
+    IHdr_.crc = crc16_update(crc, &IHdr_, sizeof(IHdr_));
+    ipos_ = 0;
+    iat_ = index_fit(ihead_, index_bytes(IHdr_.count));
+    writing_ = Writer_->begin(ibase_ + iat_, index_bytes(IHdr_.count), index_fill, index_done, this);
+    if ( !writing_ ) index_pending_ = true;
+    return;
+  }
+
+  if ( !queued_ ) return;
+  queued_ = false;
+  if ( !intact() )
+  {
+    dropped_++;
+    return;
+  }
+
+  // Measure
+  uint8_t tmp[STORE_SAMPLE_MAX];
+  uint16_t crc = 0xFFFF;
+  uint32_t len = 0;
+  memset(&Prev_, 0, sizeof(Prev_));
+  Prev_.t_ms = Reg_.t_ms;
+  uint16_t j = Reg_.i;
+  for ( uint16_t k=0; k<Reg_.n; k++ )
+  {
+    StoreSample s;
+    sample_from(L_->datum(j), &s);
+    uint8_t b = store_encode(&Prev_, &s, tmp);
+    crc = crc16_update(crc, tmp, b);
+    len += b;
+    if ( ++j > (L_->nR()-1) ) j = 0;
+  }
+  if ( len > 0xFFFF )
+  {
+    dropped_++;
+    return;
+  }
+  header_from(&Reg_, &Hdr_);
+  Hdr_.seq = seq_++;
+  Hdr_.len = uint16_t(len);
+  Hdr_.crc = crc16_update(crc, &Hdr_, sizeof(Hdr_));
+
+  // Place
+  if ( !plan(store_bytes(len), Hdr_.severity, &start_) )
+  {
+    dropped_++;
+    seq_ = Hdr_.seq;
+    return;
+  }
+  stream();
+}
+
+// One Ram datum as a codec sample
+void CollStore::sample_from(Datum_st *D, StoreSample *s)
+{
+  s->t_ms = D->t_ms;
+  s->v[0] = D->T_rot_int;
+  s->v[1] = D->a_int;
+  s->v[2] = D->b_int;
+  s->v[3] = D->c_int;
+  s->v[4] = D->T_acc_int;
+  s->v[5] = D->x_int;
+  s->v[6] = D->y_int;
+  s->v[7] = D->z_int;
+}
+
+// Scan the log and rebuild the table.  Finds the head after the newest valid record.  The index
+// journal starts over with the whole table.
+void CollStore::scan()
+{
+  nE_ = 0;
+  seq_ = 0;
+  head_ = 0;
+  ihead_ = 0;
+  whole_ = INDEX_BYTES;
+  whole_end_ = INDEX_BYTES;
+  rebuild_ = true;
+  uint32_t off = 0;
+  while ( off + sizeof(StoreHeader) <= STORE_BYTES )
+  {
+    if ( !valid(off) )
+    {
+      off += page_;
+      continue;
+    }
+    const StoreHeader *h = (const StoreHeader *)(base_ + off);
+    IndexEntry e;
+    entry_from(off, &e);
+    add(&e);
+    off += round_up(store_bytes(h->len), page_);
+    if ( h->seq >= seq_ )
+    {
+      seq_ = h->seq + 1;
+      head_ = off;
+    }
+  }
+  if ( head_ >= STORE_BYTES ) head_ = 0;
+  index_pending_ = true;
+}
+
+// Stream the placed record through the writer
+void CollStore::stream()
+{
+  if ( !intact() )
+  {
+    dropped_++;
+    seq_ = Hdr_.seq;
+    return;
+  }
+  memset(&Prev_, 0, sizeof(Prev_));
+  Prev_.t_ms = Reg_.t_ms;
+  hdr_pos_ = 0;
+  j_ = Reg_.i;
+  k_ = 0;
+  pend_len_ = 0;
+  pend_pos_ = 0;
+  writing_ = Writer_->begin(base_ + start_, store_bytes(Hdr_.len), record_fill, record_done, this);
+  if ( !writing_ )
+  {
+    dropped_++;
+    seq_ = Hdr_.seq;
+  }
+}
+
+// Header sane, trailer programmed and crc good for a record at off
+boolean CollStore::valid(const uint32_t off)
+{
+  const StoreHeader *h = (const StoreHeader *)(base_ + off);
+  if ( h->magic != STORE_MAGIC || h->version != STORE_VERSION ) return ( false );
+  if ( off + store_bytes(h->len) > STORE_BYTES ) return ( false );
+  uint32_t trailer;
+  memcpy(&trailer, base_ + off + sizeof(StoreHeader) + h->len, sizeof(trailer));
+  if ( trailer != h->seq ) return ( false );
+  StoreHeader copy = *h;
+  copy.crc = 0;
+  uint16_t crc = crc16_update(0xFFFF, h + 1, h->len);
+  return ( crc16_update(crc, &copy, sizeof(copy)) == h->crc );
+}
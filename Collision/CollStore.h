@@ -0,0 +1,134 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _COLL_STORE_H
+#define _COLL_STORE_H
+
+#include "constants.h"
+#include "CollDatum.h"
+#include "CollFormat.h"
+#include "FlashStorage.h"
+#include "FlashWriter.h"
+#include "TxQueue.h"
+
+// Append-only collision log over a flash region.  Records are compressed events (CollFormat.h)
+// starting on a page so every page is programmed once per erase.  The head walks the region and
+// rows are erased only just ahead of it, so wear is spread evenly round-robin.  Older records die as
+// the head passes them, except the STORE_KEEP most severe, which stay pinned and are stepped around.
+// A record superseded by a newer one with the same t_ms is ignored on scan.  A record cut short by
+// power loss lacks its trailer and is skipped.
+// The event table lives in a second, small flash region as a journal (CollFormat.h):  every commit
+// appends a one page delta and the whole table is written only when the journal comes round to the
+// last one, so index rows wear about as slowly as the log's.  Boot replays it instead of scanning the
+// log, keeping only entries whose records still check out, and falls back to a full scan when no
+// whole table does.
+class CollStore
+{
+public:
+  CollStore(FlashClass *Flash, FlashClass *Index, FlashWriter *Writer);
+  ~CollStore(){};
+  void begin();
+  boolean busy() { return ( writing_ || queued_ || index_pending_ ); };
+  boolean commit(Data_st *L, const uint16_t reg);
+  uint8_t count() { return ( nE_ ); };
+  uint32_t dropped() { return ( dropped_ ); };
+  IndexEntry *entry(const uint8_t i) { return ( &E_[i] ); };  // 0 is the worst
+  static void header_from(Register_st *R, StoreHeader *h);
+  void print();
+  boolean print_event(const uint8_t i);
+  void print_worst(const uint8_t n);
+  const uint8_t *record(const uint8_t i, uint32_t *bytes);
+  void run();
+  static void sample_from(Datum_st *D, StoreSample *s);
+protected:
+  void add(IndexEntry *e);
+  uint32_t end_of(const uint8_t i);
+  void entry_from(const uint32_t off, IndexEntry *e);
+  boolean entry_ok(const IndexEntry *e);
+  static boolean event_line(Print *out, const uint16_t k, void *ctx);
+  boolean find_next();
+  static uint32_t index_bytes(const uint8_t count);
+  boolean index_clear(const uint32_t at, const uint32_t bytes);
+  static void index_done(const boolean ok, void *ctx);
+  static uint16_t index_fill(uint8_t *buf, const uint16_t max, void *ctx);
+  static uint32_t index_fit(const uint32_t at, const uint32_t bytes);
+  const IndexHeader *index_item(const uint32_t at);
+  boolean intact();
+  boolean is_pinned(const uint8_t i, const uint16_t new_severity);
+  void kill(const uint32_t from, const uint32_t to);
+  static boolean list_line(Print *out, const uint16_t k, void *ctx);
+  boolean load_index();
+  boolean plan(const uint32_t bytes, const uint16_t severity, uint32_t *start);
+  static void record_done(const boolean ok, void *ctx);
+  static uint16_t record_fill(uint8_t *buf, const uint16_t max, void *ctx);
+  void scan();
+  void stream();
+  boolean valid(const uint32_t off);
+  static boolean worst_line(Print *out, const uint16_t k, void *ctx);
+  FlashClass *Flash_;
+  FlashClass *Index_;
+  FlashWriter *Writer_;
+  const uint8_t *base_;     // Start of the log in flash
+  const uint8_t *ibase_;    // Start of the index in flash
+  uint32_t page_;
+  uint32_t row_;
+  IndexEntry E_[STORE_MAX_RECORDS];  // Sorted by severity, worst first
+  uint8_t nE_;
+  uint32_t head_;           // Next free page; the rest of its row is erased
+  uint32_t seq_;            // Next sequence number
+  uint32_t dropped_;        // Commits lost to a full queue, an overwritten register or no room
+  uint32_t gen_;            // Generation of the last index item
+  uint32_t ihead_;          // Next free page of the index journal; the rest of its row is erased
+  uint32_t whole_;          // Last whole table in the index journal, INDEX_BYTES for none
+  uint32_t whole_end_;
+  IndexEntry Added_;        // Entry added last, for the next delta
+  uint8_t added_;           // Entries added since the index was written
+  boolean index_pending_;   // Table changed since the index was written
+  boolean rebuild_;         // Next index item must be the whole table
+  boolean scanned_;         // Last begin() fell back to scanning the log
+  unsigned long load_us_;   // Time taken by the last begin()
+  Data_st *L_;              // Source of the queued or in-flight event
+  Register_st Reg_;         // Copy of its register at commit
+  uint16_t iReg_;
+  boolean queued_;
+  boolean writing_;
+  StoreHeader Hdr_;         // Record job in flight
+  StoreSample Prev_;
+  uint32_t start_;
+  uint16_t hdr_pos_;
+  uint16_t j_;              // Next Ram slot to encode
+  uint16_t k_;              // Samples encoded, then one more for the trailer
+  uint8_t pend_[STORE_SAMPLE_MAX];
+  uint8_t pend_len_;
+  uint8_t pend_pos_;
+  IndexHeader IHdr_;        // Index job in flight
+  const IndexEntry *isrc_;  // Entries the index job streams
+  uint32_t iat_;            // Index offset of the item in flight
+  uint16_t ipos_;
+  const StoreHeader *ev_h_; // Event being printed
+  const uint8_t *ev_p_;
+  uint32_t ev_seq_;
+  StoreSample ev_s_;
+  uint8_t worst_n_;
+};
+
+#endif
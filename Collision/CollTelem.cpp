@@ -0,0 +1,198 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include "CollTelem.h"
+
+// Scale of each TelemKind, int16 per unit
+static const float telem_scale[TELEM_KINDS] = { O_SCL, G_SCL, 1e6, 1. };
+
+// Constructors
+CollTelem::CollTelem()
+  : on_(false), decim_(TELEM_DECIM), count_(0), mask_(TELEM_MASK), seq_(0), since_head_(0), head_due_(true),
+  t0_ms_(0ULL), sent_(0), skipped_(0)
+{}
+
+// Samples per frame
+void CollTelem::decim(const uint8_t d)
+{
+  decim_ = max(d, uint8_t(1));
+  head_due_ = true;
+}
+
+// Channels to send
+void CollTelem::mask(const uint32_t m)
+{
+  mask_ = m & ( (1UL << TELEM_CHANNELS) - 1 );
+  head_due_ = true;
+}
+
+// Settings and counters
+void CollTelem::print(Print *out)
+{
+  out->print("telemetry "); out->print(on_ ? "on" : "off");
+  out->print(" decim="); out->print(decim_);
+  out->print(" mask="); out->print(mask_);
+  out->print(" sent="); out->print(sent_);
+  out->print(" skipped="); out->print(skipped_);
+  out->print(":");
+  for ( uint8_t c=0; c<TELEM_CHANNELS; c++ )
+  {
+    if ( !( mask_ & (1UL << c) ) ) continue;
+    out->print(" "); out->print(telem_channels[c].name);
+  }
+  out->println();
+}
+
+// Call once per read, after quiet_decisions
+void CollTelem::run(Sensors *Sen)
+{
+  if ( !on_ || ++count_ < decim_ ) return;
+  count_ = 0;
+  uint8_t raw[TELEM_RAW_MAX];
+  if ( head_due_ || since_head_ >= TELEM_HEAD_EVERY )
+  {
+    TelemHead *h = (TelemHead *)raw;
+    h->type = TELEM_HEAD;
+    h->decim = decim_;
+    h->seq = seq_;
+    h->mask = mask_;
+    h->t_ms = (unsigned long long)Sen->t_ms;
+    for ( uint8_t k=0; k<TELEM_KINDS; k++ ) h->scale[k] = telem_scale[k];
+    if ( !send(raw, sizeof(TelemHead)) )
+    {
+      seq_++;
+      return;  // data would be read against the wrong mask or time base
+    }
+    t0_ms_ = h->t_ms;
+    head_due_ = false;
+    since_head_ = 0;
+  }
+  TelemData *d = (TelemData *)raw;
+  d->type = TELEM_DATA;
+  d->n = 0;
+  d->seq = seq_++;
+  d->dt_ms = uint32_t( (unsigned long long)Sen->t_ms - t0_ms_ );
+  for ( uint8_t c=0; c<TELEM_CHANNELS; c++ )
+  {
+    if ( !( mask_ & (1UL << c) ) ) continue;
+    int16_t v = value(Sen, c);
+    memcpy(raw + sizeof(TelemData) + 2*d->n++, &v, 2);
+  }
+  send(raw, sizeof(TelemData) + 2*d->n);
+  since_head_++;
+}
+
+// Call instead of run when the loop is shedding; a frame due is skipped as if it did not fit
+void CollTelem::shed()
+{
+  if ( !on_ || ++count_ < decim_ ) return;
+  count_ = 0;
+  seq_++;
+  skipped_++;
+}
+
+// crc, frame and queue n raw bytes, room allowing.  raw must have 2 bytes spare for the crc.
+boolean CollTelem::send(uint8_t *raw, const uint16_t n)
+{
+  uint8_t frame[TELEM_FRAME_MAX];
+  uint16_t crc = crc16_update(0xFFFF, raw, n);
+  raw[n] = uint8_t(crc);
+  raw[n + 1] = uint8_t(crc >> 8);
+  frame[0] = 0;
+  uint16_t len = 1 + cobs_encode(raw, n + 2, frame + 1);
+  frame[len++] = 0;
+  if ( Data.availableForWrite() < len + 2 || !Data.write(frame, len) )
+  {
+    skipped_++;
+    return ( false );
+  }
+  sent_++;
+  return ( true );
+}
+
+// Channels by name, one of them or a group.  False if the name is not known.
+boolean CollTelem::select(const char *name)
+{
+  static const struct { const char *name; uint32_t mask; } groups[] = {
+    {"time", 0x3UL}, {"raw", 0x3FCUL}, {"filt", 0x3FC00UL}, {"quiet", 0x3C0000UL}, {"dec", 0x400000UL}, {"all", 0x7FFFFFUL},
+  };
+  for ( uint8_t k=0; k<sizeof(groups)/sizeof(groups[0]); k++ )
+  {
+    if ( strcmp(name, groups[k].name) ) continue;
+    mask(groups[k].mask);
+    return ( true );
+  }
+  for ( uint8_t c=0; c<TELEM_CHANNELS; c++ )
+  {
+    if ( strcmp(name, telem_channels[c].name) ) continue;
+    mask(1UL << c);
+    return ( true );
+  }
+  return ( false );
+}
+
+// Begin streaming, header first
+void CollTelem::start()
+{
+  on_ = true;
+  count_ = decim_ - 1;  // first frame on the next read
+  head_due_ = true;
+  sent_ = 0;
+  skipped_ = 0;
+}
+
+// Channel c of Sen scaled for its kind, rounded and held to int16
+int16_t CollTelem::value(Sensors *Sen, const uint8_t c)
+{
+  float v = 0.;
+  switch ( c )
+  {
+    case 0: v = Sen->T_rot(); break;
+    case 1: v = Sen->T_acc(); break;
+    case 2: v = Sen->a_raw; break;
+    case 3: v = Sen->b_raw; break;
+    case 4: v = Sen->c_raw; break;
+    case 5: v = Sen->o_raw; break;
+    case 6: v = Sen->x_raw; break;
+    case 7: v = Sen->y_raw; break;
+    case 8: v = Sen->z_raw; break;
+    case 9: v = Sen->g_raw; break;
+    case 10: v = Sen->a_filt; break;
+    case 11: v = Sen->b_filt; break;
+    case 12: v = Sen->c_filt; break;
+    case 13: v = Sen->o_filt; break;
+    case 14: v = Sen->x_filt; break;
+    case 15: v = Sen->y_filt; break;
+    case 16: v = Sen->z_filt; break;
+    case 17: v = Sen->g_filt; break;
+    case 18: v = Sen->o_qrate; break;
+    case 19: v = Sen->o_quiet; break;
+    case 20: v = Sen->g_qrate; break;
+    case 21: v = Sen->g_quiet; break;
+    case 22:
+      return ( int16_t( Sen->o_is_quiet() | Sen->o_is_quiet_sure() << 1 | Sen->g_is_quiet() << 2 | Sen->g_is_quiet_sure() << 3 ) );
+  }
+  v *= telem_scale[telem_channels[c].kind];
+  return ( int16_t( constrain(v + ( v < 0 ? -0.5 : 0.5 ), -32768., 32767.) ) );
+}
@@ -0,0 +1,67 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#ifndef _COLL_TELEM_H
+#define _COLL_TELEM_H
+
+#include "constants.h"
+#include "CollFormat.h"
+#include "Sensors.h"
+#include "TxQueue.h"
+
+// Binary telemetry of any Sensors channels at up to the read rate, for tuning.  Frames go on Data
+// only when they fit whole; a frame that does not fit is counted and its seq skipped.  Decode on
+// the host with CollisionHost/telem_csv.
+class CollTelem
+{
+public:
+  CollTelem();
+  ~CollTelem(){};
+  uint8_t decim() { return ( decim_ ); };
+  void decim(const uint8_t d);
+  uint32_t mask() { return ( mask_ ); };
+  void mask(const uint32_t m);
+  boolean on() { return ( on_ ); };
+  void print(Print *out);
+  void run(Sensors *Sen);
+  boolean select(const char *name);
+  void shed();
+  void start();
+  void stop() { on_ = false; };
+protected:
+  boolean send(uint8_t *raw, const uint16_t n);
+  int16_t value(Sensors *Sen, const uint8_t c);
+  boolean on_;
+  uint8_t decim_;           // Samples per frame
+  uint8_t count_;           // Samples since the last frame
+  uint32_t mask_;           // Channels, bit per telem_channels
+  uint16_t seq_;            // Next data frame
+  uint16_t since_head_;     // Data frames since the last header
+  boolean head_due_;        // Header needed before the next data frame
+  uint64_t t0_ms_;          // Time base in the last header
+  uint32_t sent_;           // Frames sent since start
+  uint32_t skipped_;        // Frames due but no room
+};
+
+#endif
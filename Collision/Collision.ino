@@ -51,7 +51,7 @@
 #include "constants.h"
 
 #ifdef USE_ARDUINO
-  #include <Arduino.h> //needed for Serial.println
+  #include <Arduino.h> //needed for Text.println
   #include <Arduino_LSM6DS3.h>
 #else
   #error "Only Arduino nano 33 iot has built in IMU"
@@ -63,25 +63,54 @@
 #include "myFilters.h"
 #include "Sensors.h"
 #include "CollDatum.h"
+#include "CollPlan.h"
 #include "TimeLib.h"
+#include "FlashWriter.h"
+#include "CollStore.h"
+#include "CollLink.h"
+#include "CollCore.h"
+#include "Clock.h"
+#include "Power.h"
+#include "Snapshot.h"
+#include "CollTelem.h"
+#include "CmdReader.h"
+#include "LoadShed.h"
+#include "Probe.h"
+#include "Trace.h"
+#include "TxQueue.h"
 
 // Global
 cSF(unit, INPUT_BYTES);
-cSF(serial_str, INPUT_BYTES, "");
-cSF(input_str, INPUT_BYTES, "");
 cSF(prn_buff, INPUT_BYTES, "");
 boolean string_cpt = false;
 boolean plotting_all = false;
 uint8_t plot_num = 0;
+uint16_t plot_pace = PLOT_PACE_MS;  // Event playback period, ms
 boolean monitoring = false;
 time_t time_initial = ARBITRARY_TIME;
-unsigned long long millis_flip = millis(); // Timekeeping
-unsigned long long last_sync = millis();   // Timekeeping
-
-extern int debug;
-int debug = 0;
 
 boolean print_mem = false;
+uint8_t data_ring[TX_DATA_BYTES];  // Serial output rings, drained by Tx in idle time
+uint8_t text_ring[TX_TEXT_BYTES];
+TxPort Data(data_ring, TX_DATA_BYTES);
+TxPort Text(text_ring, TX_TEXT_BYTES);
+TxQueue Tx(&Data, &Text);
+FlashWriter Writer;  // Background flash programming, serviced once per read frame
+Flash(store_flash, STORE_BYTES);  // Collision log region
+Flash(index_flash, INDEX_BYTES);  // Collision log index region
+CollStore Store(&store_flash, &index_flash, &Writer);
+CollLink Link(&Store);  // Binary event download
+CollTelem Telem;  // Binary sensor stream
+QuietPars Quiet;  // Quiet detection tuning, 'q' commands
+Clock Clk;  // 64 bit time for everything; see Clock.h
+Power Pwr;  // Wake-on-motion doze, 'wp' command
+Flash(snap_flash, SNAP_BYTES);  // Warm boot snapshot region
+Snapshot Snap(&snap_flash, &Writer);  // Warm boot state
+Datum_st log_ram[NDATUM];  // Event log storage, in place so the link map shows it (coll_ram)
+Register_st log_reg[NREG];
+LoadShed Load;  // Frame overruns shed output before sampling falls behind, 'lt' counters
+extern const CmdEntry cmd_table[];  // Serial commands, at the end of this file
+extern const uint8_t n_cmd;
 
 // Setup
 void setup() {
@@ -90,7 +119,9 @@ void setup() {
   // Wire.setClock(400000UL);
 
   unit = version.c_str(); unit  += "_"; unit += HDWE_UNIT.c_str();
-  setTime(time_initial);
+  Quiet.nominal();
+  Clk.set(time_initial);
+  Snap.begin();  // the last known time and settings, if there are any
 
   // Serial
   Serial.begin(SERIAL_BAUD);
@@ -102,13 +133,16 @@ void setup() {
   // IMU
   if ( !IMU.begin() )
   {
-    Serial.println("Failed to initialize IMU!");
+    Serial.println("Failed to initialize IMU!");  // direct; nothing drains Tx from here
     while (1);
   }
 
   // Time to start serial monitor not Arduino IDE
   delay(5);
 
+  // Collision log
+  Store.begin();
+
   // Say 'Hello'
   say_hello();
 
@@ -118,174 +152,179 @@ void setup() {
 // Loop
 void loop()
 {
-  static unsigned long long now_ms = (unsigned long long) millis();
-  boolean chitchat = false;
-  static Sync *Talk = new Sync(TALK_DELAY);
   boolean read = false;
-  static Sync *ReadSensors = new Sync(READ_DELAY);
+  static Sync ReadSensors(READ_DELAY);
   boolean publishing;
-  static Sync *Plotting = new Sync(PLOT_DELAY);
+  static Sync Plotting(PLOT_DELAY);
   boolean control = false;
-  static Sync *ControlSync = new Sync(CONTROL_DELAY);
+  static Sync ControlSync(CONTROL_DELAY);
   boolean blink = false;
   boolean blink_on = false;
-  static Sync *BlinkSync = new Sync(BLINK_DELAY);
+  static Sync BlinkSync(BLINK_DELAY);
   boolean active = false;
-  static Sync *ActiveSync = new Sync(ACTIVE_DELAY);
+  static Sync ActiveSync(ACTIVE_DELAY);
   unsigned long long elapsed = 0;
   static boolean reset = true;
-  static unsigned long long time_start = millis();
+  static unsigned long long time_start = Clk.up_ms();
   boolean gyro_ready = false;
   boolean accel_ready = false;
   static boolean monitoring_past = monitoring;
-  static time_t new_event = 0;
-  static Sensors *Sen = new Sensors(millis(), double(NOM_DT));
-  static Data_st *L = new Data_st(NDATUM, NHOLD, NREG);  // Event log
-  static boolean logging = false;
-  static boolean logging_past = false;
-  static uint16_t log_size = 0;
+  static Sensors Sen(Clk.up_ms(), double(NOM_DT), &Quiet);
+  static boolean warm = Snap.warm(&Sen);  // filter states from the snapshot, so no reset pass
+  static Data_st L(log_ram, NDATUM, NHOLD, log_reg, NREG);  // Event log
+  static CollCore Core(&Sen, &L);  // Trigger and log pipeline
+  static CmdReader Cmds(cmd_table, n_cmd);
   boolean plotting = false;
 
 
   ///////////////////////////////////////////////////////////// Top of loop////////////////////////////////////////
 
-  // Synchronize
-  now_ms = (unsigned long long) millis();
-  if ( now_ms - last_sync > ONE_DAY_MILLIS || reset )  sync_time(&last_sync, &millis_flip); 
-  read = ReadSensors->update(millis(), reset);
-  chitchat = Talk->update(millis(), reset);
-  elapsed = ReadSensors->now() - time_start;
-  control = ControlSync->update(millis(), reset);
-  blink = BlinkSync->update(millis(), reset);
-  active = ActiveSync->update(millis(), reset);
-  publishing = Plotting->update(millis(), reset);
+  // Dozing - nap until the IMU sees motion
+  if ( Pwr.dozing() && !Pwr.nap() ) return;
+  PROBE_MARK(loop_us);
+
+  // Synchronize, from one clock read
+  unsigned long long now_ms = Clk.up_ms();
+  read = ReadSensors.update(now_ms, reset);
+  elapsed = ReadSensors.now() - time_start;
+  control = ControlSync.update(now_ms, reset);
+  blink = BlinkSync.update(now_ms, reset);
+  active = ActiveSync.update(now_ms, reset);
+  publishing = Plotting.update(now_ms, reset);
   plotting = plotting_all;
   boolean inhibit_talk = plotting_all && plot_num==7;
 
   if ( reset )
   {
-    Serial.print("size of ram NDATUM="); Serial.println(NDATUM);
-    Serial.print("num precursors NHOLD="); Serial.println(NHOLD);
-    Serial.print("num reg entries NREG="); Serial.println(NREG);
-    Serial.print("iR="); Serial.println(L->iR());
-    Serial.print("iRg="); Serial.println(L->iRg());
+    Text.print("size of ram NDATUM="); Text.println(NDATUM);
+    Text.print("num pretrigger NHOLD="); Text.println(NHOLD);
+    Text.print("num reg entries NREG="); Text.println(NREG);
+    Text.print("iR="); Text.println(L.iR());
+    Text.print("iRg="); Text.println(L.iRg());
   }
 
   if ( print_mem )
   {
-    Serial.print("size of ram NDATUM="); Serial.println(NDATUM);
-    Serial.print("num precursors NHOLD="); Serial.println(NHOLD);
-    Serial.print("num reg entries NREG="); Serial.println(NREG);
-    Serial.print("iR="); Serial.println(L->iR());
-    Serial.print("iRg="); Serial.println(L->iRg());
-    Serial.print("Data_st size: "); Serial.println(L->size());
+    Text.print("size of ram NDATUM="); Text.println(NDATUM);
+    Text.print("num pretrigger NHOLD="); Text.println(NHOLD);
+    Text.print("num reg entries NREG="); Text.println(NREG);
+    Text.print("iR="); Text.println(L.iR());
+    Text.print("iRg="); Text.println(L.iRg());
+    Text.print("Data_st size: "); Text.println(L.size());
+    Tx.print_stats();
+    Snap.print(&Text);
+    Load.print(&Text);
     print_mem = false;  // print once
   }
 
   // Read sensors
   if ( read )
   {
-
-    Sen->sample(reset, millis(), time_start, now());
-    Sen->filter(reset);
-    Sen->quiet_decisions(reset);
-    L->put_precursor(Sen);
-
-    // Logic
-    if ( Sen->both_not_quiet() && !logging )
+    PROBE_MARK(read_us);
+    TRACE_BEGIN(TRACE_READ);
+    ImuSample imu;
+    unsigned long long up_us;
+    uint8_t replayed = 1;
+    boolean replay = Pwr.replay(&imu, &up_us);  // frames the FIFO saved while dozing come first, REPLAY_FRAMES a pass
+    if ( !replay )
     {
-      logging = true;
-      new_event = Sen->t_ms;
-      log_size++;
+      PROBE_MARK(sample_us);
+      TRACE_BEGIN(TRACE_SAMPLE);
+      Sen.sample(reset && !warm, &imu);
+      TRACE_END(TRACE_SAMPLE, 0);
+      PROBE_SINCE(PROBE_SAMPLE, sample_us);
+      up_us = Clk.up_us();
     }
-    else
+    Load.frame(up_us, !replay && !reset);
+    do
     {
-      if ( Sen->both_are_quiet() && logging )
-      {
-        logging = false;  // This throws out the last event
-      }
-      log_size = 0;
-    }
+      uint8_t changed = Core.step(reset && !warm, &imu, up_us / 1000ULL, Clk.ms(up_us), inhibit_talk);
+      if ( Load.allow(SHED_DUMP) ) Telem.run(&Sen);
+      else Telem.shed();
 
-    // Log data - full resolution since part of 'read' frame
-    if ( logging && !logging_past)
-    {
-      L->register_lock(inhibit_talk, Sen);  // after move_precursor so has values on first save
-      if ( !inhibit_talk ) { Serial.println(""); Serial.println("Logging started"); }
-  
-      L->move_precursor();
-      L->put_ram(Sen);
-    }
-    else if ( !logging && logging_past )
-    {
-      L->put_ram(Sen);
-      if ( !inhibit_talk ) Serial.println("Logging stopped");
-      L->register_unlock(inhibit_talk, Sen);
-      if ( !plotting )
+      if ( changed == CORE_STARTED )
       {
-        // Serial.println("All ram");
-        // L->print_ram();
-        Serial.println("Latest ram");
-        L->print_latest_ram();
-        Serial.println("Registers");
-        L->print_all_registers();
-        Serial.println("Latest register");
-        L->print_latest_register();
+        if ( !inhibit_talk ) { Text.println(""); Text.println("Logging started"); }
       }
-      else if ( plotting_all && plot_num==7 )
+      else if ( changed == CORE_STOPPED )
       {
-        L->plot_latest_ram();  // pa7
+        if ( !inhibit_talk ) Text.println("Logging stopped");
+        Store.commit(&L, L.iRg());
+        if ( !plotting )
+        {
+          // Tx.line(&Data, "All ram");
+          // L.print_ram();
+          Tx.line(&Data, "Latest ram");
+          L.print_latest_ram();
+          Tx.line(&Data, "Registers");
+          L.print_all_registers();
+          Tx.line(&Data, "Latest register");
+          L.print_latest_register();
+        }
+        else if ( plotting_all && plot_num==7 )
+        {
+          L.plot_latest_ram(plot_pace);  // pa7
+        }
       }
-    }
-    else if ( logging )
-    {
-      L->put_ram(Sen);
-    }
-
-    logging_past = logging;
+    } while ( replay && replayed++ < REPLAY_FRAMES && Pwr.replay(&imu, &up_us) );  // the rest next pass, so flash and Tx keep up
+
+    // Flash - step right after sampling so any NVM stall lands in the idle part of the frame
+    PROBE_MARK(flash_us);
+    TRACE_BEGIN(TRACE_FLASH);
+    Store.run();
+    Snap.run(now_ms, &Sen);
+    Writer.run(FLASH_BUDGET_US);
+    TRACE_END(TRACE_FLASH, 0);
+    PROBE_SINCE(PROBE_FLASH, flash_us);
+    TRACE_END(TRACE_READ, 0);
+    PROBE_SINCE(PROBE_READ, read_us);
 
   }  // end read
 
-  // Publish
-  if ( publishing )
+  // Publish - first to go when frames overrun
+  if ( publishing && Load.allow(SHED_PLOT) )
   {
-    if ( monitoring && ( monitoring != monitoring_past ) ) Sen->print_all_header();
-    if ( monitoring ) Sen->print_all();
+    PROBE_MARK(publish_us);
+    TRACE_BEGIN(TRACE_PUBLISH);
+    if ( monitoring && ( monitoring != monitoring_past ) ) Sen.print_all_header();
+    if ( monitoring ) Sen.print_all();
     else if ( plotting_all )
     {
       static boolean done = false;
       switch ( plot_num )
       {
       case 0:
-        Sen->plot_all_sum();
+        Sen.plot_all_sum();
         break;
       case 1:
-        Sen->plot_all_acc();
+        Sen.plot_all_acc();
         break;
       case 2:
-        Sen->plot_all_rot();
+        Sen.plot_all_rot();
         break;
       case 3:
-        Sen->plot_all();
+        Sen.plot_all();
         break;
       case 4:
-        Sen->plot_quiet();
+        Sen.plot_quiet();
         break;
       case 5:
-        Sen->plot_quiet_raw();
+        Sen.plot_quiet_raw();
         break;
       case 6:
-        Sen->plot_total();
+        Sen.plot_total();
         break;
       case 7:
         break;
       default:
-        Serial.println("plot number unknown enter plot number e.g. pa0 (sum), pa1 (acc), pa2 (rot), pa3 (all), pa4 (quiet), pa5 (quiet raw), pa6 (total) or pa7 (sum plot)");
+        Text.println("plot number unknown enter plot number e.g. pa0 (sum), pa1 (acc), pa2 (rot), pa3 (all), pa4 (quiet), pa5 (quiet raw), pa6 (total) or pa7 (sum plot)");
         break;
       }
     }
 
     monitoring_past = monitoring;
+    TRACE_END(TRACE_PUBLISH, plot_num);
+    PROBE_SINCE(PROBE_PUBLISH, publish_us);
   }
 
   gyro_ready = false;
@@ -295,9 +334,9 @@ void loop()
   if ( read ) reset = false;
 
   // Blink when threshold breached and therefore logging
-  if ( blink )
+  if ( blink && Load.allow(SHED_BLINK) )
   {
-    if ( !logging )
+    if ( !Core.logging() )
     {
       blink_on = false;
     }
@@ -309,14 +348,14 @@ void loop()
     else digitalWrite(LED_BUILTIN, LOW);
   }
 
-  if ( active )
+  if ( active && Load.allow(SHED_BLINK) )
   {
     static int i_count = 0;
 
     // Blink number of stored registers
-    if ( L->num_active_registers() > 0 )   // num_active_registers
+    if ( L.num_active_registers() > 0 )   // num_active_registers
     {
-      if ( i_count < L->num_active_registers() ) blink_on = !blink_on;
+      if ( i_count < L.num_active_registers() ) blink_on = !blink_on;
       if ( blink_on ) digitalWrite(LED_BUILTIN, HIGH);
       else digitalWrite(LED_BUILTIN, LOW);
  
@@ -325,224 +364,310 @@ void loop()
     }
   }
 
-  if ( chitchat )
-  {
-    // Serial.println("chitchat");
-    read_serial();  // returns one command at a time
-    
+  // Chitchat
+  PROBE_MARK(chitchat_us);
 
-    if ( input_str.length() )
-    {
-      // Now we know the letters
-      Serial.print("input_str: "); Serial.print(input_str);
-      char letter_0 = '\0';
-      char letter_1 = '\0';
-      letter_0 = input_str.charAt(0);
-      letter_1 = input_str.charAt(1);
-      int i_value = -1;  // default value is not something used, so it stops plots
-      input_str.substring(input_str, 2).toInt(i_value);
-      Serial.print(" letter_0: "); Serial.print(letter_0); Serial.print(" letter_1: "); Serial.print(letter_1); Serial.print(" i_value: "); Serial.println(i_value);
-      switch ( letter_0 )
-      {
-        case ( 'p' ):
-          switch ( letter_1 )
-          {
-            case ( 'p' ):  // pa - plot all filtered
-              switch ( i_value )
-              {
-                case 0 ... 7:
-                  plot_num = i_value;
-                  plotting_all = true;
-                  monitoring = false;
-                  break;
-                default:
-                  Serial.println("plot number unknown enter plot number e.g. pa0 (sum), pa1 (acc), pa2 (rot), pa3 (all), pa4 (quiet), pa5 (quiet raw), pa6 (total) or pa7 (sum plot)");
-                  plotting_all = false;
-                  break;
-              }
-              break;
-            case ( 'h' ):  // ph - print history
-              Serial.println("History:");
-              L->print_ram();
-              break;
-            case ( 'r' ):  // pr - print registers
-              Serial.println("Registers:");
-              L->print_all_registers();
-              break;
-            default:
-              Serial.print(input_str.charAt(1)); Serial.print(" for "); Serial.print(input_str); Serial.println(" unknown");
-              break;
-          }
-          break;
-        case ( 'm' ):  // m  - print all
-          plotting_all = false;
-          monitoring = !monitoring;
-          break;
-        case ( 'h' ):  // h  - help
-          plotting_all = false;
-          monitoring = false;
-          Serial.println("h - this help");
-          Serial.println("HELP");
-          Serial.println("ppX - plot all version X");
-          Serial.println("\t X=blank - stop plotting");
-          Serial.println("\t X=0 - summary (g_raw, g_filt, g_quiet, q_is_quiet_sure, o_raw, o_filt, o_quiet, o_is_quiet_sure)");
-          Serial.println("\t X=1 - g sensors (T_acc, x_filt, y_filt, z_filt, g_filt, g_is_quiet, g_is_quiet_sure)");
-          Serial.println("\t X=2 - rotational sensors (T_rot, a_filt, b_filt, c_filt, o_filt, o_is_quiet, o_is_quiet_sure)");
-          Serial.println("\t X=3 - all sensors (x_filt, y_filt, z_filt, g_filt, a_filt, b_filt, c_filt, o_filt)");
-          Serial.println("\t X=4 - quiet results ( T_rot, o_filt, o_quiet, o_is_quiet_sure, T_acc, g_filt, g_quiet, g_is_quiet_sure)");
-          Serial.println("\t X=5 - quiet filtering metrics (o_quiet, g_quiet)");
-          Serial.println("\t X=6 - total (T_rot, o_filt, T_acc, g_filt)");
-          Serial.println("\t X=7 - summary for plot");
-          Serial.println("ph - print history");
-          Serial.println("pr - print registers");
-          Serial.println("m  - print all");
-          Serial.println("s  - print sizes for all (will vary depending on history of collision)");
-          Serial.println("UTxxxxxxx - set time to x (x is integer from https://www.epochconverter.com/)");
-          Serial.println("vvX  - verbosity debug level");
-          Serial.println("  vv9  - time trace in Sensors");
-          break;
-        case ( 's' ):  // s - sizes for all
-          print_mem = true;
-          break;
-        case ( 'U' ):
-          switch ( letter_1 )
-          {
-            case ( 'T' ):
-              input_str.substring(input_str, 2).toInt(i_value);
-              time_initial = time_t ( i_value );
-              setTime(time_initial);
-              prn_buff = "---";
-              time_long_2_str(time_initial*1000, prn_buff);
-              Serial.println("Time set to: "); Serial.print(time_initial); Serial.print(" = "); Serial.println(prn_buff);
-              break;
-            default:
-              Serial.print(input_str.charAt(1)); Serial.println(" unknown");
-              break;
-          }
-          break;
-        case ( 'v' ):
-          switch ( letter_1 )
-          {
-            case ( 'v' ):
-              debug = i_value;
-            break;
-            default:
-              Serial.print(letter_1); Serial.println(" unknown");
-              break;
-          }
-          break;
-        default:
-          Serial.print(letter_0); Serial.println(" unknown");
-          break;
-      }
-    }
-    input_str = "";
-    
+  // Commands - take what has arrived, run one per pass.  Never shed, so a host can stop what overruns.
+  Cmds.read(&Serial);
+  Cmds.run(&L);
+
+  // Download and trace dump - a packet each per pass while the port has room; shed after plots
+  if ( Load.allow(SHED_DUMP) )
+  {
+    Link.run();
+#if TRACES
+    Tracer.run();
+#endif
   }
+
+  // Serial output - whatever USB will take without waiting.  Never shed, so queued output drains.
+  Tx.run();
+  PROBE_SINCE(PROBE_CHITCHAT, chitchat_us);
+  PROBE_SINCE(PROBE_LOOP, loop_us);  // before the doze, which sleeps
+
+  // Doze - still, idle and on battery; standby would drop a USB host.  With no host, waiting output and
+  // a download can't drain, so they keep in ram through the doze rather than holding it off.
+  boolean still = !Serial && !Core.logging() && Sen.both_are_quiet() && !Store.busy() && !Writer.busy();
+  if ( Pwr.ready(now_ms, still) && Snap.settled(now_ms, &Sen) ) Pwr.doze();
     // Serial.println("end");
 
 }  // loop
 
 
-// Read serial for chitchat
-void read_serial()
+// Serial command handlers.  ctx is the Ram log.
+
+// dc - continue download from byte X
+void cmd_dc(Cmd *c, void *ctx)
 {
-  boolean serial_ready = false;
-  serial_str = "";
+  if ( !Link.resume(c->i) ) { Text.print("cannot resume at "); Text.println(c->i); }
+}
 
-  // Each pass try to complete input from avaiable
-  while ( !serial_ready && Serial.available() )
-  {
-    char in_char = (char)Serial.read();  // get the new byte
+// dr - download ram register X, latest when blank
+void cmd_dr(Cmd *c, void *ctx)
+{
+  Data_st *L = (Data_st *)ctx;
+  if ( !Link.send_ram(L, c->i<0 ? L->iRg() : c->i) ) { Text.print("no register "); Text.println(c->i); }
+}
 
-    // Intake
-    // if the incoming character to finish, add a ';' and set flags so the main loop can do something about it:
-    if ( is_finished(in_char) )
-    {
-        if ( serial_str.length() ) serial_str.concat(';');
-        serial_ready = true;
-        break;
-    }
+// ds - download stored event X
+void cmd_ds(Cmd *c, void *ctx)
+{
+  if ( !Link.send_stored(c->i) ) { Text.print("no stored event "); Text.println(c->i); }
+}
 
-    else if ( in_char == '\r' )
-    {
-        Serial.println("\n");  // scroll user terminal
-    }
+// dx - abort download
+void cmd_dx(Cmd *c, void *ctx)
+{
+  Link.abort();
+}
 
-    else if ( in_char == '\b' && serial_str.length() )
-    {
-        Serial.print("\b \b");  // scroll user terminal
-        serial_str.remove(serial_str.length() -1 );  // backspace
-    }
+// h - help
+void cmd_h(Cmd *c, void *ctx)
+{
+  plotting_all = false;
+  monitoring = false;
+  Tx.job(&Text, help_line, NULL);
+}
 
-    else
-    {
-        serial_str += in_char;  // process new valid character
-    }
+// lt - loop timing, overruns and stage times since the last lt
+void cmd_lt(Cmd *c, void *ctx)
+{
+  Load.print(&Text);
+#if PROBES
+  Tx.job(&Text, probe_line, NULL);
+#else
+  Text.println("no loop timing, PROBES 0");
+#endif
+}
 
-  }
+// m - print all
+void cmd_m(Cmd *c, void *ctx)
+{
+  plotting_all = false;
+  monitoring = !monitoring;
+  Telem.stop();
+}
+
+// pe - print collision log event X
+void cmd_pe(Cmd *c, void *ctx)
+{
+  if ( !Store.print_event(c->i) ) { Text.print("no stored event "); Text.println(c->i); }
+}
+
+// ph - print history
+void cmd_ph(Cmd *c, void *ctx)
+{
+  Tx.line(&Data, "History:");
+  ((Data_st *)ctx)->print_ram();
+}
 
-  // Pass info to serial_str
-  if ( serial_ready )
+// pp - plot all version X
+void cmd_pp(Cmd *c, void *ctx)
+{
+  switch ( c->i )
   {
-    input_str += serial_str.c_str();
-    finish_request(input_str);
-    serial_ready = false;
-    serial_str = "";
+    case 0 ... 7:
+      plot_num = c->i;
+      plotting_all = true;
+      monitoring = false;
+      Telem.stop();
+      break;
+    default:
+      Text.println("plot number unknown enter plot number e.g. pa0 (sum), pa1 (acc), pa2 (rot), pa3 (all), pa4 (quiet), pa5 (quiet raw), pa6 (total) or pa7 (sum plot)");
+      plotting_all = false;
+      break;
   }
 }
 
-// Cleanup string for final processing by chitchat
-void finish_request(SafeString &str)
+// pr - print registers and X worst stored
+void cmd_pr(Cmd *c, void *ctx)
 {
-  // Remove whitespace
-  str.trim();
-  str.replace("\n", "");
-  str.replace("\0", "");
-  str.replace("", "");
-  str.replace(",", "");
-  str.replace(" ", "");
-  str.replace("=", "");
-  str.replace(";", "");
+  Tx.line(&Data, "Registers:");
+  ((Data_st *)ctx)->print_all_registers();
+  Store.print_worst( c->i<0 ? 5 : c->i );
 }
 
-// Test for string completion character
-boolean is_finished(const char in_char)
+// ps - print collision log
+void cmd_ps(Cmd *c, void *ctx)
 {
-    return  in_char == '\n' ||
-            in_char == '\0' ||
-            in_char == ';'  ||
-            in_char == ',';    
+  Store.print();
 }
 
-// Say hello
-void say_hello()
+// pt - plot playback period
+void cmd_pt(Cmd *c, void *ctx)
 {
-  Serial.print("Gyroscope sample rate = ");
-  Serial.print(IMU.gyroscopeSampleRate());
-  Serial.println(" Hz");
-  Serial.println();
-  Serial.println("Gyroscope in degrees/second");
-  Serial.print("Accelerometer sample rate = ");
-  Serial.print(IMU.accelerationSampleRate());
-  Serial.println(" Hz");
-  Serial.println();
-  Serial.println("Acceleration in g's");
-  Serial.println("Set time using command 'UTxxxxxxx' where 'xxxxxx' is integer from https://www.epochconverter.com/");
-  Serial.println("Check time using command 'vv9;vv0;");
+  if ( c->i > 0 ) { plot_pace = c->i; Snap.request(); }
+  Text.print("plot playback period ms "); Text.println(plot_pace);
 }
 
-// Time synchro so printed decimal times align with hms rolls
-void sync_time(unsigned long long *last_sync, unsigned long long *millis_flip)
+// q - quiet tuning; any X that is not a positive number just shows it
+void quiet_set(Cmd *c, float *par)
+{
+  if ( ( c->type == CMD_INT || c->type == CMD_FLOAT ) && c->f > 0. ) { *par = c->f; Snap.request(); }
+  Quiet.print(&Text);
+}
+void cmd_qg(Cmd *c, void *ctx) { quiet_set(c, &Quiet.g_thr); }
+void cmd_qn(Cmd *c, void *ctx) { Quiet.nominal(); Snap.request(); Quiet.print(&Text); }
+void cmd_qo(Cmd *c, void *ctx) { quiet_set(c, &Quiet.o_thr); }
+void cmd_qr(Cmd *c, void *ctx) { quiet_set(c, &Quiet.r_scl); }
+void cmd_qs(Cmd *c, void *ctx) { quiet_set(c, &Quiet.quiet_s); }
+void cmd_qt(Cmd *c, void *ctx) { quiet_set(c, &Quiet.tau_q); }
+void cmd_qw(Cmd *c, void *ctx) { quiet_set(c, &Quiet.wn_q); }
+void cmd_qz(Cmd *c, void *ctx) { quiet_set(c, &Quiet.zeta_q); }
+
+// s - sizes for all
+void cmd_s(Cmd *c, void *ctx)
 {
-  *last_sync = millis();
+  print_mem = true;
+}
 
-  // Refresh millis() at turn of Time.now
-  int count = 0;
-  long time_begin = now();  // Seconds since start of epoch
-  while ( now()==time_begin && ++count<1100 )  // Time.now() truncates to seconds
-  {
-    delay(1);
-    *millis_flip = millis()%1000;
-  }
+// tc - telemetry channels, a mask or a name
+void cmd_tc(Cmd *c, void *ctx)
+{
+  if ( c->type == CMD_INT ) Telem.mask(c->i);
+  else if ( c->type == CMD_NAME && !Telem.select(c->arg()) ) { Text.print(c->arg()); Text.println(" unknown"); }
+  if ( c->type == CMD_INT || c->type == CMD_NAME ) Snap.request();
+  Telem.print(&Text);
+}
+
+// td - telemetry decimation
+void cmd_td(Cmd *c, void *ctx)
+{
+  if ( c->i > 0 ) { Telem.decim(c->i > 255 ? 255 : c->i); Snap.request(); }
+  Telem.print(&Text);
+}
+
+// tg - telemetry go
+void cmd_tg(Cmd *c, void *ctx)
+{
+  plotting_all = false;
+  monitoring = false;
+  Telem.start();
+  Telem.print(&Text);
+}
+
+// tr - time now, then the trace dump, binary
+void cmd_tr(Cmd *c, void *ctx)
+{
+  time_t now_s = time_t( Clk.ms() / 1000ULL );
+  prn_buff = "---";
+  time_long_2_str(now_s*1000, prn_buff);
+  Text.print("Time now: "); Text.print(now_s); Text.print(" = "); Text.println(prn_buff);
+#if TRACES
+  Tracer.print(&Text);
+  if ( !Tracer.dump(Clk.ms()) ) Text.println("trace dump under way");
+#else
+  Text.println("no trace, TRACES 0");
+#endif
+}
+
+// tx - telemetry stop
+void cmd_tx(Cmd *c, void *ctx)
+{
+  Telem.stop();
+  Telem.print(&Text);
+}
+
+// wp - wake-on-motion power saving on (1) or off (0), counters (X=blank)
+void cmd_wp(Cmd *c, void *ctx)
+{
+  if ( c->type == CMD_INT ) { Pwr.enable(c->i != 0); Snap.request(); }
+  Pwr.print(&Text);
+}
+
+// UT - set time
+void cmd_UT(Cmd *c, void *ctx)
+{
+  if ( c->type != CMD_INT ) { Text.println("UT needs an integer"); return; }
+  time_initial = time_t ( c->i );
+  Clk.set(time_initial);
+  Snap.request();
+  prn_buff = "---";
+  time_long_2_str(time_initial*1000, prn_buff);
+  Text.println("Time set to: "); Text.print(time_initial); Text.print(" = "); Text.println(prn_buff);
+}
+
+const CmdEntry cmd_table[] = {
+  {"dc", cmd_dc}, {"dr", cmd_dr}, {"ds", cmd_ds}, {"dx", cmd_dx},
+  {"h", cmd_h}, {"lt", cmd_lt}, {"m", cmd_m},
+  {"pe", cmd_pe}, {"ph", cmd_ph}, {"pp", cmd_pp}, {"pr", cmd_pr}, {"ps", cmd_ps}, {"pt", cmd_pt},
+  {"qg", cmd_qg}, {"qn", cmd_qn}, {"qo", cmd_qo}, {"qr", cmd_qr}, {"qs", cmd_qs}, {"qt", cmd_qt}, {"qw", cmd_qw}, {"qz", cmd_qz},
+  {"s", cmd_s},
+  {"tc", cmd_tc}, {"td", cmd_td}, {"tg", cmd_tg}, {"tr", cmd_tr}, {"tx", cmd_tx},
+  {"UT", cmd_UT}, {"wp", cmd_wp},
+};
+const uint8_t n_cmd = sizeof(cmd_table)/sizeof(cmd_table[0]);
+
+// Help text, one line per Tx job call
+static const char *help_text[] = {
+  "h - this help",
+  "HELP",
+  "Commands end at ';' ',' or end of line, several to a line, e.g. 'tc raw; td 2; tg'",
+  "ppX - plot all version X",
+  "\t X=blank - stop plotting",
+  "\t X=0 - summary (g_raw, g_filt, g_quiet, q_is_quiet_sure, o_raw, o_filt, o_quiet, o_is_quiet_sure)",
+  "\t X=1 - g sensors (T_acc, x_filt, y_filt, z_filt, g_filt, g_is_quiet, g_is_quiet_sure)",
+  "\t X=2 - rotational sensors (T_rot, a_filt, b_filt, c_filt, o_filt, o_is_quiet, o_is_quiet_sure)",
+  "\t X=3 - all sensors (x_filt, y_filt, z_filt, g_filt, a_filt, b_filt, c_filt, o_filt)",
+  "\t X=4 - quiet results ( T_rot, o_filt, o_quiet, o_is_quiet_sure, T_acc, g_filt, g_quiet, g_is_quiet_sure)",
+  "\t X=5 - quiet filtering metrics (o_quiet, g_quiet)",
+  "\t X=6 - total (T_rot, o_filt, T_acc, g_filt)",
+  "\t X=7 - summary for plot",
+  "ptX - event playback period for pp7, ms (X=blank - show)",
+  "ph - print history",
+  "prX - print registers and X worst stored events from flash index (X=blank - 5)",
+  "ps - print collision log in flash",
+  "peX - print collision log event X",
+  "dsX - download collision log event X, binary (CollisionHost/coll_recv)",
+  "drX - download ram register X, binary (X=blank - latest)",
+  "dcX - continue download from byte X",
+  "dx  - abort download",
+  "m  - print all",
+  "lt  - loop timing: overrun and shed counters, us per stage and a log2 histogram since the last lt (CollisionHost/coll_bench on the host)",
+  "qoX - quiet threshold, rotation, rps (X=blank - show)",
+  "qgX - quiet threshold, acceleration, g's",
+  "qsX - quiet set persistence, sec",
+  "qrX - quiet reset persistence scalar on qs",
+  "qtX - quiet rate time constant, sec",
+  "qwX - quiet filter natural frequency, r/s",
+  "qzX - quiet filter damping factor",
+  "qn  - quiet tuning back to nominal (CollisionHost/coll_sweep to choose)",
+  "tcX - telemetry channels: a name, a group or a decimal sum of bits (X=blank - show)",
+  "\t time (3) - T_rot, T_acc",
+  "\t raw (1020) - a, b, c, o, x, y, z, g",
+  "\t filt (261120) - a, b, c, o, x, y, z, g",
+  "\t quiet (3932160) - o_qrate, o_quiet, g_qrate, g_quiet",
+  "\t dec (4194304) - quiet decisions",
+  "\t all (8388607)",
+  "tdX - telemetry every X reads",
+  "tg  - telemetry go, binary (CollisionHost/telem_csv)",
+  "tr  - time now, then trace dump, binary, ring since the last tr; build with TRACES 1 (CollisionHost/coll_trace)",
+  "tx  - telemetry stop",
+  "s  - print sizes for all (will vary depending on history of collision)",
+  "UTxxxxxxx - set time to x (x is integer from https://www.epochconverter.com/)",
+  "wpX - wake-on-motion power saving, 1 on 0 off (X=blank - show counters); dozes only with no USB host, move it to wake",
+};
+
+boolean help_line(Print *out, const uint16_t k, void *ctx)
+{
+  if ( k >= sizeof(help_text)/sizeof(help_text[0]) ) return ( false );
+  out->println(help_text[k]);
+  return ( true );
+}
+
+// Say hello
+void say_hello()
+{
+  Text.print("Gyroscope sample rate = ");
+  Text.print(IMU.gyroscopeSampleRate());
+  Text.println(" Hz");
+  Text.println();
+  Text.println("Gyroscope in degrees/second");
+  Text.print("Accelerometer sample rate = ");
+  Text.print(IMU.accelerationSampleRate());
+  Text.println(" Hz");
+  Text.println();
+  Text.println("Acceleration in g's");
+  Text.println("Set time using command 'UTxxxxxxx' where 'xxxxxx' is integer from https://www.epochconverter.com/");
+  Text.println("Check time using command 'tr'");
 }
@@ -131,12 +131,12 @@ void FlashClass::erase(const volatile void *flash_ptr, uint32_t size)
 void FlashClass::erase(const volatile void *flash_ptr)
 {
 #if defined(__SAMD51__)
-  NVMCTRL->ADDR.reg = ((uint32_t)flash_ptr);
+  NVMCTRL->ADDR.reg = ((uint32_t)(uintptr_t)flash_ptr);
   NVMCTRL->CTRLB.reg = NVMCTRL_CTRLB_CMDEX_KEY | NVMCTRL_CTRLB_CMD_EB;
   while (!NVMCTRL->INTFLAG.bit.DONE) { }
   invalidate_CMCC_cache();
 #else
-  NVMCTRL->ADDR.reg = ((uint32_t)flash_ptr) / 2;
+  NVMCTRL->ADDR.reg = ((uint32_t)(uintptr_t)flash_ptr) / 2;
   NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_ER;
   while (!NVMCTRL->INTFLAG.bit.READY) { }
 #endif
@@ -58,6 +58,7 @@ public:
   void write(const volatile void *flash_ptr, const void *data, uint32_t size);
   void erase(const volatile void *flash_ptr, uint32_t size);
   void read(const volatile void *flash_ptr, void *data, uint32_t size);
+  const volatile void *address() { return flash_address; }
   uint32_t size(){ return flash_size; }
   uint32_t page_size() { return PAGE_SIZE; }
   uint32_t pages() { return PAGES; }
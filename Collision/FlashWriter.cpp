@@ -0,0 +1,166 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "FlashWriter.h"
+
+static const uint32_t pageSizes[] = { 8, 16, 32, 64, 128, 256, 512, 1024 };
+
+// Constructors
+FlashWriter::FlashWriter()
+  : dst_(NULL), size_(0), done_(0), erased_to_(0), page_size_(0), row_size_(0), stalls_(0),
+  fill_(NULL), done_cb_(NULL), ctx_(NULL), state_(IDLE)
+{}
+
+// Give up on the current job
+void FlashWriter::abort()
+{
+  if ( busy() ) finish(false);
+}
+
+// Start a job.  dst must be page aligned; if it is not row aligned the rest of its row must already
+// be erased.  Returns false if busy or the page does not fit the stage.
+boolean FlashWriter::begin(const volatile void *dst, const uint32_t size, FlashFill fill, FlashDone done, void *ctx)
+{
+  if ( busy() ) return ( false );
+  page_size_ = pageSizes[NVMCTRL->PARAM.bit.PSZ];
+  #if defined(__SAMD51__)
+    row_size_ = page_size_ * NVMCTRL->PARAM.bit.NVMP / 64;
+  #else
+    row_size_ = page_size_ * 4;
+  #endif
+  if ( page_size_ > FLASH_PAGE_MAX || ((uint32_t)(uintptr_t)dst) % page_size_ ) return ( false );
+  dst_ = (volatile uint32_t *)dst;
+  size_ = size;
+  done_ = 0;
+  erased_to_ = ( row_size_ - ((uint32_t)(uintptr_t)dst) % row_size_ ) % row_size_;  // rest of a started row is already erased
+  fill_ = fill;
+  done_cb_ = done;
+  ctx_ = ctx;
+  #if defined(__SAMD51__)
+    NVMCTRL->CTRLA.bit.WMODE = 0;
+  #else
+    NVMCTRL->CTRLB.bit.MANW = 1;  // Disable automatic page write
+  #endif
+  state_ = ERASE;
+  return ( true );
+}
+
+// Close out a job and tell the owner
+void FlashWriter::finish(const boolean ok)
+{
+  state_ = IDLE;
+  if ( done_cb_ ) done_cb_(ok, ctx_);
+}
+
+// Lock, programming or NVM errors latched by the last command
+boolean FlashWriter::nvm_error()
+{
+  #if defined(__SAMD51__)
+    return ( NVMCTRL->INTFLAG.bit.ADDRE || NVMCTRL->INTFLAG.bit.PROGE || NVMCTRL->INTFLAG.bit.LOCKE || NVMCTRL->INTFLAG.bit.NVME );
+  #else
+    return ( NVMCTRL->STATUS.bit.PROGE || NVMCTRL->STATUS.bit.LOCKE || NVMCTRL->STATUS.bit.NVME );
+  #endif
+}
+
+boolean FlashWriter::nvm_ready()
+{
+  #if defined(__SAMD51__)
+    return ( NVMCTRL->STATUS.bit.READY );
+  #else
+    return ( NVMCTRL->INTFLAG.bit.READY );
+  #endif
+}
+
+// One step per NVM command:  erase the row ahead of the page about to be written, else stage and
+// program one page.  Never waits on NVM; returns as soon as it is busy or the budget is spent.
+void FlashWriter::run(const unsigned long budget_us)
+{
+  unsigned long start = micros();
+  do
+  {
+    if ( state_ == IDLE ) return;
+    if ( !nvm_ready() )
+    {
+      stalls_++;
+      return;
+    }
+    if ( nvm_error() )
+    {
+      finish(false);
+      return;
+    }
+    if ( done_ >= size_ )
+    {
+      finish(true);
+      return;
+    }
+
+    // Erase
+    if ( done_ >= erased_to_ )
+    {
+      state_ = ERASE;
+      volatile uint8_t *row = (volatile uint8_t *)dst_;
+      #if defined(__SAMD51__)
+        NVMCTRL->ADDR.reg = ((uint32_t)(uintptr_t)row);
+        NVMCTRL->CTRLB.reg = NVMCTRL_CTRLB_CMDEX_KEY | NVMCTRL_CTRLB_CMD_EB;
+      #else
+        NVMCTRL->STATUS.reg |= NVMCTRL_STATUS_MASK;  // clear error flags
+        NVMCTRL->ADDR.reg = ((uint32_t)(uintptr_t)row) / 2;
+        NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_ER;
+      #endif
+      erased_to_ += row_size_;
+      continue;
+    }
+
+    // Program
+    state_ = PROGRAM;
+    uint16_t want = uint16_t( min(page_size_, size_ - done_) );
+    memset(Stage_, 0xFF, sizeof(Stage_));  // unfilled tail stays erased
+    uint16_t got = fill_ ? fill_(Stage_, want, ctx_) : 0;
+    if ( got < want ) size_ = done_ + got;  // source ran short
+    if ( got == 0 )
+    {
+      finish(true);
+      return;
+    }
+    #if defined(__SAMD51__)
+      NVMCTRL->CTRLB.reg = NVMCTRL_CTRLB_CMDEX_KEY | NVMCTRL_CTRLB_CMD_PBC;
+    #else
+      NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_PBC;
+    #endif
+    while ( !nvm_ready() ) {}  // page buffer clear is a few cycles
+    uint32_t words = ( uint32_t(got) + 3 ) / 4;
+    for ( uint32_t i=0; i<words; i++ )
+    {
+      uint32_t w;
+      memcpy(&w, Stage_ + 4*i, 4);
+      *dst_++ = w;
+    }
+    dst_ += ( page_size_ / 4 - words );  // next page
+    #if defined(__SAMD51__)
+      NVMCTRL->CTRLB.reg = NVMCTRL_CTRLB_CMDEX_KEY | NVMCTRL_CTRLB_CMD_WP;
+    #else
+      NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_WP;
+    #endif
+    done_ += got;
+  } while ( micros() - start < budget_us );
+}
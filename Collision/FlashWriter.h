@@ -0,0 +1,75 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _FLASH_WRITER_H
+#define _FLASH_WRITER_H
+
+#include <Arduino.h>
+#include "constants.h"
+
+// Source of bytes to program.  Fill up to max bytes of buf and return the count; fewer than max
+// only at the end of the data.
+typedef uint16_t (*FlashFill)(uint8_t *buf, const uint16_t max, void *ctx);
+
+// Called once when the job finishes, ok false on NVM error or abort
+typedef void (*FlashDone)(const boolean ok, void *ctx);
+
+// Incremental flash writer.  FlashClass::write erases the whole region then spins on NVMCTRL for
+// every page, freezing the loop for tens of ms.  This one issues at most one NVM command per step
+// and returns instead of waiting:  each row is erased just before its first page is programmed and
+// each page is filled from the source through a one page staging buffer.  Call run() once per loop
+// pass; it keeps stepping while NVM is ready and the budget allows.
+// Note the M0+ still stalls on instruction fetch while NVM is busy, so one row erase (~6 ms) is the
+// worst single stall.  Schedule run() right after the read frame to keep it off the sample.
+class FlashWriter
+{
+public:
+  FlashWriter();
+  ~FlashWriter(){};
+  void abort();
+  boolean begin(const volatile void *dst, const uint32_t size, FlashFill fill, FlashDone done, void *ctx);
+  boolean busy() { return ( state_ != IDLE ); };
+  uint32_t done_bytes() { return ( done_ ); };
+  uint8_t progress() { if ( !size_ ) return ( 100 ); return ( uint8_t( uint64_t(done_) * 100 / size_ ) ); };
+  void run(const unsigned long budget_us);
+  uint32_t size() { return ( size_ ); };
+  uint32_t stalls() { return ( stalls_ ); };
+protected:
+  enum State { IDLE, ERASE, PROGRAM };
+  void finish(const boolean ok);
+  boolean nvm_error();
+  boolean nvm_ready();
+  uint8_t Stage_[FLASH_PAGE_MAX];   // one page of staged source data
+  volatile uint32_t *dst_;          // next page to program
+  uint32_t size_;                   // bytes requested
+  uint32_t done_;                   // bytes programmed
+  uint32_t erased_to_;              // offset from start erased so far
+  uint32_t page_size_;
+  uint32_t row_size_;
+  uint32_t stalls_;                 // run() passes that found NVM still busy
+  FlashFill fill_;
+  FlashDone done_cb_;
+  void *ctx_;
+  State state_;
+};
+
+#endif
@@ -0,0 +1,85 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include "LoadShed.h"
+#include "Trace.h"
+
+static const char *const shed_names[SHED_LOADS] = {"plot", "dump", "blink"};
+
+// Constructors
+LoadShed::LoadShed()
+  : last_us_(0ULL), level_(0), clean_(0), frames_(0), overruns_(0), late_max_us_(0)
+{
+  for ( uint8_t k=0; k<SHED_LOADS; k++ ) shed_[k] = 0;
+}
+
+// True when load may run this pass; counts it when shed
+boolean LoadShed::allow(const uint8_t load)
+{
+  if ( load >= level_ ) return ( true );
+  shed_[load]++;
+  return ( false );
+}
+
+// A sampled frame at up_us.  Untimed frames, the reset pass and FIFO replays whose times are
+// backdated, start the gap over.
+void LoadShed::frame(const unsigned long long up_us, const boolean timed)
+{
+  if ( !timed || !last_us_ )
+  {
+    last_us_ = timed ? up_us : 0ULL;
+    return;
+  }
+  unsigned long long gap_us = up_us - last_us_;
+  last_us_ = up_us;
+  frames_++;
+  if ( gap_us > READ_DELAY*1000ULL + OVERRUN_US )
+  {
+    overruns_++;
+    late_max_us_ = max(late_max_us_, uint32_t(min(gap_us - READ_DELAY*1000ULL, 0xFFFFFFFFULL)));
+    if ( level_ < SHED_LOADS ) level_++;
+    clean_ = 0;
+    TRACE_COUNT(TRACE_SHED, level_);
+  }
+  else if ( level_ && ++clean_ >= SHED_RECOVER )
+  {
+    level_--;
+    clean_ = 0;
+    TRACE_COUNT(TRACE_SHED, level_);
+  }
+}
+
+// Counters
+void LoadShed::print(Print *out)
+{
+  out->print("frames="); out->print(frames_);
+  out->print(" overruns="); out->print(overruns_);
+  out->print(" late_max_us="); out->print(late_max_us_);
+  out->print(" shedding="); out->print(level_);
+  for ( uint8_t k=0; k<SHED_LOADS; k++ )
+  {
+    out->print(" "); out->print(shed_names[k]); out->print("_shed="); out->print(shed_[k]);
+  }
+  out->println();
+}
@@ -0,0 +1,67 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+#ifndef _LOAD_SHED_H
+#define _LOAD_SHED_H
+
+#include <Arduino.h>
+#include "constants.h"
+
+// Loads the loop may drop when it falls behind, first shed first
+enum ShedLoad
+{
+  SHED_PLOT,        // Monitor and plot output
+  SHED_DUMP,        // Download, trace dump and telemetry
+  SHED_BLINK,       // LED
+  SHED_LOADS
+};
+
+// Frame overrun detection and load shedding.  Every sampled frame reports its time; a frame more than
+// OVERRUN_US past READ_DELAY after the one before is an overrun, and each overrun sheds one more load
+// in ShedLoad order.  SHED_RECOVER frames on time bring the last one shed back.  Only what makes output
+// is shed; the read frame itself, sampling, the trigger and capture, and the commands and Tx drain that
+// a host needs to stop a load, are never asked and never shed.
+class LoadShed
+{
+public:
+  LoadShed();
+  ~LoadShed(){};
+  boolean allow(const uint8_t load);
+  void frame(const unsigned long long up_us, const boolean timed);
+  uint8_t level() { return ( level_ ); };
+  uint32_t overruns() { return ( overruns_ ); };
+  void print(Print *out);
+  uint32_t shed(const uint8_t load) { return ( shed_[load] ); };
+protected:
+  unsigned long long last_us_;    // Up time of the last timed frame, 0 to start over
+  uint8_t level_;                 // Loads below this are shed
+  uint16_t clean_;                // Frames on time since the level last changed
+  uint32_t frames_;
+  uint32_t overruns_;
+  uint32_t late_max_us_;          // Worst frame gap past READ_DELAY
+  uint32_t shed_[SHED_LOADS];     // Times each load was skipped
+};
+
+#endif
@@ -0,0 +1,232 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "Power.h"
+#include "Clock.h"
+#include <ArduinoLowPower.h>
+#include <Wire.h>
+
+// LSM6DS3 registers, the ones Arduino_LSM6DS3 leaves alone
+#define IMU_ADDR              0x6A      // I2C address on the Nano 33 IoT
+#define FIFO_CTRL3            0x08
+#define FIFO_CTRL5            0x0A
+#define CTRL2_G               0x11
+#define CTRL6_C               0x15
+#define CTRL7_G               0x16
+#define WAKE_UP_SRC           0x1B
+#define FIFO_STATUS1          0x3A
+#define FIFO_STATUS3          0x3C
+#define FIFO_DATA_OUT_L       0x3E
+#define TIMESTAMP0_REG        0x40
+#define TAP_CFG               0x58
+#define WAKE_UP_THS           0x5B
+#define WAKE_UP_DUR           0x5C
+#define MD1_CFG               0x5E
+
+#define FIFO_BYPASS           0x00      // FIFO_CTRL5 off, which empties it
+#define FIFO_CONTINUOUS       0x26      // FIFO_CTRL5 104 Hz, oldest overwritten
+#define FIFO_GYRO_ACC         0x09      // FIFO_CTRL3 gyro and accel, no decimation
+#define FIFO_ACC              0x01      // FIFO_CTRL3 accel alone
+#define FIFO_WORDS    ( DOZE_GYRO ? 6 : 3 )  // A frame:  gyro x, y, z then accel x, y, z, or accel alone
+#define G_ON                  0x4C      // CTRL2_G 104 Hz, 2000 deg/s, as Arduino_LSM6DS3 sets it
+#define XL_HM_OFF             0x10      // CTRL6_C accel normal mode
+#define G_HM_OFF              0x80      // CTRL7_G gyro normal mode
+#define TAP_CFG_WAKE          0x91      // Timestamp on, slope filter on wake-up, latched
+#define INT1_WU               0x20      // MD1_CFG, wake-up on INT1 for a board that wires it
+#define WU_IA                 0x08      // WAKE_UP_SRC wake-up event
+#define ACC_FS                  4.      // g's, as Arduino_LSM6DS3 sets it
+#define GYR_FS               2000.      // deg/s, as Arduino_LSM6DS3 sets it
+#define TS_US                 6400UL    // Timestamp tick, us
+#define FRAME_US              9615UL    // 104 Hz
+#define FIFO_FRAMES   ( 2048 / FIFO_WORDS )  // 4 kB of words, whole frames
+#define FIFO_SPARE               8      // Frames kept free at the wake, ~77 ms of what arrives before the replay starts
+
+// Constructors
+Power::Power()
+  : enabled_(true), dozing_(false), replaying_(false), still_ms_(0ULL), t0_us_(0ULL), n0_(0), left_(0), i_(0), ts_(0), us_(0),
+  naps_(0), dozes_(0), replayed_(0)
+{}
+
+// Hand the watching to the IMU
+void Power::doze()
+{
+  write_reg(FIFO_CTRL5, FIFO_BYPASS);  // start empty
+  write_reg(FIFO_CTRL3, DOZE_GYRO ? FIFO_GYRO_ACC : FIFO_ACC);
+  write_reg(CTRL6_C, XL_HM_OFF);
+  if ( DOZE_GYRO ) write_reg(CTRL7_G, G_HM_OFF);
+  else write_reg(CTRL2_G, 0x00);
+  write_reg(WAKE_UP_DUR, 0x00);
+  write_reg(WAKE_UP_THS, uint8_t(min(max(WAKE_G * 64. / ACC_FS + 0.5, 1.), 63.)));
+  write_reg(TAP_CFG, TAP_CFG_WAKE);
+  write_reg(MD1_CFG, INT1_WU);
+  read_reg(WAKE_UP_SRC);  // clear a stale event
+  write_reg(FIFO_CTRL5, FIFO_CONTINUOUS);
+  ts_ = timestamp();
+  us_ = micros();
+  dozing_ = true;
+  dozes_++;
+}
+
+// Frames waiting in the FIFO, after dropping the rest of any frame cut short by an overrun
+uint16_t Power::fifo_frames()
+{
+  uint16_t words = read_word(FIFO_STATUS1) & 0x0FFF;
+  uint16_t pattern = read_word(FIFO_STATUS3) & 0x03FF;
+  if ( pattern && words >= FIFO_WORDS - pattern )
+  {
+    for ( uint16_t j=pattern; j<FIFO_WORDS; j++ ) read_word(FIFO_DATA_OUT_L);
+    words -= FIFO_WORDS - pattern;
+  }
+  return ( words / FIFO_WORDS );
+}
+
+// One standby nap then a look at the wake-up flag.  True on motion, with the FIFO set to replay.
+// Time asleep is IMU time less what micros() saw, both since the last look so rounding never adds up.
+boolean Power::nap()
+{
+  LowPower.sleep(uint32_t(DOZE_NAP_S * 1000UL));
+  uint32_t ts = timestamp();
+  uint32_t us = micros();
+  unsigned long long passed = (unsigned long long)( ( ts - ts_ ) & 0xFFFFFFUL ) * TS_US;
+  unsigned long long awake = us - us_;
+  if ( passed > awake ) Clk.slept(passed - awake);
+  ts_ = ts;
+  us_ = us;
+  naps_++;
+  if ( !( read_reg(WAKE_UP_SRC) & WU_IA ) ) return ( false );
+  wake();
+  return ( true );
+}
+
+// Counters
+void Power::print(Print *out)
+{
+  out->print("wake-on-motion "); out->print(enabled_ ? "on" : "off");
+  out->print(dozing_ ? " dozing" : " awake");
+  out->print(" dozes="); out->print(dozes_);
+  out->print(" naps="); out->print(naps_);
+  out->print(" replayed="); out->print(replayed_);
+  out->print(" asleep_s="); out->println((unsigned long)( Clk.asleep_us() / 1000000ULL ));
+}
+
+uint8_t Power::read_reg(const uint8_t reg)
+{
+  Wire.beginTransmission(IMU_ADDR);
+  Wire.write(reg);
+  if ( Wire.endTransmission(false) != 0 ) return ( 0 );
+  if ( Wire.requestFrom(IMU_ADDR, 1) != 1 ) return ( 0 );
+  return ( Wire.read() );
+}
+
+// Little endian pair starting at reg
+int16_t Power::read_word(const uint8_t reg)
+{
+  Wire.beginTransmission(IMU_ADDR);
+  Wire.write(reg);
+  if ( Wire.endTransmission(false) != 0 ) return ( 0 );
+  if ( Wire.requestFrom(IMU_ADDR, 2) != 2 ) return ( 0 );
+  uint16_t lo = Wire.read();
+  return ( int16_t( lo | ( Wire.read() << 8 ) ) );
+}
+
+// Still and idle for DOZE_S, so time to doze.  Call every pass with what the loop knows.
+boolean Power::ready(const unsigned long long up_ms, const boolean still)
+{
+  if ( !still || !enabled_ || dozing_ || replaying_ ) still_ms_ = up_ms;
+  return ( up_ms - still_ms_ >= DOZE_S * 1000ULL );
+}
+
+// Next frame saved while dozing, oldest first, and its up time.  False once caught up with the live
+// data; reading goes back to the registers.
+boolean Power::replay(ImuSample *imu, unsigned long long *up_us)
+{
+  if ( !replaying_ ) return ( false );
+  if ( !left_ ) left_ = fifo_frames();
+  if ( !left_ )
+  {
+    write_reg(FIFO_CTRL5, FIFO_BYPASS);
+    replaying_ = false;
+    return ( false );
+  }
+  int16_t w[6];
+  for ( uint8_t j=0; j<FIFO_WORDS; j++ ) w[j] = read_word(FIFO_DATA_OUT_L);
+  int16_t *acc = w + FIFO_WORDS - 3;
+  imu->rot = DOZE_GYRO;
+  imu->a = w[0] * GYR_FS / 32768. * deg_to_rps;
+  imu->b = w[1] * GYR_FS / 32768. * deg_to_rps;
+  imu->c = w[2] * GYR_FS / 32768. * deg_to_rps;
+  imu->acc = true;
+  imu->x = acc[0] * ACC_FS / 32768.;
+  imu->y = acc[1] * ACC_FS / 32768.;
+  imu->z = acc[2] * ACC_FS / 32768.;
+  *up_us = t0_us_ + (unsigned long long)( ( (long long)i_ + 1LL - (long long)n0_ ) * (long long)FRAME_US );
+  left_--;
+  i_++;
+  replayed_++;
+  return ( true );
+}
+
+// IMU timestamp, 24 bits of TS_US
+uint32_t Power::timestamp()
+{
+  Wire.beginTransmission(IMU_ADDR);
+  Wire.write(TIMESTAMP0_REG);
+  if ( Wire.endTransmission(false) != 0 ) return ( 0 );
+  if ( Wire.requestFrom(IMU_ADDR, 3) != 3 ) return ( 0 );
+  uint32_t ts = Wire.read();
+  ts |= uint32_t(Wire.read()) << 8;
+  ts |= uint32_t(Wire.read()) << 16;
+  return ( ts );
+}
+
+// Motion:  high performance back at once for the event, detector off, and the FIFO queued to replay
+void Power::wake()
+{
+  write_reg(CTRL6_C, 0x00);
+  write_reg(CTRL7_G, 0x00);
+  write_reg(CTRL2_G, G_ON);  // ~70 ms to settle when it was off
+  write_reg(MD1_CFG, 0x00);
+  write_reg(TAP_CFG, 0x00);
+  write_reg(WAKE_UP_THS, 0x00);
+  setTime(time_t( Clk.ms() / 1000ULL ));  // TimeLib counts millis(), which stood still in standby
+  dozing_ = false;
+  replaying_ = true;
+  t0_us_ = Clk.up_us();
+  left_ = fifo_frames();
+  while ( left_ && left_ + FIFO_SPARE > FIFO_FRAMES )  // a full FIFO overwrites mid-frame, so make room, oldest first
+  {
+    for ( uint8_t j=0; j<FIFO_WORDS; j++ ) read_word(FIFO_DATA_OUT_L);
+    left_--;
+  }
+  n0_ = left_;
+  i_ = 0;
+  still_ms_ = t0_us_ / 1000ULL;
+}
+
+void Power::write_reg(const uint8_t reg, const uint8_t val)
+{
+  Wire.beginTransmission(IMU_ADDR);
+  Wire.write(reg);
+  Wire.write(val);
+  Wire.endTransmission();
+}
@@ -0,0 +1,87 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#ifndef _POWER_H
+#define _POWER_H
+
+#include "constants.h"
+#include "Sensors.h"
+
+// Wake-on-motion power saving for the button cell.  Once the board has been still and idle for DOZE_S
+// the LSM6DS3 takes over the watching:  its wake-up detector runs at WAKE_G and both sensors keep
+// streaming into its FIFO in normal (not high performance) mode while the M0+ naps in standby.  After
+// each DOZE_NAP_S nap the latched wake-up flag is read.  On motion the FIFO is replayed, oldest first,
+// through the usual pipeline so the pretrigger and the start of the event are logged as if the board
+// never slept, REPLAY_FRAMES a read pass so flash and serial keep their turns, and reading goes back
+// to the registers once the replay catches up.  The FIFO fills on meanwhile, so at the wake a full one
+// gives up its oldest FIFO_SPARE frames rather than overwrite the head mid-frame.
+//
+// By default (DOZE_GYRO 0) the gyro is off too, for about a twelfth of the doze current, and the replay
+// is accel alone:  rotation holds its quiet value through the pretrigger and the start of an event
+// until the replay catches up, up to a nap plus the pretrigger, and the gyro takes ~70 ms to settle
+// after.  Where the first rotation of an impact matters more than battery, DOZE_GYRO 1 keeps it on in
+// normal mode.  CollisionHost/coll_energy estimates what either choice does to battery life.
+//
+// INT1 is not wired to a pin on the Nano 33 IoT, so naps end on the RTC rather than the interrupt;
+// the FIFO (341 frames, 3.3 s at 104 Hz, twice that accel alone) makes the wait cost only latency.
+// Standby stops USB and SysTick, so the loop only dozes with no serial host, and the IMU timestamp
+// tells Clk how long each nap was.
+class Power
+{
+public:
+  Power();
+  ~Power(){};
+  void doze();
+  boolean dozing() { return ( dozing_ ); };
+  boolean enabled() { return ( enabled_ ); };
+  void enable(const boolean on) { enabled_ = on; };
+  boolean nap();
+  void print(Print *out);
+  boolean ready(const unsigned long long up_ms, const boolean still);
+  boolean replay(ImuSample *imu, unsigned long long *up_us);
+protected:
+  boolean enabled_;
+  boolean dozing_;
+  boolean replaying_;
+  unsigned long long still_ms_;   // Up time the board was last busy or moving
+  unsigned long long t0_us_;      // Up time of the wake, when the newest FIFO frame was about current
+  uint16_t n0_;                   // FIFO frames waiting at the wake
+  uint16_t left_;                 // FIFO frames known waiting
+  uint32_t i_;                    // Frames replayed since the wake
+  uint32_t ts_;                   // IMU timestamp at the last look
+  uint32_t us_;                   // micros() at the last look
+  uint32_t naps_;
+  uint32_t dozes_;
+  uint32_t replayed_;
+  uint16_t fifo_frames();
+  uint8_t read_reg(const uint8_t reg);
+  int16_t read_word(const uint8_t reg);
+  uint32_t timestamp();
+  void wake();
+  void write_reg(const uint8_t reg, const uint8_t val);
+};
+
+extern Power Pwr;
+
+#endif
@@ -0,0 +1,78 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include "Probe.h"
+
+// One time
+void Probe::add(const uint32_t us)
+{
+  n_++;
+  sum_ += us;
+  if ( us < min_ ) min_ = us;
+  if ( us > max_ ) max_ = us;
+  uint8_t k = us > 1 ? 31 - __builtin_clz(us) : 0;
+  hist_[k < PROBE_BINS ? k : PROBE_BINS - 1]++;
+}
+
+// One line:  name, count, min, mean and max us, then the filled bins as lower_us:count
+void Probe::print(Print *out)
+{
+  out->print(name_);
+  out->print(" n="); out->print(n_);
+  out->print(" min="); out->print(min_us());
+  out->print(" mean="); out->print(mean_us(), 1);
+  out->print(" max="); out->print(max_);
+  out->print(" |");
+  for ( uint8_t k=0; k<PROBE_BINS; k++ )
+  {
+    if ( !hist_[k] ) continue;
+    out->print(" "); out->print(k ? 1UL << k : 0UL); out->print(":"); out->print(hist_[k]);
+  }
+  out->println();
+}
+
+// Start over
+void Probe::reset()
+{
+  n_ = 0;
+  min_ = 0xFFFFFFFFUL;
+  max_ = 0;
+  sum_ = 0ULL;
+  for ( uint8_t k=0; k<PROBE_BINS; k++ ) hist_[k] = 0;
+}
+
+#if PROBES
+Probe Probes[PROBE_STAGES] = {Probe("sample"), Probe("filter"), Probe("quiet"), Probe("put_ram"), Probe("flash"),
+  Probe("read"), Probe("publish"), Probe("chitchat"), Probe("loop")};
+
+// Tx job for the 'lt' dump, a header then a line per stage, each reset once it is out
+boolean probe_line(Print *out, const uint16_t k, void *ctx)
+{
+  if ( k > PROBE_STAGES ) return ( false );
+  if ( k == 0 ) { out->println("Loop timing, us:  stage n min mean max | histogram bin lower_us:count"); return ( true ); }
+  Probes[k-1].print(out);
+  Probes[k-1].reset();
+  return ( true );
+}
+#endif
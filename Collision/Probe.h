@@ -0,0 +1,86 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+#ifndef _PROBE_H
+#define _PROBE_H
+
+#include <Arduino.h>
+#include "constants.h"
+
+// Loop stage timing.  A probe takes stage times in us from micros(), the SysTick count on the board,
+// and keeps their count, min, max, sum and a log2 histogram:  bin 0 holds 0 and 1 us, bin k times of
+// 2^k up to 2^(k+1) us, the last bin everything longer.  Stages are timed as laps from one mark, so a
+// run of stages costs one micros() each.  With PROBES 0 the macros are empty and nothing is kept.
+class Probe
+{
+public:
+  Probe(const char *name) : name_(name) { reset(); };
+  ~Probe(){};
+  void add(const uint32_t us);
+  uint32_t bin(const uint8_t k) { return ( hist_[k] ); };
+  uint32_t max_us() { return ( max_ ); };
+  float mean_us() { return ( n_ ? float(sum_) / n_ : 0. ); };
+  uint32_t min_us() { return ( n_ ? min_ : 0 ); };
+  uint32_t n() { return ( n_ ); };
+  const char *name() { return ( name_ ); };
+  void print(Print *out);
+  void reset();
+protected:
+  const char *name_;
+  uint32_t n_;
+  uint32_t min_;
+  uint32_t max_;
+  uint64_t sum_;
+  uint32_t hist_[PROBE_BINS];
+};
+
+// Stages, in loop order
+enum ProbeStage
+{
+  PROBE_SAMPLE,     // IMU read
+  PROBE_FILTER,     // Sensors take and filter
+  PROBE_QUIET,      // Sensors quiet_decisions
+  PROBE_PUT_RAM,    // Data_st put_ram
+  PROBE_FLASH,      // Store, Snap and Writer runs
+  PROBE_READ,       // The whole read frame, above and the rest of it
+  PROBE_PUBLISH,    // Monitor and plot output
+  PROBE_CHITCHAT,   // Commands, download and Tx drain
+  PROBE_LOOP,       // The whole pass, awake
+  PROBE_STAGES
+};
+
+#if PROBES
+  extern Probe Probes[PROBE_STAGES];
+  boolean probe_line(Print *out, const uint16_t k, void *ctx);
+  #define PROBE_MARK(t)         uint32_t t = micros()
+  #define PROBE_LAP(stage, t)   do { uint32_t probe_now = micros(); Probes[stage].add(probe_now - t); t = probe_now; } while ( 0 )
+  #define PROBE_SINCE(stage, t) Probes[stage].add(uint32_t(micros()) - t)
+#else
+  #define PROBE_MARK(t)
+  #define PROBE_LAP(stage, t)
+  #define PROBE_SINCE(stage, t)
+#endif
+
+#endif
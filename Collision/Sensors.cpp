@@ -26,6 +26,40 @@
 #include "Sensors.h"
 #include "TimeLib.h"
 #include "CollDatum.h"
+#include "Trace.h"
+#include "TxQueue.h"
+
+const char *const quiet_par_names[QUIET_PARS] = {"o_thr", "g_thr", "quiet_s", "r_scl", "tau_q", "wn_q", "zeta_q"};
+static float QuietPars::*const quiet_par_fields[QUIET_PARS] = {&QuietPars::o_thr, &QuietPars::g_thr, &QuietPars::quiet_s,
+  &QuietPars::r_scl, &QuietPars::tau_q, &QuietPars::wn_q, &QuietPars::zeta_q};
+
+// Nominal quiet tuning
+void QuietPars::nominal()
+{
+  o_thr = O_QUIET_THR;
+  g_thr = G_QUIET_THR;
+  quiet_s = QUIET_S;
+  r_scl = R_SCL;
+  tau_q = TAU_Q_FILT;
+  wn_q = WN_Q_FILT;
+  zeta_q = ZETA_Q_FILT;
+}
+
+// Field by name, NULL if none
+float *QuietPars::par(const char *name)
+{
+  for ( uint8_t k=0; k<QUIET_PARS; k++ ) if ( !strcmp(name, quiet_par_names[k]) ) return ( &(this->*quiet_par_fields[k]) );
+  return ( NULL );
+}
+
+void QuietPars::print(Print *out)
+{
+  for ( uint8_t k=0; k<QUIET_PARS; k++ )
+  {
+    out->print(k ? " " : "Quiet: "); out->print(quiet_par_names[k]); out->print("="); out->print(this->*quiet_par_fields[k], 3);
+  }
+  out->println();
+}
 
 
 // Filter noise
@@ -34,23 +68,27 @@ void Sensors::filter(const boolean reset)
 
     if ( reset || acc_available_ )
     {
-        x_filt = X_Filt->calculate(x_raw, reset, TAU_FILT, min(T_acc_, NOM_DT));
-        y_filt = Y_Filt->calculate(y_raw, reset, TAU_FILT, min(T_acc_, NOM_DT));
-        z_filt = Z_Filt->calculate(z_raw, reset, TAU_FILT, min(T_acc_, NOM_DT));
-        g_filt = G_Filt->calculate(g_raw, reset, TAU_FILT, min(T_acc_, NOM_DT));
-        g_qrate = GQuietRate->calculate(g_raw-1., reset, min(T_acc_, MAX_T_Q_FILT));     
-        g_quiet =GQuietFilt->calculate(g_qrate, reset, min(T_acc_, MAX_T_Q_FILT));
+        x_filt = X_Filt.calculate(x_raw, reset, TAU_FILT, min(T_acc_, NOM_DT));
+        y_filt = Y_Filt.calculate(y_raw, reset, TAU_FILT, min(T_acc_, NOM_DT));
+        z_filt = Z_Filt.calculate(z_raw, reset, TAU_FILT, min(T_acc_, NOM_DT));
+        g_filt = G_Filt.calculate(g_raw, reset, TAU_FILT, min(T_acc_, NOM_DT));
+        GQuietRate.tau(Qp_->tau_q);
+        GQuietFilt.omega_zeta(Qp_->wn_q, Qp_->zeta_q);
+        g_qrate = GQuietRate.calculate(g_raw-1., reset, min(T_acc_, MAX_T_Q_FILT));     
+        g_quiet =GQuietFilt.calculate(g_qrate, reset, min(T_acc_, MAX_T_Q_FILT));
         static int count = 0;
     }
 
     if ( reset || rot_available_ )
     {
-        a_filt = A_Filt->calculate(a_raw, reset, TAU_FILT, min(T_rot_, NOM_DT));
-        b_filt = B_Filt->calculate(b_raw, reset, TAU_FILT, min(T_rot_, NOM_DT));
-        c_filt = C_Filt->calculate(c_raw, reset, TAU_FILT, min(T_rot_, NOM_DT));
-        o_filt = O_Filt->calculate(o_raw, reset, TAU_FILT, min(T_rot_, NOM_DT));
-        o_qrate = OQuietRate->calculate(o_raw, reset, min(T_rot_, MAX_T_Q_FILT));     
-        o_quiet =OQuietFilt->calculate(o_qrate, reset, min(T_rot_, MAX_T_Q_FILT));
+        a_filt = A_Filt.calculate(a_raw, reset, TAU_FILT, min(T_rot_, NOM_DT));
+        b_filt = B_Filt.calculate(b_raw, reset, TAU_FILT, min(T_rot_, NOM_DT));
+        c_filt = C_Filt.calculate(c_raw, reset, TAU_FILT, min(T_rot_, NOM_DT));
+        o_filt = O_Filt.calculate(o_raw, reset, TAU_FILT, min(T_rot_, NOM_DT));
+        OQuietRate.tau(Qp_->tau_q);
+        OQuietFilt.omega_zeta(Qp_->wn_q, Qp_->zeta_q);
+        o_qrate = OQuietRate.calculate(o_raw, reset, min(T_rot_, MAX_T_Q_FILT));     
+        o_quiet =OQuietFilt.calculate(o_qrate, reset, min(T_rot_, MAX_T_Q_FILT));
     }
 
 }
@@ -63,18 +101,18 @@ void Sensors::plot_all()  // pa3
   float g_q_s = -2.; 
   if ( g_is_quiet_ ) g_q = -1;
   if ( g_is_quiet_sure_ ) g_q_s = -1;
-  Serial.print("x_filt:"); Serial.print(x_filt, 3);
-  Serial.print("\ty_filt:"); Serial.print(y_filt, 3);
-  Serial.print("\tz_filt:"); Serial.print(z_filt, 3);
-  Serial.print("\tg_filt-1:"); Serial.print(g_filt-1., 3);
+  Data.print("x_filt:"); Data.print(x_filt, 3);
+  Data.print("\ty_filt:"); Data.print(y_filt, 3);
+  Data.print("\tz_filt:"); Data.print(z_filt, 3);
+  Data.print("\tg_filt-1:"); Data.print(g_filt-1., 3);
   float o_q = -4.;
   float o_q_s = -4.; 
   if ( o_is_quiet_ ) o_q = -3;
   if ( o_is_quiet_sure_ ) o_q_s = -3;
-  Serial.print("\t\ta_filt:"); Serial.print(a_filt, 3);
-  Serial.print("\tb_filt:"); Serial.print(b_filt, 3);
-  Serial.print("\tc_filt:"); Serial.print(c_filt, 3);
-  Serial.print("\to_filt:"); Serial.println(o_filt, 3);
+  Data.print("\t\ta_filt:"); Data.print(a_filt, 3);
+  Data.print("\tb_filt:"); Data.print(b_filt, 3);
+  Data.print("\tc_filt:"); Data.print(c_filt, 3);
+  Data.print("\to_filt:"); Data.println(o_filt, 3);
 }
 
 // plot pa1
@@ -84,13 +122,13 @@ void Sensors::plot_all_acc()  // pa1
   float g_q_s = -2.; 
   if ( g_is_quiet_ ) g_q = -1;
   if ( g_is_quiet_sure_ ) g_q_s = -1;
-  Serial.print("T_acc*100:"); Serial.print(T_acc_*100., 3);
-  Serial.print("\tx_filt:"); Serial.print(x_filt, 3);
-  Serial.print("\ty_filt:"); Serial.print(y_filt, 3);
-  Serial.print("\tz_filt:"); Serial.print(z_filt, 3);
-  Serial.print("\tg_filt-1:"); Serial.print(g_filt-1., 3);
-  Serial.print("\tg_is_quiet-2:"); Serial.print(g_q, 3);
-  Serial.print("\tg_is_quiet_sure-2:"); Serial.println(g_q_s, 3);
+  Data.print("T_acc*100:"); Data.print(T_acc_*100., 3);
+  Data.print("\tx_filt:"); Data.print(x_filt, 3);
+  Data.print("\ty_filt:"); Data.print(y_filt, 3);
+  Data.print("\tz_filt:"); Data.print(z_filt, 3);
+  Data.print("\tg_filt-1:"); Data.print(g_filt-1., 3);
+  Data.print("\tg_is_quiet-2:"); Data.print(g_q, 3);
+  Data.print("\tg_is_quiet_sure-2:"); Data.println(g_q_s, 3);
 }
 
 // plot pa2
@@ -100,13 +138,13 @@ void Sensors::plot_all_rot()  // pa2
   float o_q_s = -4.; 
   if ( o_is_quiet_ ) o_q = -3;
   if ( o_is_quiet_sure_ ) o_q_s = -3;
-  Serial.print("T_rot_*100:"); Serial.print(T_rot_*100., 3);
-  Serial.print("\ta_filt:"); Serial.print(a_filt, 3);
-  Serial.print("\tb_filt:"); Serial.print(b_filt, 3);
-  Serial.print("\tc_filt:"); Serial.print(c_filt, 3);
-  Serial.print("\to_filt:"); Serial.print(o_filt, 3);
-  Serial.print("\to_is_quiet-4:"); Serial.print(o_q, 3);
-  Serial.print("\to_is_quiet_sure-4:"); Serial.println(o_q_s, 3);
+  Data.print("T_rot_*100:"); Data.print(T_rot_*100., 3);
+  Data.print("\ta_filt:"); Data.print(a_filt, 3);
+  Data.print("\tb_filt:"); Data.print(b_filt, 3);
+  Data.print("\tc_filt:"); Data.print(c_filt, 3);
+  Data.print("\to_filt:"); Data.print(o_filt, 3);
+  Data.print("\to_is_quiet-4:"); Data.print(o_q, 3);
+  Data.print("\to_is_quiet_sure-4:"); Data.println(o_q_s, 3);
 }
 
 // pa0
@@ -114,16 +152,16 @@ void Sensors::plot_all_sum()  // pa0
 {
   float g_q_s = -2.; 
   if ( g_is_quiet_sure_ ) g_q_s = -1;
-  Serial.print("g_raw-1:"); Serial.print(g_raw-1., 3);
-  Serial.print("\tg_filt-1:"); Serial.print(g_filt-1., 3);
-  Serial.print("\tg_quiet:"); Serial.print(g_quiet, 3);
-  Serial.print("\tg_is_quiet_sure-2:"); Serial.print(g_q_s, 3);
+  Data.print("g_raw-1:"); Data.print(g_raw-1., 3);
+  Data.print("\tg_filt-1:"); Data.print(g_filt-1., 3);
+  Data.print("\tg_quiet:"); Data.print(g_quiet, 3);
+  Data.print("\tg_is_quiet_sure-2:"); Data.print(g_q_s, 3);
   float o_q_s = -4.; 
   if ( o_is_quiet_sure_ ) o_q_s = -3;
-  Serial.print("\to_raw:"); Serial.print(o_raw, 3);
-  Serial.print("\to_filt:"); Serial.print(o_filt, 3);
-  Serial.print("\to_quiet:"); Serial.print(o_quiet, 3);
-  Serial.print("\to_is_quiet_sure-4:"); Serial.println(o_q_s, 3);
+  Data.print("\to_raw:"); Data.print(o_raw, 3);
+  Data.print("\to_filt:"); Data.print(o_filt, 3);
+  Data.print("\to_quiet:"); Data.print(o_quiet, 3);
+  Data.print("\to_is_quiet_sure-4:"); Data.println(o_q_s, 3);
 }
 
 // Print publish
@@ -137,111 +175,167 @@ void Sensors::plot_quiet()
   float g_q_s = -2.; 
   if ( g_is_quiet_ ) g_q = -1;
   if ( g_is_quiet_sure_ ) g_q_s = -1;
-  Serial.print("T_rot_*100:"); Serial.print(T_rot_*100., 3);
-  Serial.print("\to_filt:"); Serial.print(o_filt, 3);
-  Serial.print("\to_quiet:"); Serial.print(o_quiet, 3);
-  Serial.print("\to_is_quiet_sure-4:"); Serial.print(o_q_s, 3);
-  Serial.print("\t\tT_acc*100:"); Serial.print(T_acc_*100., 3);
-  Serial.print("\tg_filt:"); Serial.print(g_filt-1., 3);
-  Serial.print("\tg_quiet:"); Serial.print(g_quiet, 3);
-  Serial.print("\tg_is_quiet_sure-2:"); Serial.println(g_q_s, 3);
+  Data.print("T_rot_*100:"); Data.print(T_rot_*100., 3);
+  Data.print("\to_filt:"); Data.print(o_filt, 3);
+  Data.print("\to_quiet:"); Data.print(o_quiet, 3);
+  Data.print("\to_is_quiet_sure-4:"); Data.print(o_q_s, 3);
+  Data.print("\t\tT_acc*100:"); Data.print(T_acc_*100., 3);
+  Data.print("\tg_filt:"); Data.print(g_filt-1., 3);
+  Data.print("\tg_quiet:"); Data.print(g_quiet, 3);
+  Data.print("\tg_is_quiet_sure-2:"); Data.println(g_q_s, 3);
 }
 
 // Print publish
 void Sensors::plot_quiet_raw()
 {
-  Serial.print("o_quiet:"); Serial.print(o_quiet, 3);
-  Serial.print("\t\tg_quiet:"); Serial.println(g_quiet, 3);
+  Data.print("o_quiet:"); Data.print(o_quiet, 3);
+  Data.print("\t\tg_quiet:"); Data.println(g_quiet, 3);
 }
 
 // Print publish
 void Sensors::plot_total()
 {
-  Serial.print("T_rot_*100:"); Serial.print(T_rot_*100., 3);
-  Serial.print("\to_filt:"); Serial.print(o_filt, 3);
-  Serial.print("\t\tT_acc_*100:"); Serial.print(T_acc_*100., 3);
-  Serial.print("\tg_filt:"); Serial.println(g_filt-1., 3);
+  Data.print("T_rot_*100:"); Data.print(T_rot_*100., 3);
+  Data.print("\to_filt:"); Data.print(o_filt, 3);
+  Data.print("\t\tT_acc_*100:"); Data.print(T_acc_*100., 3);
+  Data.print("\tg_filt:"); Data.println(g_filt-1., 3);
 }
 
 void Sensors::print_all()
 {
-  Serial.print(T_rot_, 3); Serial.print('\t');
-  Serial.print(a_filt, 3); Serial.print('\t');
-  Serial.print(b_filt, 3); Serial.print('\t');
-  Serial.print(c_filt, 3); Serial.print('\t');
-  Serial.print(o_filt, 3); Serial.print('\t');
-  Serial.print(o_is_quiet_, 3); Serial.print('\t');
-  Serial.print(o_is_quiet_sure_, 3); Serial.print('\t');
-  Serial.print(T_acc_, 3); Serial.print("\t\t");
-  Serial.print(x_filt, 3); Serial.print('\t');
-  Serial.print(y_filt, 3); Serial.print('\t');
-  Serial.print(z_filt, 3); Serial.print('\t');
-  Serial.print(g_filt, 3); Serial.print('\t');
-  Serial.print(g_is_quiet_, 3); Serial.print('\t');
-  Serial.println(g_is_quiet_sure_, 3);
+  Data.print(T_rot_, 3); Data.print('\t');
+  Data.print(a_filt, 3); Data.print('\t');
+  Data.print(b_filt, 3); Data.print('\t');
+  Data.print(c_filt, 3); Data.print('\t');
+  Data.print(o_filt, 3); Data.print('\t');
+  Data.print(o_is_quiet_, 3); Data.print('\t');
+  Data.print(o_is_quiet_sure_, 3); Data.print('\t');
+  Data.print(T_acc_, 3); Data.print("\t\t");
+  Data.print(x_filt, 3); Data.print('\t');
+  Data.print(y_filt, 3); Data.print('\t');
+  Data.print(z_filt, 3); Data.print('\t');
+  Data.print(g_filt, 3); Data.print('\t');
+  Data.print(g_is_quiet_, 3); Data.print('\t');
+  Data.println(g_is_quiet_sure_, 3);
 }
 
 void Sensors::print_all_header()
 {
-  Serial.println("T_rot_*\ta_filt\tb_filt\tc_filt\to_filt\to_is_quiet\to_is_quiet_sure\t\tT_acc\tx_filt\ty_filt\tz_filt\tg_filt\tg_is_quiet\tg_is_quiet_sure");
+  Data.println("T_rot_*\ta_filt\tb_filt\tc_filt\to_filt\to_is_quiet\to_is_quiet_sure\t\tT_acc\tx_filt\ty_filt\tz_filt\tg_filt\tg_is_quiet\tg_is_quiet_sure");
 }
 // Detect no signal present based on detection of quiet signal.
 // Research by sound industry found that 2-pole filtering is the sweet spot between seeing noise
 // and actual motion without 'guilding the lily'
 void Sensors::quiet_decisions(const boolean reset)
 {
-  o_is_quiet_ = o_quiet <= O_QUIET_THR;  // o_filt is rss
-  o_is_quiet_sure_ = OQuietPer->calculate(o_is_quiet_, QUIET_S, QUIET_R, T_rot_, reset);
-  g_is_quiet_ = g_quiet <= G_QUIET_THR;  // g_filt is rss
-  g_is_quiet_sure_ = GQuietPer->calculate(g_is_quiet_, QUIET_S, QUIET_R, T_acc_, reset);
+  o_is_quiet_ = o_quiet <= Qp_->o_thr;  // o_filt is rss
+  o_is_quiet_sure_ = OQuietPer.calculate(o_is_quiet_, Qp_->quiet_s, Qp_->quiet_r(), T_rot_, reset);
+  g_is_quiet_ = g_quiet <= Qp_->g_thr;  // g_filt is rss
+  g_is_quiet_sure_ = GQuietPer.calculate(g_is_quiet_, Qp_->quiet_s, Qp_->quiet_r(), T_acc_, reset);
   static int count = 0;
 }
 
-// Sample the IMU
-void Sensors::sample(const boolean reset, const unsigned long long time_now_ms, const unsigned long long time_start_ms, time_t now_hms)
+// Pick up where save() left off.  The next pass runs without reset, so nothing starts over.
+void Sensors::restore(const SensorsState *S)
+{
+    float *raw[8] = {&a_raw, &b_raw, &c_raw, &o_raw, &x_raw, &y_raw, &z_raw, &g_raw};
+    LagExp *lag[8] = {&A_Filt, &B_Filt, &C_Filt, &O_Filt, &X_Filt, &Y_Filt, &Z_Filt, &G_Filt};
+    for ( uint8_t i=0; i<8; i++ )
+    {
+        *raw[i] = S->raw[i];
+        lag[i]->lstate(S->lag[i][0]);
+        lag[i]->rstate(S->lag[i][1]);
+    }
+    OQuietRate.lstate(S->qrate[0][0]);
+    OQuietRate.rstate(S->qrate[0][1]);
+    GQuietRate.lstate(S->qrate[1][0]);
+    GQuietRate.rstate(S->qrate[1][1]);
+    OQuietFilt.restore(S->qfilt[0]);
+    GQuietFilt.restore(S->qfilt[1]);
+    OQuietPer.timer(S->qper[0]);
+    GQuietPer.timer(S->qper[1]);
+    o_is_quiet_ = S->quiet & 0x01;
+    o_is_quiet_sure_ = S->quiet & 0x02;
+    g_is_quiet_ = S->quiet & 0x04;
+    g_is_quiet_sure_ = S->quiet & 0x08;
+}
+
+// Sample the IMU, the only part that needs the board
+void Sensors::sample(const boolean reset, ImuSample *imu)
+{
+    imu->acc = !reset && IMU.accelerationAvailable();
+    if ( imu->acc ) IMU.readAcceleration(imu->x, imu->y, imu->z);
+    imu->rot = !reset && IMU.gyroscopeAvailable();
+    if ( imu->rot )
+    {
+        IMU.readGyroscope(imu->a, imu->b, imu->c);
+        imu->a *= deg_to_rps;
+        imu->b *= deg_to_rps;
+        imu->c *= deg_to_rps;
+    }
+}
+
+// Filter and persistence states for a warm boot
+void Sensors::save(SensorsState *S)
+{
+    float raw[8] = {a_raw, b_raw, c_raw, o_raw, x_raw, y_raw, z_raw, g_raw};
+    LagExp *lag[8] = {&A_Filt, &B_Filt, &C_Filt, &O_Filt, &X_Filt, &Y_Filt, &Z_Filt, &G_Filt};
+    for ( uint8_t i=0; i<8; i++ )
+    {
+        S->raw[i] = raw[i];
+        S->lag[i][0] = lag[i]->lstate();
+        S->lag[i][1] = lag[i]->rstate();
+    }
+    S->qrate[0][0] = OQuietRate.lstate();
+    S->qrate[0][1] = OQuietRate.rstate();
+    S->qrate[1][0] = GQuietRate.lstate();
+    S->qrate[1][1] = GQuietRate.rstate();
+    OQuietFilt.save(S->qfilt[0]);
+    GQuietFilt.save(S->qfilt[1]);
+    S->qper[0] = OQuietPer.timer();
+    S->qper[1] = GQuietPer.timer();
+    S->quiet = ( o_is_quiet_ ? 0x01 : 0 ) | ( o_is_quiet_sure_ ? 0x02 : 0 ) | ( g_is_quiet_ ? 0x04 : 0 ) | ( g_is_quiet_sure_ ? 0x08 : 0 );
+    S->spare = 0;
+}
+
+// Take one read frame, from the IMU or from a recording.  up_ms times the frame and t_ms, epoch ms,
+// stamps it, so setting the clock never upsets the filter update times.
+void Sensors::take(const boolean reset, const ImuSample *imu, const unsigned long long up_ms, const unsigned long long t_ms_now)
 {
     // Reset
     if ( reset )
     {
-        time_rot_last_ = time_now_ms - READ_DELAY;
-        time_acc_last_ = time_now_ms - READ_DELAY;
+        time_rot_last_ = up_ms - READ_DELAY;
+        time_acc_last_ = up_ms - READ_DELAY;
     }
 
     // Accelerometer
-    if ( !reset && IMU.accelerationAvailable() )
+    if ( !reset && imu->acc )
     {
-        IMU.readAcceleration(x_raw, y_raw, z_raw);
+        x_raw = imu->x;
+        y_raw = imu->y;
+        z_raw = imu->z;
         acc_available_ = true;
         g_raw = sqrt(x_raw*x_raw + y_raw*y_raw + z_raw*z_raw);
     }
     else acc_available_ = false;
-    T_acc_ = double(time_now_ms - time_acc_last_) / 1000.;
+    T_acc_ = double(up_ms - time_acc_last_) / 1000.;
 
     // Gyroscope
-    if ( !reset && IMU.gyroscopeAvailable() )
+    if ( !reset && imu->rot )
     {
-        IMU.readGyroscope(a_raw, b_raw, c_raw);
-        a_raw *= deg_to_rps;
-        b_raw *= deg_to_rps;
-        c_raw *= deg_to_rps;
+        a_raw = imu->a;
+        b_raw = imu->b;
+        c_raw = imu->c;
         rot_available_ = true;
         o_raw = sqrt(a_raw*a_raw + b_raw*b_raw + c_raw*c_raw);
     }
     else rot_available_ = false;
-    T_rot_ = double(time_now_ms - time_rot_last_) / 1000.;
+    T_rot_ = double(up_ms - time_rot_last_) / 1000.;
 
     // Time stamp
-    t_ms = time_now_ms - time_start_ms + (unsigned long long)now_hms*1000;
-    if ( debug==9 )
-    {
-      cSF(prn_buff, INPUT_BYTES, "");
-      time_long_2_str(t_ms, prn_buff);
-      Serial.print("t_ms: "); Serial.print(prn_buff); Serial.print(" "); Serial.print(t_ms, 3); Serial.print(" = ");
-      Serial.print(time_now_ms); Serial.print(" - "); Serial.print(time_start_ms, 3); Serial.print(" + "); Serial.print((unsigned long long)now_hms);
-      time_long_2_str((unsigned long long)now_hms*1000, prn_buff); Serial.print(" "); Serial.println(prn_buff);
-
-    }
-    if ( acc_available_ ) time_acc_last_ = time_now_ms;
-    if ( rot_available_ ) time_rot_last_ = time_now_ms;
-
+    t_ms = t_ms_now;
+    TRACE_COUNT(TRACE_STAMP, int16_t(t_ms % 1000ULL));
+    if ( acc_available_ ) time_acc_last_ = up_ms;
+    if ( rot_available_ ) time_rot_last_ = up_ms;
 }
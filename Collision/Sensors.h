@@ -33,50 +33,89 @@
   #include "application.h"  // Particle
 #endif
 #include "myFilters.h"
-extern int debug;
+
+// One read frame from the IMU, rotation already converted to rps
+struct ImuSample
+{
+  boolean acc;          // Acceleration available
+  float x, y, z;        // g's
+  boolean rot;          // Rotation available
+  float a, b, c;        // rps
+};
+
+// Quiet detection tuning, adjustable at run time ('q' commands) and swept by CollisionHost/coll_sweep.
+// The thresholds and persistence act on the quiet filter outputs; tau_q, wn_q and zeta_q shape those
+// outputs.  Nominal values are the constants.h ones.
+struct QuietPars
+{
+  float o_thr;          // rps quiet detection threshold
+  float g_thr;          // g's quiet detection threshold
+  float quiet_s;        // Quiet set persistence, sec
+  float r_scl;          // Quiet reset persistence scalar on quiet_s
+  float tau_q;          // Quiet rate time constant, sec
+  float wn_q;           // Quiet filter-2 natural frequency, r/s
+  float zeta_q;         // Quiet filter-2 damping factor
+
+  void nominal();
+  float *par(const char *name);
+  void print(Print *out);
+  float quiet_r() const { return ( quiet_s / r_scl ); };
+};
+#define QUIET_PARS               7      // Fields in QuietPars, in order
+extern const char *const quiet_par_names[QUIET_PARS];
+
+// Filter and persistence states, what a warm boot restores (Snapshot.h).  Float is plenty for a
+// starting point.
+struct SensorsState
+{
+  float raw[8];         // a, b, c, o, x, y, z, g
+  float lag[8][2];      // Noise filters in raw order, lstate and rstate
+  float qrate[2][2];    // Quiet rate, o then g, lstate and rstate
+  float qfilt[2][4];    // Quiet 2-pole, o then g, General2_Pole::save order
+  int16_t qper[2];      // Quiet persistence timers, o then g
+  uint8_t quiet;        // o_is_quiet, o_is_quiet_sure, g_is_quiet, g_is_quiet_sure, bit 0 up
+  uint8_t spare;
+};
 
 // Sensors (like a big struct with public access)
 class Sensors
 {
 public:
     Sensors(): t_ms(0),
-      a_raw(0), b_raw(0), c_raw(0), o_raw(0), a_filt(0), b_filt(0), c_filt(0), o_filt(0),
-      x_raw(0), y_raw(0), z_raw(0), g_raw(0), x_filt(0), y_filt(0), z_filt(0), g_filt(0),
+      a_raw(0), b_raw(0), c_raw(0), o_raw(0), x_raw(0), y_raw(0), z_raw(0), g_raw(0),
+      a_filt(0), b_filt(0), c_filt(0), o_filt(0), x_filt(0), y_filt(0), z_filt(0), g_filt(0),
       time_acc_last_(0ULL), time_rot_last_(0ULL),
-      o_is_quiet_(true), o_is_quiet_sure_(true), g_is_quiet_(true), g_is_quiet_sure_(true)
+      o_is_quiet_(true), o_is_quiet_sure_(true), g_is_quiet_(true), g_is_quiet_sure_(true), Qp_(NULL)
     {};
-    Sensors(const unsigned long long time_now, const double NOM_DT ): t_ms(0),
-      a_raw(0), b_raw(0), c_raw(0), o_raw(0), a_filt(0), b_filt(0), c_filt(0), o_filt(0),
-      x_raw(0), y_raw(0), z_raw(0), g_raw(1), x_filt(0), y_filt(0), z_filt(0), g_filt(0),
+    // Filters held in place, no heap.  Update time and time constant changed on the fly
+    Sensors(const unsigned long long time_now, const double NOM_DT, const QuietPars *Qp): t_ms(0),
+      a_raw(0), b_raw(0), c_raw(0), o_raw(0), x_raw(0), y_raw(0), z_raw(0), g_raw(1),
+      a_filt(0), b_filt(0), c_filt(0), o_filt(0), x_filt(0), y_filt(0), z_filt(0), g_filt(0),
+      A_Filt(READ_DELAY/1000., TAU_FILT, -W_MAX, W_MAX),
+      B_Filt(READ_DELAY/1000., TAU_FILT, -W_MAX, W_MAX),
+      C_Filt(READ_DELAY/1000., TAU_FILT, -W_MAX, W_MAX),
+      O_Filt(READ_DELAY/1000., TAU_FILT, -W_MAX, W_MAX),
+      OQuietFilt(READ_DELAY/1000., Qp->wn_q, Qp->zeta_q, MIN_Q_FILT, MAX_Q_FILT),
+      OQuietRate(READ_DELAY/1000., Qp->tau_q, MIN_Q_FILT, MAX_Q_FILT),
+      OQuietPer(true, Qp->quiet_s, Qp->quiet_r(), READ_DELAY/1000.),
+      X_Filt(READ_DELAY/1000., TAU_FILT, -G_MAX, G_MAX),
+      Y_Filt(READ_DELAY/1000., TAU_FILT, -G_MAX, G_MAX),
+      Z_Filt(READ_DELAY/1000., TAU_FILT, -G_MAX, G_MAX),
+      G_Filt(READ_DELAY/1000., TAU_FILT, -G_MAX, G_MAX),
+      GQuietFilt(READ_DELAY/1000., Qp->wn_q, Qp->zeta_q, MIN_Q_FILT, MAX_Q_FILT),
+      GQuietRate(READ_DELAY/1000., Qp->tau_q, MIN_Q_FILT, MAX_Q_FILT),
+      GQuietPer(true, Qp->quiet_s, Qp->quiet_r(), READ_DELAY/1000.),
       time_acc_last_(time_now), time_rot_last_(time_now),
-      o_is_quiet_(true), o_is_quiet_sure_(true), g_is_quiet_(true), g_is_quiet_sure_(true)
-    {
-        // Update time and time constant changed on the fly
-        float Tfilt_init = READ_DELAY/1000.;
-        
-        A_Filt = new LagExp(Tfilt_init, TAU_FILT, -W_MAX, W_MAX);
-        B_Filt = new LagExp(Tfilt_init, TAU_FILT, -W_MAX, W_MAX);
-        C_Filt = new LagExp(Tfilt_init, TAU_FILT, -W_MAX, W_MAX);
-        O_Filt = new LagExp(Tfilt_init, TAU_FILT, -W_MAX, W_MAX);
-        OQuietFilt = new General2_Pole(Tfilt_init, WN_Q_FILT, ZETA_Q_FILT, MIN_Q_FILT, MAX_Q_FILT);  // actual update time provided run time
-        OQuietRate = new RateLagExp(Tfilt_init, TAU_Q_FILT, MIN_Q_FILT, MAX_Q_FILT);
-        OQuietPer = new TFDelay(true, QUIET_S, QUIET_R, Tfilt_init);
-        
-        X_Filt = new LagExp(Tfilt_init, TAU_FILT, -G_MAX, G_MAX);
-        Y_Filt = new LagExp(Tfilt_init, TAU_FILT, -G_MAX, G_MAX);
-        Z_Filt = new LagExp(Tfilt_init, TAU_FILT, -G_MAX, G_MAX);
-        G_Filt = new LagExp(Tfilt_init, TAU_FILT, -G_MAX, G_MAX);
-        GQuietFilt = new General2_Pole(Tfilt_init, WN_Q_FILT, ZETA_Q_FILT, MIN_Q_FILT, MAX_Q_FILT);  // actual update time provided run time
-        GQuietRate = new RateLagExp(Tfilt_init, TAU_Q_FILT, MIN_Q_FILT, MAX_Q_FILT);
-        GQuietPer = new TFDelay(true, QUIET_S, QUIET_R, Tfilt_init);
-    };
+      o_is_quiet_(true), o_is_quiet_sure_(true), g_is_quiet_(true), g_is_quiet_sure_(true), Qp_(Qp)
+    {};
     unsigned long long millis;
-    ~Sensors(){};
 
     boolean both_are_quiet() { return o_is_quiet_sure_ && g_is_quiet_sure_; };
     boolean both_not_quiet() { return ( !o_is_quiet_sure_ && !g_is_quiet_sure_ ); };
     void filter(const boolean reset);
+    boolean g_is_quiet() { return g_is_quiet_; };
     boolean g_is_quiet_sure() { return g_is_quiet_sure_; };
+    boolean o_is_quiet() { return o_is_quiet_; };
     boolean o_is_quiet_sure() { return o_is_quiet_sure_; };
     void plot_all();
     void plot_all_acc();
@@ -88,10 +127,13 @@ public:
     void print_all_header();
     void print_all();
     void quiet_decisions(const boolean reset);
-    void sample(const boolean reset, const unsigned long long time_now_ms, const unsigned long long time_start_ms, time_t now_hms);
+    void restore(const SensorsState *S);
+    void sample(const boolean reset, ImuSample *imu);
+    void save(SensorsState *S);
+    void take(const boolean reset, const ImuSample *imu, const unsigned long long up_ms, const unsigned long long t_ms_now);
     float T_acc() { return T_acc_; };
     float T_rot() { return T_rot_; };
-    time_t t_ms;
+    unsigned long long t_ms;  // Epoch ms of the latest frame
     // Gyroscope in radians/second
     float a_raw;
     float b_raw;
@@ -115,20 +157,20 @@ public:
     float g_qrate;
     float g_quiet;
 protected:
-    LagExp *A_Filt;     // Noise filter
-    LagExp *B_Filt;     // Noise filter
-    LagExp *C_Filt;     // Noise filter
-    LagExp *O_Filt;     // Noise filter
-    General2_Pole *OQuietFilt; // Quiet detector
-    RateLagExp *OQuietRate;    // Quiet detector
-    TFDelay *OQuietPer; // Persistence ib quiet disconnect detection
-    LagExp *X_Filt;     // Noise filter
-    LagExp *Y_Filt;     // Noise filter
-    LagExp *Z_Filt;     // Noise filter
-    LagExp *G_Filt;     // Noise filter
-    General2_Pole *GQuietFilt; // Quiet detector
-    RateLagExp *GQuietRate;    // Quiet detector
-    TFDelay *GQuietPer; // Persistence ib quiet disconnect detection
+    LagExp A_Filt;      // Noise filter
+    LagExp B_Filt;      // Noise filter
+    LagExp C_Filt;      // Noise filter
+    LagExp O_Filt;      // Noise filter
+    General2_Pole OQuietFilt;  // Quiet detector
+    RateLagExp OQuietRate;     // Quiet detector
+    TFDelay OQuietPer;  // Persistence ib quiet disconnect detection
+    LagExp X_Filt;      // Noise filter
+    LagExp Y_Filt;      // Noise filter
+    LagExp Z_Filt;      // Noise filter
+    LagExp G_Filt;      // Noise filter
+    General2_Pole GQuietFilt;  // Quiet detector
+    RateLagExp GQuietRate;     // Quiet detector
+    TFDelay GQuietPer;  // Persistence ib quiet disconnect detection
     unsigned long long time_acc_last_;
     unsigned long long time_rot_last_;
     double T_acc_;
@@ -139,6 +181,7 @@ protected:
     boolean o_is_quiet_sure_;
     boolean g_is_quiet_;
     boolean g_is_quiet_sure_;
+    const QuietPars *Qp_;  // Quiet tuning, read every pass so changes take effect at once
 };
 
 #endif
@@ -0,0 +1,174 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "Snapshot.h"
+#include "Clock.h"
+#include "CollFormat.h"
+#include "CollTelem.h"
+#include "Power.h"
+
+extern QuietPars Quiet;
+extern uint16_t plot_pace;
+extern CollTelem Telem;
+
+static uint32_t round_up(const uint32_t x, const uint32_t m) { return ( (x + m - 1) / m * m ); }
+
+// Both quiet decisions sure, SensorsState::quiet bits
+static boolean quiet(const SensorsState *S) { return ( ( S->quiet & 0x0A ) == 0x0A ); }
+
+// Constructors
+Snapshot::Snapshot(FlashClass *Flash, FlashWriter *Writer)
+  : Flash_(Flash), Writer_(Writer), base_(NULL), slot_bytes_(0), nslots_(0), slot_(0), gen_(0), pos_(0),
+  loaded_(false), warm_(false), pending_(false), writing_(false), saved_ms_(0ULL), load_us_(0), writes_(0)
+{}
+
+// Take the newest slot that checks out and put the clock and settings back.  False boots cold.  The
+// filter states go back (warm()) only from a snapshot taken quiet; one taken moving starts them cold.
+boolean Snapshot::begin()
+{
+  unsigned long start = micros();
+  base_ = (const uint8_t *)Flash_->address();
+  slot_bytes_ = round_up(sizeof(SnapImage), Flash_->row_size());
+  nslots_ = SNAP_BYTES / slot_bytes_;
+  int8_t best = -1;
+  for ( uint8_t s=0; s<nslots_; s++ )
+  {
+    const SnapImage *m = (const SnapImage *)(base_ + s * slot_bytes_);
+    if ( m->magic != SNAP_MAGIC || m->version != SNAP_VERSION ) continue;
+    SnapImage copy = *m;
+    copy.crc = 0;
+    if ( crc16_update(0xFFFF, &copy, sizeof(copy)) != m->crc ) continue;
+    if ( best < 0 || m->gen > ((const SnapImage *)(base_ + best * slot_bytes_))->gen ) best = s;
+  }
+  loaded_ = best >= 0;
+  warm_ = false;
+  if ( loaded_ )
+  {
+    slot_ = best;
+    Img_ = *(const SnapImage *)(base_ + best * slot_bytes_);
+    gen_ = Img_.gen;
+    Quiet = Img_.quiet;
+    plot_pace = Img_.plot_pace;
+    Telem.mask(Img_.telem_mask);
+    Telem.decim(Img_.telem_decim);
+    Pwr.enable(Img_.power);
+    Clk.set(time_t( Img_.t_ms / 1000ULL ));  // time off is unknown; this is the last known
+    warm_ = quiet(&Img_.sen);
+  }
+  else slot_ = nslots_ - 1;  // first write to slot 0
+  load_us_ = micros() - start;
+  return ( loaded_ );
+}
+
+// Flash writer completion
+void Snapshot::done(const boolean ok, void *ctx)
+{
+  Snapshot *S = (Snapshot *)ctx;
+  if ( ok )
+  {
+    S->gen_ = S->Img_.gen;
+    if ( ++S->slot_ >= S->nslots_ ) S->slot_ = 0;
+    S->writes_++;
+  }
+  else S->pending_ = true;
+  S->writing_ = false;
+}
+
+// Flash writer source
+uint16_t Snapshot::fill(uint8_t *buf, const uint16_t max, void *ctx)
+{
+  Snapshot *S = (Snapshot *)ctx;
+  uint16_t k = 0;
+  while ( k < max && S->pos_ < sizeof(SnapImage) ) buf[k++] = ((const uint8_t *)&S->Img_)[S->pos_++];
+  return ( k );
+}
+
+void Snapshot::print(Print *out)
+{
+  out->print("Snapshot: "); out->print(warm_ ? "warm" : ( loaded_ ? "settings" : "cold" ));
+  out->print(" boot load_us="); out->print(load_us_);
+  out->print(" gen="); out->print(gen_);
+  out->print(" slot="); out->print(slot_); out->print("/"); out->print(nslots_);
+  out->print(" bytes="); out->print(sizeof(SnapImage));
+  out->print(" writes="); out->println(writes_);
+}
+
+// Start a snapshot once the writer is free, when one was asked for or SNAP_S has passed
+void Snapshot::run(const unsigned long long up_ms, Sensors *Sen)
+{
+  if ( writing_ || !nslots_ || Writer_->busy() ) return;
+  if ( !pending_ && up_ms - saved_ms_ < SNAP_S * 1000ULL ) return;
+  take(&Img_, up_ms, Sen);
+  Img_.gen = gen_ + 1;
+  Img_.crc = crc16_update(0xFFFF, &Img_, sizeof(Img_));
+  pos_ = 0;
+  uint8_t next = ( slot_ + 1 < nslots_ ) ? slot_ + 1 : 0;
+  writing_ = Writer_->begin(base_ + next * slot_bytes_, sizeof(SnapImage), fill, done, this);
+  if ( writing_ )
+  {
+    pending_ = false;
+    saved_ms_ = up_ms;
+  }
+}
+
+// The settings and quiet decisions in flash are the board's now; a snapshot is asked for if not.  The
+// doze waits on it.  Filter states alone drifting doesn't take a write.
+boolean Snapshot::settled(const unsigned long long up_ms, Sensors *Sen)
+{
+  if ( busy() ) return ( false );
+  if ( loaded_ || writes_ )
+  {
+    SnapImage now;
+    take(&now, up_ms, Sen);
+    if ( now.power == Img_.power && now.telem_decim == Img_.telem_decim && now.telem_mask == Img_.telem_mask &&
+      now.plot_pace == Img_.plot_pace && !memcmp(&now.quiet, &Img_.quiet, sizeof(QuietPars)) &&
+      now.sen.quiet == Img_.sen.quiet ) return ( true );
+  }
+  pending_ = true;
+  return ( false );
+}
+
+// The board as it is now, but for gen and crc
+void Snapshot::take(SnapImage *m, const unsigned long long up_ms, Sensors *Sen)
+{
+  memset(m, 0, sizeof(SnapImage));
+  m->magic = SNAP_MAGIC;
+  m->version = SNAP_VERSION;
+  m->power = Pwr.enabled();
+  m->telem_decim = Telem.decim();
+  m->telem_mask = Telem.mask();
+  m->plot_pace = plot_pace;
+  m->up_s = uint32_t( up_ms / 1000ULL );
+  m->t_ms = Clk.ms();
+  m->quiet = Quiet;
+  Sen->save(&m->sen);
+}
+
+// Hand Sensors the states begin() loaded, if taken quiet.  True when it did; the first pass then runs
+// without reset.
+boolean Snapshot::warm(Sensors *Sen)
+{
+  if ( !warm_ ) return ( false );
+  Sen->restore(&Img_.sen);
+  return ( true );
+}
@@ -0,0 +1,99 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include "constants.h"
+#include "FlashStorage.h"
+#include "FlashWriter.h"
+#include "Sensors.h"
+
+#define SNAP_MAGIC          0x5A4E      // Flash snapshot slot marker
+#define SNAP_VERSION             1      // Snapshot layout version; any other boots cold
+
+// Everything a warm boot restores, one flash slot
+struct SnapImage
+{
+  uint16_t magic;
+  uint16_t crc;
+  uint32_t gen;                 // Incremented every write
+  uint8_t version;
+  uint8_t power;                // Pwr enabled
+  uint8_t telem_decim;
+  uint8_t spare;
+  uint32_t telem_mask;
+  uint16_t plot_pace;
+  uint16_t spare2;
+  uint32_t up_s;                // Up time when taken
+  unsigned long long t_ms;      // Epoch ms when taken
+  QuietPars quiet;
+  SensorsState sen;
+};
+
+// Warm boot.  A snapshot of the epoch, the run time settings and the Sensors filter states goes to a
+// small flash region every SNAP_S, after a settings command and before a doze when the settings or
+// quiet decisions changed since the last, into the next of a few rotating slots through the
+// background FlashWriter.  begin() takes the newest slot that checks out:  the clock restarts at the
+// snapshot epoch instead of ARBITRARY_TIME and the settings come back.  When it was taken quiet,
+// warm() then hands Sensors its states so the first pass runs without reset and the quiet decisions
+// carry on; filter states from a board in motion are stale by the next boot, so those start cold.  Ram is zeroed at boot, so Data_st is not part of it; events that matter are
+// already in the collision log.
+class Snapshot
+{
+public:
+  Snapshot(FlashClass *Flash, FlashWriter *Writer);
+  ~Snapshot(){};
+  boolean begin();
+  boolean busy() { return ( pending_ || writing_ ); };
+  void print(Print *out);
+  void request() { pending_ = true; };
+  void run(const unsigned long long up_ms, Sensors *Sen);
+  boolean settled(const unsigned long long up_ms, Sensors *Sen);
+  boolean warm(Sensors *Sen);
+protected:
+  void take(SnapImage *m, const unsigned long long up_ms, Sensors *Sen);
+  static void done(const boolean ok, void *ctx);
+  static uint16_t fill(uint8_t *buf, const uint16_t max, void *ctx);
+  FlashClass *Flash_;
+  FlashWriter *Writer_;
+  const uint8_t *base_;
+  uint32_t slot_bytes_;
+  uint8_t nslots_;
+  uint8_t slot_;                // Slot written or loaded last
+  uint32_t gen_;
+  SnapImage Img_;               // Loaded at begin, then the one being written
+  uint16_t pos_;                // Into Img_ while writing
+  boolean loaded_;              // begin() found one
+  boolean warm_;                // and it was taken quiet, so warm() restores Sensors
+  boolean pending_;
+  boolean writing_;
+  unsigned long long saved_ms_; // Up time of the last snapshot taken
+  unsigned long load_us_;       // Time taken by begin()
+  uint32_t writes_;
+};
+
+extern Snapshot Snap;
+
+#endif
@@ -31,16 +31,6 @@
 
 #include "Sync.h"
 
-// Constructors
-Sync::Sync()
-  : delay_(0), last_(0ULL), now_(0ULL), stat_(false), updateDiff_(0), updateTime_(0)
-{}
-Sync::Sync(unsigned long long delay)
-    : delay_(delay), last_(0ULL), now_(0ULL), stat_(false), updateDiff_(0), updateTime_(0)
-{
-  updateTimeInput_ = float(delay_)/1000.;
-}
-
 // Check and count 
 boolean Sync::update(boolean reset, unsigned long long now, boolean andCheck)
 {
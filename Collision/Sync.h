@@ -29,9 +29,11 @@
 class Sync
 {
 public:
-  // Constructors
-  Sync(void);
-  Sync(unsigned long long delay);
+  // Constructors, constexpr so a static Sync needs no startup code
+  constexpr Sync(void)
+    : delay_(0), last_(0ULL), now_(0ULL), stat_(false), updateDiff_(0), updateTime_(0), updateTimeInput_(0) {}
+  constexpr Sync(unsigned long long delay)
+    : delay_(delay), last_(0ULL), now_(0ULL), stat_(false), updateDiff_(0), updateTime_(0), updateTimeInput_(float(delay)/1000.) {}
   // Functions
   boolean update(boolean reset, unsigned long long now, boolean andCheck);
   boolean update(unsigned long long now, boolean reset, boolean andCheck);
@@ -143,93 +143,70 @@ int year(time_t t) { // the year for the given time
 /* functions to convert to and from system time */
 /* These are for interfacing with time services and are not normally needed in a sketch */
 
-// leap year calculator expects year argument as years offset from 1970
-#define LEAP_YEAR(Y)     ( ((1970+(Y))>0) && !((1970+(Y))%4) && ( ((1970+(Y))%100) || !((1970+(Y))%400) ) )
+// Civil dates in constant time, after H. Hinnant, "chrono-Compatible Low-Level Date Algorithms".
+// Years are counted from March so the leap day falls last, and the calendar repeats exactly every
+// 400 year era of 146097 days, so a date is a few divisions rather than a walk from 1970.
+
+// days since 1 Jan 1970 of the given date, month 1-12
+static int32_t daysFromCivil(int32_t y, const uint8_t m, const uint8_t d){
+  y -= m <= 2;
+  const int32_t era = (y >= 0 ? y : y - 399) / 400;
+  const uint32_t yoe = (uint32_t)(y - era * 400);                          // [0, 399]
+  const uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;   // [0, 365]
+  const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;            // [0, 146096]
+  return era * 146097 + (int32_t)doe - 719468;
+}
+
+// date of the given days since 1 Jan 1970
+static void civilFromDays(int32_t z, int32_t &y, uint8_t &m, uint8_t &d){
+  z += 719468;
+  const int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const uint32_t doe = (uint32_t)(z - era * 146097);                          // [0, 146096]
+  const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;  // [0, 399]
+  const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);                // [0, 365]
+  const uint32_t mp = (5 * doy + 2) / 153;                                     // [0, 11], March is 0
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = mp < 10 ? mp + 3 : mp - 9;
+  y = (int32_t)yoe + era * 400 + (m <= 2);
+}
 
-static  const uint8_t monthDays[]={31,28,31,30,31,30,31,31,30,31,30,31}; // API starts months from 1, this array starts from 0
- 
 void breakTime(time_t timeInput, tmElements_t &tm){
 // break the given time_t into time components
 // this is a more compact version of the C library localtime function
 // note that year is offset from 1970 !!!
+  breakTime64((uint32_t)timeInput, tm);
+}
 
-  uint8_t year;
-  uint8_t month, monthLength;
-  uint32_t time;
-  unsigned long days;
-
-  time = (uint32_t)timeInput;
-  tm.Second = time % 60;
-  time /= 60; // now it is minutes
-  tm.Minute = time % 60;
-  time /= 60; // now it is hours
-  tm.Hour = time % 24;
-  time /= 24; // now it is days
-  tm.Wday = ((time + 4) % 7) + 1;  // Sunday is day 1 
-  
-  year = 0;  
-  days = 0;
-  while((unsigned)(days += (LEAP_YEAR(year) ? 366 : 365)) <= time) {
-    year++;
+void breakTime64(int64_t time, tmElements_t &tm){
+// as breakTime, past 2038 and 2106; tm.Year holds 1970 through 2225
+  int32_t days = (int32_t)(time / 86400);
+  int32_t secs = (int32_t)(time % 86400);
+  if (secs < 0) {
+    secs += 86400;
+    days--;
   }
-  tm.Year = year; // year is offset from 1970 
-  
-  days -= LEAP_YEAR(year) ? 366 : 365;
-  time  -= days; // now it is days in this year, starting at 0
-  
-  days=0;
-  month=0;
-  monthLength=0;
-  for (month=0; month<12; month++) {
-    if (month==1) { // february
-      if (LEAP_YEAR(year)) {
-        monthLength=29;
-      } else {
-        monthLength=28;
-      }
-    } else {
-      monthLength = monthDays[month];
-    }
-    
-    if (time >= monthLength) {
-      time -= monthLength;
-    } else {
-        break;
-    }
-  }
-  tm.Month = month + 1;  // jan is month 1  
-  tm.Day = time + 1;     // day of month
+  tm.Second = secs % 60;
+  secs /= 60; // now it is minutes
+  tm.Minute = secs % 60;
+  tm.Hour = secs / 60;
+  tm.Wday = ((days % 7 + 11) % 7) + 1;  // Sunday is day 1; 1 Jan 1970 was a Thursday
+
+  int32_t year;
+  civilFromDays(days, year, tm.Month, tm.Day);
+  tm.Year = CalendarYrToTm(year); // year is offset from 1970
 }
 
-time_t makeTime(const tmElements_t &tm){   
-// assemble time elements into time_t 
+time_t makeTime(const tmElements_t &tm){
+// assemble time elements into time_t
 // note year argument is offset from 1970 (see macros in time.h to convert to other formats)
 // previous version used full four digit year (or digits since 2000),i.e. 2009 was 2009 or 9
-  
-  int i;
-  uint32_t seconds;
-
-  // seconds from 1970 till 1 jan 00:00:00 of the given year
-  seconds= tm.Year*(SECS_PER_DAY * 365);
-  for (i = 0; i < tm.Year; i++) {
-    if (LEAP_YEAR(i)) {
-      seconds += SECS_PER_DAY;   // add extra days for leap years
-    }
-  }
-  
-  // add days for this year, months start from 1
-  for (i = 1; i < tm.Month; i++) {
-    if ( (i == 2) && LEAP_YEAR(tm.Year)) { 
-      seconds += SECS_PER_DAY * 29;
-    } else {
-      seconds += SECS_PER_DAY * monthDays[i-1];  //monthDay array starts from 0
-    }
-  }
-  seconds+= (tm.Day-1) * SECS_PER_DAY;
-  seconds+= tm.Hour * SECS_PER_HOUR;
-  seconds+= tm.Minute * SECS_PER_MIN;
-  seconds+= tm.Second;
-  return (time_t)seconds; 
+  return (time_t)(uint32_t)makeTime64(tm);
+}
+
+int64_t makeTime64(const tmElements_t &tm){
+// as makeTime, past 2038 and 2106
+  int64_t days = daysFromCivil(tmYearToCalendar(tm.Year), tm.Month, 1) + tm.Day - 1;  // out of range Day runs on as before
+  return days * 86400 + tm.Hour * 3600L + tm.Minute * 60L + tm.Second;
 }
 /*=====================================================*/	
 /* Low level system time functions  */
@@ -249,14 +226,13 @@ time_t sysUnsyncedTime = 0; // the time sysTime unadjusted by sync
 
 time_t now() {
 	// calculate number of seconds passed since last call to now()
-  while (millis() - prevMillis >= 1000) {
-		// millis() and prevMillis are both unsigned ints thus the subtraction will always be the absolute value of the difference
-    sysTime++;
-    prevMillis += 1000;	
+  // millis() and prevMillis are both unsigned ints thus the subtraction will always be the absolute value of the difference
+  uint32_t secs = (uint32_t)(millis() - prevMillis) / 1000;  // all of them at once rather than a pass each
+  sysTime += secs;
+  prevMillis += secs * 1000;
 #ifdef TIME_DRIFT_INFO
-    sysUnsyncedTime++; // this can be compared to the synced time to measure long term drift     
+  sysUnsyncedTime += secs; // this can be compared to the synced time to measure long term drift     
 #endif
-  }
   if (nextSyncTime <= sysTime) {
     if (getTimePtr != 0) {
       time_t t = getTimePtr();
@@ -137,6 +137,8 @@ void    setSyncInterval(time_t interval); // set the number of seconds between r
 /* low level functions to convert to and from system time                     */
 void breakTime(time_t time, tmElements_t &tm);  // break time_t into elements
 time_t makeTime(const tmElements_t &tm);  // convert time elements into time_t
+void breakTime64(int64_t time, tmElements_t &tm);  // as breakTime, 64 bit seconds, years to 2225
+int64_t makeTime64(const tmElements_t &tm);  // as makeTime, 64 bit seconds
 
 } // extern "C++"
 #endif // __cplusplus
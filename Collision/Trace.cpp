@@ -0,0 +1,114 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#include "Trace.h"
+
+// Constructors
+Trace::Trace()
+  : head_(0), lost_(0), dumping_(false), head_due_(false), next_(0), seq_(0)
+{
+  memset(&Hdr_, 0, sizeof(Hdr_));
+}
+
+// Start over, dropping any dump under way
+void Trace::clear()
+{
+  head_ = 0;
+  lost_ = 0;
+  dumping_ = false;
+}
+
+// Freeze the ring and send it, oldest first, stamped t_ms epoch now.  False if a dump is under way.
+boolean Trace::dump(const unsigned long long t_ms)
+{
+  if ( dumping_ ) return ( false );
+  uint32_t n = min(head_, uint32_t(TRACE_EVENTS));
+  Hdr_.type = TRACE_HEAD;
+  Hdr_.n = uint16_t(n);
+  Hdr_.lost = lost_ + ( head_ - n );
+  Hdr_.us = micros();
+  Hdr_.t_ms = t_ms;
+  lost_ = 0;
+  next_ = head_ - n;
+  seq_ = 0;
+  head_due_ = true;
+  dumping_ = true;
+  return ( true );
+}
+
+// Counters
+void Trace::print(Print *out)
+{
+  out->print("trace events="); out->print(head_);
+  out->print(" kept="); out->print(min(head_, uint32_t(TRACE_EVENTS)));
+  out->print(" lost="); out->print(lost_);
+  out->print(" dumping="); out->println(dumping_);
+}
+
+// One frame of a dump, room allowing.  The ring records again, empty, once the last is out.
+void Trace::run()
+{
+  if ( !dumping_ ) return;
+  uint8_t raw[TRACE_RAW_MAX];
+  if ( head_due_ )
+  {
+    memcpy(raw, &Hdr_, sizeof(Hdr_));
+    if ( send(raw, sizeof(Hdr_)) ) head_due_ = false;
+    return;
+  }
+  if ( next_ == head_ )
+  {
+    head_ = 0;
+    dumping_ = false;
+    return;
+  }
+  TraceData d;
+  d.type = TRACE_DATA;
+  d.n = uint8_t(min(head_ - next_, uint32_t(TRACE_PER_FRAME)));
+  d.seq = seq_;
+  memcpy(raw, &d, sizeof(d));
+  for ( uint8_t k=0; k<d.n; k++ )
+    memcpy(raw + sizeof(d) + k*sizeof(TraceEvent), &ring_[( next_ + k ) & ( TRACE_EVENTS - 1 )], sizeof(TraceEvent));
+  if ( !send(raw, sizeof(d) + d.n*sizeof(TraceEvent)) ) return;
+  next_ += d.n;
+  seq_++;
+}
+
+// crc, frame and queue n raw bytes if they fit whole.  raw must have 2 bytes spare for the crc.
+boolean Trace::send(uint8_t *raw, const uint16_t n)
+{
+  uint8_t frame[TRACE_FRAME_MAX];
+  uint16_t crc = crc16_update(0xFFFF, raw, n);
+  raw[n] = uint8_t(crc);
+  raw[n + 1] = uint8_t(crc >> 8);
+  frame[0] = 0;
+  uint16_t len = 1 + cobs_encode(raw, n + 2, frame + 1);
+  frame[len++] = 0;
+  if ( Data.availableForWrite() < len ) return ( false );
+  return ( Data.write(frame, len) == len );
+}
+
+#if TRACES
+Trace Tracer;
+#endif
@@ -0,0 +1,85 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <Arduino.h>
+#include "constants.h"
+#include "CollFormat.h"
+#include "TxQueue.h"
+
+// Loop trace.  Spans, instants and counters go into a ram ring of TRACE_EVENTS as (us, id, phase,
+// value), the oldest overwritten, for a dump in binary on command ('tr') and a Chrome trace on the
+// host (CollisionHost/coll_trace).  The ring freezes while it is dumped, one data frame a pass on
+// Data as room allows, and records again when the dump is out.  An event is a micros() read and an
+// 8 byte store (coll_trace -b times it on the host); with TRACES 0 the macros are empty and neither
+// the ring nor a branch is left.
+class Trace
+{
+public:
+  Trace();
+  ~Trace(){};
+  void add(const uint8_t id, const uint8_t ph, const int16_t value)
+  {
+    if ( dumping_ ) { lost_++; return; }
+    TraceEvent *e = &ring_[head_++ & ( TRACE_EVENTS - 1 )];
+    e->us = micros();
+    e->id = id;
+    e->ph = ph;
+    e->value = value;
+  };
+  void clear();
+  boolean dump(const unsigned long long t_ms);
+  boolean dumping() { return ( dumping_ ); };
+  void print(Print *out);
+  void run();
+protected:
+  boolean send(uint8_t *raw, const uint16_t n);
+  TraceEvent ring_[TRACE_EVENTS];
+  uint32_t head_;           // Events since clear; the next goes in at head_ mod TRACE_EVENTS
+  uint32_t lost_;           // Events overwritten before a dump or dropped during one
+  boolean dumping_;
+  boolean head_due_;        // TraceHead still to go
+  uint32_t next_;           // Next event to send
+  uint16_t seq_;            // Next data frame
+  TraceHead Hdr_;
+};
+static_assert(( TRACE_EVENTS & ( TRACE_EVENTS - 1 ) ) == 0, "TRACE_EVENTS must be a power of 2");
+
+#if TRACES
+  extern Trace Tracer;
+  #define TRACE_BEGIN(id)         Tracer.add(id, 'B', 0)
+  #define TRACE_END(id, value)    Tracer.add(id, 'E', value)
+  #define TRACE_MARK(id, value)   Tracer.add(id, 'i', value)
+  #define TRACE_COUNT(id, value)  Tracer.add(id, 'C', value)
+#else
+  #define TRACE_BEGIN(id)
+  #define TRACE_END(id, value)
+  #define TRACE_MARK(id, value)
+  #define TRACE_COUNT(id, value)
+#endif
+
+#endif
@@ -0,0 +1,196 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "TxQueue.h"
+
+// Constructors
+TxPort::TxPort(uint8_t *buf, const uint16_t size)
+  : buf_(buf), size_(size), head_(0), tail_(0), peak_(0), dropping_(false), midline_(false), framed_(false),
+  dropped_(0), lines_dropped_(0)
+{}
+
+// Move up to max waiting bytes to the port, stopping after the first newline when line is set.  A
+// binary frame (CollFormat.h), zero to zero, is one line whatever bytes it holds.
+uint16_t TxPort::drain(Print *to, const uint16_t max, const boolean line)
+{
+  uint16_t done = 0;
+  while ( done < max && tail_ != head_ )
+  {
+    uint16_t chunk = ( head_ > tail_ ) ? head_ - tail_ : size_ - tail_;
+    chunk = min(chunk, uint16_t(max - done));
+    boolean eol = false;
+    if ( line )
+    {
+      boolean framed = framed_;
+      for ( uint16_t k=0; k<chunk && !eol; k++ )
+      {
+        uint8_t c = buf_[tail_ + k];
+        if ( !c ) framed = !framed;
+        eol = !framed && ( !c || c == '\n' );
+        if ( eol ) chunk = k + 1;
+      }
+    }
+    uint16_t wrote = to->write(buf_ + tail_, chunk);
+    for ( uint16_t k=0; k<wrote; k++ ) if ( !buf_[tail_ + k] ) framed_ = !framed_;
+    if ( wrote )
+    {
+      uint8_t last = buf_[tail_ + wrote - 1];
+      midline_ = framed_ || ( last && last != '\n' );  // a closing zero ends a line too
+    }
+    tail_ = ( tail_ + wrote ) % size_;
+    done += wrote;
+    if ( wrote < chunk || eol ) break;
+  }
+  return ( done );
+}
+
+// Counters
+void TxPort::print_stats(Print *to)
+{
+  to->print("size="); to->print(size_);
+  to->print(" used="); to->print(used());
+  to->print(" peak="); to->print(peak_);
+  to->print(" dropped bytes="); to->print(dropped_);
+  to->print(" lines="); to->println(lines_dropped_);
+}
+
+// Queue the whole write or drop it.  Two bytes stay free for the end of a line so a line cut short
+// is still terminated and the next one starts clean.  A binary frame, written whole and ending in its
+// zero, is a line of its own.
+size_t TxPort::write(const uint8_t *buf, size_t n)
+{
+  boolean eol = n && ( buf[n-1] == '\n' || !buf[n-1] );
+  if ( dropping_ && !eol )
+  {
+    dropped_ += n;
+    return ( 0 );
+  }
+  if ( n + ( eol ? 0 : 2 ) > size_t(availableForWrite()) )
+  {
+    if ( !dropping_ ) lines_dropped_++;
+    dropping_ = !eol;
+    dropped_ += n;
+    return ( 0 );
+  }
+  dropping_ = false;
+  for ( size_t i=0; i<n; i++ )
+  {
+    buf_[head_] = buf[i];
+    if ( ++head_ >= size_ ) head_ = 0;
+  }
+  peak_ = max(peak_, used());
+  return ( n );
+}
+
+TxQueue::TxQueue(TxPort *Data, TxPort *Text)
+  : Data_(Data), Text_(Text), nJ_(0), jobs_dropped_(0), text_turn_(false)
+{}
+
+// Queue a line job behind any others
+boolean TxQueue::job(TxPort *out, TxLine line, void *ctx, const uint16_t pace_ms)
+{
+  if ( nJ_ >= TX_JOBS )
+  {
+    jobs_dropped_++;
+    return ( false );
+  }
+  J_[nJ_].out = out;
+  J_[nJ_].line = line;
+  J_[nJ_].ctx = ctx;
+  J_[nJ_].k = 0;
+  J_[nJ_].pace_ms = pace_ms;
+  J_[nJ_].last_ms = 0UL;
+  nJ_++;
+  return ( true );
+}
+
+// Queue a fixed line, e.g. a title, in order with the jobs around it.  s must outlive the job.
+boolean TxQueue::line(TxPort *out, const char *s)
+{
+  return ( job(out, say, (void *)s) );
+}
+
+// Counters
+void TxQueue::print_stats()
+{
+  Text_->print("Tx data: "); Data_->print_stats(Text_);
+  Text_->print("Tx text: "); Text_->print_stats(Text_);
+  Text_->print("Tx jobs waiting="); Text_->print(nJ_);
+  Text_->print(" dropped="); Text_->println(jobs_dropped_);
+}
+
+// Job printing ctx as one line
+boolean TxQueue::say(Print *out, const uint16_t k, void *ctx)
+{
+  if ( k ) return ( false );
+  out->println((const char *)ctx);
+  return ( true );
+}
+
+// Call every loop pass:  top up the rings from their jobs, then hand the port what it will take.
+// A line is finished before the other ring gets a turn, so the two never splice.
+void TxQueue::run()
+{
+  while ( step(Data_) | step(Text_) ) {};
+  if ( !Serial ) return;  // no host; rings fill and then drop
+  int room = Serial.availableForWrite();
+  while ( room > 0 )
+  {
+    TxPort *from = NULL;
+    if ( Data_->midline() && Data_->used() ) from = Data_;
+    else if ( Text_->midline() && Text_->used() ) from = Text_;
+    else
+    {
+      from = text_turn_ ? Text_ : Data_;
+      if ( !from->used() ) from = ( from == Text_ ) ? Data_ : Text_;
+      if ( !from->used() ) return;
+      text_turn_ = ( from == Data_ );
+    }
+    uint16_t done = from->drain(&Serial, room, true);
+    if ( !done ) return;
+    room -= done;
+  }
+}
+
+// One line from the oldest job printing to out, if out has room and the job's pace allows.  Returns
+// false when there was nothing to do.
+boolean TxQueue::step(TxPort *out)
+{
+  uint8_t j = 0;
+  while ( j < nJ_ && J_[j].out != out ) j++;
+  if ( j >= nJ_ || out->availableForWrite() < TX_LINE_MAX ) return ( false );
+  if ( J_[j].pace_ms )
+  {
+    unsigned long now = millis();
+    if ( J_[j].k && now - J_[j].last_ms < J_[j].pace_ms ) return ( false );
+    J_[j].last_ms = now;
+  }
+  if ( J_[j].line(J_[j].out, J_[j].k, J_[j].ctx) )
+  {
+    J_[j].k++;
+    return ( true );
+  }
+  nJ_--;
+  for ( ; j<nJ_; j++ ) J_[j] = J_[j+1];
+  return ( true );
+}
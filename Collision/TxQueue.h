@@ -0,0 +1,107 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef _TX_QUEUE_H
+#define _TX_QUEUE_H
+
+#include <Arduino.h>
+#include "constants.h"
+
+// Serial output buffered in ram.  A TxPort is a Print that formats into a ring instead of the port,
+// so printing never waits on USB.  Every write goes in whole or not at all.  Once a write is dropped
+// the rest of that line is dropped too, up to the next write ending in a newline, so a full ring
+// loses whole lines rather than splicing fragments.
+class TxPort : public Print
+{
+public:
+  TxPort(uint8_t *buf, const uint16_t size);
+  ~TxPort(){};
+  virtual int availableForWrite() { return ( size_ - 1 - used() ); };
+  uint16_t drain(Print *to, const uint16_t max, const boolean line=false);
+  uint32_t dropped() { return ( dropped_ ); };
+  uint32_t lines_dropped() { return ( lines_dropped_ ); };
+  boolean midline() { return ( midline_ ); };
+  uint16_t peak() { return ( peak_ ); };
+  void print_stats(Print *to);
+  uint16_t used() { return ( uint16_t( (head_ + size_ - tail_) % size_ ) ); };
+  using Print::write;
+  virtual size_t write(uint8_t c) { return ( write(&c, 1) ); };
+  virtual size_t write(const uint8_t *buf, size_t n);
+protected:
+  uint8_t *buf_;           // The caller's, size_ bytes
+  uint16_t size_;
+  uint16_t head_;           // Next byte in
+  uint16_t tail_;           // Next byte out
+  uint16_t peak_;           // Most ever waiting
+  boolean dropping_;        // Rest of the line is being thrown away
+  boolean midline_;         // Last byte drained did not end a line or a frame
+  boolean framed_;          // Inside a binary frame
+  uint32_t dropped_;        // Bytes thrown away
+  uint32_t lines_dropped_;
+};
+
+// Long output, one line per call.  Print line k to out and return true, or return false when there
+// are no more.  Called only when out has room for TX_LINE_MAX bytes.
+typedef boolean (*TxLine)(Print *out, const uint16_t k, void *ctx);
+
+// Drains two ports to Serial a whole line at a time, no faster than the port takes it.  Long dumps
+// are queued as line jobs and produced only as the ring empties, so a slow or absent USB host costs
+// ring space instead of loop time.  Jobs run in order on each port, and the ports take turns at
+// both producing and draining lines, so neither a long dump nor a paced plot on Data holds back Text.
+// A paced job produces at most one line per pace_ms, for playback to a plotter in something like
+// real time.
+class TxQueue
+{
+public:
+  TxQueue(TxPort *Data, TxPort *Text);
+  ~TxQueue(){};
+  boolean busy() { return ( nJ_ || Data_->used() || Text_->used() ); };
+  boolean job(TxPort *out, TxLine line, void *ctx, const uint16_t pace_ms=0);
+  boolean line(TxPort *out, const char *s);
+  void print_stats();
+  void run();
+protected:
+  static boolean say(Print *out, const uint16_t k, void *ctx);
+  boolean step(TxPort *out);
+  struct Job
+  {
+    TxPort *out;
+    TxLine line;
+    void *ctx;
+    uint16_t k;
+    uint16_t pace_ms;
+    unsigned long last_ms;
+  };
+  TxPort *Data_;
+  TxPort *Text_;
+  Job J_[TX_JOBS];          // fifo, oldest first
+  uint8_t nJ_;
+  uint32_t jobs_dropped_;
+  boolean text_turn_;       // Text drains the next whole line
+};
+
+extern TxPort Data;         // Plots, dumps and downloads
+extern TxPort Text;         // Prompts, echo and debug
+extern TxQueue Tx;
+
+#endif
@@ -35,22 +35,20 @@
 // Setup
 #include "local_config.h"
 #include <SafeString.h>
+#include "CollFormat.h"  // G_MAX, W_MAX, T_MAX and the int16 sample scales, shared with host tools
 
 const double NOM_DT = 0.01;
 const float deg_to_rps = 0.0174533;
 
 // Constants; anything numeric (adjustable)
 #define ONE_DAY_MILLIS        86400000UL// Number of milliseconds in one day (24*60*60*1000)
-#define TALK_DELAY           313UL      // Talk wait, ms (313UL = 0.313 sec)
 #define READ_DELAY            10UL      // Sensor read wait, ms (10UL = 0.01 sec) Dr
 #define CONTROL_DELAY        100UL      // Control read wait, ms (100UL = 0.1 sec)
 #define LOG_DELAY             10UL      // Register wait, ms (20UL = 0.01 sec)
 #define PLOT_DELAY            80UL      // Plot wait, ms (80UL = 0.08 sec)
+#define PLOT_PACE_MS            16      // Event playback period for the serial plotter, ms (16)
 #define BLINK_DELAY           80UL      // Blink wait, ms (80UL = 0.08 sec)
 #define ACTIVE_DELAY         200UL      // Active wait, ms (200UL = 0.2 sec)
-#define G_MAX                  20.      // Max G value, g's (20.) 
-#define W_MAX                  20.      // Max rotational value, rps (20.)
-#define T_MAX                 0.02      // Max expected update time, s (0.02)
 #define INPUT_BYTES            200      // Serial input buffer sizes (200)
 #define SERIAL_BAUD         115200      // Serial baud rate (115200).
 #define TAU_FILT              0.01      // Tau filter, sec (0.01)
@@ -64,15 +62,45 @@ const float deg_to_rps = 0.0174533;
 #define QUIET_S                0.4      // Quiet set persistence, sec (0.4)
 #define O_QUIET_THR           12.0      // rps quiet detection threshold (12.)
 #define G_QUIET_THR            4.0      // g's quiet detection threshold (4.)
-#define NDATUM                 560      // Number of datum entries to store (560)  varies depending on program size
-#define NHOLD                    5      // Number of precursor entries to store (5)
+#define CAPTURE_BYTES        14000      // Ram for the event log, datums and registers, bytes (14000); sizes NDATUM and NREG (CollPlan.h), coll_ram shows the room
+#define EVENT_S                0.5      // Collision length the log is planned for, sec (0.5)
+#define EVENT_MIN                4      // Collisions of EVENT_S the log must hold at once (4)
+#define NHOLD                   20      // Number of pretrigger entries backdated from ram (20 = 0.2 sec)
+#define STACK_BYTES           4096      // Ram kept for the stack, not available to capture, bytes (4096)
 #define R_SCL                  10.      // Quiet reset persistence scalar on QUIET_S ('up 1 down 10')
 #define ARBITRARY_TIME  1704067196      // 1/1/2024 at ~12:00:00 AM
+#define FLASH_PAGE_MAX          64      // Largest NVM page the flash writer stages, bytes (64 on SAMD21)
+#define FLASH_BUDGET_US        500      // Flash writer time per loop pass beyond its first NVM command, us (500)
+#define STORE_BYTES          65536      // Flash reserved for the collision log, bytes (65536 = 256 rows)
+#define STORE_MAX_RECORDS       48      // Collision log events tracked in ram (48)
+#define STORE_KEEP               2      // Most severe logged events pinned against reclaim (2)
+#define INDEX_BYTES           7680      // Flash reserved for the collision log index journal, bytes (7680 = 30 rows; a whole table takes 5)
+#define TX_DATA_BYTES         2048      // Serial ring for plots, dumps and downloads, bytes (2048)
+#define TX_TEXT_BYTES         1024      // Serial ring for prompts and debug, bytes (1024)
+#define TX_LINE_MAX            192      // Room a dump line needs before it is produced, bytes (192)
+#define TX_JOBS                  8      // Dumps that can wait in line (8)
+#define CMD_QUEUE                8      // Serial commands read and waiting to run (8)
+#define CMD_BYTES               32      // Longest serial command, name and argument, bytes (32)
+#define TELEM_MASK      0x7FFFFFUL      // Telemetry channels, bit c for telem_channels[c] in CollFormat.h (0x7FFFFF = all)
+#define TELEM_DECIM              1      // Telemetry samples per frame (1 = every read)
+#define DOZE_S                  30      // Still and idle this long before dozing, sec (30)
+#define DOZE_NAP_S               1      // Standby nap between motion checks while dozing, sec (1); RTC alarms are whole seconds
+#define DOZE_GYRO                0      // Gyro off while dozing, a fraction of the current, but replayed pretrigger has no rotation (0); 1 keeps it
+#define REPLAY_FRAMES            8      // FIFO frames replayed a read pass after a wake (8); ~0.6 ms each, so 682 catch up in ~100 passes
+#define WAKE_G                0.25      // Wake-on-motion threshold, g's (0.25); the IMU resolves 1/16 g at 4 g full scale
+#define SNAP_BYTES            2048      // Flash reserved for warm boot snapshots, bytes (2048 = 8 slots of a row)
+#define SNAP_S                 600      // Snapshot period while awake, sec (600); also after settings change, and before a doze if settings or quiet changed
+#define OVERRUN_US            2000      // Read frame this late past READ_DELAY is an overrun and sheds a load, us (2000)
+#define SHED_RECOVER           100      // Frames on time before the last load shed comes back (100 = 1 sec)
+#ifndef PROBES
+  #define PROBES                 1      // Loop stage timing probes, 'lt' (1); 0 compiles them out
+#endif
+#define PROBE_BINS              16      // Probe histogram bins, log2 us (16 = 0 to 32 ms and over)
+#ifndef TRACES
+  #define TRACES                 0      // Trace spans into a ram ring, 'tr' (0); 1 compiles them in, out of CAPTURE_BYTES
+#endif
+#define TRACE_EVENTS           256      // Trace ring, events, a power of 2 (256 = 2 kB, about a quarter second of loop)
 
 const float QUIET_R = (QUIET_S/R_SCL);  // Quiet reset persistence, sec 
-const float O_SCL = (16000./W_MAX);     // Rotational int16_t scale factor
-const float G_SCL = (16000./G_MAX);     // Rotational int16_t scale factor
-const float T_SCL = (32000./T_MAX);     // Rotational int16_t scale factor
-const uint8_t NREG = (NDATUM)/((QUIET_S)/(LOG_DELAY)*1000*float(R_SCL+1)/float(R_SCL)+NHOLD); // Dynamically determine number of data sets to allow for if small as possible
 
 #endif
@@ -10,8 +10,6 @@
 #include "myFilters.h"
 #include "math.h"
 
-extern int debug;
-
 // class Debounce
 // constructors
 Debounce::Debounce()
@@ -740,10 +738,8 @@ void DiscreteFilter2::rateStateCalc(const double in, const double T, const int R
 // constructors
 General2_Pole::General2_Pole() : DiscreteFilter2() {}
 General2_Pole::General2_Pole(const double T, const double omega_n, const double zeta, const double min, const double max)
-    : DiscreteFilter2(T, omega_n, zeta, min, max)
+    : DiscreteFilter2(T, omega_n, zeta, min, max), AB2_(T, -1e12, 1e12), Tustin_(T, min, max)
 {
-  AB2_ = new AB2_Integrator(T, -1e12, 1e12);
-  Tustin_ = new TustinIntegrator(T, min, max);
   a_ = 2 * zeta_ * omega_n_;
   b_ = omega_n_ * omega_n_;
   General2_Pole::assignCoeff(T);
@@ -754,7 +750,7 @@ General2_Pole::~General2_Pole() {}
 double General2_Pole::calculate(double in, int RESET)
 {
   General2_Pole::rateState(in, RESET);
-  return (Tustin_->state());
+  return (Tustin_.state());
 }
 void General2_Pole::assignCoeff(const double T)
 {
@@ -764,7 +760,7 @@ double General2_Pole::calculate(double in, int RESET, const double T)
 {
   General2_Pole::assignCoeff(T);
   General2_Pole::rateStateCalc(in, T, RESET);
-  return (Tustin_->state());
+  return (Tustin_.state());
 }
 void General2_Pole::rateState(double in, int RESET)
 {
@@ -775,12 +771,12 @@ void General2_Pole::rateState(double in, int RESET)
   }
   else
   {
-    accel = b_*(in - Tustin_->state()) - a_*AB2_->state();
+    accel = b_*(in - Tustin_.state()) - a_*AB2_.state();
   }
-  Tustin_->calculate(AB2_->calculate(accel, T_, RESET, 0), T_, RESET, in);
-  if ( Tustin_->lim() )
+  Tustin_.calculate(AB2_.calculate(accel, T_, RESET, 0), T_, RESET, in);
+  if ( Tustin_.lim() )
   {
-    AB2_->newState(0);
+    AB2_.newState(0);
   }
 }
 void General2_Pole::rateStateCalc(double in, const double T, const int RESET)
@@ -120,6 +120,7 @@ public:
   boolean calculate(const boolean in, const double Tt, const double Tf, const double T, const int RESET);
   boolean state() { return ( timer_> 0 ); };
   int timer() { return timer_; };
+  void timer(const int in) { timer_ = in; };
   int nt() { return nt_; };
   int nf() { return nf_; };
   int T() { return T_; };
@@ -185,6 +186,7 @@ public:
   virtual void rateState(double in);
   virtual double rateStateCalc(double in);
   virtual double state(void);
+  void tau(const double tau) { tau_ = tau; };  // Takes effect at the next calculate with T
 protected:
   double max_;
   double min_;
@@ -285,7 +287,9 @@ public:
   double b() { return (b_); };
   double c() { return (c_); };
   double lstate() { return (lstate_); };
+  void lstate(const double in) { lstate_ = in; };
   double rstate() { return (rstate_); };
+  void rstate(const double in) { rstate_ = in; };
 protected:
   double a_;
   double b_;
@@ -368,6 +372,8 @@ public:
   virtual double calculate(double in, double T, int RESET, double init_value);
   virtual void newState(double newState);
   virtual double state() { return lstate_; };
+  void states(const double lstate, const double rstate) { lstate_ = lstate; rstate_ = rstate; };
+  double rstate() { return rstate_; };
   virtual bool lim() { return lim_; };
 protected:
   double a_;
@@ -444,11 +450,14 @@ public:
   virtual void assignCoeff(const double T);
   virtual void rateState(const double in, const int RESET);
   virtual void rateStateCalc(const double in, const double T, const int RESET);
+  void omega_zeta(const double omega_n, const double zeta) { omega_n_ = omega_n; zeta_ = zeta; a_ = 2 * zeta_ * omega_n_; b_ = omega_n_ * omega_n_; };
+  void restore(const float *s) { AB2_.states(s[0], s[1]); Tustin_.states(s[2], s[3]); };  // As save() left them
+  void save(float *s) { s[0] = AB2_.state(); s[1] = AB2_.rstate(); s[2] = Tustin_.state(); s[3] = Tustin_.rstate(); };
 protected:
-  AB2_Integrator *AB2_;
+  AB2_Integrator AB2_;
   double a_;
   double b_;
-  TustinIntegrator *Tustin_;
+  TustinIntegrator Tustin_;
 };
 
 // PID
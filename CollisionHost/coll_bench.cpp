@@ -0,0 +1,177 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Host benchmark of the read frame with the firmware loop probes (Collision/Probe.h).  Recorded
+// sessions run through one pipeline, CollCore with its Sensors and Data_st as on the board, -r times
+// over, and the probes in CollCore::step time filter, quiet and put_ram, here against the host clock;
+// read is the whole step.  The board's own figures come from its 'lt' command, in the same form.
+// Output is CSV, a row per stage with the histogram bins named by their lower bound in us; the
+// headline on stderr is the step against a READ_DELAY frame.  Single thread; the probes are global.
+//
+// -g sweeps put_ram against the register count instead, 1, 2, 4 ... up to registers, with every
+// register in use:  short events are logged back to back so the fifo is full and the write pointer
+// is always running into the oldest.  Each row is put_ram in ns a sample, lock and unlock spread
+// over it, and for comparison the scan of every register the log used to make per sample.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -Ihal -I../Collision -o coll_bench coll_bench.cpp hal/hal.cpp
+//           ../Collision/{CollCore,CollDatum,Probe,Sensors,myFilters,Time,TxQueue}.cpp
+// Use:    coll_bench [-r repeats] [-q name=value]... <session.csv>...
+//         coll_bench -g registers
+
+#include "coll_session.h"
+#include "CollCore.h"
+#include "CollPlan.h"
+#include "Probe.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#if !PROBES
+  #error "coll_bench needs the probes, PROBES 1"
+#endif
+
+// The per sample overlap check the log made before the register fifo:  every register but the one
+// being filled, three comparisons each
+static uint16_t scan(Register_st *reg, const uint16_t n, const Register_st *current, const uint16_t iR, const uint16_t iStart)
+{
+  uint16_t hits = 0;
+  for ( uint16_t j=0; j<n; j++ )
+  {
+    if ( &reg[j] == current ) continue;
+    if ( iR < reg[j].i + reg[j].n - 1 && iStart > reg[j].i && iR > reg[j].i ) hits++;
+  }
+  return ( hits );
+}
+
+// Samples logged as back to back short events, with the old scan too when asked; ns a sample
+static double run_events(const uint16_t n, QuietPars *Qp, const uint32_t samples, const boolean with_scan)
+{
+  std::vector<Datum_st> ram(NDATUM);
+  std::vector<Register_st> reg(n);
+  Sensors Sen(0ULL, double(NOM_DT), Qp);
+  Data_st L(ram.data(), NDATUM, NHOLD, reg.data(), n);
+  const uint32_t event = NHOLD + 4;  // samples logged an event, then as many idle
+  volatile uint32_t hits = 0;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for ( uint32_t k=0; k<samples; k++ )
+  {
+    Sen.t_ms = k + 1;
+    L.put_ram(&Sen);
+    if ( with_scan ) hits += scan(reg.data(), n, NULL, L.iR(), uint16_t( ( L.iR() + NDATUM - NHOLD ) % NDATUM ));
+    uint32_t phase = k % ( 2 * event );
+    if ( phase == 0 ) L.register_lock(true, &Sen);
+    else if ( phase == event ) L.register_unlock(true, &Sen);
+  }
+  std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+  return ( std::chrono::duration<double, std::nano>(t1 - t0).count() / samples );
+}
+
+// put_ram and the old scan, ns a sample, for 1, 2, 4 ... max registers all in use.  The scan is the
+// difference between runs with and without it; the best of a few runs of each.
+static int sweep(const int max_reg, QuietPars *Qp)
+{
+  const uint32_t samples = 2000000;
+  printf("registers,put_ram_ns,scan_ns\n");
+  double first_ns = 0., last_ns = 0., last_scan_ns = 0.;
+  for ( int n=1; n<=max_reg; n = n < max_reg && 2*n > max_reg ? max_reg : 2*n )
+  {
+    double put_ns = 1e9, both_ns = 1e9;
+    for ( int r=0; r<3; r++ )
+    {
+      put_ns = min(put_ns, run_events(uint16_t(n), Qp, samples, false));
+      both_ns = min(both_ns, run_events(uint16_t(n), Qp, samples, true));
+    }
+    double scan_ns = max(both_ns - put_ns, 0.);
+    printf("%d,%.2f,%.2f\n", n, put_ns, scan_ns);
+    if ( n == 1 ) first_ns = put_ns;
+    last_ns = put_ns;
+    last_scan_ns = scan_ns;
+  }
+  fprintf(stderr, "put_ram %.1f ns a sample at 1 register, %.1f ns at %d; the old scan would add %.1f ns at %d, on this host\n",
+    first_ns, last_ns, max_reg, last_scan_ns, max_reg);
+  return ( 0 );
+}
+
+int main(int argc, char *argv[])
+{
+  int repeats = 1;
+  int sweep_reg = 0;
+  QuietPars Qp;
+  Qp.nominal();
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-r") ) repeats = atoi(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-g") ) sweep_reg = atoi(argv[a + 1]);
+    else if ( strcmp(argv[a], "-q") || !coll_quiet_arg(argv[a + 1], &Qp) ) break;
+  }
+  if ( sweep_reg > 0 && sweep_reg < 256 && a == argc ) return ( sweep(sweep_reg, &Qp) );
+  if ( a >= argc || argv[a][0] == '-' || repeats < 1 )
+  {
+    fprintf(stderr, "usage: %s [-r repeats] [-q name=value]... <session.csv>...\n       %s -g registers\n", argv[0], argv[0]);
+    return ( 1 );
+  }
+
+  std::vector<Datum_st> ram(NDATUM);
+  std::vector<Register_st> reg(NREG);
+  unsigned long events = 0;
+  for ( ; a<argc; a++ )
+  {
+    std::vector<CollSample> in;
+    if ( !coll_load_session(argv[a], &in) )
+    {
+      fprintf(stderr, "%s: cannot read\n", argv[a]);
+      continue;
+    }
+    for ( int r=0; r<repeats; r++ )
+    {
+      Sensors Sen(0ULL, double(NOM_DT), &Qp);
+      Data_st L(ram.data(), NDATUM, NHOLD, reg.data(), NREG);
+      CollCore Core(&Sen, &L);
+      for ( size_t k=0; k<in.size(); k++ )
+      {
+        PROBE_MARK(t);
+        if ( Core.step(k == 0, &in[k].imu, in[k].t_ms, in[k].t_ms, true) == CORE_STOPPED ) events++;
+        PROBE_SINCE(PROBE_READ, t);
+      }
+    }
+  }
+
+  const ProbeStage stages[] = {PROBE_FILTER, PROBE_QUIET, PROBE_PUT_RAM, PROBE_READ};
+  printf("stage,n,min_us,mean_us,max_us");
+  for ( uint8_t k=0; k<PROBE_BINS; k++ ) printf(",us_%lu", k ? 1UL << k : 0UL);
+  printf("\n");
+  for ( auto s : stages )
+  {
+    Probe *P = &Probes[s];
+    printf("%s,%u,%u,%.3f,%u", P->name(), P->n(), P->min_us(), P->mean_us(), P->max_us());
+    for ( uint8_t k=0; k<PROBE_BINS; k++ ) printf(",%u", P->bin(k));
+    printf("\n");
+  }
+  Probe *R = &Probes[PROBE_READ];
+  fprintf(stderr, "%u frames, %lu events, step mean %.3f us max %u us, %.3f%% of a %lu ms frame on this host\n",
+    R->n(), events, R->mean_us(), R->max_us(), R->mean_us() / ( READ_DELAY * 10. ), READ_DELAY);
+  return ( 0 );
+}
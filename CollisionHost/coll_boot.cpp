@@ -0,0 +1,195 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Time to the first valid quiet decision after a boot, cold and warm (Collision/Snapshot.h), over
+// recorded sessions.  A reference pipeline runs each session start to end.  At a boot every -e ms
+// along it, a fresh Sensors starts the way the board would:
+//   cold - nominal tuning and the reset pass, which takes no data, then the samples
+//   warm - the snapshot tuning and the filter states the reference had -a ms before the boot, as
+//          Snapshot stores them (floats), then the samples with no reset
+// The time to valid is from the boot to the first sample after which both quiet decisions agree
+// with the reference through the -h horizon; a boot still disagreeing at the end of it counts as
+// never.  -q is the tuning the board runs, restored warm and lost cold.  Output is CSV, a row per
+// mode over all sessions.  Boot time before the first pass, IMU.begin and the rest, is not modeled.
+//
+// Build:  g++ -O2 -std=c++11 -pthread -DARDUINO=100 -DPROBES=0 -Ihal -I../Collision -o coll_boot coll_boot.cpp hal/hal.cpp
+//           ../Collision/{CollCore,CollDatum,Sensors,myFilters,Time,TxQueue}.cpp
+// Use:    coll_boot [-j threads] [-e every_ms] [-h horizon_ms] [-a age_ms,...] [-q name=value]... <session.csv>...
+
+#include "coll_decode.h"
+#include "coll_session.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+struct Mode
+{
+  std::string name;
+  bool warm;
+  long age_ms;
+  std::vector<long> valid_ms;   // Per boot that became valid
+  unsigned long never;
+};
+
+// Both quiet decisions, one bit each
+static uint8_t decisions(Sensors *S)
+{
+  return ( ( S->o_is_quiet_sure() ? 1 : 0 ) | ( S->g_is_quiet_sure() ? 2 : 0 ) );
+}
+
+// One pass the way CollCore::step runs Sensors
+static void pass(Sensors *S, const boolean reset, const CollSample &c)
+{
+  S->take(reset, &c.imu, c.t_ms, c.t_ms);
+  S->filter(reset);
+  S->quiet_decisions(reset);
+}
+
+// Every boot of one mode along one session
+static void run_mode(const std::vector<CollSample> &in, const std::vector<uint8_t> &ref, const std::vector<SensorsState> &saved,
+  const QuietPars &tuned, const long every_ms, const long horizon_ms, Mode *M)
+{
+  size_t n = in.size();
+  if ( n < 2 ) return;
+  QuietPars P;
+  P.nominal();
+  if ( M->warm ) P = tuned;
+  unsigned long long next = in[0].t_ms + std::max(M->age_ms, every_ms);
+  size_t s = 0;                       // Latest sample at or before the snapshot time
+  for ( size_t b=1; b<n; b++ )
+  {
+    if ( in[b].t_ms < next ) continue;
+    next = in[b].t_ms + every_ms;
+    unsigned long long end_ms = in[b].t_ms + horizon_ms;
+    if ( in[n-1].t_ms < end_ms ) break;
+    Sensors *S = new Sensors(in[b].t_ms - READ_DELAY, double(NOM_DT), &P);
+    if ( M->warm )
+    {
+      while ( s + 1 < b && in[s+1].t_ms + M->age_ms <= in[b].t_ms ) s++;
+      S->restore(&saved[s]);
+    }
+    size_t good = b;                  // First sample of the agreeing run
+    size_t k = b;
+    for ( ; k<n && in[k].t_ms <= end_ms; k++ )
+    {
+      pass(S, !M->warm && k == b, in[k]);
+      if ( decisions(S) != ref[k] ) good = k + 1;
+    }
+    delete S;
+    if ( good >= k ) M->never++;
+    else M->valid_ms.push_back(long(in[good].t_ms - in[b].t_ms));
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned threads = std::thread::hardware_concurrency();
+  long every_ms = 250;
+  long horizon_ms = 3000;
+  std::vector<long> ages;
+  QuietPars tuned;
+  tuned.nominal();
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-j") ) threads = atoi(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-e") ) every_ms = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-h") ) horizon_ms = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-a") )
+    {
+      for ( const char *p = argv[a + 1]; *p; )
+      {
+        char *end;
+        ages.push_back(strtol(p, &end, 10));
+        if ( end == p ) break;
+        p = ( *end == ',' ) ? end + 1 : end;
+      }
+    }
+    else if ( strcmp(argv[a], "-q") || !coll_quiet_arg(argv[a + 1], &tuned) )
+    {
+      fprintf(stderr, "bad option %s %s\n", argv[a], argv[a + 1]);
+      return ( 1 );
+    }
+  }
+  if ( a >= argc || every_ms < 1 || horizon_ms < 1 )
+  {
+    fprintf(stderr, "usage: %s [-j threads] [-e every_ms] [-h horizon_ms] [-a age_ms,...] [-q name=value]... <session.csv>...\n", argv[0]);
+    return ( 1 );
+  }
+  if ( ages.empty() ) ages.push_back(0);
+
+  std::vector<std::string> paths(argv + a, argv + argc);
+  std::vector<std::vector<Mode>> modes(paths.size());
+  coll_parallel(paths.size(), threads, [&](size_t i) {
+    std::vector<CollSample> in;
+    if ( !coll_load_session(paths[i].c_str(), &in) )
+    {
+      fprintf(stderr, "%s: cannot read\n", paths[i].c_str());
+      return;
+    }
+    // Reference decisions and the snapshot a board would have taken after each sample
+    std::vector<uint8_t> ref(in.size());
+    std::vector<SensorsState> saved(in.size());
+    QuietPars P = tuned;
+    Sensors *R = new Sensors(in.empty() ? 0ULL : in[0].t_ms - READ_DELAY, double(NOM_DT), &P);
+    for ( size_t k=0; k<in.size(); k++ )
+    {
+      pass(R, k == 0, in[k]);
+      ref[k] = decisions(R);
+      R->save(&saved[k]);
+    }
+    delete R;
+    Mode cold = {"cold", false, 0, {}, 0};
+    modes[i].push_back(cold);
+    for ( auto age : ages )
+    {
+      Mode warm = {"warm_" + std::to_string(age), true, age, {}, 0};
+      modes[i].push_back(warm);
+    }
+    for ( auto &M : modes[i] ) run_mode(in, ref, saved, tuned, every_ms, horizon_ms, &M);
+  });
+
+  printf("mode,boots,valid_mean_ms,valid_p50_ms,valid_p95_ms,valid_max_ms,never\n");
+  for ( size_t m=0; m<ages.size()+1; m++ )
+  {
+    Mode all = {"", false, 0, {}, 0};
+    for ( auto &ms : modes )
+    {
+      if ( m >= ms.size() ) continue;
+      all.name = ms[m].name;
+      all.valid_ms.insert(all.valid_ms.end(), ms[m].valid_ms.begin(), ms[m].valid_ms.end());
+      all.never += ms[m].never;
+    }
+    std::vector<long> &v = all.valid_ms;
+    std::sort(v.begin(), v.end());
+    double mean = 0.;
+    for ( auto x : v ) mean += x;
+    if ( !v.empty() ) mean /= v.size();
+    if ( v.empty() ) printf("%s,%lu,,,,,%lu\n", all.name.c_str(), all.never, all.never);
+    else printf("%s,%lu,%.1f,%ld,%ld,%ld,%lu\n", all.name.c_str(), v.size() + all.never, mean, v[v.size() / 2],
+      v[std::min(v.size() - 1, v.size() * 95 / 100)], v.back(), all.never);
+  }
+  return ( 0 );
+}
@@ -0,0 +1,357 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Event capture before and after the Ram ring took over the pretrigger (Collision/CollDatum.h).  The
+// old Data_st, a Precursor ring of -o samples copied into Ram at the trigger, is kept here verbatim
+// but for storage and prints; the firmware's backdates NHOLD samples into Ram.  One Sensors and
+// CollCore drive both, sample for sample, and every window is read out at its unlock and checked
+// against the samples that went in:
+//   old    the trigger, the -o - 1 samples before it and on to the unlock, after one stale slot
+//   new    the same back NHOLD samples, but not into the event before while its register is live,
+//          so two events never share samples; and the register's last slot is iEnd_
+//   diff   where the two overlap they must be the same samples
+// Input is telem_csv sessions (coll_session.h); with none a made up session of -n hits, quiet gaps
+// of 5 to 400 samples and many just past the quiet reset so events follow closely, is used.  Output
+// is CSV, a row a session; the first mismatch goes to stderr, and the headline.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -DPROBES=0 -Ihal -I../Collision -o coll_capture coll_capture.cpp hal/hal.cpp
+//           ../Collision/{CollCore,CollDatum,Sensors,myFilters,Time,TxQueue}.cpp
+// Use:    coll_capture [-o old_pretrigger] [-n hits] [-s seed] [session.csv]...
+
+#include "coll_session.h"
+#include "CollCore.h"
+#include "CollPlan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define NHOLD_OLD                5      // Precursor samples before the Ram ring pretrigger
+
+// The old Ram manager, as it stood before the pretrigger moved into Ram
+class OldData
+{
+public:
+  OldData(uint16_t ram_datums, uint16_t pre_datums, uint16_t reg_registers) :
+   iR_(ram_datums), nR_(ram_datums),
+   iP_(pre_datums), nP_(pre_datums),
+   iRg_(reg_registers), nRg_(reg_registers),
+   iOldRg_(0), nAR_(0), CurrentRegPtr_(NULL)
+  {
+    Precursor.resize(nP_);
+    for ( int j=0; j<nP_; j++ ) Precursor[j].nominal();
+    Ram.resize(nR_);
+    for ( int j=0; j<nR_; j++ ) Ram[j].nominal();
+    Reg.resize(nRg_);
+    for ( int j=0; j<nRg_; j++ ) Reg[j].put_nominal();
+  };
+  void clear_register_overlap()
+  {
+    while ( nAR_ && &Reg[iOldRg_] != CurrentRegPtr_ && Reg[iOldRg_].holds(iR_, nR_) )
+      pop_oldest_register();
+  }
+  void pop_oldest_register()
+  {
+    Reg[iOldRg_].put_nominal();
+    if ( ++iOldRg_ > (nRg_-1) ) iOldRg_ = 0;  // circular buffer
+    nAR_--;
+  }
+  // Transfer precursor data to storage
+  void move_precursor()
+  {
+    uint16_t count = 0;
+    uint16_t j = iP_;
+    while ( count++ < nP_ -1 )
+    {
+      if ( ++j > (nP_-1) ) j = 0;  // circular buffer
+      if ( Precursor[j].t_ms == 1ULL ) continue;
+      put_ram(&Precursor[j]);
+    }
+  }
+  // Precursor storage
+  void put_precursor(Sensors *Sen)
+  {
+    if ( ++iP_ > (nP_-1) ) iP_ = 0;  // circular buffer
+    Precursor[iP_].raw_from(Sen);
+  }
+  void put_ram(Sensors *Sen)
+  {
+    if ( ++iR_ > (nR_-1) ) iR_ = 0;  // circular buffer
+    Ram[iR_].raw_from(Sen);
+    clear_register_overlap();
+  }
+  void put_ram(Datum_st *point)
+  {
+    if ( ++iR_ > (nR_-1) ) iR_ = 0;  // circular buffer
+    Ram[iR_].from(point);
+    clear_register_overlap();
+  }
+  // Enter information about last data set into register
+  void register_lock()
+  {
+    iRg_++;
+    if ( iRg_ > (nRg_-1) ) iRg_ = 0;  // circular buffer
+    if ( nAR_ >= nRg_ ) pop_oldest_register();  // fifo full so iRg_ is the oldest; reuse it
+    if ( !nAR_ ) iOldRg_ = iRg_;
+    nAR_++;
+    iStart_ = iR_;
+    if ( iStart_ > (nR_-1) ) iStart_ = 0;  // circular buffer
+    Reg[iRg_].locked = true;
+    Reg[iRg_].i = iStart_;
+    CurrentRegPtr_ = &Reg[iRg_];
+  }
+  void register_unlock()
+  {
+    Reg[iRg_].t_ms = Ram[iStart_].t_ms;
+    if ( Reg[iRg_].i < iR_ )
+    {
+      Reg[iRg_].n = iR_ - Reg[iRg_].i;
+    }
+    else
+    {
+      Reg[iRg_].n = nR_ - (Reg[iRg_].i - iR_);
+    }
+    Reg[iRg_].locked = false;
+    CurrentRegPtr_ = NULL;
+  }
+  std::vector<Datum_st> Precursor;
+  std::vector<Datum_st> Ram;
+  std::vector<Register_st> Reg;
+  Register_st *latest() { return ( &Reg[iRg_] ); };
+protected:
+  uint16_t iR_, nR_, iP_, nP_, iRg_, nRg_, iStart_;
+  uint16_t iOldRg_;
+  uint8_t nAR_;
+  Register_st *CurrentRegPtr_;
+};
+
+// The firmware's, with what the checks need to see
+class NewData : public Data_st
+{
+public:
+  NewData(Datum_st *ram, const uint16_t ram_datums, const uint16_t pre_datums, Register_st *reg, const uint16_t reg_registers) :
+    Data_st(ram, ram_datums, pre_datums, reg, reg_registers) {};
+  uint16_t end() { return ( iEnd_ ); };
+  Register_st *latest() { return ( &Reg[iRg_] ); };
+};
+
+static boolean same(const Datum_st &a, const Datum_st &b)
+{
+  return ( a.t_ms == b.t_ms && a.T_rot_int == b.T_rot_int && a.a_int == b.a_int && a.b_int == b.b_int && a.c_int == b.c_int &&
+    a.T_acc_int == b.T_acc_int && a.x_int == b.x_int && a.y_int == b.y_int && a.z_int == b.z_int );
+}
+
+// Samples [from, to) of truth against ring slots starting at i
+static boolean window_is(const std::vector<Datum_st> &truth, const long from, const long to, const Datum_st *ring,
+  const uint16_t nR, const uint16_t i, const uint16_t n)
+{
+  if ( from < 0 || to - from != long(n) ) return ( false );
+  for ( long k=from; k<to; k++ ) if ( !same(truth[k], ring[( i + ( k - from ) ) % nR]) ) return ( false );
+  return ( true );
+}
+
+struct Result
+{
+  std::string name;
+  unsigned long samples;
+  unsigned long events;
+  unsigned long old_bad;
+  unsigned long new_bad;
+  unsigned long diff;
+  unsigned long clamped;
+  unsigned long old_pre;
+  unsigned long new_pre;
+};
+
+static void bad(Result *R, const char *what, const unsigned long long t_ms)
+{
+  if ( !( R->old_bad + R->new_bad + R->diff ) ) fprintf(stderr, "%s: event at t_ms %llu: %s\n", R->name.c_str(), t_ms, what);
+}
+
+static void run(Result *R, const std::vector<CollSample> &in, const uint16_t old_pre)
+{
+  static Datum_st ram[NDATUM];
+  static Register_st reg[NREG];
+  QuietPars Qp;
+  Qp.nominal();
+  Sensors Sen(0ULL, double(NOM_DT), &Qp);
+  NewData L(ram, NDATUM, NHOLD, reg, NREG);
+  OldData O(NDATUM, old_pre, NREG);
+  CollCore Core(&Sen, &L);
+  std::vector<Datum_st> truth(in.size());
+  long trig = -1, unlock_prev = -1;
+  boolean live_prev = false;
+  for ( size_t k=0; k<in.size(); k++ )
+  {
+    uint8_t changed = Core.step(k == 0, &in[k].imu, in[k].t_ms, in[k].t_ms, true);
+    truth[k].raw_from(&Sen);
+
+    // The old loop:  precursors every sample, Ram only while logging
+    O.put_precursor(&Sen);
+    if ( changed == CORE_STARTED )
+    {
+      O.register_lock();
+      O.move_precursor();
+      O.put_ram(&Sen);
+      trig = long(k);
+      live_prev = L.num_active_registers() > 1;  // the event before still whole at this lock
+    }
+    else if ( changed == CORE_STOPPED )
+    {
+      O.put_ram(&Sen);
+      O.register_unlock();
+    }
+    else if ( Core.logging() ) O.put_ram(&Sen);
+    if ( changed != CORE_STOPPED ) continue;
+
+    R->events++;
+    long unlock = long(k);
+    unsigned long long t_ms = truth[trig].t_ms;
+
+    // Old:  a stale slot first, but for the first event, whose start index was out of the ring
+    Register_st *Ro = O.latest();
+    uint16_t skip = R->events > 1 ? 1 : 0;
+    long o_from = max(trig - long(old_pre) + 1, 0L);
+    if ( !window_is(truth, o_from, unlock, O.Ram.data(), NDATUM, uint16_t( ( Ro->i + skip ) % NDATUM ), uint16_t(Ro->n - skip)) )
+    {
+      bad(R, "old window isn't the samples that went in", t_ms);
+      R->old_bad++;
+    }
+
+    // New:  back NHOLD, stopped at the event before while it is live
+    Register_st *Rn = L.latest();
+    long n_from = max(trig - long(NHOLD), 0L);
+    if ( live_prev && unlock_prev > n_from )
+    {
+      n_from = unlock_prev;
+      R->clamped++;
+    }
+    if ( !window_is(truth, n_from, unlock, ram, NDATUM, Rn->i, Rn->n) )
+    {
+      bad(R, "new window isn't the samples that went in", t_ms);
+      R->new_bad++;
+    }
+    else if ( L.end() != ( Rn->i + Rn->n - 1 ) % NDATUM )
+    {
+      bad(R, "iEnd_ isn't the register's last slot", t_ms);
+      R->new_bad++;
+    }
+
+    // Where both have the samples they must agree
+    long from = max(o_from, n_from);
+    for ( long j=from; j<unlock; j++ )
+      if ( !same(O.Ram[( Ro->i + skip + ( j - o_from ) ) % NDATUM], ram[( Rn->i + ( j - n_from ) ) % NDATUM]) )
+      {
+        bad(R, "old and new windows differ", t_ms);
+        R->diff++;
+        break;
+      }
+    R->old_pre += trig - o_from;
+    R->new_pre += trig - n_from;
+    unlock_prev = unlock;
+  }
+  R->samples = in.size();
+}
+
+// Made up session:  hits of 3 to 60 samples between quiet gaps, a third of them just long enough
+// for the quiet reset so the next event follows the unlock within NHOLD
+static void make_session(std::vector<CollSample> *out, const unsigned long hits, unsigned long long seed)
+{
+  srand48(long(seed));
+  out->clear();
+  unsigned long long t = 1700000000000ULL;
+  for ( unsigned long h=0; h<=hits; h++ )
+  {
+    long gap = drand48() < 0.33 ? 40 + lrand48() % 30 : 5 + lrand48() % 396;
+    long len = h < hits ? 3 + lrand48() % 58 : 0;
+    for ( long j=0; j<gap+len; j++ )
+    {
+      CollSample s;
+      s.t_ms = t;
+      t += 10ULL;
+      boolean hit = j >= gap;
+      ImuSample imu = {true, float(hit ? 10. : 0.01 * ( drand48() - 0.5 )), float(hit ? -8. : 0.01 * ( drand48() - 0.5 )),
+        float(hit ? 6. : 1. + 0.01 * ( drand48() - 0.5 )), true, float(hit ? 30. : 0.02 * ( drand48() - 0.5 )),
+        float(hit ? -20. : 0.02 * ( drand48() - 0.5 )), float(hit ? 10. : 0.02 * ( drand48() - 0.5 ))};
+      s.imu = imu;
+      out->push_back(s);
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  uint16_t old_pre = NHOLD_OLD;
+  unsigned long hits = 3000;
+  unsigned long long seed = 1;
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-o") ) old_pre = uint16_t(atoi(argv[a + 1]));
+    else if ( !strcmp(argv[a], "-n") ) hits = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-s") ) seed = strtoull(argv[a + 1], NULL, 10);
+    else break;
+  }
+  if ( old_pre < 1 || old_pre > NHOLD + 1 || !hits )
+  {
+    fprintf(stderr, "usage: %s [-o old_pretrigger] [-n hits] [-s seed] [session.csv]...\n", argv[0]);
+    return ( 1 );
+  }
+
+  std::vector<Result> results;
+  std::vector<CollSample> in;
+  if ( a == argc )
+  {
+    make_session(&in, hits, seed);
+    results.push_back(Result());
+    results.back().name = "made_up";
+    run(&results.back(), in, old_pre);
+  }
+  for ( ; a<argc; a++ )
+  {
+    if ( !coll_load_session(argv[a], &in) )
+    {
+      fprintf(stderr, "%s: can't read\n", argv[a]);
+      return ( 1 );
+    }
+    results.push_back(Result());
+    results.back().name = argv[a];
+    run(&results.back(), in, old_pre);
+  }
+
+  unsigned long events = 0, failed = 0, clamped = 0;
+  printf("session,samples,events,old_bad,new_bad,differ,clamped,old_pre_mean,new_pre_mean\n");
+  for ( size_t k=0; k<results.size(); k++ )
+  {
+    Result *R = &results[k];
+    printf("%s,%lu,%lu,%lu,%lu,%lu,%lu,%.2f,%.2f\n", R->name.c_str(), R->samples, R->events, R->old_bad, R->new_bad, R->diff,
+      R->clamped, R->events ? double(R->old_pre) / R->events : 0., R->events ? double(R->new_pre) / R->events : 0.);
+    events += R->events;
+    failed += R->old_bad + R->new_bad + R->diff;
+    clamped += R->clamped;
+  }
+  fprintf(stderr, "%lu events, %lu clamped at the event before, %lu bad windows; pretrigger %u samples was %u%s\n", events,
+    clamped, failed, NHOLD, old_pre - 1, failed || !events ? "; FAILED" : "");
+  return ( failed || !events ? 1 : 0 );
+}
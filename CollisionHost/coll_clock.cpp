@@ -0,0 +1,246 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// The 64 bit clock (Collision/Clock.h) on a fake micros(), the virtual clock (hal/Arduino.h).
+//   wrap   up_us() read at random gaps, from 1 us to just under the 2^32 us a read must come within,
+//          through -w wraps of micros(); it must equal the virtual clock exactly, as must us() and
+//          ms() after set().
+//   sleep  Power dozes and naps (Collision/Power.cpp) against the IMU and standby models (hal/Wire.h,
+//          hal/ArduinoLowPower.h), with random awake time between naps, for -h hours of device
+//          time, through micros() and IMU timestamp wraps, then wakes on motion.  After every nap
+//          up_us() must be within an IMU tick of device time, and after the wake TimeLib must agree.
+//   replay, overrun
+//          a doze of 3 s, and of 60 s that overruns the FIFO and leaves a partial frame at its head,
+//          then the wake and the replay REPLAY_FRAMES a read pass until it catches up with frames
+//          still arriving.  Every frame must come whole (1 g on z), in order with none skipped, no
+//          fewer than the FIFO holds, each stamped within a frame and an IMU tick of when the model
+//          wrote it, and the FIFO must be back to bypass.
+// Output is CSV, a row a check; the first mismatch goes to stderr, and the headline.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -Ihal -I../Collision -o coll_clock coll_clock.cpp hal/hal.cpp hal/imu.cpp
+//           ../Collision/{Clock,Power,Time,TxQueue}.cpp
+// Use:    coll_clock [-w wraps] [-h hours] [-s seed]
+
+#include "Clock.h"
+#include "Power.h"
+#include <ArduinoLowPower.h>
+#include <Wire.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WRAP_US      4294967296ULL      // micros() range
+#define TICK_US               6400LL    // IMU timestamp tick, as Power.cpp
+#define TS_WRAP_US  ( TICK_US << 24 )   // IMU timestamp range, about 29.8 hours
+#define AWAKE_MAX_US          3000      // Loop time between naps at most, us
+#define EPOCH           1704067200UL    // 1 Jan 2024
+#define FRAME_US              9615LL    // 104 Hz, as Power.cpp
+#define FIFO_WORDS    ( DOZE_GYRO ? 6 : 3 )
+#define ACC_RAW     ( 32768. / 4. )     // Counts a g
+#define GYR_RAW     ( 32768. / 2000. / deg_to_rps )  // Counts a rad/s
+
+Clock Clk;
+Power Pwr;
+
+// xorshift64, so runs repeat for a seed
+static unsigned long long rng_ = 88172645463325252ULL;
+static unsigned long long rnd()
+{
+  rng_ ^= rng_ << 13;
+  rng_ ^= rng_ >> 7;
+  rng_ ^= rng_ << 17;
+  return ( rng_ );
+}
+
+struct Result
+{
+  const char *name;
+  unsigned long reads;
+  unsigned long wraps;
+  unsigned long ts_wraps;
+  unsigned long bad;
+  long long worst_us;
+};
+
+static void first_bad(Result *R, const char *what, const unsigned long long want, const unsigned long long got)
+{
+  if ( !R->bad++ ) fprintf(stderr, "%s: read %lu %s want %llu got %llu\n", R->name, R->reads, what, want, got);
+}
+
+// Reads at random gaps until micros() has wrapped wraps times; epoch set halfway
+static void wrap(Result *R, const unsigned long wraps)
+{
+  Clock C;
+  unsigned long long set_us = 0ULL;
+  boolean set = false;
+  host_us = 0ULL;
+  while ( host_us < wraps * WRAP_US )
+  {
+    unsigned long long next = ( host_us / WRAP_US + 1 ) * WRAP_US;
+    switch ( rnd() % 8 )
+    {
+      case 0: case 1: case 2: host_us += 1 + rnd() % 1000; break;  // loop passes
+      case 3: host_us += 1 + rnd() % 100000000ULL; break;          // up to 100 s
+      case 4: host_us += WRAP_US - 1 - rnd() % 1000; break;        // just under the limit
+      case 5: host_us += 1 + rnd() % ( WRAP_US - 1 ); break;
+      default: host_us = max(host_us + 1, next - 1 - rnd() % 2000); break;  // just short of a wrap
+    }
+    if ( !set && host_us >= wraps * WRAP_US / 2 )
+    {
+      C.set(EPOCH);
+      set_us = host_us;
+      set = true;
+    }
+    R->reads++;
+    unsigned long long up = C.up_us();
+    if ( up != host_us ) first_bad(R, "up_us", host_us, up);
+    R->worst_us = max(R->worst_us, llabs((long long)( up - host_us )));
+    if ( !set ) continue;
+    unsigned long long us = EPOCH * 1000000ULL + host_us - set_us;
+    if ( C.us() != us ) first_bad(R, "us", us, C.us());
+    if ( C.ms() != us / 1000ULL ) first_bad(R, "ms", us / 1000ULL, C.ms());
+  }
+  R->wraps = (unsigned long)( host_us / WRAP_US );
+}
+
+// Doze, nap for hours of device time, then wake on motion
+static void sleep(Result *R, const double hours)
+{
+  host_us = WRAP_US - 60000000ULL;  // a minute short of a micros() wrap
+  Clk.up_us();
+  Clk.set(EPOCH);
+  unsigned long long up0 = host_us;
+  Wire.moving = false;
+  Pwr.doze();
+  unsigned long long end_us = (unsigned long long)( hours * 3600e6 );
+  boolean woke = false;
+  while ( !woke )
+  {
+    host_us += 1 + rnd() % AWAKE_MAX_US;
+    Wire.moving = host_us - up0 + LowPower.slept_us >= end_us;
+    woke = Pwr.nap();
+    R->reads++;
+    long long device = (long long)( host_us + LowPower.slept_us );
+    long long err = (long long)Clk.up_us() - device;
+    if ( llabs(err) >= TICK_US ) first_bad(R, "up_us", device, Clk.up_us());
+    R->worst_us = max(R->worst_us, llabs(err));
+  }
+  unsigned long long epoch_s = EPOCH + ( host_us - up0 + LowPower.slept_us ) / 1000000ULL;
+  if ( (unsigned long long)now() + 1 < epoch_s || (unsigned long long)now() > epoch_s ) first_bad(R, "now()", epoch_s, now());
+  if ( Pwr.dozing() ) first_bad(R, "dozing after motion", 0, 1);
+  R->wraps = (unsigned long)( host_us / WRAP_US );
+  R->ts_wraps = (unsigned long)( ( host_us + LowPower.slept_us ) / TS_WRAP_US );
+}
+
+// Doze for s of device time, wake, and replay as loop() does until caught up
+static void replay(Result *R, const double s)
+{
+  host_us = 1000000ULL;
+  LowPower.slept_us = 0ULL;
+  Clk = Clock();
+  Clk.up_us();
+  Clk.set(EPOCH);
+  Pwr = Power();
+  Wire.moving = false;
+  Pwr.doze();
+  unsigned long long up0 = host_us;
+  while ( !Pwr.nap() )
+  {
+    host_us += 1 + rnd() % AWAKE_MAX_US;
+    Wire.moving = host_us - up0 + LowPower.slept_us >= (unsigned long long)( s * 1e6 );
+  }
+  uint32_t at_wake = Wire.fifo_written;
+  Wire.moving = false;
+
+  unsigned long long stamp[4096];
+  int prev = -1;
+  boolean more = true;
+  while ( more )
+  {
+    host_us += READ_DELAY * 1000ULL;
+    uint8_t k = 0;
+    ImuSample imu;
+    while ( k++ < REPLAY_FRAMES && ( more = Pwr.replay(&imu, &stamp[R->reads % 4096]) ) )
+    {
+      int lo = int( lround(imu.x * ACC_RAW) ), hi = int( lround(imu.y * ACC_RAW) );
+      int f = lo | hi << 4;
+      if ( lround(imu.z * ACC_RAW) != 8192L || lo < 0 || lo > 15 || hi < 0 || hi > 15 ) first_bad(R, "whole frame, z", 8192, lround(imu.z * ACC_RAW));
+      else if ( DOZE_GYRO && ( lround(imu.a * GYR_RAW) != lo || lround(imu.b * GYR_RAW) != hi ) ) first_bad(R, "gyro word", lo, lround(imu.a * GYR_RAW));
+      else if ( prev >= 0 && f != ( ( prev + 1 ) & 0xFF ) ) first_bad(R, "frame", ( prev + 1 ) & 0xFF, f);
+      prev = f;
+      R->reads++;
+    }
+  }
+
+  // The last frame replayed is the last one written; count back from it
+  unsigned long n = min(R->reads, 4096UL);
+  for ( unsigned long j=0; j<n; j++ )
+  {
+    unsigned long long f = Wire.fifo_written - n + j;
+    long long err = (long long)stamp[( R->reads - n + j ) % 4096] - (long long)( Wire.fifo_t0 + ( f + 1 ) * FRAME_US );
+    if ( llabs(err) >= FRAME_US + TICK_US ) first_bad(R, "stamp", Wire.fifo_t0 + ( f + 1 ) * FRAME_US, stamp[( R->reads - n + j ) % 4096]);
+    R->worst_us = max(R->worst_us, llabs(err));
+  }
+  unsigned long held = min((unsigned long)at_wake, (unsigned long)( HOST_FIFO_WORDS / FIFO_WORDS - 1 ));
+  if ( R->reads < held ) first_bad(R, "frames replayed", held, R->reads);
+  if ( Wire.reg[0x0A] & 0x07 ) first_bad(R, "FIFO mode after", 0, Wire.reg[0x0A] & 0x07);
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long wraps = 1000;
+  double hours = 40.;
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-w") ) wraps = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-h") ) hours = atof(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-s") ) rng_ += strtoull(argv[a + 1], NULL, 10);
+    else break;
+  }
+  if ( a < argc || !wraps || hours <= 0. )
+  {
+    fprintf(stderr, "usage: %s [-w wraps] [-h hours] [-s seed]\n", argv[0]);
+    return ( 1 );
+  }
+
+  host_virtual = true;
+  Result R[4] = {{"wrap"}, {"sleep"}, {"replay"}, {"overrun"}};
+  wrap(&R[0], wraps);
+  sleep(&R[1], hours);
+  replay(&R[2], 3.);
+  replay(&R[3], 60.);
+
+  unsigned long bad = 0;
+  printf("check,reads,micros_wraps,timestamp_wraps,mismatches,worst_us\n");
+  for ( int k=0; k<4; k++ )
+  {
+    printf("%s,%lu,%lu,%lu,%lu,%lld\n", R[k].name, R[k].reads, R[k].wraps, R[k].ts_wraps, R[k].bad, R[k].worst_us);
+    bad += R[k].bad;
+  }
+  fprintf(stderr, "%lu reads through %lu micros() wraps exact; %lu naps, %.1f h asleep, worst %lld us off device time (limit %lld); "
+    "replayed %lu and %lu frames after 3 and 60 s, worst stamp %lld us off (limit %lld)%s\n",
+    R[0].reads, R[0].wraps, R[1].reads, hours, R[1].worst_us, TICK_US, R[2].reads, R[3].reads, max(R[2].worst_us, R[3].worst_us),
+    FRAME_US + TICK_US, bad ? "; FAILED" : "");
+  return ( bad ? 1 : 0 );
+}
@@ -0,0 +1,382 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Serial command parsing (Collision/CmdReader.h) on made up command streams, through a host Stream
+// read the way loop() reads Serial:  Cmds.read then Cmds.run, once a pass.
+//   script  -n commands from the firmware's names and some unknown ones, with int, float and word
+//           arguments, spaces and '=' anywhere they are dropped, every separator, typos and begun
+//           arguments backspaced out, and some too long.  Each must come out once, in order, as written.
+//   flood   the script all at once, more than CMD_QUEUE commands waiting; none may be lost.
+//   fuzz    -b random bytes, weighted to separators, spaces and backspace.  Every command out must
+//           be a name of letters, fit CMD_BYTES and have its argument typed as the reference says.
+//   cost    put() over the script with the fifo emptied behind it, per byte, and read and run with
+//           dispatch and the echo into Text, per byte.
+// The reference types an argument on its own:  none, an int in int32_t, a number with one point, at
+// most 10 digits all told, or else a name.  Output is CSV, a row a check; the first mismatch goes to
+// stderr, and the headline.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -Ihal -I../Collision -o coll_cmd coll_cmd.cpp hal/hal.cpp
+//           ../Collision/{CmdReader,TxQueue}.cpp
+// Use:    coll_cmd [-n commands] [-b fuzz_bytes] [-s seed]
+
+#include "CmdReader.h"
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// xorshift64, so runs repeat for a seed
+static unsigned long long rng_ = 88172645463325252ULL;
+static unsigned long long rnd()
+{
+  rng_ ^= rng_ << 13;
+  rng_ ^= rng_ >> 7;
+  rng_ ^= rng_ << 17;
+  return ( rng_ );
+}
+
+// Bytes waiting on the port, up to room a pass as USB hands them over
+class HostIn : public Stream
+{
+public:
+  HostIn() : at(0), room(0) {};
+  int available() { return ( int( min(s.size() - at, room) ) ); };
+  int read()
+  {
+    if ( !available() ) return ( -1 );
+    room--;
+    return ( (uint8_t)s[at++] );
+  };
+  size_t write(uint8_t c) { return ( 0 ); };
+  std::string s;
+  size_t at;
+  size_t room;
+};
+
+// What a command should parse to
+struct Want
+{
+  std::string name;
+  std::string arg;
+  boolean too_long;
+};
+
+// The reader, with the fifo emptied behind put() for timing
+class Reader : public CmdReader
+{
+public:
+  Reader(const CmdEntry *table, const uint8_t n) : CmdReader(table, n) {};
+  void drop() { iQ_ = nQ_ = 0; };
+};
+
+static std::vector<Cmd> got;
+static void record(Cmd *c, void *ctx) { got.push_back(*c); }
+static const CmdEntry table[] = {
+  {"dc", record}, {"dr", record}, {"ds", record}, {"dx", record}, {"h", record}, {"lt", record}, {"m", record},
+  {"pe", record}, {"ph", record}, {"pp", record}, {"pr", record}, {"qg", record}, {"qn", record}, {"qo", record},
+  {"qr", record}, {"s", record}, {"tc", record}, {"td", record}, {"tg", record}, {"tr", record}, {"UT", record},
+  {"wp", record},
+};
+#define N_TABLE ( sizeof(table) / sizeof(table[0]) )
+
+static boolean known(const std::string &name)
+{
+  for ( size_t t=0; t<N_TABLE; t++ ) if ( name == table[t].name ) return ( true );
+  return ( false );
+}
+
+// Argument type, i and f, from the text alone
+static uint8_t reference(const std::string &arg, int32_t *i, float *f)
+{
+  *i = -1;
+  *f = 0.;
+  if ( arg.empty() ) return ( CMD_NONE );
+  size_t k = ( arg[0] == '-' || arg[0] == '+' ) ? 1 : 0;
+  size_t digits = 0, points = 0;
+  for ( size_t j=k; j<arg.size(); j++ )
+  {
+    if ( arg[j] == '.' ) points++;
+    else if ( arg[j] >= '0' && arg[j] <= '9' ) digits++;
+    else return ( CMD_NAME );
+  }
+  if ( !digits || digits > 10 || points > 1 ) return ( CMD_NAME );
+  std::string whole = arg.substr(k, arg.find('.') == std::string::npos ? std::string::npos : arg.find('.') - k);
+  if ( strtoll(( "0" + whole ).c_str(), NULL, 10) > 0x7FFFFFFFLL ) return ( CMD_NAME );
+  *f = float(strtod(arg.c_str(), NULL));
+  if ( points ) return ( CMD_FLOAT );
+  *i = int32_t(strtoll(arg.c_str(), NULL, 10));
+  return ( CMD_INT );
+}
+
+static std::string letters(const size_t n)
+{
+  std::string s;
+  for ( size_t k=0; k<n; k++ ) s += char( ( rnd() % 2 ? 'a' : 'A' ) + rnd() % 26 );
+  return ( s );
+}
+
+static std::string digits(const size_t n)
+{
+  std::string s;
+  for ( size_t k=0; k<n; k++ ) s += char('0' + rnd() % 10);
+  return ( s );
+}
+
+// A random argument, and whether it needs a space or '=' before it to stay out of the name
+static std::string make_arg(boolean *word)
+{
+  *word = false;
+  switch ( rnd() % 9 )
+  {
+    case 0: return ( "" );
+    case 1: return ( digits(1 + rnd() % 4) );
+    case 2: return ( "-" + digits(1 + rnd() % 10) );
+    case 3: return ( digits(1 + rnd() % 11) );                            // past 10 digits is a name
+    case 4: return ( ( rnd() % 2 ? "" : "2" ) + digits(9) + digits(1) );   // around INT32_MAX
+    case 5: return ( digits(rnd() % 4) + "." + digits(rnd() % 4) );
+    case 6: return ( digits(1 + rnd() % 3) + "." + digits(1) + "." + digits(1) );
+    case 7: return ( ( rnd() % 2 ? "+" : "-" ) + digits(rnd() % 3) + "x" );
+    default: *word = true; return ( letters(1 + rnd() % 6) + digits(rnd() % 3) );
+  }
+}
+
+// Spaces or '=' sprinkled, all dropped by the reader
+static std::string pad()
+{
+  switch ( rnd() % 6 )
+  {
+    case 0: return ( " " );
+    case 1: return ( "=" );
+    case 2: return ( " = " );
+    default: return ( "" );
+  }
+}
+
+// A script of n commands and what each should parse to
+static void make_script(const unsigned long n, std::string *s, std::vector<Want> *want)
+{
+  static const char *const seps[] = {";", ",", "\n", "\r\n", "\r"};
+  for ( unsigned long c=0; c<n; c++ )
+  {
+    Want W;
+    W.name = rnd() % 8 ? table[rnd() % N_TABLE].name : letters(1 + rnd() % 3);
+    boolean word;
+    W.arg = make_arg(&word);
+    W.too_long = rnd() % 50 == 0;
+    if ( W.too_long ) W.arg = digits(CMD_BYTES + rnd() % 20);
+    std::string text = pad() == "" ? "" : " ";
+    for ( size_t k=0; k<W.name.size(); k++ )
+    {
+      text += W.name[k];
+      if ( rnd() % 20 == 0 ) text += letters(1) + "\b";  // a typo taken back
+      if ( rnd() % 20 == 0 ) text += " " + digits(1) + "\b\b";  // an argument begun, taken back into the name
+    }
+    if ( !W.arg.empty() )
+    {
+      std::string gap = pad();
+      if ( word || ( W.arg[0] >= 'a' && W.arg[0] <= 'z' ) || ( W.arg[0] >= 'A' && W.arg[0] <= 'Z' ) )
+        while ( gap.empty() ) gap = pad();
+      text += gap;
+      for ( size_t k=0; k<W.arg.size(); k++ )
+      {
+        text += W.arg[k];
+        if ( rnd() % 10 == 0 ) text += pad();
+        if ( rnd() % 20 == 0 ) text += digits(1) + "\b";
+      }
+    }
+    text += pad();
+    if ( c % 7 == 0 && text.find_first_not_of(" =") != std::string::npos ) text += ";";  // an empty command between
+    text += rnd() % 6 ? seps[rnd() % 5] : std::string(1, '\0');
+    s->append(text);
+    want->push_back(W);
+  }
+}
+
+struct Result
+{
+  const char *name;
+  unsigned long commands;
+  unsigned long bytes;
+  unsigned long bad;
+  unsigned long mismatches;
+  double ns_per_byte;
+};
+
+static void first_bad(Result *R, const unsigned long k, const std::string &what)
+{
+  if ( !R->mismatches++ ) fprintf(stderr, "%s: command %lu %s\n", R->name, k, what.c_str());
+}
+
+// One command against what it should be, or against the reference alone when want is NULL
+static void check(Result *R, const unsigned long k, Cmd *c, const Want *want)
+{
+  std::string name = c->name(), arg = c->arg();
+  if ( want && ( name != want->name || arg != want->arg ) )
+  {
+    first_bad(R, k, "'" + name + "' '" + arg + "' wanted '" + want->name + "' '" + want->arg + "'");
+    return;
+  }
+  for ( size_t j=0; j<name.size(); j++ )
+    if ( !( ( name[j] >= 'a' && name[j] <= 'z' ) || ( name[j] >= 'A' && name[j] <= 'Z' ) ) ) first_bad(R, k, "name not letters");
+  if ( name.size() + 1 + arg.size() >= CMD_BYTES ) first_bad(R, k, "too long to fit");
+  int32_t i;
+  float f;
+  uint8_t type = reference(arg, &i, &f);
+  if ( type != c->type || i != c->i || fabs(f - c->f) > 1e-6 * fabs(f) ) first_bad(R, k, "arg '" + arg + "' typed wrong");
+}
+
+// Passes of read then run, room bytes arriving a pass, until all is in and run
+static void passes(CmdReader *Cmds, HostIn *in, const size_t room)
+{
+  for ( ;; )
+  {
+    in->room = room;
+    Cmds->read(in);
+    boolean ran = Cmds->run(NULL);
+    Text.drain(&Serial, 0xFFFF);  // the echo, thrown away
+    if ( !ran && in->at >= in->s.size() ) return;
+  }
+}
+
+static void scripted(Result *R, const std::vector<Want> &want, const std::string &s, const size_t room)
+{
+  Reader Cmds(table, N_TABLE);
+  HostIn in;
+  in.s = s;
+  got.clear();
+  passes(&Cmds, &in, room);
+  unsigned long k = 0, bad = 0;
+  for ( size_t w=0; w<want.size(); w++ )
+  {
+    if ( want[w].too_long || !known(want[w].name) ) { bad++; continue; }  // counted, not run
+    if ( k >= got.size() ) { first_bad(R, k, "missing"); break; }
+    check(R, k, &got[k], &want[w]);
+    k++;
+  }
+  if ( k < got.size() ) first_bad(R, k, "extra commands");
+  if ( Cmds.bad() != bad ) first_bad(R, k, "bad count off");
+  R->commands = got.size();
+  R->bytes = s.size();
+  R->bad = Cmds.bad();
+}
+
+static void fuzz(Result *R, const unsigned long bytes)
+{
+  static const char bias[] = " =;,\n\r\b\0-+.";
+  Reader Cmds(table, N_TABLE);
+  HostIn in;
+  for ( unsigned long k=0; k<bytes; k++ )
+  {
+    unsigned long long r = rnd();
+    if ( r % 4 == 0 ) in.s += bias[( r >> 8 ) % ( sizeof(bias) - 1 )];
+    else if ( r % 4 == 1 ) in.s += char('0' + ( r >> 8 ) % 10);
+    else if ( r % 4 == 2 ) in.s += char('a' + ( r >> 8 ) % 26);
+    else in.s += char(r >> 8);
+  }
+  got.clear();
+  passes(&Cmds, &in, 64);
+  for ( size_t k=0; k<got.size(); k++ )
+  {
+    check(R, k, &got[k], NULL);
+    if ( R->mismatches ) break;
+  }
+  R->commands = got.size();
+  R->bytes = in.s.size();
+  R->bad = Cmds.bad();
+}
+
+static double now_s()
+{
+  struct timeval t;
+  gettimeofday(&t, NULL);
+  return ( t.tv_sec + t.tv_usec * 1e-6 );
+}
+
+static void cost(Result *P, Result *D, const std::string &s)
+{
+  const int reps = 20;
+  Reader Cmds(table, N_TABLE);
+  double t0 = now_s();
+  for ( int r=0; r<reps; r++ )
+    for ( size_t k=0; k<s.size(); k++ )
+      if ( !Cmds.put(s[k]) )
+      {
+        Cmds.drop();
+        Cmds.put(s[k]);
+      }
+  P->ns_per_byte = ( now_s() - t0 ) * 1e9 / ( double(reps) * s.size() );
+  P->bytes = reps * s.size();
+  P->bad = Cmds.bad();
+
+  HostIn in;
+  for ( int r=0; r<reps; r++ ) in.s += s;
+  got.clear();
+  got.reserve(reps * s.size() / 4);
+  t0 = now_s();
+  passes(&Cmds, &in, 64);
+  D->ns_per_byte = ( now_s() - t0 ) * 1e9 / in.s.size();
+  D->bytes = in.s.size();
+  D->commands = got.size();
+  D->bad = Cmds.bad() - P->bad;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long commands = 100000;
+  unsigned long bytes = 20000000;
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-n") ) commands = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-b") ) bytes = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-s") ) rng_ += strtoull(argv[a + 1], NULL, 10);
+    else break;
+  }
+  if ( a < argc || !commands )
+  {
+    fprintf(stderr, "usage: %s [-n commands] [-b fuzz_bytes] [-s seed]\n", argv[0]);
+    return ( 1 );
+  }
+
+  std::string s;
+  std::vector<Want> want;
+  make_script(commands, &s, &want);
+  Result R[5] = {{"script"}, {"flood"}, {"fuzz"}, {"cost_put"}, {"cost_run"}};
+  scripted(&R[0], want, s, 64);
+  scripted(&R[1], want, s, s.size());
+  fuzz(&R[2], bytes);
+  cost(&R[3], &R[4], s);
+
+  unsigned long bad = 0;
+  printf("check,commands,bytes,bad,mismatches,ns_per_byte\n");
+  for ( int k=0; k<5; k++ )
+  {
+    printf("%s,%lu,%lu,%lu,%lu,%.1f\n", R[k].name, R[k].commands, R[k].bytes, R[k].bad, R[k].mismatches, R[k].ns_per_byte);
+    bad += R[k].mismatches;
+  }
+  fprintf(stderr, "%lu scripted commands as written, %lu flooded, %lu from %lu fuzz bytes; %.1f ns/byte to parse, %.1f to read and run%s\n",
+    R[0].commands, R[1].commands, R[2].commands, R[2].bytes, R[3].ns_per_byte, R[4].ns_per_byte, bad ? "; FAILED" : "");
+  return ( bad ? 1 : 0 );
+}
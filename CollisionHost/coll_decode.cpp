@@ -0,0 +1,201 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// Bulk decoder for collision log dumps:  any number of files, each a record downloaded by coll_recv,
+// several of them concatenated into a session archive, or an image of the flash log region.  Every
+// valid record becomes one columnar file of physical units in the output directory, and a line in
+// events.csv there.  Files are memory mapped and the work is spread over all cores.
+//
+// Column file, little endian:  ColHeader, then int64 t_ms[n], then float32 [n] for each channel in
+// header order.  With numpy:
+//   h = np.fromfile(f, np.uint32, 4, offset=4); n = h[2]
+//   t = np.fromfile(f, np.int64, n, offset=96); v = np.fromfile(f, np.float32, 8*n, offset=96+8*n).reshape(8, n)
+//
+// Build:  g++ -O3 -march=native -std=c++11 -pthread -I../Collision -o coll_decode coll_decode.cpp
+// Use:    coll_decode [-j threads] <out_dir> <dump>...
+
+#include "coll_decode.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+struct ColHeader
+{
+  char magic[4];        // "CCOL"
+  uint32_t version;     // 1
+  uint32_t seq;
+  uint32_t n;           // Samples
+  uint64_t t_ms;        // Time of first sample, ms since epoch
+  uint16_t severity;
+  uint8_t flags;        // StoreHeader flags
+  uint8_t channels;     // STORE_CHANNELS
+  uint32_t spare;
+  char names[STORE_CHANNELS][8];
+};
+
+// One mapped input
+struct Dump
+{
+  std::string path;
+  std::string stem;     // file name without directory or extension, to name the outputs
+  const uint8_t *base;
+  size_t size;
+  std::vector<CollRecord> recs;
+};
+
+static double now_s()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ( tv.tv_sec + tv.tv_usec * 1e-6 );
+}
+
+static bool map_dump(Dump *d)
+{
+  int fd = open(d->path.c_str(), O_RDONLY);
+  struct stat st;
+  if ( fd < 0 || fstat(fd, &st) ) return ( false );
+  d->size = st.st_size;
+  d->base = NULL;
+  if ( d->size )
+  {
+    void *m = mmap(NULL, d->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if ( m == MAP_FAILED ) return ( false );
+    madvise(m, d->size, MADV_WILLNEED);
+    d->base = (const uint8_t *)m;
+  }
+  close(fd);
+  size_t slash = d->path.find_last_of('/');
+  d->stem = d->path.substr(slash == std::string::npos ? 0 : slash + 1);
+  size_t dot = d->stem.find_last_of('.');
+  if ( dot != std::string::npos && dot ) d->stem.resize(dot);
+  return ( true );
+}
+
+static bool write_columns(const std::string &path, const CollEvent &ev)
+{
+  ColHeader c;
+  memset(&c, 0, sizeof(c));
+  memcpy(c.magic, "CCOL", 4);
+  c.version = 1;
+  c.seq = ev.h.seq;
+  c.n = ev.h.n;
+  c.t_ms = ev.h.t_ms;
+  c.severity = ev.h.severity;
+  c.flags = ev.h.flags;
+  c.channels = STORE_CHANNELS;
+  for ( int k=0; k<STORE_CHANNELS; k++ ) strncpy(c.names[k], coll_names[k], 7);
+  FILE *f = fopen(path.c_str(), "wb");
+  if ( !f ) return ( false );
+  bool ok = fwrite(&c, sizeof(c), 1, f) == 1 && fwrite(ev.t_ms.data(), 8, ev.h.n, f) == ev.h.n;
+  for ( int k=0; k<STORE_CHANNELS && ok; k++ ) ok = fwrite(ev.v[k].data(), 4, ev.h.n, f) == ev.h.n;
+  return ( fclose(f) == 0 && ok );
+}
+
+int main(int argc, char **argv)
+{
+  unsigned threads = std::thread::hardware_concurrency();
+  int a = 1;
+  if ( argc > 2 && !strcmp(argv[1], "-j") )
+  {
+    threads = atoi(argv[2]);
+    a = 3;
+  }
+  if ( argc - a < 2 || !threads )
+  {
+    fprintf(stderr, "usage: %s [-j threads] <out_dir> <dump>...\n", argv[0]);
+    return ( 2 );
+  }
+  std::string out_dir = argv[a++];
+  mkdir(out_dir.c_str(), 0755);
+
+  std::vector<Dump> dumps(argc - a);
+  size_t bytes = 0;
+  for ( size_t k=0; k<dumps.size(); k++ )
+  {
+    dumps[k].path = argv[a + k];
+    if ( !map_dump(&dumps[k]) )
+    {
+      fprintf(stderr, "%s: %s\n", argv[a + k], strerror(errno));
+      return ( 1 );
+    }
+    bytes += dumps[k].size;
+  }
+
+  // Find, then decode and write, each on every core
+  double t0 = now_s();
+  std::vector<std::pair<size_t, size_t>> work;  // dump, record
+  for ( size_t k=0; k<dumps.size(); k++ )
+  {
+    coll_scan(dumps[k].base, dumps[k].size, threads, &dumps[k].recs);
+    for ( size_t r=0; r<dumps[k].recs.size(); r++ ) work.push_back(std::make_pair(k, r));
+  }
+  double t1 = now_s();
+  std::vector<std::string> names(work.size());
+  std::atomic<unsigned long> failed(0), samples(0);
+  coll_parallel(work.size(), threads, [&](size_t i) {
+    const Dump &d = dumps[work[i].first];
+    const CollRecord &r = d.recs[work[i].second];
+    CollEvent ev;
+    char name[96];
+    snprintf(name, sizeof(name), "%s_%llu_%u.col", d.stem.c_str(), (unsigned long long)r.h.t_ms, r.h.seq);
+    if ( !coll_decode(d.base + r.off, &ev) || !write_columns(out_dir + "/" + name, ev) )
+    {
+      failed++;
+      return;
+    }
+    names[i] = name;
+    samples += ev.h.n;
+  });
+  double t2 = now_s();
+
+  std::string index = out_dir + "/events.csv";
+  FILE *f = fopen(index.c_str(), "w");
+  if ( !f )
+  {
+    perror(index.c_str());
+    return ( 1 );
+  }
+  fprintf(f, "file,dump,off,seq,t_ms,n,severity,raw,o_raw_max,g_raw_max,o_filt_max,g_filt_max\n");
+  for ( size_t i=0; i<work.size(); i++ )
+  {
+    if ( names[i].empty() ) continue;
+    const Dump &d = dumps[work[i].first];
+    const StoreHeader &h = d.recs[work[i].second].h;
+    fprintf(f, "%s,%s,%llu,%u,%llu,%u,%u,%d,%g,%g,%g,%g\n", names[i].c_str(), d.path.c_str(),
+      (unsigned long long)d.recs[work[i].second].off, h.seq, (unsigned long long)h.t_ms, h.n, h.severity,
+      ( h.flags & STORE_RAW ) ? 1 : 0, h.o_raw_max, h.g_raw_max, h.o_filt_max, h.g_filt_max);
+  }
+  fclose(f);
+  fprintf(stderr, "%zu dumps, %.1f MB: %zu events, %lu samples, %lu failed; scan %.3f s (%.0f MB/s), decode %.3f s on %u threads\n",
+    dumps.size(), bytes / 1e6, work.size() - failed, (unsigned long)samples, (unsigned long)failed,
+    t1 - t0, bytes / 1e6 / std::max(t1 - t0, 1e-9), t2 - t1, threads);
+  return ( failed ? 1 : 0 );
+}
@@ -0,0 +1,208 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// Host library for collision log records (CollFormat.h):  find every valid record in a buffer, as
+// downloaded by coll_recv or read straight out of the flash log region, decode one to columns and
+// scale the int16 columns to physical units.  Header only; the scan and the bulk work run on as many
+// threads as asked.  Scales and layouts come from the firmware's own CollFormat.h.
+
+#ifndef _COLL_DECODE_H
+#define _COLL_DECODE_H
+
+#include "CollFormat.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#if defined(__AVX2__) || defined(__SSE2__)
+  #include <immintrin.h>
+#endif
+
+// Channels of StoreSample, and their units
+static const char *const coll_names[STORE_CHANNELS] = { "T_rot", "a", "b", "c", "T_acc", "x", "y", "z" };
+static const char *const coll_units[STORE_CHANNELS] = { "s", "rps", "rps", "rps", "s", "g", "g", "g" };
+
+// int16 per unit of channel c
+inline float coll_scale(const int c)
+{
+  if ( c == 0 || c == 4 ) return ( T_SCL );
+  if ( c < 4 ) return ( O_SCL );
+  return ( G_SCL );
+}
+
+// A valid record found at off
+struct CollRecord
+{
+  uint64_t off;
+  StoreHeader h;
+};
+
+// One decoded event, a column per channel
+struct CollEvent
+{
+  StoreHeader h;
+  std::vector<uint64_t> t_ms;
+  std::vector<int16_t> raw[STORE_CHANNELS];
+  std::vector<float> v[STORE_CHANNELS];  // raw / coll_scale
+};
+
+// crc16_update a byte at a time from a 256 entry table; same result, several times the speed
+inline uint16_t coll_crc16(uint16_t crc, const void *data, size_t len)
+{
+  struct Table
+  {
+    uint16_t t[256];
+    Table()
+    {
+      for ( int b=0; b<256; b++ )
+      {
+        uint8_t one = uint8_t(b);
+        t[b] = crc16_update(0, &one, 1);  // from 0, the byte alone
+      }
+    }
+  };
+  static const Table T;
+  const uint8_t *p = (const uint8_t *)data;
+  while ( len-- ) crc = uint16_t( (crc << 8) ^ T.t[uint8_t(crc >> 8) ^ *p++] );
+  return ( crc );
+}
+
+// Record at p, with avail bytes behind it, has a sane header and a good crc
+inline bool coll_record_ok(const uint8_t *p, const size_t avail, StoreHeader *h)
+{
+  if ( avail < sizeof(StoreHeader) ) return ( false );
+  memcpy(h, p, sizeof(StoreHeader));
+  if ( h->magic != STORE_MAGIC || h->version != STORE_VERSION || !h->n ) return ( false );
+  if ( sizeof(StoreHeader) + h->len > avail ) return ( false );
+  if ( h->flags & STORE_PLAIN ) { if ( h->len != h->n * sizeof(StoreSample) ) return ( false ); }
+  else if ( h->len < h->n * ( 1 + STORE_CHANNELS ) || h->len > h->n * STORE_SAMPLE_MAX ) return ( false );
+  StoreHeader z = *h;
+  z.crc = 0;
+  return ( coll_crc16(coll_crc16(0xFFFF, p + sizeof(StoreHeader), h->len), &z, sizeof(z)) == h->crc );
+}
+
+// Run fn(i) for every i < n, threads at a time
+template <class F> inline void coll_parallel(const size_t n, unsigned threads, F fn)
+{
+  threads = std::max(1U, std::min<unsigned>(threads, n));
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> pool;
+  for ( unsigned t=0; t<threads; t++ )
+    pool.push_back(std::thread([&]() { for ( size_t i; ( i = next++ ) < n; ) fn(i); }));
+  for ( auto &th : pool ) th.join();
+}
+
+// Every valid record in base, in order.  Each thread searches its own stretch for the magic and skips
+// over what it finds; the merge drops anything that lands inside an earlier record.
+inline void coll_scan(const uint8_t *base, const size_t size, const unsigned threads, std::vector<CollRecord> *out)
+{
+  const size_t stretch = 1UL << 22;
+  size_t n = ( size + stretch - 1 ) / stretch;
+  std::vector<std::vector<CollRecord>> found(n);
+  coll_parallel(n, threads, [&](size_t k) {
+    const uint8_t *p = base + k * stretch;
+    const uint8_t *end = base + std::min(size, ( k + 1 ) * stretch);
+    const uint8_t *stop = base + size;
+    while ( p < end )
+    {
+      p = (const uint8_t *)memchr(p, STORE_MAGIC & 0xFF, end - p);
+      if ( !p ) break;
+      CollRecord r;
+      if ( p + 1 < stop && p[1] == STORE_MAGIC >> 8 && coll_record_ok(p, stop - p, &r.h) )
+      {
+        r.off = p - base;
+        found[k].push_back(r);
+        p += sizeof(StoreHeader) + r.h.len;
+      }
+      else p++;
+    }
+  });
+  out->clear();
+  uint64_t covered = 0;
+  for ( auto &f : found )
+    for ( auto &r : f )
+    {
+      if ( r.off < covered ) continue;
+      out->push_back(r);
+      covered = r.off + sizeof(StoreHeader) + r.h.len;
+    }
+}
+
+// out[i] = in[i] / scale, eight or sixteen at a time where the cpu allows
+inline void coll_to_units(const int16_t *in, float *out, const size_t n, const float scale)
+{
+  const float k = 1.f / scale;
+  size_t i = 0;
+#if defined(__AVX2__)
+  const __m256 vk = _mm256_set1_ps(k);
+  for ( ; i + 16 <= n; i += 16 )
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(in + i));
+    __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(x)));
+    __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1)));
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(lo, vk));
+    _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(hi, vk));
+  }
+#elif defined(__SSE2__)
+  const __m128 vk = _mm_set1_ps(k);
+  for ( ; i + 8 <= n; i += 8 )
+  {
+    __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);  // sign extend
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), vk));
+    _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vk));
+  }
+#endif
+  for ( ; i < n; i++ ) out[i] = in[i] * k;
+}
+
+// Decode the checked record at rec into ev.  False if the payload does not decode.
+inline bool coll_decode(const uint8_t *rec, CollEvent *ev)
+{
+  memcpy(&ev->h, rec, sizeof(StoreHeader));
+  const uint16_t n = ev->h.n;
+  const uint8_t *p = rec + sizeof(StoreHeader);
+  const uint8_t *end = p + ev->h.len;
+  ev->t_ms.resize(n);
+  for ( int c=0; c<STORE_CHANNELS; c++ ) ev->raw[c].resize(n);
+  StoreSample s;
+  memset(&s, 0, sizeof(s));
+  s.t_ms = ev->h.t_ms;
+  for ( uint16_t k=0; k<n; k++ )
+  {
+    if ( ev->h.flags & STORE_PLAIN ) memcpy(&s, p + k * sizeof(s), sizeof(s));
+    else if ( !store_decode(&s, &p, end) ) return ( false );
+    ev->t_ms[k] = s.t_ms;
+    for ( int c=0; c<STORE_CHANNELS; c++ ) ev->raw[c][k] = s.v[c];
+  }
+  for ( int c=0; c<STORE_CHANNELS; c++ )
+  {
+    ev->v[c].resize(n);
+    coll_to_units(ev->raw[c].data(), ev->v[c].data(), n, coll_scale(c));
+  }
+  return ( true );
+}
+
+#endif
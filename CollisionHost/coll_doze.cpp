@@ -0,0 +1,234 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Doze entry on battery (Collision/Power.h), with the end of loop() modeled on the virtual clock.  The
+// firmware pipeline, log, store, download link and Tx queue run as loop() runs them, against the
+// IMU and standby models (hal/Wire.h, hal/ArduinoLowPower.h).  A host is attached at boot; an impact
+// ends in the usual dump and a download of it, and the host is unplugged -u ms later with both
+// partly out.  The board lies still, must doze, naps -d s, then is moved and the host comes back.
+// Two rules for still are run:
+//   held   as before, waiting on the link and Tx too, which with no host never drain
+//   loop   as loop() has it now
+// For each:  the time from unplugging to the doze, what was still waiting then, naps, and once the host is back whether the rings
+// drained with nothing dropped and the download reached its end.  The loop rule must doze within
+// DOZE_S plus -g s of grace, with output still waiting, and lose nothing.  Snapshot::settled, the last doze condition, is left
+// out; it only waits on a flash write.  Output is CSV, a row a rule, and the headline on stderr.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -DPROBES=0 -Ihal -I../Collision -o coll_doze coll_doze.cpp hal/hal.cpp hal/imu.cpp hal/nvm.cpp
+//           ../Collision/{Clock,CollCore,CollDatum,CollLink,CollStore,FlashStorage,FlashWriter,Power,Sensors,myFilters,Time,TxQueue}.cpp
+// Use:    coll_doze [-u unplug_ms] [-d doze_s] [-g grace_s]
+
+#include "Clock.h"
+#include "CollCore.h"
+#include "CollLink.h"
+#include "CollPlan.h"
+#include "CollStore.h"
+#include "FlashWriter.h"
+#include "Power.h"
+#include <ArduinoLowPower.h>
+#include <Wire.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PASS_US               1000ULL   // Loop pass, us
+#define USB_BYTES               64      // A host takes this much a pass
+#define HIT_MS                3000ULL   // Impact starts, up ms
+#define HIT_LEN_MS             300ULL
+#define AFTER_S                 60ULL   // Run on this long after the host comes back, s
+
+Clock Clk;
+Power Pwr;
+
+// The link, with the end of the download in sight
+class Link_t : public CollLink
+{
+public:
+  Link_t(CollStore *Store) : CollLink(Store) {};
+  boolean ended() { return ( ended_ ); };
+};
+
+struct Result
+{
+  const char *name;
+  boolean held;
+  double doze_s;            // Unplug to doze, device time, -1 never
+  unsigned long naps;
+  unsigned long dozes;
+  unsigned long waiting;    // Bytes in the rings at the doze
+  boolean mid_download;     // and the download not through
+  boolean drained;
+  unsigned long dropped;
+  boolean ended;
+};
+
+// Flat on the bench, or knocked about
+static void imu_at(const unsigned long long up_ms, const boolean moving, ImuSample *imu)
+{
+  float n = 0.002 * float( ( up_ms * 7919ULL ) % 11ULL ) - 0.01;
+  ImuSample still = {true, n, -n, 1.f + n, true, 2.f * n, n, -n};
+  ImuSample hit = {true, 10., -8., 6., true, 30., -20., 10.};
+  *imu = moving ? hit : still;
+}
+
+static void run(Result *R, const unsigned long long unplug_ms, const double doze_s)
+{
+  static Datum_st ram[NDATUM];
+  static Register_st reg[NREG];
+  host_us = 0ULL;
+  Nvm.begin(STORE_BYTES + INDEX_BYTES);  // erased
+  FlashClass Log(Nvm.flash(), STORE_BYTES);
+  FlashClass Index(Nvm.flash() + STORE_BYTES, INDEX_BYTES);
+  FlashWriter Writer;
+  CollStore Store(&Log, &Index, &Writer);
+  Store.begin();
+  Link_t Link(&Store);
+  QuietPars Qp;
+  Qp.nominal();
+  Sensors Sen(0ULL, double(NOM_DT), &Qp);
+  Data_st L(ram, NDATUM, NHOLD, reg, NREG);
+  CollCore Core(&Sen, &L);
+  Pwr = Power();
+  Clk = Clock();
+  LowPower.slept_us = 0ULL;
+  Wire.moving = false;
+  Serial.open = true;
+  Serial.out.clear();
+  uint32_t dropped0 = Data.dropped() + Text.dropped();
+
+  unsigned long long next_read_ms = 0ULL, unplugged_ms = 0ULL, woke_ms = 0ULL, doze_ms = 0ULL;
+  boolean reset = true;
+  for ( ;; )
+  {
+    unsigned long long device_ms = ( host_us + LowPower.slept_us ) / 1000ULL;
+    if ( woke_ms && device_ms > woke_ms + AFTER_S * 1000ULL ) break;
+    if ( !doze_ms && unplugged_ms && device_ms > unplugged_ms + ( DOZE_S + 120ULL ) * 1000ULL ) break;  // never going to
+    if ( doze_ms && !woke_ms && device_ms >= doze_ms + (unsigned long long)( doze_s * 1000. ) ) Wire.moving = true;
+    if ( woke_ms && !Serial.open && device_ms >= woke_ms + 1000ULL ) Serial.open = true;
+    Serial.room = Serial.open ? USB_BYTES : 0;
+    host_us += PASS_US;
+
+    // Dozing
+    if ( Pwr.dozing() )
+    {
+      if ( !Pwr.nap() ) continue;
+      woke_ms = ( host_us + LowPower.slept_us ) / 1000ULL;
+      Wire.moving = false;
+    }
+
+    // Read
+    unsigned long long now_ms = Clk.up_ms();
+    if ( now_ms >= next_read_ms )
+    {
+      next_read_ms = now_ms + READ_DELAY;
+      ImuSample imu;
+      unsigned long long up_us;
+      if ( !Pwr.replay(&imu, &up_us) )
+      {
+        imu_at(now_ms, now_ms >= HIT_MS && now_ms < HIT_MS + HIT_LEN_MS, &imu);
+        up_us = Clk.up_us();
+      }
+      if ( Core.step(reset, &imu, up_us / 1000ULL, Clk.ms(up_us), false) == CORE_STOPPED )
+      {
+        Store.commit(&L, L.iRg());
+        Tx.line(&Data, "Latest ram");
+        L.print_latest_ram();
+        Tx.line(&Data, "Registers");
+        L.print_all_registers();
+        Link.send_ram(&L, L.iRg());  // as 'dr' from the host
+        unplugged_ms = now_ms + unplug_ms;
+      }
+      Store.run();
+      Writer.run(FLASH_BUDGET_US);
+      reset = false;
+    }
+    if ( unplugged_ms && !woke_ms && now_ms >= unplugged_ms ) Serial.open = false;
+
+    // Chitchat
+    Link.run();
+    Tx.run();
+
+    // Doze
+    boolean still = !Serial && !Core.logging() && Sen.both_are_quiet() && !Store.busy() && !Writer.busy();
+    if ( R->held ) still = still && !Link.busy() && !Tx.busy();
+    if ( Pwr.ready(now_ms, still) )
+    {
+      if ( !doze_ms )
+      {
+        doze_ms = ( host_us + LowPower.slept_us ) / 1000ULL;
+        R->waiting = Data.used() + Text.used();
+        R->mid_download = !Link.ended();
+      }
+      R->dozes++;
+      Pwr.doze();
+    }
+  }
+  R->doze_s = doze_ms ? ( doze_ms - unplugged_ms ) / 1000. : -1.;
+  R->naps = LowPower.sleeps;
+  R->drained = woke_ms && !Tx.busy();
+  R->dropped = Data.dropped() + Text.dropped() - dropped0;
+  R->ended = Link.ended();
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long long unplug_ms = 20ULL;
+  double doze_s = 600.;
+  double grace_s = 2.;
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-u") ) unplug_ms = strtoull(argv[a + 1], NULL, 10);
+    else if ( !strcmp(argv[a], "-d") ) doze_s = atof(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-g") ) grace_s = atof(argv[a + 1]);
+    else break;
+  }
+  if ( a < argc || doze_s < DOZE_NAP_S || grace_s < 0. )
+  {
+    fprintf(stderr, "usage: %s [-u unplug_ms] [-d doze_s] [-g grace_s]\n", argv[0]);
+    return ( 1 );
+  }
+
+  host_virtual = true;
+  Result R[2] = {{"held", true}, {"loop", false}};
+  for ( int k=0; k<2; k++ )
+  {
+    unsigned long sleeps0 = LowPower.sleeps;
+    run(&R[k], unplug_ms, doze_s);
+    R[k].naps = LowPower.sleeps - sleeps0;
+  }
+
+  Result *Lp = &R[1];
+  boolean bad = Lp->doze_s < 0. || Lp->doze_s > DOZE_S + grace_s || !Lp->drained || Lp->dropped || !Lp->ended || Lp->dozes != 1
+    || !( Lp->waiting || Lp->mid_download );
+  printf("rule,unplug_to_doze_s,waiting_bytes,mid_download,dozes,naps,drained,dropped_bytes,download_ended\n");
+  for ( int k=0; k<2; k++ )
+    printf("%s,%.2f,%lu,%d,%lu,%lu,%d,%lu,%d\n", R[k].name, R[k].doze_s, R[k].waiting, R[k].mid_download, R[k].dozes, R[k].naps,
+      R[k].drained, R[k].dropped, R[k].ended);
+  fprintf(stderr, "unplugged %llu ms into a dump:  held rule %s, loop rule dozed after %.1f s (DOZE_S %d) with %lu bytes waiting, %lu naps, %s%s\n",
+    unplug_ms, R[0].doze_s < 0. ? "never dozed" : "dozed", Lp->doze_s, DOZE_S, Lp->waiting, Lp->naps,
+    !( Lp->waiting || Lp->mid_download ) ? "nothing was waiting, -u is too late to check" :
+    Lp->drained && !Lp->dropped && Lp->ended ? "all output and the download through once the host was back" : "output lost",
+    bad ? "; FAILED" : "");
+  return ( bad ? 1 : 0 );
+}
@@ -0,0 +1,256 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Battery life of the wake-on-motion doze (Collision/Power.h) for an activity profile.  A day is a
+// run of blocks, e.g. 2 h of practice, 1 h on the bench and the rest in the bag, each with a rate of
+// motion events and their length.  The season is stepped through at STEP_S with motion drawn at
+// random, and the firmware rules decide the duty cycle:  quiet QUIET_S after motion stops, doze once
+// quiet DOZE_S, a nap check every DOZE_NAP_S, and on a wake a replay of what the FIFO saved.  Every
+// motion event is taken to cross WAKE_G.  Output is CSV, a row per block and a total, averaged per
+// day; the headline on stderr is days of battery with the doze and without it.
+//
+// Currents are typical figures for the M0+ and LSM6DS3 and go in with -c name=value; measure yours.
+// They cover the MCU and IMU alone.  The Nano 33 IoT board adds its regulator, power LED and radio,
+// which are far beyond a button cell unless cut off; give what is left as board_ua.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -Ihal -I../Collision -o coll_energy coll_energy.cpp
+// Use:    coll_energy [-d season_days] [-s seed] [-g doze_gyro] [-c name=value]... [-a name:hours:events_per_hour:event_s]...
+
+#include "constants.h"
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define STEP_S                0.1       // Simulation step, sec
+#define FIFO_BYTES            8192      // LSM6DS3 FIFO
+#define FIFO_HZ               104.      // FIFO rate while dozing
+
+struct Par
+{
+  const char *name;
+  double value;
+  const char *what;
+};
+
+static Par pars[] = {
+  {"run_ma", 6.5, "M0+ running at 48 MHz, USB off, mA"},
+  {"standby_ua", 4., "M0+ standby with the RTC running, uA"},
+  {"imu_hp_ma", 1.25, "LSM6DS3 accel and gyro, high performance, mA"},
+  {"imu_np_ma", 0.9, "LSM6DS3 accel and gyro, normal mode, mA (doze with gyro)"},
+  {"imu_xl_ma", 0.07, "LSM6DS3 accel alone, normal mode, mA (doze without gyro)"},
+  {"board_ua", 0., "Board draw the MCU does not control, uA"},
+  {"nap_ms", 2., "Awake per nap to resume and read the wake-up flag, ms"},
+  {"replay_ms", 0.6, "Awake per FIFO frame replayed at a wake, ms"},
+  {"cell_mah", 225., "Cell capacity, mAh (CR2032)"},
+  {"usable", 0.8, "Fraction of the capacity usable at these currents"},
+};
+#define N_PARS ( sizeof(pars) / sizeof(pars[0]) )
+
+struct Block
+{
+  std::string name;
+  double hours;
+  double events_per_hour;
+  double event_s;
+  // Season totals
+  double awake_s, doze_s, mas;    // mas is charge, mA*s
+  unsigned long events, naps, wakes;
+};
+
+static double par(const char *name)
+{
+  for ( size_t k=0; k<N_PARS; k++ ) if ( !strcmp(pars[k].name, name) ) return ( pars[k].value );
+  return ( 0. );
+}
+
+// name=value into pars.  False if unknown.
+static bool set_par(const char *arg)
+{
+  const char *eq = strchr(arg, '=');
+  if ( !eq ) return ( false );
+  for ( size_t k=0; k<N_PARS; k++ )
+    if ( strlen(pars[k].name) == size_t(eq - arg) && !strncmp(pars[k].name, arg, eq - arg) )
+    {
+      pars[k].value = atof(eq + 1);
+      return ( true );
+    }
+  return ( false );
+}
+
+// name:hours:events_per_hour:event_s.  False if malformed.
+static bool parse_block(const char *arg, Block *B)
+{
+  char name[32];
+  double events = 0., event_s = 0.;
+  int n = sscanf(arg, "%31[^:]:%lf:%lf:%lf", name, &B->hours, &events, &event_s);
+  if ( n < 2 || !( B->hours > 0. ) || events < 0. || ( events > 0. && !( event_s > 0. ) ) ) return ( false );
+  B->name = name;
+  B->events_per_hour = events;
+  B->event_s = event_s;
+  return ( true );
+}
+
+int main(int argc, char *argv[])
+{
+  double days = 120.;
+  unsigned seed = 1;
+  bool gyro = DOZE_GYRO;
+  std::vector<Block> blocks;
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    Block B = Block();
+    if ( !strcmp(argv[a], "-d") ) days = atof(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-s") ) seed = atoi(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-g") ) gyro = atoi(argv[a + 1]) != 0;
+    else if ( !strcmp(argv[a], "-c") && set_par(argv[a + 1]) ) ;
+    else if ( !strcmp(argv[a], "-a") && parse_block(argv[a + 1], &B) ) blocks.push_back(B);
+    else
+    {
+      fprintf(stderr, "bad option %s %s\n", argv[a], argv[a + 1]);
+      return ( 1 );
+    }
+  }
+  if ( a != argc || !( days > 0. ) )
+  {
+    fprintf(stderr, "usage: %s [-d season_days] [-s seed] [-g doze_gyro] [-c name=value]... [-a name:hours:events_per_hour:event_s]...\n", argv[0]);
+    for ( size_t k=0; k<N_PARS; k++ ) fprintf(stderr, "  %-10s %8g  %s\n", pars[k].name, pars[k].value, pars[k].what);
+    return ( 1 );
+  }
+  if ( blocks.empty() )
+  {
+    const char *nominal[] = {"practice:2:30:2", "bench:1:6:1", "bag:21:0"};
+    for ( auto s : nominal ) { Block B = Block(); parse_block(s, &B); blocks.push_back(B); }
+  }
+  double hours = 0.;
+  for ( auto &B : blocks ) hours += B.hours;
+  if ( hours > 24. + 1e-9 )
+  {
+    fprintf(stderr, "blocks add to %g hours, more than a day\n", hours);
+    return ( 1 );
+  }
+  if ( hours < 24. - 1e-9 ) { Block B = Block(); B.name = "rest"; B.hours = 24. - hours; blocks.push_back(B); }
+
+  // Currents, mA
+  double board = par("board_ua") / 1000.;
+  double awake_ma = par("run_ma") + par("imu_hp_ma") + board;
+  double doze_ma = par("standby_ua") / 1000. + ( gyro ? par("imu_np_ma") : par("imu_xl_ma") ) + board;
+  double fifo_frames = FIFO_BYTES / 2 / ( gyro ? 6 : 3 );
+  double pretrigger_s = NHOLD * NOM_DT;
+
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> U(0., 1.);
+  bool dozing = false, latched = false;
+  double motion_left = 0.;        // Of the event under way, sec
+  double since_motion = 1e9;      // Quiet after QUIET_S of this
+  double still = 0.;              // Power::ready's timer
+  double nap = 0.;                // Into the current nap
+  double dozed = 0.;              // Since the doze began, for what the FIFO holds
+  double motion_at = 0.;          // Dozing time the latched motion began
+  unsigned long lost = 0;         // Wakes too late for the whole pretrigger to be in the FIFO
+  double latency_max = 0.;
+  long steps = long(days * 86400. / STEP_S + 0.5);
+  size_t b = 0;
+  double block_end = blocks[0].hours * 3600.;
+  for ( long i=0; i<steps; i++ )
+  {
+    double t = fmod(i * STEP_S, 86400.);
+    if ( t < STEP_S / 2 ) { b = 0; block_end = blocks[0].hours * 3600.; }
+    while ( t >= block_end - 1e-9 && b + 1 < blocks.size() ) block_end += blocks[++b].hours * 3600.;
+    Block &B = blocks[b];
+
+    if ( motion_left <= 0. && B.events_per_hour > 0. && U(rng) < B.events_per_hour / 3600. * STEP_S )
+    {
+      motion_left = B.event_s;
+      B.events++;
+    }
+    bool moving = motion_left > 0.;
+    if ( moving ) { motion_left -= STEP_S; since_motion = 0.; }
+    else since_motion += STEP_S;
+
+    if ( dozing )
+    {
+      B.doze_s += STEP_S;
+      B.mas += doze_ma * STEP_S;
+      dozed += STEP_S;
+      if ( moving && !latched ) { latched = true; motion_at = dozed; }
+      nap += STEP_S;
+      if ( nap >= DOZE_NAP_S - 1e-9 )
+      {
+        nap = 0.;
+        B.naps++;
+        B.mas += awake_ma * par("nap_ms") / 1000.;
+        if ( latched )
+        {
+          double frames = std::min(dozed * FIFO_HZ, fifo_frames);
+          B.mas += awake_ma * frames * par("replay_ms") / 1000.;
+          double latency = dozed - motion_at;
+          latency_max = std::max(latency_max, latency);
+          if ( latency + pretrigger_s > fifo_frames / FIFO_HZ ) lost++;
+          B.wakes++;
+          dozing = latched = false;
+          still = 0.;
+        }
+      }
+      continue;
+    }
+
+    B.awake_s += STEP_S;
+    B.mas += awake_ma * STEP_S;
+    if ( since_motion >= QUIET_S ) still += STEP_S;
+    else still = 0.;
+    if ( still >= DOZE_S )
+    {
+      dozing = true;
+      nap = dozed = 0.;
+    }
+  }
+
+  printf("block,hours,events,awake_h,dozing_h,naps,wakes,mAh,avg_ua\n");
+  double mas = 0., awake_s = 0., doze_s = 0.;
+  unsigned long events = 0, naps = 0, wakes = 0;
+  for ( auto &B : blocks )
+  {
+    printf("%s,%g,%.1f,%.3f,%.3f,%.0f,%.1f,%.3f,%.1f\n", B.name.c_str(), B.hours, B.events / days, B.awake_s / 3600. / days,
+      B.doze_s / 3600. / days, B.naps / days, B.wakes / days, B.mas / 3600. / days, B.mas / ( B.awake_s + B.doze_s ) * 1000.);
+    mas += B.mas; awake_s += B.awake_s; doze_s += B.doze_s;
+    events += B.events; naps += B.naps; wakes += B.wakes;
+  }
+  printf("day,24,%.1f,%.3f,%.3f,%.0f,%.1f,%.3f,%.1f\n", events / days, awake_s / 3600. / days, doze_s / 3600. / days,
+    naps / days, wakes / days, mas / 3600. / days, mas / ( awake_s + doze_s ) * 1000.);
+
+  double usable = par("cell_mah") * par("usable");
+  double life = usable / ( mas / 3600. / days );
+  double life_awake = usable / ( awake_ma * 24. );
+  fprintf(stderr, "%g mAh usable, doze %s gyro:  %.1f days (always awake %.1f); season %g days %s\n", usable,
+    gyro ? "with" : "without", life, life_awake, days, life >= days ? "covered" : "NOT covered");
+  fprintf(stderr, "%.2f mAh a day, %.2f awake and %.2f dozing and napping; the season needs a %.0f mAh cell\n", mas / 3600. / days,
+    awake_s * awake_ma / 3600. / days, ( mas - awake_s * awake_ma ) / 3600. / days, mas / 3600. / par("usable"));
+  fprintf(stderr, "wake latency max %.1f s, %lu of %lu wakes lost some pretrigger\n", latency_max, lost, wakes);
+  return ( 0 );
+}
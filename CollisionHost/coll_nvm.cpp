@@ -0,0 +1,159 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+// How long sampling stalls while an event goes to flash, on the NVM controller model (hal/sam.h).
+// A model of the read frame runs on the virtual clock:  a sample is due every READ_DELAY, takes -r us,
+// and then flash gets its turn as in loop().  Every -e seconds an event of -b bytes is written, three
+// ways:  all at once through FlashClass erase and write as before, and through FlashWriter, with the
+// M0+ stalling on instruction fetch while NVM is busy and, for comparison, without.  The image is
+// checked against the source after every event.  Output is CSV, a row a way; the headline on stderr
+// is the worst sample delay each way.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -Ihal -I../Collision -o coll_nvm coll_nvm.cpp hal/hal.cpp hal/nvm.cpp
+//           ../Collision/{FlashStorage,FlashWriter,TxQueue}.cpp
+// Use:    coll_nvm [-s seconds] [-e every_s] [-b bytes] [-r read_us] [-E erase_us] [-W write_us]
+
+#include "FlashStorage.h"
+#include "FlashWriter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum Way { BLOCKING, WRITER, WRITER_RAM, WAYS };
+static const char *way_names[WAYS] = {"blocking", "writer", "writer_ram"};
+
+struct Job
+{
+  uint32_t pos;             // Source bytes handed out
+  unsigned long long start_us;
+  unsigned long long job_us;
+  unsigned long events;
+  boolean ok;
+};
+
+static uint8_t source(const uint32_t k) { return ( uint8_t( k * 7 + ( k >> 8 ) ) ); }
+
+static uint16_t fill(uint8_t *buf, const uint16_t max, void *ctx)
+{
+  Job *J = (Job *)ctx;
+  for ( uint16_t k=0; k<max; k++ ) buf[k] = source(J->pos + k);
+  J->pos += max;
+  return ( max );
+}
+
+static void done(const boolean ok, void *ctx)
+{
+  Job *J = (Job *)ctx;
+  J->ok = J->ok && ok;
+  J->job_us += host_us - J->start_us;
+  J->events++;
+}
+
+static boolean check(const uint32_t bytes)
+{
+  for ( uint32_t k=0; k<bytes; k++ ) if ( Nvm.flash()[k] != source(k) ) return ( false );
+  return ( true );
+}
+
+int main(int argc, char *argv[])
+{
+  double seconds = 20., every_s = 2.;
+  unsigned long bytes = 6144, read_us = 400, erase_us = 6000, write_us = 2500;
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-s") ) seconds = atof(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-e") ) every_s = atof(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-b") ) bytes = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-r") ) read_us = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-E") ) erase_us = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-W") ) write_us = atol(argv[a + 1]);
+    else break;
+  }
+  if ( a < argc || seconds <= 0. || every_s <= 0. || !bytes || bytes > STORE_BYTES )
+  {
+    fprintf(stderr, "usage: %s [-s seconds] [-e every_s] [-b bytes] [-r read_us] [-E erase_us] [-W write_us]\n", argv[0]);
+    return ( 1 );
+  }
+
+  host_virtual = true;
+  const unsigned long frame_us = READ_DELAY * 1000UL;
+  const unsigned long frames = (unsigned long)( seconds * 1e6 / frame_us );
+  const unsigned long every = max(1UL, (unsigned long)( every_s * 1e6 / frame_us ));
+  double worst_ms[WAYS];
+  boolean all_ok = true;
+  printf("way,frames,late,late_max_ms,late_mean_ms,events,job_mean_ms,erases,page_writes,stalled_ms,writer_stalls,ok\n");
+  for ( int w=0; w<WAYS; w++ )
+  {
+    host_us = 0ULL;
+    Nvm.begin(STORE_BYTES, erase_us, write_us, w != WRITER_RAM);
+    FlashClass Region(Nvm.flash(), STORE_BYTES);
+    FlashWriter Writer;
+    Job J = Job();
+    J.ok = true;
+    unsigned long late = 0;
+    unsigned long long late_sum = 0ULL, late_max = 0ULL, due = 0ULL;
+    for ( unsigned long f=0; f<frames; f++, due += frame_us )
+    {
+      if ( host_us < due ) host_us = due;  // idle to the next sample
+      unsigned long long lag = host_us - due;
+      late_sum += lag;
+      late_max = max(late_max, lag);
+      if ( lag > OVERRUN_US ) late++;
+      host_us += read_us;
+      if ( f % every == every / 2 )
+      {
+        J.pos = 0;
+        J.start_us = host_us;
+        if ( w == BLOCKING )
+        {
+          uint8_t *img = (uint8_t *)malloc(bytes);
+          for ( uint32_t k=0; k<bytes; k++ ) img[k] = source(k);
+          Region.erase(Nvm.flash(), bytes);
+          Region.write(Nvm.flash(), img, bytes);
+          free(img);
+          done(true, &J);
+          J.ok = J.ok && check(bytes);
+        }
+        else if ( !Writer.begin(Nvm.flash(), bytes, fill, done, &J) ) J.ok = false;  // last event still going
+      }
+      if ( w != BLOCKING )
+      {
+        boolean was = Writer.busy();
+        Writer.run(FLASH_BUDGET_US);
+        if ( was && !Writer.busy() ) J.ok = J.ok && check(bytes);
+      }
+    }
+    worst_ms[w] = late_max / 1000.;
+    all_ok = all_ok && J.ok && J.events && !Nvm.overwrites();
+    printf("%s,%lu,%lu,%.3f,%.3f,%lu,%.1f,%u,%u,%.1f,%u,%d\n", way_names[w], frames, late, late_max / 1000., late_sum / 1000. / frames,
+      J.events, J.events ? J.job_us / 1000. / J.events : 0., Nvm.erases(0), Nvm.writes(), Nvm.stalled_us() / 1000., Writer.stalls(),
+      J.ok && !Nvm.overwrites());
+  }
+  fprintf(stderr, "worst sample delay %.1f ms writing %lu bytes at once, %.1f ms through FlashWriter, %.1f ms if it ran from ram "
+    "(READ_DELAY %lu ms, erase %lu us, page %lu us)%s\n", worst_ms[BLOCKING], bytes, worst_ms[WRITER], worst_ms[WRITER_RAM],
+    READ_DELAY, erase_us, write_us, all_ok ? "" : "; FLASH CHECK FAILED");
+  return ( all_ok ? 0 : 1 );
+}
@@ -0,0 +1,211 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Read cadence while an event plays back to the serial plotter (pa7, Collision/CollDatum.h).  A model
+// of loop() runs on the virtual clock:  the firmware ReadSensors Sync schedules reads, CollCore logs
+// a made up impact every -e s, and at each stop the latest register plays back, one plot line a pace
+// period.  Each read costs -r us and each pass -p us, and the host takes -b bytes a pass.  Two ways:
+//   blocking  the old playback, the line then delay(pace) inside the loop, for comparison
+//   job       the paced Tx job (TxQueue::job) the firmware queues, drained by Tx.run each pass
+// Every read gap is timed, playback the only load; past READ_DELAY by OVERRUN_US is late.  The job way
+// must have no late frames, every line of each register out, and lines no closer than the pace
+// less a pass.  Output is CSV, a row a way, and the headline on stderr.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -DPROBES=0 -Ihal -I../Collision -o coll_pace coll_pace.cpp hal/hal.cpp
+//           ../Collision/{CollCore,CollDatum,Sensors,Sync,myFilters,Time,TxQueue}.cpp
+// Use:    coll_pace [-s seconds] [-e event_every_s] [-t pace_ms] [-r read_us] [-p pass_us] [-b usb_bytes]
+
+#include "CollCore.h"
+#include "CollPlan.h"
+#include "Sync.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HIT_MS                 300ULL   // Impact length
+
+struct Result
+{
+  const char *name;
+  boolean blocking;
+  unsigned long events;
+  unsigned long frames;           // Read gaps timed
+  unsigned long late;
+  double gap_max_ms;
+  unsigned long lines;            // Plot lines out
+  unsigned long lines_want;       // Register samples plus the 5 repeats, every event
+  double spacing_min_ms;          // Between plot lines of one playback
+  double spacing_mean_ms;
+  double play_s;                  // Playback time, all events
+};
+
+// Flat on the bench, or knocked about
+static void imu_at(const unsigned long long up_ms, const boolean moving, ImuSample *imu)
+{
+  float n = 0.002 * float( ( up_ms * 7919ULL ) % 11ULL ) - 0.01;
+  ImuSample still = {true, n, -n, 1.f + n, true, 2.f * n, n, -n};
+  ImuSample hit = {true, 10., -8., 6., true, 30., -20., 10.};
+  *imu = moving ? hit : still;
+}
+
+// Plot lines in s from from on; other output, the Data_st size, doesn't count
+static unsigned long count_lines(const std::string &s, const size_t from)
+{
+  unsigned long n = 0;
+  for ( size_t k=s.find("T_rot_", from); k!=std::string::npos; k=s.find("T_rot_", k + 1) ) n++;
+  return ( n );
+}
+
+static void run(Result *R, const double seconds, const double every_s, const uint16_t pace_ms, const double read_us,
+  const double pass_us, const int usb_bytes)
+{
+  static Datum_st ram[NDATUM];
+  static Register_st reg[NREG];
+  QuietPars Qp;
+  Qp.nominal();
+  Sensors Sen(0ULL, double(NOM_DT), &Qp);
+  Data_st L(ram, NDATUM, NHOLD, reg, NREG);
+  CollCore Core(&Sen, &L);
+  Sync ReadSensors(READ_DELAY);
+  host_us = 0ULL;
+  Serial.open = true;
+  Serial.out.clear();
+
+  boolean reset = true, playing = false;
+  unsigned long long last_read_us = 0ULL, play_start_us = 0ULL, last_line_us = 0ULL;
+  double spacing_sum_ms = 0.;
+  unsigned long spacings = 0;
+  R->spacing_min_ms = 1e9;
+  unsigned long long every_ms = (unsigned long long)( every_s * 1000. );
+  while ( host_us < (unsigned long long)( seconds * 1e6 ) || playing )
+  {
+    Serial.room = usb_bytes;
+    unsigned long long now_ms = millis();
+    if ( ReadSensors.update(now_ms, reset) )
+    {
+      if ( last_read_us )
+      {
+        double gap_ms = ( host_us - last_read_us ) / 1000.;
+        R->frames++;
+        R->gap_max_ms = max(R->gap_max_ms, gap_ms);
+        if ( gap_ms * 1000. > READ_DELAY * 1000. + OVERRUN_US ) R->late++;
+      }
+      last_read_us = host_us;
+      ImuSample imu;
+      unsigned long long in_ms = now_ms % every_ms;
+      imu_at(now_ms, now_ms > every_ms && in_ms < HIT_MS, &imu);
+      uint8_t changed = Core.step(reset, &imu, now_ms, now_ms, true);
+      host_us += (unsigned long long)read_us;
+      if ( changed == CORE_STOPPED )
+      {
+        R->events++;
+        R->lines_want += L.reg(L.iRg())->n + 5;
+        playing = true;
+        play_start_us = host_us;
+        last_line_us = 0ULL;
+        if ( R->blocking )
+        {
+          // The old way, the whole register before the loop goes on
+          Register_st *Rg = L.reg(L.iRg());
+          for ( uint16_t k=0; k<Rg->n + 5; k++ )
+          {
+            uint16_t j = ( Rg->i + ( k < 5 ? 0 : k - 5 ) ) % NDATUM;
+            ram[j].plot(j, &Data);
+            Serial.room = 0x7FFF;
+            Tx.run();
+            host_us += pace_ms * 1000ULL;
+          }
+        }
+        else L.plot_latest_ram(pace_ms);
+      }
+      reset = false;
+    }
+
+    // Chitchat
+    size_t before = Serial.out.size();
+    Tx.run();
+    unsigned long out = count_lines(Serial.out, before);
+    if ( out && !R->blocking )
+    {
+      if ( last_line_us )
+      {
+        double spacing_ms = ( host_us - last_line_us ) / 1000.;
+        R->spacing_min_ms = min(R->spacing_min_ms, spacing_ms);
+        spacing_sum_ms += spacing_ms;
+        spacings++;
+      }
+      last_line_us = host_us;
+    }
+    if ( playing && !Tx.busy() )
+    {
+      playing = false;
+      R->play_s += ( host_us - play_start_us ) / 1e6;
+    }
+    host_us += (unsigned long long)pass_us;
+  }
+  R->lines = count_lines(Serial.out, 0);
+  R->spacing_mean_ms = spacings ? spacing_sum_ms / spacings : 0.;
+  if ( !spacings ) R->spacing_min_ms = 0.;
+}
+
+int main(int argc, char *argv[])
+{
+  double seconds = 120.;
+  double every_s = 10.;
+  uint16_t pace_ms = PLOT_PACE_MS;
+  double read_us = 400.;
+  double pass_us = 200.;
+  int usb_bytes = 64;
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-s") ) seconds = atof(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-e") ) every_s = atof(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-t") ) pace_ms = uint16_t(atoi(argv[a + 1]));
+    else if ( !strcmp(argv[a], "-r") ) read_us = atof(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-p") ) pass_us = atof(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-b") ) usb_bytes = atoi(argv[a + 1]);
+    else break;
+  }
+  if ( a < argc || seconds <= 0. || every_s < 1. || !pace_ms || pass_us < 1. || usb_bytes < 1 )
+  {
+    fprintf(stderr, "usage: %s [-s seconds] [-e event_every_s] [-t pace_ms] [-r read_us] [-p pass_us] [-b usb_bytes]\n", argv[0]);
+    return ( 1 );
+  }
+
+  host_virtual = true;
+  Result R[2] = {{"blocking", true}, {"job", false}};
+  for ( int k=0; k<2; k++ ) run(&R[k], seconds, every_s, pace_ms, read_us, pass_us, usb_bytes);
+
+  Result *J = &R[1];
+  double pass_ms = pass_us / 1000.;
+  boolean bad = !J->events || J->late || J->lines != J->lines_want || J->spacing_min_ms < pace_ms - pass_ms - read_us / 1000.;
+  printf("way,events,frames,late,gap_max_ms,lines,lines_want,spacing_min_ms,spacing_mean_ms,play_s\n");
+  for ( int k=0; k<2; k++ )
+    printf("%s,%lu,%lu,%lu,%.3f,%lu,%lu,%.3f,%.3f,%.2f\n", R[k].name, R[k].events, R[k].frames, R[k].late, R[k].gap_max_ms, R[k].lines,
+      R[k].lines_want, R[k].spacing_min_ms, R[k].spacing_mean_ms, R[k].play_s);
+  fprintf(stderr, "playback at %u ms a line:  blocking %lu of %lu reads late, worst gap %.1f ms; job %lu of %lu late, worst gap %.1f ms (READ_DELAY %lu ms), %lu of %lu lines at least %.1f ms apart%s\n",
+    pace_ms, R[0].late, R[0].frames, R[0].gap_max_ms, J->late, J->frames, J->gap_max_ms, READ_DELAY, J->lines, J->lines_want,
+    J->spacing_min_ms, bad ? "; FAILED" : "");
+  return ( bad ? 1 : 0 );
+}
@@ -0,0 +1,82 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Event log plans (Collision/CollPlan.h) for capture budgets other than the board's.  Each budget
+// runs through the same constexpr planner the firmware build does, here at run time, and the
+// static_asserts below run it at compile time on budgets the board never has.  Output is CSV, a row
+// per budget, ok 0 where the firmware build would stop; the headline on stderr is the board's plan.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -Ihal -I../Collision -o coll_plan coll_plan.cpp
+// Use:    coll_plan [-e event_s] [-n events] [-p pretrigger] [-s quiet_s] <capture_bytes>...
+
+#include "CollPlan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static_assert(plan_datums(0, 24, 40, 64.) == 0, "nothing from nothing");
+static_assert(plan_datums(1575, 24, 40, 64.) == 63 && plan_datums(1576, 24, 40, 64.) == 64,
+  "a register comes with the 64th datum");
+static_assert(plan_bytes(plan_datums(9999, 24, 40, 64.), 24, 40, 64.) <= 9999, "never over budget");
+static_assert(plan_datums(10000000UL, 24, 40, 64.) == 65535 && plan_registers(65535, 64.) == 255, "limits hold");
+static_assert(plan_registers(560, plan_event(0., 0.4, 10., 10UL, 20)) == 8, "the old NREG at NDATUM 560");
+
+int main(int argc, char *argv[])
+{
+  float event_s = EVENT_S;
+  unsigned events = EVENT_MIN;
+  unsigned hold = NHOLD;
+  float quiet_s = QUIET_S;
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-e") ) event_s = atof(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-n") ) events = atoi(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-p") ) hold = atoi(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-s") ) quiet_s = atof(argv[a + 1]);
+    else break;
+  }
+  if ( a >= argc || argv[a][0] == '-' )
+  {
+    fprintf(stderr, "usage: %s [-e event_s] [-n events] [-p pretrigger] [-s quiet_s] <capture_bytes>...\n", argv[0]);
+    return ( 1 );
+  }
+
+  fprintf(stderr, "board: CAPTURE_BYTES=%d NDATUM=%u NREG=%u, %lu bytes, %u events of %.2f s, longest %.2f s\n",
+    CAPTURE_BYTES, NDATUM, NREG, plan_bytes(NDATUM, sizeof(Datum_st), sizeof(Register_st), EVENT_MIN_DATUMS),
+    plan_events(NDATUM, EVENT_DATUMS), float(EVENT_S), plan_longest_s(NDATUM, EVENT_MIN_DATUMS, LOG_DELAY));
+  float min_event = plan_event(0., quiet_s, R_SCL, LOG_DELAY, hold);
+  float event = plan_event(event_s, quiet_s, R_SCL, LOG_DELAY, hold);
+  printf("capture_bytes,ndatum,nreg,used_bytes,events,longest_s,ok\n");
+  for ( ; a<argc; a++ )
+  {
+    unsigned long bytes = strtoul(argv[a], NULL, 0);
+    uint16_t n = plan_datums(bytes, sizeof(Datum_st), sizeof(Register_st), min_event);
+    uint8_t r = plan_registers(n, min_event);
+    uint16_t held = plan_events(n, event);
+    boolean ok = n > hold && r > 0 && held >= events;
+    printf("%lu,%u,%u,%lu,%u,%.2f,%d\n", bytes, n, r, plan_bytes(n, sizeof(Datum_st), sizeof(Register_st), min_event), held,
+      plan_longest_s(n, min_event, LOG_DELAY), ok);
+  }
+  return ( 0 );
+}
@@ -0,0 +1,310 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Summary printing before and after its speedups, over recorded sessions (telem_csv output, see
+// coll_session.h).  Each check formats every sample of the sessions, in order as the firmware would,
+// with the old code kept here verbatim and with the firmware's, and the bytes must match.
+//   time   time_long_2_str, before the cached date prefix
+//   plot   Datum_st::plot, before int16 samples were printed without float
+//   print  Datum_st::print, the same
+// Samples are stored as raw_from() would, with the time between samples for T_rot and T_acc, and
+// after the sessions every int16 value goes through every channel.  The old sample prints went
+// through Arduino's printFloat, copied here.  Output is CSV, a row a check with lines, bytes,
+// mismatches and the time per line each way; the first mismatch goes to stderr, and the headline.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -Ihal -I../Collision -o coll_print coll_print.cpp hal/hal.cpp
+//           ../Collision/{CollDatum,Sensors,myFilters,Time,TxQueue}.cpp
+// Use:    coll_print <session.csv>...
+
+#include "coll_session.h"
+#include "CollDatum.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Print as the Arduino core's does floats:  printFloat, verbatim but for the ovf/nan cases samples
+// can't reach
+class ArduinoOut : public Print
+{
+public:
+  using Print::write;
+  size_t write(uint8_t c) { s += char(c); return ( 1 ); };
+  size_t write(const uint8_t *buf, size_t n) { s.append((const char *)buf, n); return ( n ); };
+  using Print::print;
+  using Print::println;
+  size_t print(double number, int digits) { return ( printFloat(number, uint8_t(digits)) ); };
+  size_t println(double number, int digits) { size_t n = print(number, digits); return ( n + println() ); };
+  size_t println(float number, int digits) { return ( println(double(number), digits) ); };
+  std::string s;
+protected:
+  size_t printFloat(double number, uint8_t digits)
+  {
+    size_t n = 0;
+    if ( number < 0.0 )
+    {
+      n += print('-');
+      number = -number;
+    }
+    double rounding = 0.5;
+    for ( uint8_t i=0; i<digits; ++i ) rounding /= 10.0;
+    number += rounding;
+    unsigned long int_part = (unsigned long)number;
+    double remainder = number - (double)int_part;
+    n += print(int_part);
+    if ( digits > 0 ) n += print(".");
+    while ( digits-- > 0 )
+    {
+      remainder *= 10.0;
+      unsigned int toPrint = (unsigned int)(remainder);
+      n += print(toPrint);
+      remainder -= toPrint;
+    }
+    return ( n );
+  };
+};
+
+// Old time_long_2_str, verbatim
+static void old_time_long_2_str(const unsigned long long _time_ms, SafeString &return_str)
+{
+    int thou_ = _time_ms % 1000;
+    time_t time = _time_ms / 1000;
+    char tempStr[36];
+    #ifndef USE_ARDUINO
+      uint32_t year_ = Time.year(time);
+      uint8_t month_ = Time.month(time);
+      uint8_t day_ = Time.day(time);
+      uint8_t hours_ = Time.hour(time);
+      uint8_t minutes_   = Time.minute(time);
+      uint8_t seconds_   = Time.second(time);
+    #else
+      uint32_t year_ = year(time);
+      uint8_t month_ = month(time);
+      uint8_t day_ = day(time);
+      uint8_t hours_ = hour(time);
+      uint8_t minutes_   = minute(time);
+      uint8_t seconds_   = second(time);
+    #endif
+    sprintf(tempStr, "%4u-%02u-%02uT%02u:%02u:%02u.%03d", int(year_), month_, day_, hours_, minutes_, seconds_, thou_);
+    return_str = tempStr;
+}
+
+// Old Datum_st::plot and print, verbatim but for the class
+struct OldDatum : public Datum_st
+{
+  void plot(const uint16_t i, ArduinoOut *out);
+  void print(const uint16_t i, ArduinoOut *out);
+};
+
+void OldDatum::plot(const uint16_t i, ArduinoOut *out)
+{
+  #ifndef SAVE_RAW
+    out->print("T_rot_filt*100:"); out->print(float(T_rot_int) * 100. / T_SCL, 3);
+    out->print("\ta_filt:"); out->print(float(a_int) / O_SCL, 3);
+    out->print("\tb_filt:"); out->print(float(b_int) / O_SCL, 3);
+    out->print("\tc_filt:"); out->print(float(c_int) / O_SCL, 3);
+    out->print("\tT_acc_filt*100:"); out->print(float(T_acc_int) * 100. / T_SCL, 3);
+    out->print("\tx_filt:"); out->print(float(x_int) / G_SCL, 3);
+    out->print("\ty_filt:"); out->print(float(y_int) / G_SCL, 3);
+    out->print("\tz_filt:"); out->println(float(z_int) / G_SCL, 3);
+  #else
+    out->print("T_rot_raw*100:"); out->print(float(T_rot_int) * 100. / T_SCL, 3);
+    out->print("\ta_raw:"); out->print(float(a_int) / O_SCL, 3);
+    out->print("\tb_raw:"); out->print(float(b_int) / O_SCL, 3);
+    out->print("\tc_raw:"); out->print(float(c_int) / O_SCL, 3);
+    out->print("\tT_acc_raw*100:"); out->print(float(T_acc_int) * 100. / T_SCL, 3);
+    out->print("\tx_raw:"); out->print(float(x_int) / G_SCL, 3);
+    out->print("\ty_raw:"); out->print(float(y_int) / G_SCL, 3);
+    out->print("\tz_raw:"); out->println(float(z_int) / G_SCL, 3);
+  #endif
+}
+
+void OldDatum::print(const uint16_t i, ArduinoOut *out)
+{
+  cSF(prn_buff, INPUT_BYTES, "");
+  prn_buff = "---";
+  time_long_2_str(t_ms, prn_buff);
+  out->print(i);
+  out->print(" "); out->print(t_ms);
+  out->print(" "); out->print(prn_buff);
+  #ifndef SAVE_RAW
+    out->print(" T_rot_filt "); out->print(float(T_rot_int) / T_SCL, 3);
+    out->print(" a_filt "); out->print(float(a_int) / O_SCL, 3);
+    out->print(" b_filt "); out->print(float(b_int) / O_SCL, 3);
+    out->print(" c_filt "); out->print(float(c_int) / O_SCL, 3);
+    out->print(" T_acc_filt "); out->print(float(T_acc_int) / T_SCL, 3);
+    out->print(" x_filt "); out->print(float(x_int) / G_SCL, 3);
+    out->print(" y_filt "); out->print(float(y_int) / G_SCL, 3);
+    out->print(" z_filt "); out->println(float(z_int) / G_SCL, 3);
+  #else
+    out->print(" T_rot_raw "); out->print(float(T_rot_int) / T_SCL, 3);
+    out->print(" a_raw "); out->print(float(a_int) / O_SCL, 3);
+    out->print(" b_raw "); out->print(float(b_int) / O_SCL, 3);
+    out->print(" c_raw "); out->print(float(c_int) / O_SCL, 3);
+    out->print(" T_acc_raw "); out->print(float(T_acc_int) / T_SCL, 3);
+    out->print(" x_raw "); out->print(float(x_int) / G_SCL, 3);
+    out->print(" y_raw "); out->print(float(y_int) / G_SCL, 3);
+    out->print(" z_raw "); out->println(float(z_int) / G_SCL, 3);
+  #endif
+}
+
+// A sample as raw_from() stores it
+static int16_t to_int(const double v) { return ( int16_t( constrain(v, -32767., 32767.) ) ); }
+static void datum_from(const CollSample &s, const double T, OldDatum *D)
+{
+  D->t_ms = s.t_ms;
+  D->T_rot_int = to_int(T * T_SCL);
+  D->a_int = to_int(s.imu.a * O_SCL);
+  D->b_int = to_int(s.imu.b * O_SCL);
+  D->c_int = to_int(s.imu.c * O_SCL);
+  D->T_acc_int = to_int(T * T_SCL);
+  D->x_int = to_int(s.imu.x * G_SCL);
+  D->y_int = to_int(s.imu.y * G_SCL);
+  D->z_int = to_int(s.imu.z * G_SCL);
+}
+
+static void old_time(const uint16_t i, OldDatum &D, std::string *out)
+{
+  cSF(prn_buff, INPUT_BYTES, "");
+  old_time_long_2_str(D.t_ms, prn_buff);
+  *out = prn_buff.c_str();
+}
+
+static void new_time(const uint16_t i, OldDatum &D, std::string *out)
+{
+  cSF(prn_buff, INPUT_BYTES, "");
+  time_long_2_str(D.t_ms, prn_buff);
+  *out = prn_buff.c_str();
+}
+
+static void old_plot(const uint16_t i, OldDatum &D, std::string *out)
+{
+  ArduinoOut A;
+  D.plot(i, &A);
+  out->swap(A.s);
+}
+
+static void new_plot(const uint16_t i, OldDatum &D, std::string *out)
+{
+  ArduinoOut A;
+  D.Datum_st::plot(i, &A);
+  out->swap(A.s);
+}
+
+static void old_print(const uint16_t i, OldDatum &D, std::string *out)
+{
+  ArduinoOut A;
+  D.print(i, &A);
+  out->swap(A.s);
+}
+
+static void new_print(const uint16_t i, OldDatum &D, std::string *out)
+{
+  ArduinoOut A;
+  D.Datum_st::print(i, &A);
+  out->swap(A.s);
+}
+
+typedef void (*Format)(const uint16_t i, OldDatum &D, std::string *out);
+struct Check
+{
+  const char *name;
+  Format old_fmt;
+  Format new_fmt;
+};
+static const Check checks[] = {
+  {"time", old_time, new_time},
+  {"plot", old_plot, new_plot},
+  {"print", old_print, new_print},
+};
+#define N_CHECKS ( sizeof(checks) / sizeof(checks[0]) )
+
+// Every sample through fmt into out, one string a sample; returns ns per line
+static double format_all(std::vector<OldDatum> &D, const Format fmt, std::vector<std::string> *out)
+{
+  out->assign(D.size(), std::string());
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for ( size_t k=0; k<D.size(); k++ ) fmt(uint16_t(k), D[k], &(*out)[k]);
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+  return ( D.size() ? ns / D.size() : 0. );
+}
+
+int main(int argc, char *argv[])
+{
+  if ( argc < 2 )
+  {
+    fprintf(stderr, "usage: %s <session.csv>...\n", argv[0]);
+    return ( 1 );
+  }
+  std::vector<OldDatum> S;
+  std::vector<CollSample> one;
+  for ( int a=1; a<argc; a++ )
+  {
+    if ( !coll_load_session(argv[a], &one) )
+    {
+      fprintf(stderr, "%s: can't read\n", argv[a]);
+      return ( 1 );
+    }
+    for ( size_t k=0; k<one.size(); k++ )
+    {
+      OldDatum D;
+      datum_from(one[k], k ? ( one[k].t_ms - one[k-1].t_ms ) / 1000. : NOM_DT, &D);
+      S.push_back(D);
+    }
+  }
+  if ( S.empty() )
+  {
+    fprintf(stderr, "no samples\n");
+    return ( 1 );
+  }
+  size_t recorded = S.size();
+  for ( int32_t v=-32768; v<=32767; v++ )
+  {
+    OldDatum D = S.back();
+    D.t_ms += 10;
+    D.T_rot_int = D.a_int = D.b_int = D.c_int = D.T_acc_int = D.x_int = D.y_int = D.z_int = int16_t(v);
+    S.push_back(D);
+  }
+
+  unsigned long bad_total = 0;
+  printf("check,lines,bytes,mismatches,old_ns,new_ns\n");
+  for ( size_t c=0; c<N_CHECKS; c++ )
+  {
+    std::vector<std::string> was, now;
+    double old_ns = format_all(S, checks[c].old_fmt, &was);
+    double new_ns = format_all(S, checks[c].new_fmt, &now);
+    unsigned long bad = 0, bytes = 0;
+    for ( size_t k=0; k<S.size(); k++ )
+    {
+      bytes += now[k].size();
+      if ( was[k] == now[k] ) continue;
+      if ( !bad++ ) fprintf(stderr, "%s: t_ms %llu old '%s' new '%s'\n", checks[c].name, S[k].t_ms, was[k].c_str(), now[k].c_str());
+    }
+    bad_total += bad;
+    printf("%s,%zu,%lu,%lu,%.1f,%.1f\n", checks[c].name, S.size(), bytes, bad, old_ns, new_ns);
+  }
+  fprintf(stderr, "%zu samples from %d sessions and %zu swept, %lu mismatches%s\n", recorded, argc - 1, S.size() - recorded,
+    bad_total, bad_total ? "; FAILED" : "");
+  return ( bad_total ? 1 : 0 );
+}
@@ -0,0 +1,394 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Event download and telemetry rates on a pseudo-terminal stand-in for the USB port, the text dump
+// against the binary link (Collision/CollLink.h), and the telemetry stream (Collision/CollTelem.h).  The firmware pipeline, log, store, link, command reader and Tx
+// queue run as loop() runs them, on the host clock, behind the master side of a pty; the port takes up
+// to -b bytes a -p us pass, as USB does.  A hit of -l ms is logged and stored first on the virtual
+// clock.  Then each download is run by a receiver on the slave side:
+//   text    the Latest ram dump loop() prints at each stop, read until a second of quiet
+//   dr      coll_recv on the ram register, plain binary
+//   ds0     coll_recv on the stored record, compressed
+//   telem   telem_csv for -t s, all channels at every read
+// For each:  bytes on the wire, seconds from the command to the last byte, B/s, and the receiver's
+// own line.  The binary downloads must end in a good record, and the stream must lose no frame,
+// neither skipped here nor missing there, at the full read rate.  Output is CSV, a row a run, and
+// the headline on stderr.  Build coll_recv and telem_csv first; -r is where they are.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -DPROBES=0 -Ihal -I../Collision -o coll_pty coll_pty.cpp hal/hal.cpp hal/nvm.cpp
+//           ../Collision/{CmdReader,CollCore,CollDatum,CollLink,CollStore,CollTelem,FlashStorage,FlashWriter,Sensors,myFilters,Time,TxQueue}.cpp
+// Use:    coll_pty [-p pass_us] [-b bytes] [-l hit_ms] [-t telem_s] [-r receivers_dir]
+
+#include "CmdReader.h"
+#include "CollCore.h"
+#include "CollLink.h"
+#include "CollPlan.h"
+#include "CollStore.h"
+#include "CollTelem.h"
+#include "FlashWriter.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define HIT_MS                1000ULL   // Impact starts, up ms
+#define TEXT_QUIET_S             1.0    // Text reader stops after this much silence, s
+#define TIMEOUT_S               90.0    // A download that takes longer has failed, s
+
+static double now_s()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ( tv.tv_sec + tv.tv_usec * 1e-6 );
+}
+
+// Flat on the bench, or knocked about
+static void imu_at(const unsigned long long up_ms, const boolean moving, ImuSample *imu)
+{
+  float n = 0.002 * float( ( up_ms * 7919ULL ) % 11ULL ) - 0.01;
+  ImuSample still = {true, n, -n, 1.f + n, true, 2.f * n, n, -n};
+  ImuSample hit = {true, 10., -8., 6., true, 30., -20., 10.};
+  *imu = moving ? hit : still;
+}
+
+// Bytes from the receiver, as USB hands them to the board
+class PtyIn : public Stream
+{
+public:
+  PtyIn() : fd(-1), at(0), got(0) {};
+  int available() { return ( int( s.size() - at ) ); };
+  int read() { return ( available() ? (uint8_t)s[at++] : -1 ); };
+  size_t write(uint8_t c) { return ( 0 ); };
+  void fill()
+  {
+    if ( at == s.size() ) { s.clear(); at = 0; }
+    char buf[256];
+    ssize_t n;
+    while ( ( n = ::read(fd, buf, sizeof(buf)) ) > 0 ) { s.append(buf, n); got += n; }
+  };
+  int fd;
+  std::string s;
+  size_t at;
+  unsigned long got;        // Bytes since the run began
+};
+
+// The stream, with its counts
+class Telem_t : public CollTelem
+{
+public:
+  uint32_t sent() { return ( sent_ ); };
+  uint32_t skipped() { return ( skipped_ ); };
+};
+
+// The board, behind the master
+static FlashClass *Log_, *Index_;
+static FlashWriter *Writer_;
+static CollStore *Store_;
+static CollLink *Link_;
+static Sensors *Sen_;
+static Data_st *L_;
+static CollCore *Core_;
+static Telem_t Telem;
+static PtyIn In;
+static std::string pending;  // Taken by USB, not yet by the pty
+static unsigned long long next_read_ms = 0ULL, base_us = 0ULL;
+static boolean reset = true;
+static unsigned long stops = 0UL;  // Events logged
+static unsigned long reads = 0UL;
+static double real0 = 0.;
+
+// dc, dr, ds, dx as Collision.ino has them
+static void cmd_dc(Cmd *c, void *ctx) { if ( !Link_->resume(c->i) ) { Text.print("cannot resume at "); Text.println(c->i); } }
+static void cmd_dr(Cmd *c, void *ctx)
+{
+  Data_st *L = (Data_st *)ctx;
+  if ( !Link_->send_ram(L, c->i<0 ? L->iRg() : c->i) ) { Text.print("no register "); Text.println(c->i); }
+}
+static void cmd_ds(Cmd *c, void *ctx) { if ( !Link_->send_stored(c->i) ) { Text.print("no stored event "); Text.println(c->i); } }
+static void cmd_dx(Cmd *c, void *ctx) { Link_->abort(); }
+
+// dt - the text dump loop() prints at each stop
+static void cmd_dt(Cmd *c, void *ctx)
+{
+  Tx.line(&Data, "Latest ram");
+  ((Data_st *)ctx)->print_latest_ram();
+}
+
+// tg, tx as Collision.ino has them
+static void cmd_tg(Cmd *c, void *ctx) { Telem.start(); Telem.print(&Text); }
+static void cmd_tx(Cmd *c, void *ctx) { Telem.stop(); Telem.print(&Text); }
+
+static const CmdEntry table[] = {{"dc", cmd_dc}, {"dr", cmd_dr}, {"ds", cmd_ds}, {"dt", cmd_dt}, {"dx", cmd_dx},
+  {"tg", cmd_tg}, {"tx", cmd_tx}};
+static CmdReader Cmds(table, sizeof(table) / sizeof(table[0]));
+
+// One loop() pass.  The virtual clock follows the host's once the event is in.  Returns the bytes
+// the pty took.
+static unsigned long pass(const boolean real, const int room, const boolean moving)
+{
+  if ( real ) host_us = base_us + (unsigned long long)( ( now_s() - real0 ) * 1e6 );
+  unsigned long long now_ms = host_us / 1000ULL;
+  if ( real )
+  {
+    In.fill();
+    Cmds.read(&In);
+    Cmds.run(L_);
+  }
+  if ( now_ms >= next_read_ms )
+  {
+    next_read_ms = now_ms + READ_DELAY;
+    ImuSample imu;
+    imu_at(now_ms, moving, &imu);
+    if ( Core_->step(reset, &imu, now_ms, now_ms, true) == CORE_STOPPED )
+    {
+      Store_->commit(L_, L_->iRg());
+      stops++;
+    }
+    Telem.run(Sen_);
+    reads++;
+    Store_->run();
+    Writer_->run(FLASH_BUDGET_US);
+    reset = false;
+  }
+  Link_->run();
+  Serial.room = max(room - int(pending.size()), 0);
+  Tx.run();
+  pending += Serial.out;
+  Serial.out.clear();
+  ssize_t n = pending.size() ? write(In.fd, pending.data(), pending.size()) : 0;
+  if ( n <= 0 ) return ( 0UL );
+  pending.erase(0, n);
+  return ( (unsigned long)n );
+}
+
+struct Result
+{
+  const char *name;
+  const char *cmd;
+  unsigned long bytes;      // On the wire, from the command to the receiver's end
+  double seconds;           // Command in to the last byte out
+  boolean ok;
+  std::string said;         // The receiver's last line
+  unsigned long rows;       // Telemetry rows decoded
+  unsigned long lost;       // and missing by seq
+  unsigned long reads;      // Reads while the receiver listened
+};
+
+// The old path's receiver:  the dump as text, to a second of quiet
+static int read_text(const char *slave)
+{
+  int fd = open(slave, O_RDWR | O_NOCTTY);
+  if ( fd < 0 ) return ( 1 );
+  struct termios t;
+  tcgetattr(fd, &t);
+  cfmakeraw(&t);
+  t.c_cc[VMIN] = 0;
+  t.c_cc[VTIME] = 1;
+  tcsetattr(fd, TCSANOW, &t);
+  double t0 = now_s(), last = 0.;
+  unsigned long bytes = 0, lines = 0;
+  if ( write(fd, "dt\n", 3) != 3 ) return ( 1 );
+  while ( ( last ? now_s() - last : now_s() - t0 ) < ( last ? TEXT_QUIET_S : TIMEOUT_S ) )
+  {
+    char buf[512];
+    ssize_t got = read(fd, buf, sizeof(buf));
+    if ( got <= 0 ) continue;
+    bytes += got;
+    for ( ssize_t b=0; b<got; b++ ) if ( buf[b] == '\n' ) lines++;
+    last = now_s();
+  }
+  printf("%lu bytes, %lu lines in %.3f s (%.0f B/s)\n", bytes, lines, last - t0, bytes / ( last - t0 ));
+  return ( lines > 1 ? 0 : 1 );
+}
+
+// One download, the receiver in a child on the slave, the board here until it is done
+static void run(Result *R, const char *slave, int slave_fd, const char *dir, const unsigned long pass_us, const int room,
+  const char *telem_s)
+{
+  tcflush(slave_fd, TCIOFLUSH);
+  In.s.clear();
+  In.at = 0;
+  In.got = 0;
+  int out[2];
+  if ( pipe(out) ) return;
+  char bin[64];
+  snprintf(bin, sizeof(bin), "/tmp/coll_pty_%d.bin", int(getpid()));
+  pid_t pid = fork();
+  if ( pid == 0 )
+  {
+    dup2(out[1], 1);
+    dup2(out[1], 2);
+    close(out[0]);
+    if ( !strcmp(R->cmd, "dt") ) { int rc = read_text(slave); fflush(stdout); _exit(rc); }
+    boolean telem = !strcmp(R->cmd, "tg");
+    std::string recv = std::string(dir) + ( telem ? "/telem_csv" : "/coll_recv" );
+    if ( telem ) { int csv = open("/dev/null", O_WRONLY); dup2(csv, 1); }  // the rows; only the count is wanted
+    if ( telem ) execl(recv.c_str(), "telem_csv", slave, telem_s, (char *)NULL);
+    else execl(recv.c_str(), "coll_recv", slave, R->cmd, bin, (char *)NULL);
+    fprintf(stderr, "%s: %s\n", recv.c_str(), strerror(errno));
+    _exit(1);
+  }
+  close(out[1]);
+  fcntl(out[0], F_SETFL, O_NONBLOCK);
+
+  std::string said;
+  double start = 0., last = 0., t0 = now_s();
+  unsigned long reads0 = 0UL;
+  int status = 1;
+  for ( ;; )
+  {
+    double t = now_s();
+    unsigned long n = pass(true, room, false);
+    if ( !start && In.got ) { start = t; reads0 = reads; }
+    if ( start ) R->bytes += n;
+    if ( n ) last = now_s();
+    char buf[512];
+    ssize_t k;
+    while ( ( k = read(out[0], buf, sizeof(buf)) ) > 0 ) said.append(buf, k);
+    if ( waitpid(pid, &status, WNOHANG) == pid ) break;
+    if ( now_s() - t0 > TIMEOUT_S + 10. ) { kill(pid, SIGKILL); waitpid(pid, &status, 0); break; }
+    if ( pass_us ) { double wait = pass_us * 1e-6 - ( now_s() - t ); if ( wait > 0. ) usleep(useconds_t( wait * 1e6 )); }
+  }
+  ssize_t k;
+  char buf[512];
+  while ( ( k = read(out[0], buf, sizeof(buf)) ) > 0 ) said.append(buf, k);
+  close(out[0]);
+  unlink(bin);
+  while ( said.size() && said[said.size() - 1] == '\n' ) said.erase(said.size() - 1);
+  R->said = said.substr(said.rfind('\n') == std::string::npos ? 0 : said.rfind('\n') + 1);
+  R->seconds = last > start ? last - start : 0.;
+  R->reads = reads - reads0;
+  R->ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && R->bytes && R->seconds > 0.;
+  if ( !strcmp(R->cmd, "tg") )
+  {
+    R->ok = R->ok && sscanf(R->said.c_str(), "%lu rows, %*u headers in %*f s (%*f rows/s, %*f B/s); lost %lu", &R->rows,
+      &R->lost) == 2 && !R->lost && !Telem.skipped() && R->rows + 5UL >= R->reads;  // a few still on the way at tx
+  }
+  Link_->abort();
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long pass_us = 1000UL;
+  int room = 64;
+  unsigned long long hit_ms = 2000ULL;
+  const char *telem_s = "5";
+  const char *dir = ".";
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-p") ) pass_us = strtoul(argv[a + 1], NULL, 10);
+    else if ( !strcmp(argv[a], "-b") ) room = atoi(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-l") ) hit_ms = strtoull(argv[a + 1], NULL, 10);
+    else if ( !strcmp(argv[a], "-t") ) telem_s = argv[a + 1];
+    else if ( !strcmp(argv[a], "-r") ) dir = argv[a + 1];
+    else break;
+  }
+  if ( a < argc || room < 1 || !hit_ms || atof(telem_s) < 1. )
+  {
+    fprintf(stderr, "usage: %s [-p pass_us] [-b bytes] [-l hit_ms] [-t telem_s] [-r receivers_dir]\n", argv[0]);
+    return ( 1 );
+  }
+
+  // The pty, the slave held open here too so the master never sees it hang up between receivers
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if ( master < 0 || grantpt(master) || unlockpt(master) )
+  {
+    perror("pty");
+    return ( 1 );
+  }
+  const char *slave = ptsname(master);
+  int slave_fd = open(slave, O_RDWR | O_NOCTTY);
+  struct termios t;
+  if ( slave_fd < 0 || tcgetattr(slave_fd, &t) )
+  {
+    perror(slave);
+    return ( 1 );
+  }
+  cfmakeraw(&t);
+  tcsetattr(slave_fd, TCSANOW, &t);
+  fcntl(master, F_SETFL, O_NONBLOCK);
+  In.fd = master;
+
+  // The board, and the event logged and stored on the virtual clock
+  static Datum_st ram[NDATUM];
+  static Register_st reg[NREG];
+  host_virtual = true;
+  host_us = 0ULL;
+  Nvm.begin(STORE_BYTES + INDEX_BYTES);
+  Log_ = new FlashClass(Nvm.flash(), STORE_BYTES);
+  Index_ = new FlashClass(Nvm.flash() + STORE_BYTES, INDEX_BYTES);
+  Writer_ = new FlashWriter;
+  Store_ = new CollStore(Log_, Index_, Writer_);
+  Store_->begin();
+  Link_ = new CollLink(Store_);
+  QuietPars Qp;
+  Qp.nominal();
+  Sen_ = new Sensors(0ULL, double(NOM_DT), &Qp);
+  L_ = new Data_st(ram, NDATUM, NHOLD, reg, NREG);
+  Core_ = new CollCore(Sen_, L_);
+  Serial.open = true;
+  while ( !stops || Store_->busy() || Writer_->busy() )
+  {
+    unsigned long long up_ms = host_us / 1000ULL;
+    if ( up_ms > HIT_MS + hit_ms + 600000ULL ) break;
+    pass(false, 0, up_ms >= HIT_MS && up_ms < HIT_MS + hit_ms);
+    host_us += 100ULL;
+  }
+  uint32_t rec_bytes = 0;
+  if ( stops != 1 || !Store_->record(0, &rec_bytes) )
+  {
+    fprintf(stderr, "no event stored; FAILED\n");
+    return ( 1 );
+  }
+  base_us = host_us;
+  real0 = now_s();
+
+  Telem.mask(TELEM_MASK);
+  Telem.decim(1);
+  Result R[4] = {{"text", "dt"}, {"dr", "dr"}, {"ds0", "ds0"}, {"telem", "tg"}};
+  for ( int k=0; k<4; k++ ) run(&R[k], slave, slave_fd, dir, pass_us, room, telem_s);
+
+  boolean bad = false;
+  printf("run,wire_bytes,seconds,bytes_per_s,ok,receiver\n");
+  for ( int k=0; k<4; k++ )
+  {
+    bad = bad || !R[k].ok;
+    printf("%s,%lu,%.3f,%.0f,%d,\"%s\"\n", R[k].name, R[k].bytes, R[k].seconds, R[k].seconds > 0. ? R[k].bytes / R[k].seconds : 0.,
+      R[k].ok, R[k].said.c_str());
+  }
+  fprintf(stderr, "%u samples, pass %lu us, %d B a pass:  text %.3f s, dr %.3f s (%.1fx), ds0 %.3f s (%.1fx); "
+    "telem %lu rows of %lu reads (%.1f rows/s, %.0f B/s), skipped %lu lost %lu%s\n",
+    ((const StoreHeader *)Store_->record(0, &rec_bytes))->n, pass_us, room, R[0].seconds, R[1].seconds,
+    R[1].seconds > 0. ? R[0].seconds / R[1].seconds : 0., R[2].seconds, R[2].seconds > 0. ? R[0].seconds / R[2].seconds : 0.,
+    R[3].rows, R[3].reads, R[3].seconds > 0. ? R[3].rows / R[3].seconds : 0., R[3].seconds > 0. ? R[3].bytes / R[3].seconds : 0.,
+    (unsigned long)Telem.skipped(), R[3].lost, bad ? "; FAILED" : "");
+  return ( bad ? 1 : 0 );
+}
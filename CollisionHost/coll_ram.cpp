@@ -0,0 +1,135 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Ram budget of a firmware build, from its link.  Everything the firmware keeps is static, nothing
+// comes off the heap, so the symbol table is the whole story:  the statics end at __bss_end__ and the
+// stack comes down from __StackTop.  What lies between, less STACK_BYTES, is what more capture could
+// use.  Capture is the event log storage, log_ram and log_reg, planned from CAPTURE_BYTES
+// (CollPlan.h), so the room converts to the CAPTURE_BYTES that would use it and the plan that gives.
+// Output is CSV, the largest ram symbols first; the headline on stderr is the budget, and the exit
+// status is 1 when the statics leave less than STACK_BYTES.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -Ihal -I../Collision -o coll_ram coll_ram.cpp
+// Use:    arm-none-eabi-nm -S -C <build>/Collision.ino.elf | coll_ram [-n symbols] [-r ram_bytes] [-k stack_bytes]
+
+#include "CollPlan.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define RAM_ORIGIN      0x20000000UL    // SAMD21 sram
+#define RAM_BYTES            32768      // Nano 33 IoT, when the link has no __StackTop
+
+struct Sym
+{
+  std::string name;
+  unsigned long addr;
+  unsigned long size;
+};
+
+int main(int argc, char *argv[])
+{
+  unsigned long show = 20;
+  unsigned long ram_bytes = RAM_BYTES;
+  unsigned long stack_bytes = STACK_BYTES;
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-n") ) show = strtoul(argv[a + 1], NULL, 10);
+    else if ( !strcmp(argv[a], "-r") ) ram_bytes = strtoul(argv[a + 1], NULL, 0);
+    else if ( !strcmp(argv[a], "-k") ) stack_bytes = strtoul(argv[a + 1], NULL, 0);
+    else break;
+  }
+  if ( a < argc )
+  {
+    fprintf(stderr, "usage: arm-none-eabi-nm -S -C <elf> | %s [-n symbols] [-r ram_bytes] [-k stack_bytes]\n", argv[0]);
+    return ( 1 );
+  }
+
+  // nm -S lines are 'address size type name', or 'address type name' for symbols without a size
+  std::vector<Sym> ram;
+  unsigned long data_start = 0, bss_end = 0, stack_top = 0, log_bytes = 0;
+  char line[512];
+  while ( fgets(line, sizeof(line), stdin) )
+  {
+    line[strcspn(line, "\r\n")] = '\0';
+    char *f[3];
+    char *p = line;
+    int n = 0;
+    for ( ; n<3; n++ )
+    {
+      f[n] = p;
+      p = strchr(p, ' ');
+      if ( !p ) break;
+      *p++ = '\0';
+    }
+    if ( n < 2 ) continue;
+    Sym s;
+    s.addr = strtoul(f[0], NULL, 16);
+    s.size = 0;
+    const char *type = f[1];
+    if ( n == 3 && strlen(f[1]) > 1 )
+    {
+      s.size = strtoul(f[1], NULL, 16);
+      type = f[2];
+      s.name = p;
+    }
+    else s.name = ( n == 3 ) ? std::string(f[2]) + " " + p : f[2];
+    if ( s.name == "__data_start__" ) data_start = s.addr;
+    else if ( s.name == "__bss_end__" ) bss_end = s.addr;
+    else if ( s.name == "__StackTop" ) stack_top = s.addr;
+    if ( !strchr("bBdD", type[0]) || !s.size ) continue;
+    if ( s.name == "log_ram" || s.name == "log_reg" ) log_bytes += s.size;
+    ram.push_back(s);
+  }
+  if ( !bss_end )
+  {
+    fprintf(stderr, "no __bss_end__; give the firmware elf to nm\n");
+    return ( 1 );
+  }
+  if ( !data_start ) data_start = RAM_ORIGIN;
+  if ( !stack_top ) stack_top = RAM_ORIGIN + ram_bytes;
+
+  std::sort(ram.begin(), ram.end(), [](const Sym &x, const Sym &y) { return ( x.size > y.size ); });
+  printf("symbol,bytes\n");
+  for ( size_t k=0; k<ram.size() && k<show; k++ ) printf("%s,%lu\n", ram[k].name.c_str(), ram[k].size);
+
+  long statics = long(bss_end - data_start);
+  long room = long(stack_top - bss_end) - long(stack_bytes);
+  fprintf(stderr, "ram %lu, statics %ld of which capture %lu (NDATUM=%d NREG=%d), stack kept %lu, left %ld\n",
+    stack_top - data_start, statics, log_bytes, NDATUM, int(NREG), stack_bytes, room);
+  if ( log_bytes )
+  {
+    long total = room + long(log_bytes);
+    unsigned long bytes = total > 0 ? total : 0;
+    uint16_t n = plan_datums(bytes, sizeof(Datum_st), sizeof(Register_st), EVENT_MIN_DATUMS);
+    fprintf(stderr, "CAPTURE_BYTES could be %lu:  NDATUM=%u (%+d, %.2f s of history) NREG=%u, %u events of EVENT_S\n",
+      bytes, n, int(n) - int(NDATUM), n * double(LOG_DELAY) / 1000., plan_registers(n, EVENT_MIN_DATUMS), plan_events(n, EVENT_DATUMS));
+  }
+  else fprintf(stderr, "no log_ram or log_reg in the symbols\n");
+  return ( room < 0 ? 1 : 0 );
+}
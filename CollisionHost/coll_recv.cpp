@@ -0,0 +1,245 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Host receiver for the binary event download (CollLink, 'ds'/'dr' commands).  Sends the command,
+// reassembles the COBS framed packets, resumes with 'dc' from the first missing byte after a gap or
+// a quiet link, validates the record crc and writes the record to a file.  Optionally decodes it to
+// CSV of the raw int16 channels.
+//
+// Build:  g++ -O2 -std=c++11 -I../Collision -o coll_recv coll_recv.cpp
+// Use:    coll_recv /dev/ttyACM0 ds0 event.bin [event.csv]
+
+#include "CollFormat.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+static double now_s()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ( tv.tv_sec + tv.tv_usec * 1e-6 );
+}
+
+static int open_port(const char *path)
+{
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if ( fd < 0 ) return ( -1 );
+  struct termios t;
+  if ( tcgetattr(fd, &t) == 0 )
+  {
+    cfmakeraw(&t);
+    cfsetspeed(&t, B115200);  // ignored by USB CDC
+    t.c_cc[VMIN] = 0;
+    t.c_cc[VTIME] = 1;        // 0.1 s read timeout
+    tcsetattr(fd, TCSANOW, &t);
+  }
+  return ( fd );
+}
+
+static void command(int fd, const char *cmd)
+{
+  char line[32];
+  int n = snprintf(line, sizeof(line), "%s\n", cmd);
+  if ( write(fd, line, n) != n ) perror("write");
+}
+
+// Header sane and crc good, as CollStore::valid
+static bool record_ok(const std::vector<uint8_t> &obj)
+{
+  if ( obj.size() < sizeof(StoreHeader) ) return ( false );
+  StoreHeader h;
+  memcpy(&h, obj.data(), sizeof(h));
+  if ( h.magic != STORE_MAGIC || h.version != STORE_VERSION || sizeof(h) + h.len != obj.size() ) return ( false );
+  uint16_t crc = h.crc;
+  h.crc = 0;
+  return ( crc16_update(crc16_update(0xFFFF, obj.data() + sizeof(h), h.len), &h, sizeof(h)) == crc );
+}
+
+static bool write_csv(const std::vector<uint8_t> &obj, const char *path)
+{
+  StoreHeader h;
+  memcpy(&h, obj.data(), sizeof(h));
+  FILE *f = fopen(path, "w");
+  if ( !f ) return ( false );
+  fprintf(f, "i,t_ms,T_rot,a,b,c,T_acc,x,y,z\n");
+  const uint8_t *p = obj.data() + sizeof(h);
+  const uint8_t *end = p + h.len;
+  StoreSample s;
+  memset(&s, 0, sizeof(s));
+  s.t_ms = h.t_ms;
+  bool ok = true;
+  for ( uint16_t k=0; k<h.n && ok; k++ )
+  {
+    if ( h.flags & STORE_PLAIN )
+    {
+      ok = p + sizeof(s) <= end;
+      if ( ok ) memcpy(&s, p, sizeof(s));
+      p += sizeof(s);
+    }
+    else ok = store_decode(&s, &p, end);
+    if ( !ok ) break;
+    fprintf(f, "%u,%llu", k, (unsigned long long)s.t_ms);
+    for ( int c=0; c<STORE_CHANNELS; c++ ) fprintf(f, ",%d", s.v[c]);
+    fprintf(f, "\n");
+  }
+  fclose(f);
+  return ( ok );
+}
+
+int main(int argc, char **argv)
+{
+  if ( argc < 4 )
+  {
+    fprintf(stderr, "usage: %s <port> <ds<i>|dr[<i>]> <out.bin> [out.csv]\n", argv[0]);
+    return ( 2 );
+  }
+  int fd = open_port(argv[1]);
+  if ( fd < 0 )
+  {
+    fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+    return ( 1 );
+  }
+
+  std::vector<uint8_t> obj;
+  std::vector<uint8_t> frame;
+  uint8_t raw[LINK_FRAME_MAX];
+  int id = -1;
+  long size = -1;
+  unsigned long packets = 0, bad = 0, gaps = 0, resumes = 0, junk = 0;
+  double t0 = now_s();
+  double last = t0;
+  command(fd, argv[2]);
+
+  while ( size < 0 || long(obj.size()) < size )
+  {
+    uint8_t buf[256];
+    ssize_t got = read(fd, buf, sizeof(buf));
+    if ( got < 0 && errno != EINTR )
+    {
+      perror("read");
+      return ( 1 );
+    }
+
+    // Quiet link:  ask again from what we have
+    if ( got <= 0 )
+    {
+      if ( now_s() - last > 1.0 )
+      {
+        if ( now_s() - t0 > 60.0 )
+        {
+          fprintf(stderr, "timed out at %zu bytes\n", obj.size());
+          return ( 1 );
+        }
+        char cmd[24];
+        if ( id < 0 ) snprintf(cmd, sizeof(cmd), "%s", argv[2]);
+        else snprintf(cmd, sizeof(cmd), "dc%zu", obj.size());
+        command(fd, cmd);
+        resumes++;
+        last = now_s();
+      }
+      continue;
+    }
+
+    for ( ssize_t b=0; b<got; b++ )
+    {
+      if ( buf[b] )
+      {
+        if ( frame.size() < LINK_FRAME_MAX ) frame.push_back(buf[b]);
+        else junk++;  // echoed text or noise; the crc rejects what is left
+        continue;
+      }
+      if ( frame.empty() ) continue;  // back to back delimiters
+      uint16_t n = cobs_decode(frame.data(), uint16_t(frame.size()), raw);
+      frame.clear();
+      if ( n < sizeof(LinkHead) + 2 )
+      {
+        bad++;
+        continue;
+      }
+      uint16_t crc = uint16_t(raw[n-2]) | uint16_t(raw[n-1]) << 8;
+      if ( crc16_update(0xFFFF, raw, n - 2) != crc )
+      {
+        bad++;
+        continue;
+      }
+      LinkHead h;
+      memcpy(&h, raw, sizeof(h));
+      if ( h.type != LINK_DATA && h.type != LINK_END && h.type != LINK_ERR ) continue;  // telemetry sharing the port
+      if ( id >= 0 && h.id != id ) continue;  // left over from an earlier download
+      id = h.id;
+      packets++;
+      last = now_s();
+      if ( h.type == LINK_ERR )
+      {
+        fprintf(stderr, "source went away after %zu bytes\n", obj.size());
+        return ( 1 );
+      }
+      if ( h.type == LINK_END )
+      {
+        size = h.off;
+        if ( long(obj.size()) < size )
+        {
+          char cmd[24];
+          snprintf(cmd, sizeof(cmd), "dc%zu", obj.size());
+          command(fd, cmd);
+          resumes++;
+        }
+        continue;
+      }
+      if ( h.type != LINK_DATA ) continue;
+      uint16_t len = n - sizeof(LinkHead) - 2;
+      if ( h.off == obj.size() ) obj.insert(obj.end(), raw + sizeof(LinkHead), raw + sizeof(LinkHead) + len);
+      else if ( h.off > obj.size() ) gaps++;
+    }
+  }
+  double dt = now_s() - t0;
+
+  if ( !record_ok(obj) )
+  {
+    fprintf(stderr, "record crc failed\n");
+    return ( 1 );
+  }
+  FILE *f = fopen(argv[3], "wb");
+  if ( !f || fwrite(obj.data(), 1, obj.size(), f) != obj.size() )
+  {
+    perror(argv[3]);
+    return ( 1 );
+  }
+  fclose(f);
+  StoreHeader h;
+  memcpy(&h, obj.data(), sizeof(h));
+  printf("%zu bytes, %u samples, severity %u in %.3f s (%.0f B/s); packets %lu bad %lu gaps %lu resumes %lu junk %lu\n",
+    obj.size(), h.n, h.severity, dt, obj.size() / dt, packets, bad, gaps, resumes, junk);
+  if ( argc > 4 && !write_csv(obj, argv[4]) )
+  {
+    fprintf(stderr, "%s: decode failed\n", argv[4]);
+    return ( 1 );
+  }
+  return ( 0 );
+}
@@ -0,0 +1,168 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Replays recorded sessions through the firmware trigger and log pipeline (CollCore, Sensors,
+// Data_st) built for the host against the stand-ins in hal/.  Input is telem_csv output with at least
+// the t_ms and a_raw..z_raw columns; repeated column headers are fine.  Each file gets its own
+// pipeline and writes <out_dir>/<name>.events.csv with a line per event the board would have logged.
+// Files run largest first, one whole file per task, spread over all cores.  -q sets quiet tuning
+// (QuietPars names, e.g. -q o_thr=10), as coll_sweep reports it.  The loop probes (Probe.h) are one
+// set for the program, so they are built out here; coll_bench times the stages.
+//
+// Build:  g++ -O2 -std=c++11 -pthread -DARDUINO=100 -DPROBES=0 -Ihal -I../Collision -o coll_replay coll_replay.cpp hal/hal.cpp
+//           ../Collision/{CollCore,CollDatum,Sensors,myFilters,Time,TxQueue}.cpp
+// Use:    coll_replay [-j threads] [-q name=value]... <out_dir> <session.csv>...
+
+#include "coll_decode.h"
+#include "coll_session.h"
+#include "CollCore.h"
+#include "CollPlan.h"
+#include <algorithm>
+#include <errno.h>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <vector>
+
+struct Session
+{
+  std::string path;
+  off_t size;
+  unsigned long rows;
+  unsigned long events;
+  unsigned long long span_ms;
+  boolean ok;
+};
+
+static std::mutex text_lock;  // Data_st construction prints to the shared Text ring
+
+static double now_s()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ( tv.tv_sec + tv.tv_usec * 1e-6 );
+}
+
+// One session through its own pipeline
+static void replay(Session *s, const QuietPars *Qp, const char *out_dir)
+{
+  std::vector<CollSample> in;
+  if ( !coll_load_session(s->path.c_str(), &in) )
+  {
+    fprintf(stderr, "%s: %s\n", s->path.c_str(), strerror(errno));
+    return;
+  }
+  std::string name = s->path.substr(s->path.find_last_of('/') + 1);
+  name = name.substr(0, name.find_last_of('.'));
+  std::string out_path = std::string(out_dir) + "/" + name + ".events.csv";
+  FILE *out = fopen(out_path.c_str(), "w");
+  if ( !out )
+  {
+    fprintf(stderr, "%s: %s\n", out_path.c_str(), strerror(errno));
+    return;
+  }
+  fprintf(out, "t_ms,n,severity,o_raw_max,g_raw_max,o_filt_max,g_filt_max\n");
+
+  Sensors *Sen = new Sensors(0ULL, double(NOM_DT), Qp);
+  std::vector<Datum_st> ram(NDATUM);  // Static on the board, one set per replay here
+  std::vector<Register_st> reg(NREG);
+  Data_st *L;
+  {
+    std::lock_guard<std::mutex> hold(text_lock);
+    L = new Data_st(ram.data(), NDATUM, NHOLD, reg.data(), NREG);
+  }
+  CollCore *Core = new CollCore(Sen, L);
+
+  for ( size_t k=0; k<in.size(); k++ )
+  {
+    if ( Core->step(k == 0, &in[k].imu, in[k].t_ms, in[k].t_ms, true) == CORE_STOPPED )
+    {
+      Register_st *R = L->reg(L->iRg());
+      fprintf(out, "%llu,%u,%u,%.4f,%.4f,%.4f,%.4f\n", R->t_ms, R->n, R->severity(),
+        R->o_raw_max, R->g_raw_max, R->o_filt_max, R->g_filt_max);
+      s->events++;
+    }
+  }
+  s->rows = in.size();
+  if ( s->rows ) s->span_ms = in.back().t_ms - in.front().t_ms;
+  s->ok = true;
+  fclose(out);
+  delete Core;
+  delete L;
+  delete Sen;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned threads = std::thread::hardware_concurrency();
+  QuietPars Qp;
+  Qp.nominal();
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-j") ) threads = atoi(argv[a + 1]);
+    else if ( strcmp(argv[a], "-q") || !coll_quiet_arg(argv[a + 1], &Qp) ) break;
+  }
+  if ( argc - a < 2 || argv[a][0] == '-' )
+  {
+    fprintf(stderr, "usage: %s [-j threads] [-q name=value]... <out_dir> <session.csv>...\n", argv[0]);
+    return ( 1 );
+  }
+  const char *out_dir = argv[a++];
+  mkdir(out_dir, 0777);
+
+  std::vector<Session> sessions;
+  for ( ; a<argc; a++ )
+  {
+    struct stat st;
+    if ( stat(argv[a], &st) )
+    {
+      fprintf(stderr, "%s: %s\n", argv[a], strerror(errno));
+      continue;
+    }
+    Session s = {argv[a], st.st_size, 0UL, 0UL, 0ULL, false};
+    sessions.push_back(s);
+  }
+  std::sort(sessions.begin(), sessions.end(), [](const Session &x, const Session &y) { return ( x.size > y.size ); });
+
+  double t = now_s();
+  coll_parallel(sessions.size(), threads, [&](size_t i) { replay(&sessions[i], &Qp, out_dir); });
+  t = now_s() - t;
+
+  unsigned long rows = 0UL, events = 0UL;
+  double span_s = 0.;
+  for ( auto &s : sessions )
+  {
+    if ( !s.ok ) continue;
+    printf("%s: %lu samples, %.1f s, %lu events\n", s.path.c_str(), s.rows, s.span_ms / 1000., s.events);
+    rows += s.rows;
+    events += s.events;
+    span_s += s.span_ms / 1000.;
+  }
+  fprintf(stderr, "%zu sessions, %lu samples, %lu events in %.3f s (%.0f samples/s, %.0fx real time)\n",
+    sessions.size(), rows, events, t, rows / max(t, 1e-9), span_s / max(t, 1e-9));
+  return ( 0 );
+}
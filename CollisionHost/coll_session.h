@@ -0,0 +1,115 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Recorded sessions for the host replay tools (coll_replay, coll_sweep):  telem_csv output read back
+// into IMU samples.  Needs t_ms and a_raw..z_raw among the columns; a repeated column header
+// starts a new column map.  Header only; the tools build against the hal/ stand-ins.
+
+#ifndef _COLL_SESSION_H
+#define _COLL_SESSION_H
+
+#include "constants.h"
+#include "Sensors.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+struct CollSample
+{
+  unsigned long long t_ms;
+  ImuSample imu;
+};
+
+#define COLL_SESSION_COLS 7
+static const char *const coll_session_cols[COLL_SESSION_COLS] = {"t_ms", "a_raw", "b_raw", "c_raw", "x_raw", "y_raw", "z_raw"};
+
+// Map header names to coll_session_cols positions.  False if any is missing.
+inline bool coll_session_head(char *line, int *at)
+{
+  for ( int k=0; k<COLL_SESSION_COLS; k++ ) at[k] = -1;
+  int c = 0;
+  for ( char *tok = strtok(line, ",\r\n"); tok; tok = strtok(NULL, ",\r\n"), c++ )
+    for ( int k=0; k<COLL_SESSION_COLS; k++ ) if ( !strcmp(tok, coll_session_cols[k]) ) at[k] = c;
+  for ( int k=0; k<COLL_SESSION_COLS; k++ ) if ( at[k] < 0 ) return ( false );
+  return ( true );
+}
+
+// One data row.  False if a column is missing.
+inline bool coll_session_row(const char *line, const int *at, CollSample *s)
+{
+  double v[COLL_SESSION_COLS];
+  int found = 0;
+  int c = 0;
+  for ( const char *p = line; found < COLL_SESSION_COLS; c++ )
+  {
+    for ( int k=0; k<COLL_SESSION_COLS; k++ ) if ( at[k] == c ) { v[k] = strtod(p, NULL); found++; }
+    p = strchr(p, ',');
+    if ( !p ) break;
+    p++;
+  }
+  if ( found < COLL_SESSION_COLS ) return ( false );
+  s->t_ms = (unsigned long long)v[0];
+  ImuSample imu = {true, float(v[4]), float(v[5]), float(v[6]), true, float(v[1]), float(v[2]), float(v[3])};
+  s->imu = imu;
+  return ( true );
+}
+
+// Whole session into out.  False if the file can't be read.
+inline bool coll_load_session(const char *path, std::vector<CollSample> *out)
+{
+  FILE *in = fopen(path, "r");
+  if ( !in ) return ( false );
+  out->clear();
+  char line[1024];
+  int at[COLL_SESSION_COLS];
+  bool have_head = false;
+  while ( fgets(line, sizeof(line), in) )
+  {
+    if ( line[0] < '0' || line[0] > '9' )
+    {
+      have_head = coll_session_head(line, at);
+      continue;
+    }
+    CollSample s;
+    if ( have_head && coll_session_row(line, at, &s) ) out->push_back(s);
+  }
+  fclose(in);
+  return ( true );
+}
+
+// "name=value" onto P, as -q takes it.  False if the name is unknown or the value not positive.
+inline bool coll_quiet_arg(const char *arg, QuietPars *P)
+{
+  const char *eq = strchr(arg, '=');
+  if ( !eq ) return ( false );
+  std::string name(arg, eq - arg);
+  float *par = P->par(name.c_str());
+  float v = strtof(eq + 1, NULL);
+  if ( !par || !( v > 0. ) ) return ( false );
+  *par = v;
+  return ( true );
+}
+
+#endif
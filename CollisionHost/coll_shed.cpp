@@ -0,0 +1,167 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Sample cadence under slow output, with and without load shedding (Collision/LoadShed.h).  A model
+// of loop() runs on a virtual clock:  the firmware Syncs schedule the read frame, plots and blinking
+// and LoadShed decides what runs, as on the board, while each stage costs what -c gives it.  Slow
+// sinks are injected as costs:  a plot to a slow serial plotter, telemetry each read, and every -e s a
+// download whose packets make each pass slow for a while.  Commands and the Tx drain run every pass,
+// as the loop never sheds them.  Output is CSV, a row with shedding off and one with it on; the
+// headline on stderr is late frames and the worst gap either way.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -Ihal -I../Collision -o coll_shed coll_shed.cpp hal/hal.cpp
+//           ../Collision/{LoadShed,Sync,TxQueue}.cpp
+// Use:    coll_shed [-s seconds] [-e dump_every_s] [-c name=us]...
+
+#include "LoadShed.h"
+#include "Sync.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct Cost
+{
+  const char *name;
+  double us;
+  const char *what;
+};
+static Cost costs[] = {
+  {"read", 400., "read frame: sample, filter, quiet, put_ram, flash"},
+  {"telem", 60., "a telemetry frame, each read"},
+  {"plot", 12000., "one plot line to a slow serial plotter"},
+  {"chitchat", 40., "commands and Tx drain, a pass"},
+  {"dump", 3000., "a download or trace dump packet, a pass while one runs"},
+  {"dump_ms", 400., "how long the download runs"},
+  {"blink", 10., "LED"},
+  {"pass", 20., "the rest of a pass"},
+};
+#define N_COSTS ( sizeof(costs) / sizeof(costs[0]) )
+
+static double cost(const char *name)
+{
+  for ( size_t k=0; k<N_COSTS; k++ ) if ( !strcmp(costs[k].name, name) ) return ( costs[k].us );
+  return ( 0. );
+}
+
+struct Run
+{
+  unsigned long frames;
+  unsigned long late;
+  double gap_sum_ms;
+  double gap_max_ms;
+  unsigned long plots;
+  LoadShed Load;
+};
+
+// The loop for seconds, shedding or only counting
+static void run(const double seconds, const double dump_every_s, const boolean shedding, Run *R)
+{
+  Sync ReadSensors(READ_DELAY);
+  Sync Plotting(PLOT_DELAY);
+  Sync BlinkSync(BLINK_DELAY);
+  double now_us = 0.;
+  double last_read_us = -1.;
+  double dump_until_us = -1.;
+  double next_dump_us = dump_every_s * 1e6;
+  boolean reset = true;
+  while ( now_us < seconds * 1e6 )
+  {
+    unsigned long long now_ms = (unsigned long long)( now_us / 1000. );
+    boolean read = ReadSensors.update(now_ms, reset);
+    boolean publishing = Plotting.update(now_ms, reset);
+    boolean blink = BlinkSync.update(now_ms, reset);
+    if ( read )
+    {
+      if ( last_read_us >= 0. )
+      {
+        double gap_ms = ( now_us - last_read_us ) / 1000.;
+        R->frames++;
+        R->gap_sum_ms += gap_ms;
+        R->gap_max_ms = max(R->gap_max_ms, gap_ms);
+        if ( gap_ms * 1000. > READ_DELAY*1000. + OVERRUN_US ) R->late++;
+      }
+      last_read_us = now_us;
+      R->Load.frame((unsigned long long)( now_us ), !reset);
+      now_us += cost("read");
+      if ( !shedding || R->Load.allow(SHED_DUMP) ) now_us += cost("telem");
+      if ( dump_every_s > 0. && now_us >= next_dump_us )
+      {
+        dump_until_us = now_us + cost("dump_ms") * 1000.;
+        next_dump_us += dump_every_s * 1e6;
+      }
+    }
+    if ( publishing && ( !shedding || R->Load.allow(SHED_PLOT) ) )
+    {
+      now_us += cost("plot");
+      R->plots++;
+    }
+    if ( blink && ( !shedding || R->Load.allow(SHED_BLINK) ) ) now_us += cost("blink");
+    now_us += cost("chitchat");
+    if ( now_us < dump_until_us && ( !shedding || R->Load.allow(SHED_DUMP) ) ) now_us += cost("dump");
+    now_us += cost("pass");
+    reset = false;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  double seconds = 60.;
+  double dump_every_s = 5.;
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-s") ) seconds = atof(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-e") ) dump_every_s = atof(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-c") )
+    {
+      const char *eq = strchr(argv[a + 1], '=');
+      size_t k = 0;
+      for ( ; eq && k<N_COSTS; k++ ) if ( !strncmp(costs[k].name, argv[a + 1], eq - argv[a + 1]) && !costs[k].name[eq - argv[a + 1]] ) break;
+      if ( !eq || k == N_COSTS ) break;
+      costs[k].us = atof(eq + 1);
+    }
+    else break;
+  }
+  if ( a < argc || seconds <= 0. )
+  {
+    fprintf(stderr, "usage: %s [-s seconds] [-e dump_every_s] [-c name=us]...\n", argv[0]);
+    for ( size_t k=0; k<N_COSTS; k++ ) fprintf(stderr, "  %-8s %8.0f  %s\n", costs[k].name, costs[k].us, costs[k].what);
+    return ( 1 );
+  }
+
+  Run off = Run();
+  Run on = Run();
+  run(seconds, dump_every_s, false, &off);
+  run(seconds, dump_every_s, true, &on);
+  printf("shedding,frames,late,gap_mean_ms,gap_max_ms,plots,overruns,plot_shed,dump_shed,blink_shed\n");
+  Run *runs[2] = {&off, &on};
+  for ( int k=0; k<2; k++ )
+  {
+    Run *R = runs[k];
+    printf("%s,%lu,%lu,%.3f,%.3f,%lu,%u,%u,%u,%u\n", k ? "on" : "off", R->frames, R->late, R->frames ? R->gap_sum_ms / R->frames : 0.,
+      R->gap_max_ms, R->plots, R->Load.overruns(), R->Load.shed(SHED_PLOT), R->Load.shed(SHED_DUMP), R->Load.shed(SHED_BLINK));
+  }
+  fprintf(stderr, "late frames %lu of %lu without shedding, %lu of %lu with; worst gap %.1f ms vs %.1f ms (READ_DELAY %lu ms)\n",
+    off.late, off.frames, on.late, on.frames, off.gap_max_ms, on.gap_max_ms, READ_DELAY);
+  return ( 0 );
+}
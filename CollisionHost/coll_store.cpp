@@ -0,0 +1,432 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+// The collision log (CollStore) on the NVM controller model (hal/sam.h), with power cut partway
+// through its writes.  Events of random length and severity are committed one at a time and the
+// loop's flash steps run until the store is idle.  Every -c events power fails at a random NVM
+// command of the next commit, landing in the record and in the index journal by turns.  Power comes
+// back, a new store boots off the image and is checked:  every listed record reads back with a good
+// crc and the samples committed, a record written in full before the cut is listed, nothing listed
+// before the cut is lost but what was reclaimed for the new record, and the next commit is listed.
+// Every -k events the index is damaged instead, by turns a byte of the last whole table, a byte of
+// the last delta, all of it erased, all of it garbage, and a byte of a listed record:  boot must
+// still list every record that checks out and only those.  At the end erases per row give the wear
+// of the log and of the index, and neither may wear a row much past the log's mean; boots off the
+// final image are timed from the index and by scan.  Output is CSV, a row a region; the headline on
+// stderr counts cuts and recoveries.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -DPROBES=0 -Ihal -I../Collision -o coll_store coll_store.cpp hal/hal.cpp hal/nvm.cpp
+//           ../Collision/{CollDatum,CollStore,FlashStorage,FlashWriter,Sensors,myFilters,Time,TxQueue}.cpp
+// Use:    coll_store [-n events] [-c cut_every] [-k damage_every] [-r seed]
+
+#include "CollPlan.h"
+#include "CollStore.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <vector>
+
+#define T0_MS   1704067200000ULL  // First event, 1/1/2024
+#define GAP_MS          60000ULL  // Between events
+#define BOOTS                 200  // Timed boots each way
+
+enum Damage { WHOLE, DELTA, ERASED, GARBAGE, RECORD, DAMAGES };
+static const char *damage_names[DAMAGES] = {"whole", "delta", "erased", "garbage", "record"};
+
+static uint32_t rnd_ = 1;
+static uint32_t rnd() { rnd_ = rnd_ * 1103515245UL + 12345UL; return ( rnd_ >> 8 ); }
+
+static Datum_st ram[NDATUM];
+static Register_st reg[NREG];
+
+// Event id:  its samples, a random walk seeded by id, and its register
+static void samples(const uint32_t id, const uint16_t n, std::vector<StoreSample> *out)
+{
+  uint32_t r = id * 2654435761UL + 1;
+  StoreSample s;
+  memset(&s, 0, sizeof(s));
+  out->clear();
+  for ( uint16_t k=0; k<n; k++ )
+  {
+    s.t_ms = T0_MS + id * GAP_MS + k * READ_DELAY;
+    for ( uint8_t c=0; c<STORE_CHANNELS; c++ )
+    {
+      r = r * 1103515245UL + 12345UL;
+      s.v[c] = int16_t( s.v[c] + int16_t( ( r >> 16 ) % 257 ) - 128 );
+    }
+    out->push_back(s);
+  }
+}
+
+static uint16_t length(const uint32_t id) { return ( uint16_t( 50 + ( id * 40503UL ) % min(250, NDATUM - 50) ) ); }
+
+static void make_event(const uint32_t id, Data_st *L)
+{
+  std::vector<StoreSample> S;
+  uint16_t n = length(id);
+  samples(id, n, &S);
+  uint16_t i = uint16_t(rnd() % NDATUM);
+  for ( uint16_t k=0; k<n; k++ )
+  {
+    Datum_st *D = L->datum(( i + k ) % NDATUM);
+    D->t_ms = S[k].t_ms;
+    D->T_rot_int = S[k].v[0];
+    D->a_int = S[k].v[1];
+    D->b_int = S[k].v[2];
+    D->c_int = S[k].v[3];
+    D->T_acc_int = S[k].v[4];
+    D->x_int = S[k].v[5];
+    D->y_int = S[k].v[6];
+    D->z_int = S[k].v[7];
+  }
+  Register_st *R = L->reg(0);
+  R->put_nominal();
+  R->i = i;
+  R->n = n;
+  R->t_ms = T0_MS + id * GAP_MS;
+  R->g_raw_max = G_MAX * ( rnd() % 1000 ) / 1000.;
+  R->o_raw_max = W_MAX * ( rnd() % 1000 ) / 2000.;
+}
+
+// Record at off has its trailer and a good crc, as CollStore::valid
+static boolean crc_ok(const uint8_t *base, const uint32_t off)
+{
+  const StoreHeader *h = (const StoreHeader *)(base + off);
+  if ( h->magic != STORE_MAGIC || h->version != STORE_VERSION || off + store_bytes(h->len) > STORE_BYTES ) return ( false );
+  uint32_t trailer;
+  memcpy(&trailer, base + off + sizeof(StoreHeader) + h->len, sizeof(trailer));
+  if ( trailer != h->seq ) return ( false );
+  StoreHeader copy = *h;
+  copy.crc = 0;
+  uint16_t crc = crc16_update(0xFFFF, h + 1, h->len);
+  return ( crc16_update(crc, &copy, sizeof(copy)) == h->crc );
+}
+
+// Every listed record checks out and holds the samples committed; the table is sorted worst first
+static const char *check_listed(CollStore *S)
+{
+  std::vector<StoreSample> want;
+  for ( uint8_t i=0; i<S->count(); i++ )
+  {
+    IndexEntry *e = S->entry(i);
+    if ( i && e->severity > S->entry(i-1)->severity ) return ( "table out of order" );
+    uint32_t bytes;
+    const StoreHeader *h = (const StoreHeader *)S->record(i, &bytes);
+    if ( !crc_ok(Nvm.flash(), e->off) ) return ( "listed record fails crc" );
+    if ( h->seq != e->seq || h->t_ms != e->t_ms || h->n != e->n || h->severity != e->severity ) return ( "entry does not match its record" );
+    uint32_t id = uint32_t( ( h->t_ms - T0_MS ) / GAP_MS );
+    if ( h->n != length(id) ) return ( "record has the wrong length" );
+    samples(id, h->n, &want);
+    StoreSample s;
+    memset(&s, 0, sizeof(s));
+    s.t_ms = h->t_ms;
+    const uint8_t *p = (const uint8_t *)(h + 1);
+    for ( uint16_t k=0; k<h->n; k++ )
+      if ( !store_decode(&s, &p, (const uint8_t *)(h + 1) + h->len) || memcmp(&s, &want[k], sizeof(s)) )
+        return ( "record samples differ from the commit" );
+  }
+  return ( NULL );
+}
+
+static int find(CollStore *S, const IndexEntry &e)
+{
+  for ( uint8_t i=0; i<S->count(); i++ ) if ( S->entry(i)->seq == e.seq && S->entry(i)->t_ms == e.t_ms ) return ( i );
+  return ( -1 );
+}
+
+// Flash an event's record takes, padded to a page
+static uint32_t record_bytes(const uint32_t id)
+{
+  std::vector<StoreSample> S;
+  samples(id, length(id), &S);
+  StoreSample prev;
+  memset(&prev, 0, sizeof(prev));
+  prev.t_ms = S[0].t_ms;
+  uint8_t tmp[STORE_SAMPLE_MAX];
+  uint32_t len = 0;
+  for ( size_t k=0; k<S.size(); k++ ) len += store_encode(&prev, &S[k], tmp);
+  return ( ( store_bytes(uint16_t(len)) + HOST_NVM_PAGE - 1 ) / HOST_NVM_PAGE * HOST_NVM_PAGE );
+}
+
+// After a cut, what was listed before it is still listed, except records in the room reclaimed for
+// the one being written and, with the table full, the oldest unpinned.  A pinned record goes only to
+// a more severe one.
+static const char *check_kept(CollStore *S, const std::vector<IndexEntry> &before, const uint32_t id, const uint16_t severity)
+{
+  std::vector<IndexEntry> lost;
+  for ( size_t i=0; i<before.size(); i++ )
+  {
+    if ( find(S, before[i]) >= 0 ) continue;
+    if ( i < STORE_KEEP && severity <= before[i].severity ) return ( "pinned record lost" );
+    lost.push_back(before[i]);
+  }
+  uint32_t room = ( record_bytes(id) + HOST_NVM_ROW - 1 ) / HOST_NVM_ROW * HOST_NVM_ROW + HOST_NVM_ROW;
+  for ( int evict=( S->count() >= STORE_MAX_RECORDS ); ; evict-- )
+  {
+    uint32_t off_max = 0, end_min = 0xFFFFFFFF;
+    for ( size_t i=0; i<lost.size(); i++ )
+    {
+      off_max = max(off_max, lost[i].off);
+      end_min = min(end_min, lost[i].off + record_bytes(uint32_t( ( lost[i].t_ms - T0_MS ) / GAP_MS )));
+    }
+    if ( lost.empty() || off_max < end_min + room ) break;
+    if ( evict <= 0 ) return ( "record lost outside the room reclaimed" );
+    size_t oldest = 0;
+    for ( size_t i=0; i<lost.size(); i++ ) if ( lost[i].seq < lost[oldest].seq ) oldest = i;
+    lost.erase(lost.begin() + oldest);
+  }
+  if ( !before.empty() )
+  {
+    size_t newest = 0;
+    for ( size_t i=0; i<before.size(); i++ ) if ( before[i].seq > before[newest].seq ) newest = i;
+    if ( find(S, before[newest]) < 0 ) return ( "newest record lost" );
+  }
+  return ( NULL );
+}
+
+// After damage, every record listed before that still checks out is listed
+static const char *check_all(CollStore *S, const std::vector<IndexEntry> &before)
+{
+  for ( size_t i=0; i<before.size(); i++ )
+  {
+    const StoreHeader *h = (const StoreHeader *)(Nvm.flash() + before[i].off);
+    boolean good = crc_ok(Nvm.flash(), before[i].off) && h->seq == before[i].seq && h->t_ms == before[i].t_ms;
+    if ( good && find(S, before[i]) < 0 ) return ( "record that checks out lost after damage" );
+    if ( !good && find(S, before[i]) >= 0 ) return ( "damaged record listed" );
+  }
+  return ( NULL );
+}
+
+// Newest index item, whole table or delta, by its header alone
+static int32_t newest(const boolean whole)
+{
+  int32_t best = -1;
+  for ( uint32_t p=0; p<INDEX_BYTES; p+=HOST_NVM_PAGE )
+  {
+    const IndexHeader *h = (const IndexHeader *)(Nvm.flash() + STORE_BYTES + p);
+    if ( h->magic != INDEX_MAGIC || h->version != INDEX_VERSION || ( ( h->flags & INDEX_WHOLE ) != 0 ) != whole ) continue;
+    if ( best < 0 || h->gen > ((const IndexHeader *)(Nvm.flash() + STORE_BYTES + best))->gen ) best = p;
+  }
+  return ( best );
+}
+
+static void damage(const int kind, CollStore *S)
+{
+  int32_t at;
+  switch ( kind )
+  {
+    case WHOLE:
+    case DELTA:
+      at = newest(kind == WHOLE);
+      if ( at >= 0 ) Nvm.poke(STORE_BYTES + at + sizeof(IndexHeader), Nvm.flash()[STORE_BYTES + at + sizeof(IndexHeader)] ^ 0x5A);
+      break;
+    case ERASED:
+    case GARBAGE:
+      for ( uint32_t k=0; k<INDEX_BYTES; k++ ) Nvm.poke(STORE_BYTES + k, kind == ERASED ? 0xFF : uint8_t(rnd()));
+      break;
+    case RECORD:
+      if ( S->count() )
+      {
+        const IndexEntry *e = S->entry(rnd() % S->count());
+        uint32_t k = e->off + sizeof(StoreHeader) + ((const StoreHeader *)(Nvm.flash() + e->off))->len / 2;
+        Nvm.poke(k, Nvm.flash()[k] ^ 0x5A);
+      }
+      break;
+  }
+}
+
+// Power cycle and boot a new store off the image
+static void reboot(CollStore **S, FlashWriter **W, FlashClass *Log, FlashClass *Index)
+{
+  Nvm.power_cycle();
+  delete *S;
+  delete *W;
+  *W = new FlashWriter;
+  *S = new CollStore(Log, Index, *W);
+  (*S)->begin();
+}
+
+// Host time of a boot off the image, us
+static double boot_us(FlashClass *Log, FlashClass *Index, uint8_t *listed)
+{
+  FlashWriter W;
+  struct timeval t0, t1;
+  gettimeofday(&t0, NULL);
+  for ( int k=0; k<BOOTS; k++ )
+  {
+    CollStore S(Log, Index, &W);
+    S.begin();
+    *listed = S.count();
+  }
+  gettimeofday(&t1, NULL);
+  return ( ( ( t1.tv_sec - t0.tv_sec ) * 1e6 + ( t1.tv_usec - t0.tv_usec ) ) / BOOTS );
+}
+
+struct Wear
+{
+  uint32_t min;
+  uint32_t max;
+  double mean;
+};
+
+static Wear wear(const uint32_t from, const uint32_t to)
+{
+  Wear W = {0xFFFFFFFF, 0, 0.};
+  for ( uint32_t r=from/HOST_NVM_ROW; r<to/HOST_NVM_ROW; r++ )
+  {
+    W.min = min(W.min, Nvm.erases(r));
+    W.max = max(W.max, Nvm.erases(r));
+    W.mean += Nvm.erases(r);
+  }
+  W.mean /= ( to - from ) / HOST_NVM_ROW;
+  return ( W );
+}
+
+// Loop passes until the store is idle or power fails
+static void settle(CollStore *S, FlashWriter *W)
+{
+  for ( uint32_t pass=0; ( S->busy() || W->busy() ) && !Nvm.dead() && pass<100000; pass++ )
+  {
+    S->run();
+    W->run(FLASH_BUDGET_US);
+    host_us += READ_DELAY * 1000UL;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long events = 3000, cut_every = 3, damage_every = 50;
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-n") ) events = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-c") ) cut_every = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-k") ) damage_every = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-r") ) rnd_ = atol(argv[a + 1]);
+    else break;
+  }
+  if ( a < argc || !events )
+  {
+    fprintf(stderr, "usage: %s [-n events] [-c cut_every] [-k damage_every] [-r seed]\n", argv[0]);
+    return ( 1 );
+  }
+
+  host_virtual = true;
+  Nvm.begin(STORE_BYTES + INDEX_BYTES);
+  FlashClass Log(Nvm.flash(), STORE_BYTES);
+  FlashClass Index(Nvm.flash() + STORE_BYTES, INDEX_BYTES);
+  Data_st *L = new Data_st(ram, NDATUM, NHOLD, reg, NREG);
+  FlashWriter *W = new FlashWriter;
+  CollStore *S = new CollStore(&Log, &Index, W);
+  S->begin();
+
+  const char *fail = NULL;
+  unsigned long cuts[2] = {0, 0}, listed_cut = 0, damages = 0;
+  uint32_t commands = 50, last_seq = 0;
+  boolean any = false;
+  std::vector<IndexEntry> before;
+  unsigned long e;
+  for ( e=0; e<events && !fail; e++ )
+  {
+    before.clear();
+    for ( uint8_t i=0; i<S->count(); i++ ) before.push_back(*S->entry(i));
+
+    // Damage to flash found at boot
+    if ( damage_every && e % damage_every == damage_every - 1 )
+    {
+      int kind = damages++ % DAMAGES;
+      damage(kind, S);
+      reboot(&S, &W, &Log, &Index);
+      fail = check_listed(S);
+      if ( !fail ) fail = check_all(S, before);
+      if ( fail ) fprintf(stderr, "after %s damage:  ", damage_names[kind]);
+      for ( uint8_t k=0; k<S->count(); k++ ) last_seq = max(last_seq, S->entry(k)->seq);
+      settle(S, W);
+      before.clear();
+      for ( uint8_t i=0; i<S->count(); i++ ) before.push_back(*S->entry(i));
+    }
+
+    make_event(e, L);
+    uint16_t severity = L->reg(0)->severity();
+    uint32_t from = Nvm.commands();
+    if ( cut_every && e % cut_every == cut_every - 1 )
+    {
+      if ( ( e / cut_every ) % 2 ) Nvm.cut(1 + rnd() % 4, STORE_BYTES, STORE_BYTES + INDEX_BYTES);
+      else Nvm.cut(1 + rnd() % commands, 0, STORE_BYTES);
+    }
+    if ( !fail && !S->commit(L, 0) ) fail = "commit refused";
+    settle(S, W);
+    if ( !Nvm.dead() )
+    {
+      commands = max(1U, Nvm.commands() - from);
+      int i = -1;
+      for ( uint8_t k=0; k<S->count(); k++ ) if ( S->entry(k)->t_ms == T0_MS + e * GAP_MS ) i = k;
+      if ( !fail && i < 0 ) fail = "commit not listed";
+      else if ( !fail && any && S->entry(i)->seq <= last_seq ) fail = "sequence went backward";
+      if ( i >= 0 ) last_seq = S->entry(i)->seq;
+      any = true;
+      if ( !fail ) fail = check_listed(S);
+      continue;
+    }
+
+    // Power fails, comes back and the store boots off what flash holds
+    cuts[Nvm.at() < STORE_BYTES ? 0 : 1]++;
+    reboot(&S, &W, &Log, &Index);
+    int listed = -1;
+    for ( uint8_t k=0; k<S->count(); k++ ) if ( S->entry(k)->t_ms == T0_MS + e * GAP_MS ) listed = k;
+    if ( listed >= 0 ) listed_cut++;
+    else
+      for ( uint32_t off=0; off<STORE_BYTES && !fail; off+=HOST_NVM_PAGE )
+        if ( ((const StoreHeader *)(Nvm.flash() + off))->t_ms == T0_MS + e * GAP_MS && crc_ok(Nvm.flash(), off) )
+          fail = "record written in full before the cut not listed";
+    if ( !fail ) fail = check_listed(S);
+    if ( !fail ) fail = check_kept(S, before, e, severity);
+    for ( uint8_t k=0; k<S->count(); k++ ) last_seq = max(last_seq, S->entry(k)->seq);
+    settle(S, W);  // index rewritten after a rebuild
+    if ( Nvm.dead() ) fail = "power failed with no cut";
+  }
+
+  // Boots off the final image, from the index and, with it erased, by scan
+  uint8_t from_index = 0, by_scan = 0;
+  double index_us = boot_us(&Log, &Index, &from_index);
+  std::vector<uint8_t> keep(Nvm.flash() + STORE_BYTES, Nvm.flash() + STORE_BYTES + INDEX_BYTES);
+  for ( uint32_t k=0; k<INDEX_BYTES; k++ ) Nvm.poke(STORE_BYTES + k, 0xFF);
+  double scan_us = boot_us(&Log, &Index, &by_scan);
+  for ( uint32_t k=0; k<INDEX_BYTES; k++ ) Nvm.poke(STORE_BYTES + k, keep[k]);
+  if ( !fail && from_index != by_scan ) fail = "boot from the index lists a different count than a scan";
+
+  Wear Wl = wear(0, STORE_BYTES), Wi = wear(STORE_BYTES, STORE_BYTES + INDEX_BYTES);
+  printf("region,rows,erases_min,erases_max,erases_mean,erases_per_event\n");
+  printf("log,%u,%u,%u,%.1f,%.3f\n", STORE_BYTES / HOST_NVM_ROW, Wl.min, Wl.max, Wl.mean, Wl.mean / e);
+  printf("index,%u,%u,%u,%.1f,%.3f\n", INDEX_BYTES / HOST_NVM_ROW, Wi.min, Wi.max, Wi.mean, Wi.mean / e);
+  if ( !fail && Wl.max > Wl.mean * 1.5 + 2 ) fail = "log wear uneven";
+  if ( !fail && Wi.max > Wl.mean * 1.5 + 2 ) fail = "index wears faster than the log";
+  fprintf(stderr, "%lu events, power cut %lu times in a record and %lu in the index, %lu cut events listed after boot, "
+    "%lu damaged indexes; log row erases %u to %u, index %u to %u; boot %.0f us from the index, %.0f us by scan, %u listed (host)%s%s\n",
+    e, cuts[0], cuts[1], listed_cut, damages, Wl.min, Wl.max, Wi.min, Wi.max, index_us, scan_us, from_index,
+    fail ? "; FAILED: " : "", fail ? fail : "");
+  return ( fail ? 1 : 0 );
+}
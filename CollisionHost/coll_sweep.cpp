@@ -0,0 +1,433 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Parameter sweep of the quiet detection tuning (QuietPars) over a labeled corpus of recorded
+// sessions.  Each parameter set runs the firmware detector on every session and is scored against
+// the labels:  hits, misses, false triggers and the latency from impact to trigger.  Output is CSV, a
+// row per set, with the best set on stderr in the -q form coll_replay takes.
+//
+// Sessions are telem_csv output.  Labels sit beside them as <name>.labels, one impact t_ms per line
+// ('#' comments); no labels file means no impacts.  A trigger within the window of an impact is a
+// hit, each impact taking the first; any other trigger is false.
+//
+// -p name=spec sets a parameter:  a value, a list 'a,b,c', or a range 'lo:hi:n'.  The grid is every
+// combination.  With -r N, N sets are drawn at random instead:  uniform over ranges, from lists as
+// given, so -r needs at least one -p with more than one value.  Names not given stay nominal.
+//
+// tau_q, wn_q and zeta_q shape the quiet filter outputs; the rest only act downstream of them.  So
+// sets are grouped on those three, the filters run once per group and session, and every set in the
+// group replays just the decisions from the saved outputs.  Random draws of the three come from the
+// n points of their range so groups are shared.  Tasks are (group, session) pairs, largest session
+// first, spread over all cores.
+//
+// -v 1 also runs every set through the whole CollCore::step pipeline, as the board does, and checks
+// that its trigger starts match the two-stage replay exactly.  Any difference fails the run.
+//
+// Build:  g++ -O2 -std=c++11 -pthread -DARDUINO=100 -DPROBES=0 -Ihal -I../Collision -o coll_sweep coll_sweep.cpp hal/hal.cpp
+//           ../Collision/{CollCore,CollDatum,Sensors,myFilters,Time,TxQueue}.cpp
+// Use:    coll_sweep [-j threads] [-w window_ms] [-r sets] [-s seed] [-v 1] [-p name=spec]... <session.csv>...
+
+#include "coll_decode.h"
+#include "coll_session.h"
+#include "CollCore.h"
+#include "CollPlan.h"
+#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <map>
+#include <mutex>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <vector>
+
+#define SWEEP_FILTER_PARS 3     // tau_q, wn_q, zeta_q:  the last three QuietPars fields
+
+struct Axis
+{
+  float lo, hi;                 // Range, when values came from lo:hi:n
+  bool range;
+  std::vector<float> values;
+};
+
+struct Session
+{
+  std::string path;
+  off_t size;
+  std::vector<CollSample> samples;
+  std::vector<unsigned long long> labels;
+};
+
+struct Score
+{
+  unsigned hits, misses, falses;
+  std::vector<long> latency_ms;
+};
+
+static std::mutex text_lock;  // Data_st construction prints to the shared Text ring
+
+// One saved quiet filter output
+struct QuietSample
+{
+  unsigned long long t_ms;
+  float o_quiet;
+  float g_quiet;
+};
+
+static double now_s()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ( tv.tv_sec + tv.tv_usec * 1e-6 );
+}
+
+static float *field(QuietPars *P, const int k)
+{
+  return ( P->par(quiet_par_names[k]) );
+}
+
+// name=spec onto axes.  False if malformed.
+static bool parse_axis(const char *arg, Axis *axes)
+{
+  const char *eq = strchr(arg, '=');
+  if ( !eq ) return ( false );
+  std::string name(arg, eq - arg);
+  int k = 0;
+  while ( k < QUIET_PARS && name != quiet_par_names[k] ) k++;
+  if ( k == QUIET_PARS ) return ( false );
+  Axis &A = axes[k];
+  A.values.clear();
+  A.range = false;
+  const char *spec = eq + 1;
+  if ( strchr(spec, ':') )
+  {
+    int n = 0;
+    if ( sscanf(spec, "%f:%f:%d", &A.lo, &A.hi, &n) != 3 || n < 1 || !( A.lo > 0. ) || A.hi < A.lo ) return ( false );
+    A.range = true;
+    for ( int i=0; i<n; i++ ) A.values.push_back(n == 1 ? A.lo : A.lo + ( A.hi - A.lo ) * i / ( n - 1 ));
+    return ( true );
+  }
+  for ( const char *p = spec; *p; )
+  {
+    char *end;
+    float v = strtof(p, &end);
+    if ( end == p || !( v > 0. ) ) return ( false );
+    A.values.push_back(v);
+    p = ( *end == ',' ) ? end + 1 : end;
+    if ( *end && *end != ',' ) return ( false );
+  }
+  return ( !A.values.empty() );
+}
+
+// Impact times for a session, sorted
+static void load_labels(Session *s)
+{
+  std::string path = s->path.substr(0, s->path.find_last_of('.')) + ".labels";
+  FILE *in = fopen(path.c_str(), "r");
+  if ( !in ) return;
+  char line[128];
+  while ( fgets(line, sizeof(line), in) )
+    if ( line[0] >= '0' && line[0] <= '9' ) s->labels.push_back(strtoull(line, NULL, 10));
+  fclose(in);
+  std::sort(s->labels.begin(), s->labels.end());
+}
+
+// Match triggers to impacts
+static void score(const std::vector<unsigned long long> &starts, const std::vector<unsigned long long> &labels,
+  const long window_ms, Score *S)
+{
+  std::vector<bool> used(starts.size(), false);
+  S->hits = S->misses = S->falses = 0;
+  S->latency_ms.clear();
+  for ( auto label : labels )
+  {
+    size_t j = 0;
+    while ( j < starts.size() && ( used[j] || long(starts[j] - label) < -window_ms ) ) j++;
+    if ( j < starts.size() && long(starts[j] - label) <= window_ms )
+    {
+      used[j] = true;
+      S->hits++;
+      S->latency_ms.push_back(long(starts[j] - label));
+    }
+    else S->misses++;
+  }
+  for ( size_t j=0; j<starts.size(); j++ ) if ( !used[j] ) S->falses++;
+}
+
+// Trigger starts from the whole pipeline, filters and decisions together as on the board
+static void full_starts(const QuietPars &P0, const Session &s, std::vector<unsigned long long> *starts)
+{
+  QuietPars Qp = P0;
+  Sensors *Sen = new Sensors(0ULL, double(NOM_DT), &Qp);
+  std::vector<Datum_st> ram(NDATUM);
+  std::vector<Register_st> reg(NREG);
+  Data_st *L;
+  {
+    std::lock_guard<std::mutex> hold(text_lock);
+    L = new Data_st(ram.data(), NDATUM, NHOLD, reg.data(), NREG);
+  }
+  CollCore *Core = new CollCore(Sen, L);
+  starts->clear();
+  for ( size_t k=0; k<s.samples.size(); k++ )
+    if ( Core->step(k == 0, &s.samples[k].imu, s.samples[k].t_ms, s.samples[k].t_ms, true) == CORE_STARTED )
+      starts->push_back(Core->new_event());
+  delete Core;
+  delete L;
+  delete Sen;
+}
+
+// Filters once for the group, then the decisions for each set in it
+static void run_task(const std::vector<QuietPars> &sets, const std::vector<size_t> &group, const Session &s,
+  const size_t n_sessions, const size_t i_session, const long window_ms, std::vector<Score> *scores,
+  std::atomic<unsigned> *differ)
+{
+  size_t n = s.samples.size();
+  std::vector<QuietSample> q(n);
+  QuietPars Qp = sets[group[0]];
+  Sensors *Up = new Sensors(0ULL, double(NOM_DT), &Qp);
+  for ( size_t k=0; k<n; k++ )
+  {
+    Up->take(k == 0, &s.samples[k].imu, s.samples[k].t_ms, s.samples[k].t_ms);
+    Up->filter(k == 0);
+    QuietSample Q = {s.samples[k].t_ms, Up->o_quiet, Up->g_quiet};
+    q[k] = Q;
+  }
+  delete Up;
+
+  QuietPars Dp = Qp;
+  Sensors *Down = new Sensors(0ULL, double(NOM_DT), &Dp);
+  const ImuSample both = {true, 0., 0., 0., true, 0., 0., 0.};  // only the sample times matter here
+  std::vector<unsigned long long> starts, full;
+  for ( auto i : group )
+  {
+    Dp = sets[i];
+    CollCore Core(Down, NULL);
+    starts.clear();
+    for ( size_t k=0; k<n; k++ )
+    {
+      Down->take(k == 0, &both, q[k].t_ms, q[k].t_ms);
+      Down->o_quiet = q[k].o_quiet;
+      Down->g_quiet = q[k].g_quiet;
+      Down->quiet_decisions(k == 0);
+      if ( Core.trigger(true) == CORE_STARTED ) starts.push_back(Core.new_event());
+    }
+    score(starts, s.labels, window_ms, &(*scores)[i * n_sessions + i_session]);
+    if ( differ )
+    {
+      full_starts(sets[i], s, &full);
+      if ( full != starts )
+      {
+        fprintf(stderr, "set %zu, %s:  %zu starts from step, %zu from the replay\n", i, s.path.c_str(), full.size(),
+          starts.size());
+        (*differ)++;
+      }
+    }
+  }
+  delete Down;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned threads = std::thread::hardware_concurrency();
+  long window_ms = 500;
+  unsigned n_random = 0;
+  unsigned seed = 1;
+  bool verify = false;
+  Axis axes[QUIET_PARS];
+  QuietPars nom;
+  nom.nominal();
+  for ( int k=0; k<QUIET_PARS; k++ )
+  {
+    axes[k].range = false;
+    axes[k].values.push_back(*field(&nom, k));
+  }
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-j") ) threads = atoi(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-w") ) window_ms = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-r") ) n_random = atoi(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-s") ) seed = atoi(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-v") ) verify = atoi(argv[a + 1]);
+    else if ( strcmp(argv[a], "-p") || !parse_axis(argv[a + 1], axes) )
+    {
+      fprintf(stderr, "bad option %s %s\n", argv[a], argv[a + 1]);
+      return ( 1 );
+    }
+  }
+  if ( a >= argc )
+  {
+    fprintf(stderr, "usage: %s [-j threads] [-w window_ms] [-r sets] [-s seed] [-v 1] [-p name=value|a,b,c|lo:hi:n]... <session.csv>...\n", argv[0]);
+    fprintf(stderr, "names:");
+    for ( int k=0; k<QUIET_PARS; k++ ) fprintf(stderr, " %s", quiet_par_names[k]);
+    fprintf(stderr, "\n");
+    return ( 1 );
+  }
+  size_t choices = 1;
+  for ( int k=0; k<QUIET_PARS; k++ ) choices *= axes[k].values.size();
+  if ( n_random && choices < 2 )
+  {
+    fprintf(stderr, "-r %u needs a -p range or list to draw from; every set would be the same\n", n_random);
+    return ( 1 );
+  }
+
+  // Parameter sets
+  std::vector<QuietPars> sets;
+  if ( n_random )
+  {
+    std::mt19937 rng(seed);
+    for ( unsigned i=0; i<n_random; i++ )
+    {
+      QuietPars P = nom;
+      for ( int k=0; k<QUIET_PARS; k++ )
+      {
+        Axis &A = axes[k];
+        bool filter_par = k >= QUIET_PARS - SWEEP_FILTER_PARS;
+        if ( A.range && !filter_par ) *field(&P, k) = std::uniform_real_distribution<float>(A.lo, A.hi)(rng);
+        else *field(&P, k) = A.values[std::uniform_int_distribution<size_t>(0, A.values.size() - 1)(rng)];
+      }
+      sets.push_back(P);
+    }
+  }
+  else
+  {
+    for ( size_t i=0; i<choices; i++ )
+    {
+      QuietPars P = nom;
+      size_t r = i;
+      for ( int k=QUIET_PARS-1; k>=0; k-- )
+      {
+        *field(&P, k) = axes[k].values[r % axes[k].values.size()];
+        r /= axes[k].values.size();
+      }
+      sets.push_back(P);
+    }
+  }
+
+  // Groups sharing the filter stage
+  std::map<std::vector<float>, std::vector<size_t>> by_filter;
+  for ( size_t i=0; i<sets.size(); i++ )
+    by_filter[std::vector<float>({sets[i].tau_q, sets[i].wn_q, sets[i].zeta_q})].push_back(i);
+  std::vector<std::vector<size_t>> groups;
+  for ( auto &g : by_filter ) groups.push_back(g.second);
+
+  // Corpus, largest first
+  std::vector<Session> sessions;
+  for ( ; a<argc; a++ )
+  {
+    struct stat st;
+    if ( stat(argv[a], &st) )
+    {
+      fprintf(stderr, "%s: %s\n", argv[a], strerror(errno));
+      continue;
+    }
+    Session s;
+    s.path = argv[a];
+    s.size = st.st_size;
+    sessions.push_back(s);
+  }
+  std::sort(sessions.begin(), sessions.end(), [](const Session &x, const Session &y) { return ( x.size > y.size ); });
+  double t = now_s();
+  coll_parallel(sessions.size(), threads, [&](size_t i) {
+    if ( !coll_load_session(sessions[i].path.c_str(), &sessions[i].samples) )
+      fprintf(stderr, "%s: %s\n", sessions[i].path.c_str(), strerror(errno));
+    load_labels(&sessions[i]);
+  });
+  double t_load = now_s() - t;
+  unsigned long long samples = 0ULL, labels = 0ULL;
+  for ( auto &s : sessions )
+  {
+    samples += s.samples.size();
+    labels += s.labels.size();
+  }
+
+  // Sweep
+  size_t n_tasks = groups.size() * sessions.size();
+  std::vector<Score> scores(sets.size() * sessions.size());
+  std::atomic<unsigned> differ(0);
+  t = now_s();
+  coll_parallel(n_tasks, threads, [&](size_t k) {
+    size_t i_session = k / groups.size();
+    run_task(sets, groups[k % groups.size()], sessions[i_session], sessions.size(), i_session, window_ms, &scores,
+      verify ? &differ : NULL);
+  });
+  double t_sweep = now_s() - t;
+
+  // Report
+  printf("set");
+  for ( int k=0; k<QUIET_PARS; k++ ) printf(",%s", quiet_par_names[k]);
+  printf(",hits,misses,false,latency_mean_ms,latency_p50_ms,latency_max_ms\n");
+  size_t best = 0;
+  unsigned best_bad = ~0U;
+  double best_lat = 0.;
+  for ( size_t i=0; i<sets.size(); i++ )
+  {
+    unsigned hits = 0, misses = 0, falses = 0;
+    std::vector<long> lat;
+    for ( size_t j=0; j<sessions.size(); j++ )
+    {
+      Score &S = scores[i * sessions.size() + j];
+      hits += S.hits;
+      misses += S.misses;
+      falses += S.falses;
+      lat.insert(lat.end(), S.latency_ms.begin(), S.latency_ms.end());
+    }
+    std::sort(lat.begin(), lat.end());
+    double mean = 0.;
+    for ( auto l : lat ) mean += l;
+    if ( !lat.empty() ) mean /= lat.size();
+    printf("%zu", i);
+    QuietPars P = sets[i];
+    for ( int k=0; k<QUIET_PARS; k++ ) printf(",%g", *field(&P, k));
+    if ( lat.empty() ) printf(",%u,%u,%u,,,\n", hits, misses, falses);
+    else printf(",%u,%u,%u,%.1f,%ld,%ld\n", hits, misses, falses, mean, lat[lat.size() / 2], lat.back());
+    if ( misses + falses < best_bad || ( misses + falses == best_bad && mean < best_lat ) )
+    {
+      best = i;
+      best_bad = misses + falses;
+      best_lat = mean;
+    }
+  }
+
+  double evaluated = double(samples) * sets.size();
+  fprintf(stderr, "%zu sessions, %llu samples, %llu impacts loaded in %.3f s\n", sessions.size(), samples, labels, t_load);
+  fprintf(stderr, "%zu sets in %zu filter groups, %zu tasks in %.3f s (%.3g set-samples/s)\n", sets.size(), groups.size(),
+    n_tasks, t_sweep, evaluated / max(t_sweep, 1e-9));
+  if ( !sets.empty() )
+  {
+    fprintf(stderr, "best: set %zu, %u misses + false,", best, best_bad);
+    QuietPars P = sets[best];
+    for ( int k=0; k<QUIET_PARS; k++ ) fprintf(stderr, " -q %s=%g", quiet_par_names[k], *field(&P, k));
+    fprintf(stderr, "\n");
+  }
+  if ( verify )
+  {
+    fprintf(stderr, "step vs replay:  %zu sets x %zu sessions, %u differ%s\n", sets.size(), sessions.size(),
+      differ.load(), differ ? "; FAILED" : "");
+    if ( differ ) return ( 1 );
+  }
+  return ( 0 );
+}
@@ -0,0 +1,293 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Civil date conversion before and after its constant time rewrite (Collision/Time.cpp).  The old
+// year and month walk is kept here verbatim, once on 32 bit seconds as it shipped and once widened
+// to 64 bit seconds so it reaches the end of 2225, as far as tmElements_t Year goes.  Every day from
+// 1 Jan 1970 to 31 Dec 2225 at several times of day goes through both, and they must agree:
+//   break32  breakTime against the old breakTime, 32 bit wrap and all
+//   make32   makeTime against the old makeTime, the same
+//   break64  breakTime64 against the widened old walk
+//   make64   makeTime64 against the widened old walk and the seconds the day started from
+//   makeday  makeTime64 for Day 1 to 31 in every month of every year, out of range days running on
+// Output is CSV, a row a check with cases, mismatches and the time per call each way; the first
+// mismatch goes to stderr, and the headline.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -Ihal -I../Collision -o coll_time coll_time.cpp hal/hal.cpp
+//           ../Collision/{Time,TxQueue}.cpp
+// Use:    coll_time
+
+#include <Arduino.h>
+#include "TimeLib.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define YEARS                  256      // 1970 through 2225
+#define FIRST_2024      1704067200LL    // 1 Jan 2024 00:00:00
+
+static const uint32_t day_secs[] = {0, 1, 3661, 43200, 86399};  // Times of day checked
+#define N_DAY_SECS ( sizeof(day_secs) / sizeof(day_secs[0]) )
+
+// The old conversions, verbatim but for the seconds type S:  uint32_t as shipped, uint64_t widened
+
+// leap year calculator expects year argument as years offset from 1970
+#define LEAP_YEAR(Y)     ( ((1970+(Y))>0) && !((1970+(Y))%4) && ( ((1970+(Y))%100) || !((1970+(Y))%400) ) )
+
+static  const uint8_t monthDays[]={31,28,31,30,31,30,31,31,30,31,30,31}; // API starts months from 1, this array starts from 0
+
+template <typename S>
+static void old_breakTime(S timeInput, tmElements_t &tm){
+  uint8_t year;
+  uint8_t month, monthLength;
+  S time;
+  S days;
+
+  time = (S)timeInput;
+  tm.Second = time % 60;
+  time /= 60; // now it is minutes
+  tm.Minute = time % 60;
+  time /= 60; // now it is hours
+  tm.Hour = time % 24;
+  time /= 24; // now it is days
+  tm.Wday = ((time + 4) % 7) + 1;  // Sunday is day 1
+
+  year = 0;
+  days = 0;
+  while((S)(days += (LEAP_YEAR(year) ? 366 : 365)) <= time) {
+    year++;
+  }
+  tm.Year = year; // year is offset from 1970
+
+  days -= LEAP_YEAR(year) ? 366 : 365;
+  time  -= days; // now it is days in this year, starting at 0
+
+  days=0;
+  month=0;
+  monthLength=0;
+  for (month=0; month<12; month++) {
+    if (month==1) { // february
+      if (LEAP_YEAR(year)) {
+        monthLength=29;
+      } else {
+        monthLength=28;
+      }
+    } else {
+      monthLength = monthDays[month];
+    }
+
+    if (time >= monthLength) {
+      time -= monthLength;
+    } else {
+        break;
+    }
+  }
+  tm.Month = month + 1;  // jan is month 1
+  tm.Day = time + 1;     // day of month
+}
+
+template <typename S>
+static S old_makeTime(const tmElements_t &tm){
+  int i;
+  S seconds;
+
+  // seconds from 1970 till 1 jan 00:00:00 of the given year
+  seconds= tm.Year*(SECS_PER_DAY * 365);
+  for (i = 0; i < tm.Year; i++) {
+    if (LEAP_YEAR(i)) {
+      seconds += SECS_PER_DAY;   // add extra days for leap years
+    }
+  }
+
+  // add days for this year, months start from 1
+  for (i = 1; i < tm.Month; i++) {
+    if ( (i == 2) && LEAP_YEAR(tm.Year)) {
+      seconds += SECS_PER_DAY * 29;
+    } else {
+      seconds += SECS_PER_DAY * monthDays[i-1];  //monthDay array starts from 0
+    }
+  }
+  seconds+= (tm.Day-1) * SECS_PER_DAY;
+  seconds+= tm.Hour * SECS_PER_HOUR;
+  seconds+= tm.Minute * SECS_PER_MIN;
+  seconds+= tm.Second;
+  return seconds;
+}
+
+static boolean same(const tmElements_t &a, const tmElements_t &b)
+{
+  return ( a.Second==b.Second && a.Minute==b.Minute && a.Hour==b.Hour && a.Wday==b.Wday && a.Day==b.Day &&
+    a.Month==b.Month && a.Year==b.Year );
+}
+
+static void show(const tmElements_t &tm, char *b, const size_t n)
+{
+  snprintf(b, n, "%04d-%02u-%02u %02u:%02u:%02u wday %u", tmYearToCalendar(tm.Year), tm.Month, tm.Day, tm.Hour,
+    tm.Minute, tm.Second, tm.Wday);
+}
+
+struct Result
+{
+  const char *name;
+  unsigned long cases;
+  unsigned long bad;
+  double old_ns;
+  double new_ns;
+};
+
+static double ns_since(const std::chrono::steady_clock::time_point t0, const size_t n)
+{
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+  return ( n ? ns / n : 0. );
+}
+
+static void first_bad(Result *R, const int64_t t, const char *was, const char *now)
+{
+  if ( !R->bad++ ) fprintf(stderr, "%s: t %lld old '%s' new '%s'\n", R->name, (long long)t, was, now);
+}
+
+// breakTime or breakTime64 each way over T
+static void check_break(Result *R, const std::vector<int64_t> &T, const boolean wide)
+{
+  std::vector<tmElements_t> was(T.size()), now(T.size());
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for ( size_t k=0; k<T.size(); k++ )
+  {
+    if ( wide ) old_breakTime<uint64_t>(uint64_t(T[k]), was[k]);
+    else old_breakTime<uint32_t>(uint32_t(T[k]), was[k]);
+  }
+  R->old_ns = ns_since(t0, T.size());
+  t0 = std::chrono::steady_clock::now();
+  for ( size_t k=0; k<T.size(); k++ )
+  {
+    if ( wide ) breakTime64(T[k], now[k]);
+    else breakTime(time_t(T[k]), now[k]);
+  }
+  R->new_ns = ns_since(t0, T.size());
+  R->cases = T.size();
+  for ( size_t k=0; k<T.size(); k++ )
+  {
+    if ( same(was[k], now[k]) ) continue;
+    char a[48], b[48];
+    show(was[k], a, sizeof(a));
+    show(now[k], b, sizeof(b));
+    first_bad(R, T[k], a, b);
+  }
+}
+
+// makeTime or makeTime64 each way over M; expect, when given, is what both must return
+static void check_make(Result *R, const std::vector<tmElements_t> &M, const boolean wide, const std::vector<int64_t> *expect)
+{
+  std::vector<int64_t> was(M.size()), now(M.size());
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for ( size_t k=0; k<M.size(); k++ )
+    was[k] = wide ? int64_t(old_makeTime<uint64_t>(M[k])) : int64_t(old_makeTime<uint32_t>(M[k]));
+  R->old_ns = ns_since(t0, M.size());
+  t0 = std::chrono::steady_clock::now();
+  for ( size_t k=0; k<M.size(); k++ )
+    now[k] = wide ? makeTime64(M[k]) : int64_t(uint32_t(makeTime(M[k])));
+  R->new_ns = ns_since(t0, M.size());
+  R->cases = M.size();
+  for ( size_t k=0; k<M.size(); k++ )
+  {
+    boolean ok = was[k] == now[k] && ( !expect || now[k] == (*expect)[k] );
+    if ( ok ) continue;
+    char a[48], b[48], c[48];
+    show(M[k], c, sizeof(c));
+    snprintf(a, sizeof(a), "%lld", (long long)was[k]);
+    snprintf(b, sizeof(b), "%lld", (long long)now[k]);
+    if ( !R->bad ) fprintf(stderr, "%s: %s expected %lld\n", R->name, c, expect ? (long long)(*expect)[k] : (long long)was[k]);
+    first_bad(R, expect ? (*expect)[k] : was[k], a, b);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  if ( argc > 1 )
+  {
+    fprintf(stderr, "usage: %s\n", argv[0]);
+    return ( 1 );
+  }
+
+  // Every day of the range at each time of day, and those broken with the widened old walk
+  int64_t days = 0;
+  tmElements_t tm;
+  for ( int y=0; y<YEARS; y++ ) days += LEAP_YEAR(y) ? 366 : 365;
+  std::vector<int64_t> T;
+  std::vector<tmElements_t> M;
+  for ( int64_t d=0; d<days; d++ )
+    for ( size_t s=0; s<N_DAY_SECS; s++ )
+    {
+      T.push_back(d * 86400 + day_secs[s]);
+      old_breakTime<uint64_t>(uint64_t(T.back()), tm);
+      M.push_back(tm);
+    }
+
+  // Day 1 to 31 of every month, valid or not
+  std::vector<tmElements_t> D;
+  std::vector<int64_t> D_t;
+  memset(&tm, 0, sizeof(tm));
+  tm.Hour = 12;
+  for ( int y=0; y<YEARS; y++ )
+    for ( int m=1; m<=12; m++ )
+      for ( int d=1; d<=31; d++ )
+      {
+        tm.Year = uint8_t(y);
+        tm.Month = uint8_t(m);
+        tm.Day = uint8_t(d);
+        D.push_back(tm);
+      }
+
+  // A year of 2024 at a minute and a second apart, for the time each way where the firmware runs
+  std::vector<int64_t> T24;
+  std::vector<tmElements_t> M24;
+  for ( int64_t t=FIRST_2024; t<FIRST_2024+366*86400LL; t+=61 )
+  {
+    T24.push_back(t);
+    breakTime64(t, tm);
+    M24.push_back(tm);
+  }
+
+  Result R[7] = {{"break32"}, {"make32"}, {"break64"}, {"make64"}, {"makeday"}, {"break2024"}, {"make2024"}};
+  check_break(&R[0], T, false);
+  check_make(&R[1], M, false, NULL);
+  check_break(&R[2], T, true);
+  check_make(&R[3], M, true, &T);
+  check_make(&R[4], D, true, NULL);
+  check_break(&R[5], T24, false);
+  check_make(&R[6], M24, false, NULL);
+
+  unsigned long cases = 0, bad = 0;
+  printf("check,cases,mismatches,old_ns,new_ns\n");
+  for ( int k=0; k<7; k++ )
+  {
+    printf("%s,%lu,%lu,%.1f,%.1f\n", R[k].name, R[k].cases, R[k].bad, R[k].old_ns, R[k].new_ns);
+    cases += R[k].cases;
+    bad += R[k].bad;
+  }
+  fprintf(stderr, "%lld days 1970 through %d, %lu cases, %lu mismatches; 2024 breakTime %.1f ns was %.1f, makeTime %.1f ns was %.1f%s\n",
+    (long long)days, tmYearToCalendar(YEARS - 1), cases, bad, R[5].new_ns, R[5].old_ns, R[6].new_ns, R[6].old_ns,
+    bad ? "; FAILED" : "");
+  return ( bad ? 1 : 0 );
+}
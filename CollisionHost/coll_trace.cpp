@@ -0,0 +1,286 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+
+// Host converter for the loop trace dump (Collision/Trace.h, 'tr' command on a TRACES 1 build) to
+// Chrome trace JSON, for chrome://tracing or ui.perfetto.dev.  Asks for the dump, splits the COBS
+// framed packets, checks their crc and writes the events of each dump in time order, placed by the
+// epoch the dump was stamped with.  Span ends whose start was already overwritten are dropped.  A
+// file, e.g. a saved capture, is converted as is.  -b measures what an event costs to record here,
+// with the firmware ring and the host clock, then dumps a made up loop through the same path.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -DTRACES=1 -Ihal -I../Collision -o coll_trace coll_trace.cpp hal/hal.cpp
+//           ../Collision/{Trace,TxQueue}.cpp
+// Use:    coll_trace /dev/ttyACM0 [seconds] > trace.json
+//         coll_trace -b events > trace.json
+
+#include "Trace.h"
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+#if !TRACES
+  #error "coll_trace needs the trace ring, TRACES 1"
+#endif
+
+static double now_s()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ( tv.tv_sec + tv.tv_usec * 1e-6 );
+}
+
+static int open_port(const char *path, bool *tty)
+{
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if ( fd < 0 ) fd = open(path, O_RDONLY);
+  if ( fd < 0 ) return ( -1 );
+  struct termios t;
+  *tty = tcgetattr(fd, &t) == 0;
+  if ( *tty )
+  {
+    cfmakeraw(&t);
+    cfsetspeed(&t, B115200);  // ignored by USB CDC
+    t.c_cc[VMIN] = 0;
+    t.c_cc[VTIME] = 1;        // 0.1 s read timeout
+    tcsetattr(fd, TCSANOW, &t);
+  }
+  return ( fd );
+}
+
+static void command(int fd, const char *cmd)
+{
+  char line[32];
+  int n = snprintf(line, sizeof(line), "%s\n", cmd);
+  if ( write(fd, line, n) != n ) perror("write");
+}
+
+// Frames in, JSON out
+struct Converter
+{
+  std::vector<uint8_t> frame;
+  TraceHead head;
+  bool have_head = false;
+  std::vector<TraceEvent> ev;
+  int expect = 0;           // seq of the next data frame
+  bool started = false;     // t0 set and an event written
+  long long t0_us = 0;      // Epoch us of the first event written
+  unsigned long dumps = 0, events = 0, orphans = 0, lost = 0, missing = 0, bad = 0, junk = 0;
+
+  void begin() { printf("{\"traceEvents\":[\n"); }
+
+  // The dump so far, in ring order, which is time order
+  void flush()
+  {
+    if ( !have_head ) return;
+    int open[TRACE_IDS] = {0};
+    for ( size_t k=0; k<ev.size(); k++ )
+    {
+      const TraceEvent *e = &ev[k];
+      if ( e->id >= TRACE_IDS ) { bad++; continue; }
+      if ( e->ph == 'B' ) open[e->id]++;
+      else if ( e->ph == 'E' && !open[e->id] ) { orphans++; continue; }
+      else if ( e->ph == 'E' ) open[e->id]--;
+      long long us = (long long)( head.t_ms ) * 1000LL + int32_t(e->us - head.us);
+      if ( !started ) t0_us = us;
+      const char *name = trace_names[e->id];
+      printf("%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":1,\"tid\":1", started ? ",\n" : "", name, e->ph, us - t0_us);
+      if ( e->ph == 'C' ) printf(",\"args\":{\"%s\":%d}}", name, e->value);
+      else if ( e->ph == 'i' ) printf(",\"s\":\"t\",\"args\":{\"value\":%d}}", e->value);
+      else printf(",\"args\":{\"value\":%d}}", e->value);
+      started = true;
+      events++;
+    }
+    missing += head.n - ev.size();
+    lost += head.lost;
+    dumps++;
+    have_head = false;
+    ev.clear();
+  }
+
+  void end()
+  {
+    flush();
+    printf("\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"t0_epoch_us\":\"%lld\",\"dumps\":%lu,\"lost\":%lu}}\n", t0_us, dumps, lost);
+  }
+
+  // One byte off the port; true when a whole dump is in
+  bool byte(const uint8_t b)
+  {
+    if ( b )
+    {
+      if ( frame.size() < TRACE_FRAME_MAX ) frame.push_back(b);
+      else junk++;  // echoed text or noise; the crc rejects what is left
+      return ( false );
+    }
+    if ( frame.empty() ) return ( false );  // back to back delimiters
+    uint8_t raw[TRACE_FRAME_MAX];
+    uint16_t n = cobs_decode(frame.data(), uint16_t(frame.size()), raw);
+    frame.clear();
+    if ( n < sizeof(TraceData) + 2 ) return ( false );  // text lines fall out here
+    uint16_t crc = uint16_t(raw[n-2]) | uint16_t(raw[n-1]) << 8;
+    if ( crc16_update(0xFFFF, raw, n - 2) != crc )
+    {
+      bad++;
+      return ( false );
+    }
+    n -= 2;
+    if ( raw[0] == TRACE_HEAD && n == sizeof(TraceHead) )
+    {
+      flush();
+      memcpy(&head, raw, sizeof(head));
+      have_head = true;
+      expect = 0;
+    }
+    else if ( raw[0] == TRACE_DATA && have_head )
+    {
+      TraceData d;
+      memcpy(&d, raw, sizeof(d));
+      if ( n != sizeof(TraceData) + d.n*sizeof(TraceEvent) || d.seq != expect )
+      {
+        bad++;
+        return ( false );
+      }
+      expect++;
+      for ( uint8_t k=0; k<d.n; k++ )
+      {
+        TraceEvent e;
+        memcpy(&e, raw + sizeof(TraceData) + k*sizeof(TraceEvent), sizeof(e));
+        ev.push_back(e);
+      }
+    }
+    return ( have_head && ev.size() >= head.n );
+  }
+};
+
+// Data drained on the host
+class Capture : public Print
+{
+public:
+  std::vector<uint8_t> bytes;
+  using Print::write;
+  size_t write(uint8_t c) { bytes.push_back(c); return ( 1 ); };
+};
+
+// Per event cost with the firmware ring and micros(), then a made up loop dumped and converted
+static int bench(const long n, Converter *C)
+{
+  typedef std::chrono::steady_clock clk;
+  volatile uint32_t sink = 0;
+  clk::time_point t0 = clk::now();
+  for ( long k=0; k<n; k++ ) sink += micros();
+  clk::time_point t1 = clk::now();
+  for ( long k=0; k<n; k++ ) TRACE_MARK(TRACE_STAMP, int16_t(k));
+  clk::time_point t2 = clk::now();
+  double clock_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+  double event_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / n;
+
+  Tracer.clear();
+  for ( int f=0; f<40; f++ )
+  {
+    TRACE_BEGIN(TRACE_READ);
+    TRACE_BEGIN(TRACE_SAMPLE);
+    TRACE_END(TRACE_SAMPLE, 0);
+    TRACE_BEGIN(TRACE_STEP);
+    TRACE_COUNT(TRACE_STAMP, int16_t(f * READ_DELAY % 1000));
+    TRACE_END(TRACE_STEP, 0);
+    TRACE_BEGIN(TRACE_FLASH);
+    TRACE_END(TRACE_FLASH, 0);
+    TRACE_END(TRACE_READ, 0);
+    uint32_t until = micros() + READ_DELAY * 100;  // a tenth of the frame, so the trace has some space in it
+    while ( micros() < until ) ;
+  }
+  Capture cap;
+  Tracer.dump(1000ULL * ARBITRARY_TIME);
+  while ( Tracer.dumping() )
+  {
+    Tracer.run();
+    Data.drain(&cap, TX_DATA_BYTES);
+  }
+  C->begin();
+  for ( size_t k=0; k<cap.bytes.size(); k++ ) C->byte(cap.bytes[k]);
+  C->end();
+  fprintf(stderr, "record %.1f ns an event on this host, %.1f ns of it micros(); %u bytes an event, %d in the ring (%u bytes); "
+    "dump of %lu events, %lu lost, %lu orphan ends, %zu bytes framed; TRACES 0 records nothing\n",
+    event_ns, clock_ns, unsigned(sizeof(TraceEvent)), TRACE_EVENTS, unsigned(TRACE_EVENTS * sizeof(TraceEvent)),
+    C->events, C->lost, C->orphans, cap.bytes.size());
+  return ( 0 );
+}
+
+int main(int argc, char **argv)
+{
+  long bench_n = 0;
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-b") ) bench_n = atol(argv[a + 1]);
+    else break;
+  }
+  Converter C;
+  if ( bench_n > 0 && a == argc ) return ( bench(bench_n, &C) );
+  if ( a >= argc || argv[a][0] == '-' )
+  {
+    fprintf(stderr, "usage: %s <port|capture> [seconds]\n       %s -b events\n", argv[0], argv[0]);
+    return ( 2 );
+  }
+  bool tty = false;
+  int fd = open_port(argv[a], &tty);
+  if ( fd < 0 )
+  {
+    fprintf(stderr, "%s: %s\n", argv[a], strerror(errno));
+    return ( 1 );
+  }
+  double seconds = a + 1 < argc ? atof(argv[a + 1]) : 10.;
+
+  unsigned long bytes = 0;
+  double t0 = now_s();
+  C.begin();
+  if ( tty ) command(fd, "tr");
+  bool done = false;
+  while ( !done && ( !tty || now_s() - t0 < seconds ) )
+  {
+    uint8_t buf[512];
+    ssize_t got = read(fd, buf, sizeof(buf));
+    if ( got < 0 && errno != EINTR )
+    {
+      perror("read");
+      return ( 1 );
+    }
+    if ( got == 0 && !tty ) break;  // end of capture
+    if ( got <= 0 ) continue;
+    bytes += got;
+    for ( ssize_t b=0; b<got; b++ ) if ( C.byte(buf[b]) && tty ) done = true;  // one dump off a port
+  }
+  C.end();
+  fprintf(stderr, "%lu dumps, %lu events from %lu bytes in %.3f s; lost %lu on the board, %lu missing, %lu orphan ends, bad %lu junk %lu\n",
+    C.dumps, C.events, bytes, now_s() - t0, C.lost, C.missing, C.orphans, C.bad, C.junk);
+  return ( 0 );
+}
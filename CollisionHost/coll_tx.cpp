@@ -0,0 +1,199 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Serial output sharing on a throttled port (Collision/TxQueue.h).  The firmware rings and jobs run
+// on a virtual clock, a loop pass a ms, with Serial taking -b bytes a pass as a slow USB host would.
+// Two runs:  'dump', a long unpaced dump on Data, and 'plot', a plot paced at PLOT_PACE_MS on Data.
+// In both a prompt is printed to Text every -t ms while the Data job runs and a listing job on Text
+// is queued behind it.  Every line out must be whole and in order for its ring, nothing may be
+// dropped, no prompt may wait more than -w ms and the listing must finish before the Data job ahead
+// of it.  Output is CSV, a row a run; the headline on stderr is the worst prompt wait and when the
+// listing finished.
+//
+// Build:  g++ -O2 -std=c++11 -DARDUINO=100 -Ihal -I../Collision -o coll_tx coll_tx.cpp hal/hal.cpp
+//           ../Collision/TxQueue.cpp
+// Use:    coll_tx [-b bytes_per_ms] [-t prompt_every_ms] [-w wait_ms] [-n dump_lines]
+
+#include "TxQueue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define PLOT_LINES             100      // Lines in the paced plot
+#define LIST_LINES              40      // Lines in the listing on Text
+#define LIST_WIDTH              60      // Listing line, bytes before the newline
+#define DUMP_WIDTH             120      // Dump and plot line, bytes before the newline
+#define PROMPT_WIDTH            16      // Prompt line, bytes before the newline
+#define PASS_MAX            600000      // Give up, passes
+
+// Line k of a stream:  its tag, k and filler to width, so a splice or a gap shows
+static std::string make(const char tag, const uint16_t k, const uint16_t width)
+{
+  char b[16];
+  snprintf(b, sizeof(b), "%c,%u,", tag, k);
+  std::string s(b);
+  while ( s.size() < width ) s += char( 'a' + ( k + s.size() ) % 26 );
+  return ( s );
+}
+
+struct Lines
+{
+  char tag;
+  uint16_t n;
+  uint16_t width;
+};
+
+// Tx line job for a stream
+static boolean lines_line(Print *out, const uint16_t k, void *ctx)
+{
+  Lines *L = (Lines *)ctx;
+  if ( k >= L->n ) return ( false );
+  out->println(make(L->tag, k, L->width).c_str());
+  return ( true );
+}
+
+struct Run
+{
+  const char *name;
+  unsigned long passes;
+  unsigned long data_done_ms;
+  unsigned long list_done_ms;
+  unsigned long prompts;
+  unsigned long wait_max_ms;
+  double wait_sum_ms;
+  uint32_t dropped;
+  const char *fail;
+};
+
+// One run:  the Data job, the listing behind it and prompts until the Data job is out
+static void run(Run *R, Lines *D, const uint16_t pace_ms, const int bytes, const unsigned long prompt_ms)
+{
+  Lines List = {'L', LIST_LINES, LIST_WIDTH};
+  std::vector<unsigned long> printed;
+  uint16_t next[256] = {0};
+  uint32_t dropped0 = Data.dropped() + Text.dropped() + Data.lines_dropped() + Text.lines_dropped();
+  size_t parsed = 0;
+  boolean data_done = false, list_done = false;
+  Serial.out.clear();
+  Tx.job(&Data, lines_line, D, pace_ms);
+  Tx.job(&Text, lines_line, &List);
+  unsigned long pass;
+  for ( pass=0; pass<PASS_MAX && !R->fail && ( Tx.busy() || !data_done ); pass++ )
+  {
+    host_us = pass * 1000ULL;
+    if ( !data_done && pass % prompt_ms == 0 )
+    {
+      Text.println(make('T', uint16_t(printed.size()), PROMPT_WIDTH).c_str());
+      printed.push_back(pass);
+    }
+    Serial.room = bytes;
+    Tx.run();
+
+    // Lines that came out whole this pass
+    size_t eol;
+    while ( !R->fail && ( eol = Serial.out.find('\n', parsed) ) != std::string::npos )
+    {
+      std::string line = Serial.out.substr(parsed, eol - parsed);
+      parsed = eol + 1;
+      if ( line.size() < 2 || line[line.size()-1] != '\r' ) R->fail = "line without its \\r\\n";
+      else line.erase(line.size() - 1);
+      uint8_t tag = uint8_t(line[0]);
+      uint16_t width = tag == D->tag ? D->width : ( tag == 'L' ? LIST_WIDTH : PROMPT_WIDTH );
+      if ( R->fail ) break;
+      if ( line != make(char(tag), next[tag], width) ) R->fail = "line spliced, out of order or missing";
+      else if ( tag == 'T' )
+      {
+        unsigned long wait = pass - printed[next[tag]];
+        R->wait_max_ms = max(R->wait_max_ms, wait);
+        R->wait_sum_ms += wait;
+        R->prompts++;
+      }
+      next[tag]++;
+      if ( tag == D->tag && next[tag] == D->n )
+      {
+        data_done = true;
+        R->data_done_ms = pass;
+      }
+      if ( tag == 'L' && next[tag] == LIST_LINES )
+      {
+        list_done = true;
+        R->list_done_ms = pass;
+      }
+    }
+  }
+  R->passes = pass;
+  R->dropped = Data.dropped() + Text.dropped() + Data.lines_dropped() + Text.lines_dropped() - dropped0;
+  if ( R->fail ) return;
+  if ( !data_done || !list_done ) R->fail = "output never finished";
+  else if ( next[uint8_t('T')] != printed.size() ) R->fail = "prompt lost";
+  else if ( R->dropped ) R->fail = "ring dropped output";
+  else if ( R->list_done_ms >= R->data_done_ms ) R->fail = "listing on Text waited on the Data job ahead of it";
+}
+
+int main(int argc, char *argv[])
+{
+  int bytes = 64;
+  unsigned long prompt_ms = 50, wait_ms = 50;
+  uint16_t dump_lines = 500;
+  int a = 1;
+  for ( ; a + 1 < argc && argv[a][0] == '-'; a += 2 )
+  {
+    if ( !strcmp(argv[a], "-b") ) bytes = atoi(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-t") ) prompt_ms = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-w") ) wait_ms = atol(argv[a + 1]);
+    else if ( !strcmp(argv[a], "-n") ) dump_lines = uint16_t(atoi(argv[a + 1]));
+    else break;
+  }
+  if ( a < argc || bytes <= 0 || !prompt_ms || !dump_lines )
+  {
+    fprintf(stderr, "usage: %s [-b bytes_per_ms] [-t prompt_every_ms] [-w wait_ms] [-n dump_lines]\n", argv[0]);
+    return ( 1 );
+  }
+
+  host_virtual = true;
+  Serial.open = true;
+  Lines Dump = {'D', dump_lines, DUMP_WIDTH};
+  Lines Plot = {'P', PLOT_LINES, DUMP_WIDTH};
+  Run runs[2] = {Run(), Run()};
+  runs[0].name = "dump";
+  runs[1].name = "plot";
+  run(&runs[0], &Dump, 0, bytes, prompt_ms);
+  run(&runs[1], &Plot, PLOT_PACE_MS, bytes, prompt_ms);
+
+  const char *fail = NULL;
+  printf("run,bytes_per_ms,passes,data_done_ms,list_done_ms,prompts,wait_mean_ms,wait_max_ms,dropped\n");
+  for ( int k=0; k<2; k++ )
+  {
+    Run *R = &runs[k];
+    printf("%s,%d,%lu,%lu,%lu,%lu,%.2f,%lu,%u\n", R->name, bytes, R->passes, R->data_done_ms, R->list_done_ms, R->prompts,
+      R->prompts ? R->wait_sum_ms / R->prompts : 0., R->wait_max_ms, R->dropped);
+    if ( !fail && R->fail ) fail = R->fail;
+    if ( !fail && R->wait_max_ms > wait_ms ) fail = "a prompt waited too long behind Data";
+  }
+  fprintf(stderr, "prompt wait worst %lu ms behind a dump, %lu ms behind a plot (limit %lu); listing out at %lu ms of %lu and %lu of %lu%s%s\n",
+    runs[0].wait_max_ms, runs[1].wait_max_ms, wait_ms, runs[0].list_done_ms, runs[0].data_done_ms, runs[1].list_done_ms,
+    runs[1].data_done_ms, fail ? "; FAILED: " : "", fail ? fail : "");
+  return ( fail ? 1 : 0 );
+}
@@ -0,0 +1,126 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Host stand-in for the Arduino core, just enough for the hardware free firmware sources (CollCore,
+// Sensors, myFilters, CollDatum, TxQueue, Time) to build on a PC.  Nothing here talks to hardware:
+// millis() is the replay clock, micros() the host's for timing, Serial is absent unless a tool opens
+// it as a throttled sink, and Print formats as the Arduino one does.  FlashStorage and FlashWriter
+// run on the NVM controller model in sam.h, on a virtual clock.
+
+#ifndef _HAL_ARDUINO_H
+#define _HAL_ARDUINO_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+typedef bool boolean;
+typedef uint8_t byte;
+#define DEC 10
+
+// Mixed argument types as the Arduino macros allow
+using std::min;
+using std::max;
+template <class A, class B> inline auto min(A a, B b) -> decltype( a<b ? a : b ) { return ( a<b ? a : b ); }
+template <class A, class B> inline auto max(A a, B b) -> decltype( a>b ? a : b ) { return ( a>b ? a : b ); }
+#define constrain(amt, low, high) ( (amt)<(low) ? (low) : ( (amt)>(high) ? (high) : (amt) ) )
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// Virtual clock, for models that account time themselves (sam.h).  While host_virtual is set
+// micros() and millis() read host_us instead of the host clock.
+extern boolean host_virtual;
+extern unsigned long long host_us;
+
+class String : public std::string
+{
+public:
+  String() {};
+  String(const char *s) : std::string(s) {};
+};
+
+class Print
+{
+public:
+  virtual ~Print() {};
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t n) { size_t k = 0; while ( n-- ) k += write(*buf++); return ( k ); };
+  size_t write(const char *s) { return ( write((const uint8_t *)s, strlen(s)) ); };
+  virtual int availableForWrite() { return ( 0 ); };
+  size_t print(const char *s) { return ( write(s) ); };
+  size_t print(const String &s) { return ( write(s.c_str()) ); };
+  size_t print(char c) { return ( write(uint8_t(c)) ); };
+  size_t print(int v, int base=DEC) { return ( number("%d", v) ); };
+  size_t print(unsigned int v, int base=DEC) { return ( number("%u", v) ); };
+  size_t print(long v, int base=DEC) { return ( number("%ld", v) ); };
+  size_t print(unsigned long v, int base=DEC) { return ( number("%lu", v) ); };
+  size_t print(long long v, int base=DEC) { return ( number("%lld", v) ); };
+  size_t print(unsigned long long v, int base=DEC) { return ( number("%llu", v) ); };
+  size_t print(double v, int digits=2) { char b[64]; snprintf(b, sizeof(b), "%.*f", digits, v); return ( write(b) ); };
+  size_t println() { return ( write("\r\n") ); };
+  template <class T> size_t println(T v) { size_t n = print(v); return ( n + println() ); };
+  template <class T> size_t println(T v, int d) { size_t n = print(v, d); return ( n + println() ); };
+protected:
+  template <class T> size_t number(const char *fmt, T v) { char b[32]; snprintf(b, sizeof(b), fmt, v); return ( write(b) ); };
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() { return ( 0 ); };
+  virtual int read() { return ( -1 ); };
+};
+
+// No host port, so output rings fill and drop, unless a tool sets open.  Then it takes up to room
+// bytes, as USB would between loop passes, and keeps them in out.
+class HostSerial : public Stream
+{
+public:
+  HostSerial() : open(false), room(0) {};
+  using Print::write;
+  int availableForWrite() { return ( open ? room : 0 ); };
+  size_t write(uint8_t c) { return ( write(&c, 1) ); };
+  size_t write(const uint8_t *buf, size_t n)
+  {
+    if ( !open ) return ( 0 );
+    n = min(n, size_t(max(room, 0)));
+    out.append((const char *)buf, n);
+    room -= int(n);
+    return ( n );
+  };
+  operator bool() { return ( open ); };
+  boolean open;
+  int room;
+  std::string out;
+};
+extern HostSerial Serial;
+
+#include "sam.h"
+
+#endif
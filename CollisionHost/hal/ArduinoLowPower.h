@@ -0,0 +1,42 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Host stand-in for standby.  A sleep stops micros() and millis(), as standby stops SysTick on the
+// SAMD21, so it adds to slept_us rather than host_us; device time (Wire.h) runs on through it.
+
+#ifndef _HAL_LOWPOWER_H
+#define _HAL_LOWPOWER_H
+
+#include <Arduino.h>
+
+class ArduinoLowPowerClass
+{
+public:
+  ArduinoLowPowerClass() : slept_us(0ULL), sleeps(0) {};
+  void sleep(const uint32_t ms) { slept_us += ms * 1000ULL; sleeps++; };
+  unsigned long long slept_us;      // Time in standby, that micros() did not count
+  uint32_t sleeps;
+};
+extern ArduinoLowPowerClass LowPower;
+
+#endif
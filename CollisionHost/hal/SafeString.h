@@ -0,0 +1,50 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Host stand-in for the parts of SafeString the firmware core uses:  cSF() buffers, assignment,
+// c_str() and printing.
+
+#ifndef _HAL_SAFESTRING_H
+#define _HAL_SAFESTRING_H
+
+#include <Arduino.h>
+
+class SafeString : public Print
+{
+public:
+  SafeString(const size_t cap, char *buf, const char *init) : buf_(buf), cap_(cap), len_(0) { buf_[0] = '\0'; write(init); };
+  using Print::write;
+  size_t write(uint8_t c) { if ( len_ >= cap_ ) return ( 0 ); buf_[len_++] = c; buf_[len_] = '\0'; return ( 1 ); };
+  SafeString &operator=(const char *s) { len_ = 0; buf_[0] = '\0'; write(s); return ( *this ); };
+  SafeString &operator+=(const char *s) { write(s); return ( *this ); };
+  const char *c_str() const { return ( buf_ ); };
+  size_t length() const { return ( len_ ); };
+  operator const char *() const { return ( buf_ ); };
+protected:
+  char *buf_;
+  size_t cap_;
+  size_t len_;
+};
+#define cSF(name, size, ...) char name##_SAFEBUFFER[(size)+1]; SafeString name(size, name##_SAFEBUFFER, "" __VA_ARGS__)
+
+#endif
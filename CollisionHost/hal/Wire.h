@@ -0,0 +1,74 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Host stand-in for the I2C bus with the LSM6DS3 registers Power drives behind it (Collision/Power.cpp).
+// Registers read back what was written, auto incrementing as the part does, except:  the 24 bit
+// timestamp counts 6400 us ticks of device time, which is host_us plus the time in standby
+// (ArduinoLowPower.h), and WAKE_UP_SRC reports motion while moving is set.  In continuous mode
+// (FIFO_CTRL5) the FIFO fills at 104 Hz of device time with frames of a still board, gyro then accel
+// words as FIFO_CTRL3 asks, each x and y word holding the frame number's low and next four bits so a
+// reader can check the order.  When full the oldest word goes, so an overrun leaves a partial frame
+// at the head, as on the part; FIFO_STATUS3 says which word of a frame is next.
+
+#ifndef _HAL_WIRE_H
+#define _HAL_WIRE_H
+
+#include <Arduino.h>
+
+#define HOST_IMU_ADDR         0x6A
+#define HOST_IMU_REGS          128
+#define HOST_FIFO_WORDS       2048      // 4 kB
+
+class TwoWire
+{
+public:
+  TwoWire();
+  int available() { return ( int( n_ - k_ ) ); };
+  void beginTransmission(const int addr);
+  uint8_t endTransmission(const bool stop=true);
+  int read();
+  uint8_t requestFrom(const int addr, const int n);
+  size_t write(const uint8_t b);
+  bool moving;                      // Motion past the wake-up threshold, latched in WAKE_UP_SRC
+  uint8_t reg[HOST_IMU_REGS];
+  unsigned long long fifo_t0;       // Device time the FIFO started filling, us
+  uint32_t fifo_written;            // Frames written since
+protected:
+  int addr_;
+  int sent_;                        // Bytes written since beginTransmission
+  uint8_t at_;                      // Register pointer
+  uint8_t rx_[8];
+  int n_;
+  int k_;
+  int16_t fifo_[HOST_FIFO_WORDS];
+  uint8_t pattern_[HOST_FIFO_WORDS];  // Word of its frame
+  int head_;                        // Oldest word
+  int words_;
+  int16_t out_;                     // Word being read
+  void fill();
+  uint8_t get(const uint8_t r);
+  void push(const int16_t w, const uint8_t pattern);
+};
+extern TwoWire Wire;
+
+#endif
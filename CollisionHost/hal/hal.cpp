@@ -0,0 +1,51 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Host stand-in globals.  The Tx rings fill and drop unless a tool opens Serial (Arduino.h).
+
+#include <Arduino.h>
+#include <Arduino_LSM6DS3.h>
+#include "TxQueue.h"
+#include <chrono>
+
+HostSerial Serial;
+LSM6DS3Class IMU;
+static uint8_t data_ring[TX_DATA_BYTES];
+static uint8_t text_ring[TX_TEXT_BYTES];
+TxPort Data(data_ring, TX_DATA_BYTES);
+TxPort Text(text_ring, TX_TEXT_BYTES);
+TxQueue Tx(&Data, &Text);
+time_t time_initial = 0;
+
+boolean host_virtual = false;
+unsigned long long host_us = 0ULL;
+
+unsigned long millis() { return ( host_virtual ? (unsigned long)( host_us / 1000ULL ) : 0UL ); }
+// The host clock, for the loop probes (Probe.h), or the virtual one
+unsigned long micros()
+{
+  if ( host_virtual ) return ( (unsigned long)host_us );
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return ( std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() );
+}
+void delay(unsigned long ms) {}
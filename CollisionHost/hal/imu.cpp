@@ -0,0 +1,153 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// The I2C and standby models (Wire.h, ArduinoLowPower.h)
+
+#include <ArduinoLowPower.h>
+#include <Wire.h>
+
+#define FIFO_CTRL3            0x08
+#define FIFO_CTRL5            0x0A
+#define WAKE_UP_SRC           0x1B
+#define FIFO_STATUS1          0x3A
+#define FIFO_STATUS2          0x3B
+#define FIFO_STATUS3          0x3C
+#define FIFO_DATA_OUT_L       0x3E
+#define FIFO_DATA_OUT_H       0x3F
+#define TIMESTAMP0            0x40
+#define WU_IA                 0x08
+#define FIFO_FULL_OVER        0x60      // FIFO_STATUS2 full and overrun
+#define TICK_US               6400ULL
+#define ODR_US                9615ULL   // 104 Hz
+#define ONE_G                 8192      // At 4 g full scale
+
+ArduinoLowPowerClass LowPower;
+TwoWire Wire;
+
+TwoWire::TwoWire()
+  : moving(false), fifo_t0(0ULL), fifo_written(0), addr_(0), sent_(0), at_(0), n_(0), k_(0), head_(0), words_(0), out_(0)
+{
+  memset(reg, 0, sizeof(reg));
+}
+
+void TwoWire::beginTransmission(const int addr)
+{
+  addr_ = addr;
+  sent_ = 0;
+}
+
+// Nack anything but the IMU
+uint8_t TwoWire::endTransmission(const bool stop)
+{
+  return ( addr_ == HOST_IMU_ADDR ? 0 : 2 );
+}
+
+// Device time, us
+static unsigned long long device_us()
+{
+  return ( host_us + LowPower.slept_us );
+}
+
+// The frames due since the last look.  After a long nap only the ones that can still be in it.
+void TwoWire::fill()
+{
+  if ( ( reg[FIFO_CTRL5] & 0x07 ) != 0x06 ) return;
+  boolean gyro = ( reg[FIFO_CTRL3] >> 3 ) & 0x07;
+  boolean acc = reg[FIFO_CTRL3] & 0x07;
+  unsigned long long due = ( device_us() - fifo_t0 ) / ODR_US;
+  if ( due > fifo_written + HOST_FIFO_WORDS ) fifo_written = uint32_t( due - HOST_FIFO_WORDS );
+  for ( ; fifo_written < due; fifo_written++ )
+  {
+    int16_t lo = int16_t( fifo_written & 0x0F ), hi = int16_t( ( fifo_written >> 4 ) & 0x0F );
+    uint8_t k = 0;
+    if ( gyro ) { push(lo, k++); push(hi, k++); push(0, k++); }
+    if ( acc ) { push(lo, k++); push(hi, k++); push(ONE_G, k++); }
+  }
+}
+
+// One word in, the oldest out when full
+void TwoWire::push(const int16_t w, const uint8_t pattern)
+{
+  if ( words_ == HOST_FIFO_WORDS )
+  {
+    head_ = ( head_ + 1 ) % HOST_FIFO_WORDS;
+    words_--;
+  }
+  int at = ( head_ + words_++ ) % HOST_FIFO_WORDS;
+  fifo_[at] = w;
+  pattern_[at] = pattern;
+}
+
+// Register r as read now
+uint8_t TwoWire::get(const uint8_t r)
+{
+  if ( r >= TIMESTAMP0 && r < TIMESTAMP0 + 3 )
+  {
+    unsigned long long ticks = ( host_us + LowPower.slept_us ) / TICK_US;
+    return ( uint8_t( ticks >> ( 8 * ( r - TIMESTAMP0 ) ) ) );
+  }
+  if ( r == WAKE_UP_SRC ) return ( moving ? WU_IA : 0 );
+  if ( r == FIFO_STATUS1 ) return ( uint8_t(words_) );
+  if ( r == FIFO_STATUS2 ) return ( uint8_t( ( words_ >> 8 ) | ( words_ == HOST_FIFO_WORDS ? FIFO_FULL_OVER : 0 ) ) );
+  if ( r == FIFO_STATUS3 ) return ( words_ ? pattern_[head_] : 0 );
+  if ( r == FIFO_DATA_OUT_L )
+  {
+    out_ = words_ ? fifo_[head_] : 0;
+    if ( words_ ) { head_ = ( head_ + 1 ) % HOST_FIFO_WORDS; words_--; }
+    return ( uint8_t(out_) );
+  }
+  if ( r == FIFO_DATA_OUT_H ) return ( uint8_t( out_ >> 8 ) );
+  return ( r < HOST_IMU_REGS ? reg[r] : 0 );
+}
+
+int TwoWire::read()
+{
+  return ( k_ < n_ ? rx_[k_++] : -1 );
+}
+
+uint8_t TwoWire::requestFrom(const int addr, const int n)
+{
+  n_ = k_ = 0;
+  if ( addr != HOST_IMU_ADDR ) return ( 0 );
+  fill();
+  for ( ; n_<n && n_<int(sizeof(rx_)); n_++ ) rx_[n_] = get(uint8_t(at_ + n_));
+  at_ += uint8_t(n_);
+  return ( uint8_t(n_) );
+}
+
+// First byte sets the register pointer, the rest write on from it
+size_t TwoWire::write(const uint8_t b)
+{
+  if ( sent_++ == 0 ) at_ = b;
+  else if ( at_ < HOST_IMU_REGS )
+  {
+    if ( at_ == FIFO_CTRL5 && ( b & 0x07 ) != ( reg[at_] & 0x07 ) )  // a mode change empties it
+    {
+      words_ = 0;
+      fifo_t0 = device_us();
+      fifo_written = 0;
+    }
+    reg[at_++] = b;
+  }
+  return ( 1 );
+}
@@ -0,0 +1,173 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// The NVM controller model (sam.h)
+
+#include <Arduino.h>
+
+HostNvm Nvm;
+static HostNvmctrl nvmctrl = { {}, {{1}}, {{3, 4096}}, {}, {}, {} };  // 64 byte pages, 256 kB
+HostNvmctrl *NVMCTRL = &nvmctrl;
+
+HostNvm::HostNvm()
+  : image_(NULL), bytes_(0), erase_us_(0), write_us_(0), fetch_stall_(true), busy_until_(0ULL), stalled_us_(0ULL), addr_(0),
+  status_(0), commands_(0), at_(0), cut_(0), cut_from_(0), cut_to_(0), cut_seen_(0), dead_(false), writes_(0), overwrites_(0)
+{}
+
+HostNvm::~HostNvm()
+{
+  free(image_);
+}
+
+// A fresh, erased part of bytes, a whole number of rows
+void HostNvm::begin(const uint32_t bytes, const unsigned long erase_us, const unsigned long write_us, const bool fetch_stall)
+{
+  free(image_);
+  bytes_ = ( bytes + HOST_NVM_ROW - 1 ) / HOST_NVM_ROW * HOST_NVM_ROW;
+  image_ = (uint8_t *)aligned_alloc(HOST_NVM_ROW, bytes_);
+  memset(image_, 0xFF, bytes_);
+  cells_.assign(bytes_, 0xFF);
+  erases_.assign(bytes_ / HOST_NVM_ROW, 0);
+  erase_us_ = erase_us;
+  write_us_ = write_us;
+  fetch_stall_ = fetch_stall;
+  busy_until_ = host_us;
+  stalled_us_ = 0ULL;
+  status_ = 0;
+  commands_ = 0;
+  at_ = 0;
+  cut_ = 0;
+  dead_ = false;
+  writes_ = 0;
+  overwrites_ = 0;
+}
+
+// One command.  A command power fails in does half its work.
+void HostNvm::command(const uint32_t v)
+{
+  if ( ( v & 0xFF00 ) != NVMCTRL_CTRLA_CMDEX_KEY )
+  {
+    status_ |= NVMCTRL_STATUS_PROGE;
+    return;
+  }
+  if ( dead_ ) return;
+  uint8_t cmd = uint8_t(v & 0x7F);
+  if ( cmd == NVMCTRL_CTRLA_CMD_PBC )
+  {
+    memcpy(image_, cells_.data(), bytes_);
+    return;
+  }
+  if ( cmd != NVMCTRL_CTRLA_CMD_ER && cmd != NVMCTRL_CTRLA_CMD_WP ) return;
+  commands_++;
+  bool cut;
+  if ( cmd == NVMCTRL_CTRLA_CMD_ER )
+  {
+    uint32_t off;
+    if ( !row_of(&off) ) return;
+    at_ = off;
+    cut = hit();
+    memset(&cells_[off], 0xFF, cut ? HOST_NVM_ROW/2 : HOST_NVM_ROW);
+    memset(image_ + off, 0xFF, HOST_NVM_ROW);
+    erases_[off / HOST_NVM_ROW]++;
+    busy_until_ = host_us + erase_us_;
+  }
+  else
+  {
+    // The page buffer holds whatever pages were loaded since the last PBC or WP
+    uint32_t p = 0;
+    while ( p < bytes_ && !memcmp(image_ + p, &cells_[p], HOST_NVM_PAGE) ) p += HOST_NVM_PAGE;
+    at_ = p;
+    cut = hit();
+    for ( ; p<bytes_; p+=HOST_NVM_PAGE )
+    {
+      if ( !memcmp(image_ + p, &cells_[p], HOST_NVM_PAGE) ) continue;
+      uint32_t n = cut ? HOST_NVM_PAGE/2 : HOST_NVM_PAGE;
+      for ( uint32_t k=0; k<n; k++ )
+      {
+        if ( image_[p+k] & ~cells_[p+k] ) overwrites_++;
+        cells_[p+k] &= image_[p+k];
+      }
+      writes_++;
+    }
+    busy_until_ = host_us + write_us_;
+  }
+  if ( cut )
+  {
+    dead_ = true;
+    busy_until_ = host_us;
+    memcpy(image_, cells_.data(), bytes_);
+    return;
+  }
+  if ( fetch_stall_ ) wait();
+}
+
+// Power fails during the nth command from now that lands in [from, to)
+void HostNvm::cut(const uint32_t n, const uint32_t from, const uint32_t to)
+{
+  cut_ = n;
+  cut_from_ = from;
+  cut_to_ = to;
+  cut_seen_ = 0;
+}
+
+// The command just issued is the one power fails in
+bool HostNvm::hit()
+{
+  if ( !cut_ || at_ < cut_from_ || at_ >= cut_to_ ) return ( false );
+  return ( ++cut_seen_ == cut_ );
+}
+
+// Power back on:  what was loaded and not programmed is gone and NVM is idle
+void HostNvm::power_cycle()
+{
+  memcpy(image_, cells_.data(), bytes_);
+  dead_ = false;
+  cut_ = 0;
+  busy_until_ = host_us;
+  status_ = 0;
+}
+
+// INTFLAG.READY.  A poll that finds NVM busy takes a us.
+bool HostNvm::ready()
+{
+  if ( host_us >= busy_until_ ) return ( true );
+  host_us++;
+  return ( false );
+}
+
+// Row offset of ADDR, false with NVME set when it is outside the part
+bool HostNvm::row_of(uint32_t *off)
+{
+  *off = ( addr_ * 2 - uint32_t(uintptr_t(image_)) ) / HOST_NVM_ROW * HOST_NVM_ROW;
+  if ( *off < bytes_ ) return ( true );
+  status_ |= NVMCTRL_STATUS_NVME;
+  return ( false );
+}
+
+// The CPU stalls until NVM is done
+void HostNvm::wait()
+{
+  if ( host_us >= busy_until_ ) return;
+  stalled_us_ += busy_until_ - host_us;
+  host_us = busy_until_;
+}
@@ -0,0 +1,123 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Host stand-in for the SAMD21 NVM controller, the NVMCTRL registers FlashStorage and FlashWriter
+// drive.  Commands act on a flash image owned by the model, with row erase and page write times on
+// the virtual clock (Arduino.h host_us).  Writes into the image stand for page buffer loads:  WP
+// programs what was loaded, ANDing it into the page as flash does, and PBC throws it away.  With
+// fetch_stall the CPU waits out each erase and write, as the M0+ does fetching code from flash while
+// NVM is busy; without it READY polls cost 1 us each, as code run from ram would see.  Rows count
+// their erases, and power can be cut partway through a chosen command.  poke() changes flash behind
+// the controller's back, for stray writes and bit rot.
+
+#ifndef _HAL_SAM_H
+#define _HAL_SAM_H
+
+#include <stdint.h>
+#include <vector>
+
+#define NVMCTRL_CTRLA_CMDEX_KEY 0xA500
+#define NVMCTRL_CTRLA_CMD_ER      0x02
+#define NVMCTRL_CTRLA_CMD_WP      0x04
+#define NVMCTRL_CTRLA_CMD_PBC     0x44
+#define NVMCTRL_STATUS_PROGE    0x0004
+#define NVMCTRL_STATUS_LOCKE    0x0008
+#define NVMCTRL_STATUS_NVME     0x0010
+#define NVMCTRL_STATUS_MASK     0x011E
+#define HOST_NVM_PAGE               64      // SAMD21G18 page, bytes
+#define HOST_NVM_ROW   ( 4*HOST_NVM_PAGE )
+
+class HostNvm
+{
+public:
+  HostNvm();
+  ~HostNvm();
+  uint32_t at() { return ( at_ ); };  // image offset of the last row erased or page written
+  void begin(const uint32_t bytes, const unsigned long erase_us=6000, const unsigned long write_us=2500, const bool fetch_stall=true);
+  uint32_t bytes() { return ( bytes_ ); };
+  uint32_t commands() { return ( commands_ ); };
+  void cut(const uint32_t n, const uint32_t from=0, const uint32_t to=0xFFFFFFFF);
+  bool dead() { return ( dead_ ); };
+  uint32_t erases(const uint32_t row) { return ( erases_[row] ); };
+  uint8_t *flash() { return ( image_ ); };
+  uint32_t overwrites() { return ( overwrites_ ); };
+  void poke(const uint32_t off, const uint8_t v) { cells_[off] = v; image_[off] = v; };
+  void power_cycle();
+  uint32_t rows() { return ( bytes_ / HOST_NVM_ROW ); };
+  unsigned long long stalled_us() { return ( stalled_us_ ); };
+  uint32_t writes() { return ( writes_ ); };
+  // Register side
+  void address(const uint32_t v) { addr_ = v; };
+  void clear(const uint16_t mask) { status_ &= uint16_t(~mask); };
+  void command(const uint32_t v);
+  bool ready();
+  uint16_t status() { return ( status_ ); };
+protected:
+  bool hit();
+  bool row_of(uint32_t *off);
+  void wait();
+  uint8_t *image_;                  // What the CPU reads, and page buffer loads not yet programmed
+  std::vector<uint8_t> cells_;      // What flash holds
+  std::vector<uint32_t> erases_;    // Per row
+  uint32_t bytes_;
+  unsigned long erase_us_;
+  unsigned long write_us_;
+  bool fetch_stall_;
+  unsigned long long busy_until_;
+  unsigned long long stalled_us_;   // CPU time lost waiting on NVM
+  uint32_t addr_;                   // ADDR, a 16-bit word address
+  uint16_t status_;
+  uint32_t commands_;
+  uint32_t at_;
+  uint32_t cut_;                    // Power fails in the cut_th command landing in [cut_from_, cut_to_), 0 never
+  uint32_t cut_from_;
+  uint32_t cut_to_;
+  uint32_t cut_seen_;
+  bool dead_;
+  uint32_t writes_;
+  uint32_t overwrites_;             // Page writes that tried to set a programmed bit
+};
+extern HostNvm Nvm;
+
+// Registers, each access going to the model
+struct HostNvmCommand { HostNvmCommand &operator=(const uint32_t v) { Nvm.command(v); return ( *this ); }; };
+struct HostNvmAddress { HostNvmAddress &operator=(const uint32_t v) { Nvm.address(v); return ( *this ); }; };
+struct HostNvmReady { operator bool() const { return ( Nvm.ready() ); }; };
+template <uint16_t M> struct HostNvmFlag { operator bool() const { return ( Nvm.status() & M ); }; };
+struct HostNvmStatus { HostNvmStatus &operator|=(const uint16_t m) { Nvm.clear(m); return ( *this ); }; };
+struct HostNvmctrl
+{
+  struct { HostNvmCommand reg; } CTRLA;
+  struct { struct { uint32_t MANW:1; } bit; } CTRLB;
+  struct { struct { uint32_t PSZ:3; uint32_t NVMP:16; } bit; } PARAM;
+  struct { struct { HostNvmReady READY; } bit; } INTFLAG;
+  struct
+  {
+    struct { HostNvmFlag<NVMCTRL_STATUS_PROGE> PROGE; HostNvmFlag<NVMCTRL_STATUS_LOCKE> LOCKE; HostNvmFlag<NVMCTRL_STATUS_NVME> NVME; } bit;
+    HostNvmStatus reg;
+  } STATUS;
+  struct { HostNvmAddress reg; } ADDR;
+};
+extern HostNvmctrl *NVMCTRL;
+
+#endif
@@ -0,0 +1,187 @@
+// MIT License
+//
+// Copyright (C) 2024 - Dave Gutz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+// Host decoder for the binary telemetry stream (CollTelem, 'tc'/'td'/'tg' commands).  Starts the
+// stream, splits the COBS framed packets, checks their crc and writes one CSV row per data frame in
+// engineering units, with a fresh column header whenever the channel mask changes.  Stops the
+// stream after the given seconds.  A file, e.g. a saved capture, is decoded as is.
+//
+// Build:  g++ -O2 -std=c++11 -I../Collision -o telem_csv telem_csv.cpp
+// Use:    telem_csv /dev/ttyACM0 [seconds] > telem.csv
+
+#include "CollFormat.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+static double now_s()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ( tv.tv_sec + tv.tv_usec * 1e-6 );
+}
+
+static int open_port(const char *path, bool *tty)
+{
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if ( fd < 0 ) fd = open(path, O_RDONLY);
+  if ( fd < 0 ) return ( -1 );
+  struct termios t;
+  *tty = tcgetattr(fd, &t) == 0;
+  if ( *tty )
+  {
+    cfmakeraw(&t);
+    cfsetspeed(&t, B115200);  // ignored by USB CDC
+    t.c_cc[VMIN] = 0;
+    t.c_cc[VTIME] = 1;        // 0.1 s read timeout
+    tcsetattr(fd, TCSANOW, &t);
+  }
+  return ( fd );
+}
+
+static void command(int fd, const char *cmd)
+{
+  char line[32];
+  int n = snprintf(line, sizeof(line), "%s\n", cmd);
+  if ( write(fd, line, n) != n ) perror("write");
+}
+
+int main(int argc, char **argv)
+{
+  if ( argc < 2 )
+  {
+    fprintf(stderr, "usage: %s <port|capture> [seconds]\n", argv[0]);
+    return ( 2 );
+  }
+  bool tty = false;
+  int fd = open_port(argv[1], &tty);
+  if ( fd < 0 )
+  {
+    fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+    return ( 1 );
+  }
+  double seconds = argc > 2 ? atof(argv[2]) : 10.;
+
+  std::vector<uint8_t> frame;
+  uint8_t raw[TELEM_FRAME_MAX];
+  TelemHead head;
+  memset(&head, 0, sizeof(head));
+  bool have_head = false;
+  uint32_t mask_shown = 0;
+  int expect = -1;          // seq of the next data frame
+  unsigned long rows = 0, heads = 0, bad = 0, lost = 0, junk = 0, bytes = 0;
+  double t0 = now_s();
+  if ( tty ) command(fd, "tg");
+
+  while ( !tty || now_s() - t0 < seconds )
+  {
+    uint8_t buf[512];
+    ssize_t got = read(fd, buf, sizeof(buf));
+    if ( got < 0 && errno != EINTR )
+    {
+      perror("read");
+      return ( 1 );
+    }
+    if ( got == 0 && !tty ) break;  // end of capture
+    if ( got <= 0 ) continue;
+    bytes += got;
+
+    for ( ssize_t b=0; b<got; b++ )
+    {
+      if ( buf[b] )
+      {
+        if ( frame.size() < TELEM_FRAME_MAX ) frame.push_back(buf[b]);
+        else junk++;  // echoed text or noise; the crc rejects what is left
+        continue;
+      }
+      if ( frame.empty() ) continue;  // back to back delimiters
+      uint16_t n = cobs_decode(frame.data(), uint16_t(frame.size()), raw);
+      frame.clear();
+      if ( n < sizeof(TelemData) + 2 )
+      {
+        bad++;
+        continue;
+      }
+      uint16_t crc = uint16_t(raw[n-2]) | uint16_t(raw[n-1]) << 8;
+      if ( crc16_update(0xFFFF, raw, n - 2) != crc )
+      {
+        bad++;
+        continue;
+      }
+      n -= 2;
+
+      if ( raw[0] == TELEM_HEAD && n == sizeof(TelemHead) )
+      {
+        memcpy(&head, raw, sizeof(head));
+        if ( expect >= 0 ) lost += uint16_t(head.seq - expect);
+        expect = head.seq;
+        have_head = true;
+        heads++;
+        if ( head.mask != mask_shown || !rows )
+        {
+          printf("t_ms,seq");
+          for ( int c=0; c<TELEM_CHANNELS; c++ ) if ( head.mask & (1UL << c) ) printf(",%s", telem_channels[c].name);
+          printf("\n");
+          mask_shown = head.mask;
+        }
+        continue;
+      }
+      if ( raw[0] != TELEM_DATA || !have_head ) continue;  // download packets, or joined mid stream
+      TelemData d;
+      memcpy(&d, raw, sizeof(d));
+      if ( n != sizeof(TelemData) + 2*d.n )
+      {
+        bad++;
+        continue;
+      }
+      lost += uint16_t(d.seq - expect);
+      expect = uint16_t(d.seq + 1);
+      printf("%llu,%u", (unsigned long long)( head.t_ms + d.dt_ms ), d.seq);
+      const uint8_t *p = raw + sizeof(TelemData);
+      for ( int c=0; c<TELEM_CHANNELS; c++ )
+      {
+        if ( !( head.mask & (1UL << c) ) ) continue;
+        int16_t v;
+        memcpy(&v, p, 2);
+        p += 2;
+        uint8_t kind = telem_channels[c].kind;
+        if ( kind == TELEM_BITS ) printf(",%d", v);
+        else printf(",%.6g", v / head.scale[kind]);
+      }
+      printf("\n");
+      rows++;
+    }
+  }
+  if ( tty ) command(fd, "tx");
+  double dt = now_s() - t0;
+  fprintf(stderr, "%lu rows, %lu headers in %.3f s (%.0f rows/s, %.0f B/s); lost %lu bad %lu junk %lu\n",
+    rows, heads, dt, rows / dt, bytes / dt, lost, bad, junk);
+  return ( 0 );
+}